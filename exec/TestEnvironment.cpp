@@ -35,7 +35,7 @@ constexpr uint64_t F64_NAN_BIT = 0x0008000000000000ULL;
 constexpr uint64_t F64_NAN = F64_NAN_BASE | F64_NAN_BIT;
 constexpr uint64_t F64_NAN_NEG = F64_NAN | F64_NEG;
 
-static Result spectest_print(const Thread *thread, const HostFunc * func, Value* buffer) {
+static Result spectest_print(Thread *thread, const HostFunc * func, Value* buffer) {
 	auto ptr = buffer[0].i32;
 
 	if (auto mem = (const char *)thread->GetMemory(0, ptr)) {
@@ -51,19 +51,24 @@ static bool compare_value(const TypedValue &tval, const Value &val) {
 	case Type::I64: return tval.value.i64 == val.i64; break;
 	case Type::F32: return tval.value.f32_bits == val.f32_bits; break;
 	case Type::F64: return tval.value.f64_bits == val.f64_bits; break;
+	case Type::V128: return tval.value.v128_bits.lo == val.v128_bits.lo && tval.value.v128_bits.hi == val.v128_bits.hi; break;
 	case Type::Any: return true; break;
 	default: return false; break;
 	}
 	return false;
 }
 
-static bool assert_return(ThreadedRuntime &runtime, std::ostream &stream, StringView module, StringView func, Vector<Value> &buf, TypedValue ret) {
+static bool assert_return(ThreadedRuntime &runtime, std::ostream &stream, StringView module, StringView func, Vector<Value> &buf, const Vector<TypedValue> &ret) {
 	if (auto fn = runtime.getExportFunc(module, func)) {
 		//fn->printInfo(std::cout);
-		if (runtime.call(*fn, buf.data())) {
+		if (runtime.call(*fn, buf)) {
 
 			//stream << "ret: f32 " << buf.front().asFloat() << " ";
-			if (compare_value(ret, buf.front())) {
+			bool success = ret.size() == fn->sig->results.size();
+			for (size_t i = 0; success && i < ret.size(); ++ i) {
+				success = compare_value(ret[i], buf[i]);
+			}
+			if (success) {
 				stream << "\"" << module << "\".\"" << func << "\": assert_return success\n";
 				return true;
 			}
@@ -157,7 +162,7 @@ TestEnvironment *TestEnvironment::getInstance() {
 TestEnvironment::TestEnvironment() {
 	_testModule = makeHostModule("spectest");
 
-	_testModule->addFunc("print", { Type::I32 }, {}, &spectest_print, this);
+	_testModule->addFunc("print", &spectest_print, { Type::I32 }, {}, this);
 }
 
 bool TestEnvironment::run() {
@@ -287,10 +292,10 @@ static StringView read_invoke(const sexpr::Token &invoke, Vector<Value> &buf) {
 
 static bool run_assert_return(wasm::ThreadedRuntime &runtime, std::ostream &stream, StringView name, const sexpr::Token &token) {
 	Vector<Value> buf;
-	TypedValue result(Type::Any);
+	Vector<TypedValue> result;
 	StringView funcName = read_invoke(token.vec[1], buf);
-	if (token.vec.size() > 2) {
-		result = parse_return_value(token.vec[2]);
+	for (size_t i = 2; i < token.vec.size(); ++ i) {
+		result.emplace_back(parse_return_value(token.vec[i]));
 	}
 	if (!funcName.empty()) {
 		return assert_return(runtime, stream, name, funcName, buf, result);
@@ -339,6 +344,8 @@ static bool run_assert_trap(wasm::ThreadedRuntime &runtime, std::ostream &stream
 			expected = Thread::Result::TrapUndefinedTableIndex;
 		} else if (token.vec[2].token == "integer divide by zero") {
 			expected = Thread::Result::TrapIntegerDivideByZero;
+		} else if (token.vec[2].token == "atomic memory access is unaligned") {
+			expected = Thread::Result::TrapAtomicMemoryAccessUnaligned;
 		} else {
 			stream << token.vec[2].token << "\n";
 			return false;
@@ -21,20 +21,24 @@
 #include <string.h>
 #include <ftw.h>
 #include <dirent.h>
+#include <malloc.h>
 
 #include <iostream>
+#include <algorithm>
 #include "TestEnvironment.h"
+#include "PooledRuntime.h"
+#include "tests/RuntimeTests.h"
 
 namespace wasm {
 
 namespace host {
 
-Result do_decrement(const Thread *thread, const HostFunc * func, Value* buffer) {
+Result do_decrement(Thread *thread, const HostFunc * func, Value* buffer) {
 	-- buffer[0].i32;
 	return Result::Ok;
 }
 
-Result do_increment(const Thread *thread, const HostFunc * func, Value* buffer) {
+Result do_increment(Thread *thread, const HostFunc * func, Value* buffer) {
 	++ buffer[0].i32;
 	return Result::Ok;
 }
@@ -43,14 +47,14 @@ Result do_increment(const Thread *thread, const HostFunc * func, Value* buffer)
 
 }
 
-void process_file_data(const char *filename, const uint8_t *data, size_t size) {
+void read_file(const char *filename) {
 	wasm::Environment env;
-	if (auto mod = env.loadModule("test", data, size)) {
+	if (auto mod = env.loadModuleFile("test", filename)) {
 		mod->printInfo(std::cout);
 
 		auto envMod = env.getEnvModule();
-		envMod->addFunc("do_decrement", { wasm::Type::I32 }, { wasm::Type::I32 }, &wasm::host::do_decrement);
-		envMod->addFunc("do_increment", { wasm::Type::I32 }, { wasm::Type::I32 }, &wasm::host::do_increment);
+		envMod->addFunc("do_decrement", &wasm::host::do_decrement, { wasm::Type::I32 }, { wasm::Type::I32 });
+		envMod->addFunc("do_increment", &wasm::host::do_increment, { wasm::Type::I32 }, { wasm::Type::I32 });
 
 		wasm::ThreadedRuntime runtime;
 		if (runtime.init(&env, wasm::LinkingThreadOptions())) {
@@ -67,25 +71,30 @@ void process_file_data(const char *filename, const uint8_t *data, size_t size) {
 	}
 }
 
-void read_file(const char *filename) {
+void read_file(const char *dirname, const char *filename) {
 	char buf[PATH_MAX + 1] = { 0 };
 
-	FILE *fp;
-	fp = fopen(filename, "r");
-	if (fp) {
-		fseek(fp, 0, SEEK_END);
-		long int size = ftell(fp);
-		fseek(fp, 0, SEEK_SET);
-		uint8_t buf[size];
-		if (fread(buf, size, 1, fp) == 1) {
-			process_file_data(filename, buf, size);
-		}
+	sprintf(buf, "%s/%s", dirname, filename);
 
-		fclose(fp);
-	}
+	wasm::StringView name(filename, strlen(filename) - 5);
+	//if (name == "endianness") {
+		wasm::ReadOptions opts;
+		opts.features.setBoundsCheckHoisting(true);
+		opts.features.setTailCallEnabled(true);
+		opts.features.setMultiValueEnabled(true);
+		opts.features.setBulkMemoryEnabled(true);
+		opts.features.setSimdEnabled(true);
+		opts.features.setThreadsEnabled(true);
+		if (auto mod = wasm::test::TestEnvironment::getInstance()->loadModuleFile(name, buf, opts)) {
+			//std::cout << "Module " << name << " loaded\n";
+			//mod->printInfo(std::cout);
+		} else {
+			//std::cout << "===== Fail to load module: " << name << " =====\n";
+		}
+	//}
 }
 
-void read_file(const char *dirname, const char *filename) {
+void read_assert(const char *dirname, const char *filename) {
 	char buf[PATH_MAX + 1] = { 0 };
 
 	FILE *fp;
@@ -95,43 +104,463 @@ void read_file(const char *dirname, const char *filename) {
 		fseek(fp, 0, SEEK_END);
 		long int size = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
-		uint8_t buf[size];
-		if (fread(buf, size, 1, fp) == 1) {
-			wasm::StringView name(filename, strlen(filename) - 5);
-			//if (name == "endianness") {
-				if (auto mod = wasm::test::TestEnvironment::getInstance()->loadModule(name, buf, size)) {
-					//std::cout << "Module " << name << " loaded\n";
-					//mod->printInfo(std::cout);
-				} else {
-					//std::cout << "===== Fail to load module: " << name << " =====\n";
-				}
-			//}
+		wasm::Vector<uint8_t> data(size);
+		if (fread(data.data(), size, 1, fp) == 1) {
+			wasm::StringView name(filename, strlen(filename) - 7);
+			if (wasm::test::TestEnvironment::getInstance()->loadAsserts(name, data.data(), size)) {
+				//std::cout << "Test asserts " << name << " loaded\n";
+			}
 		}
 
 		fclose(fp);
 	}
 }
 
-void read_assert(const char *dirname, const char *filename) {
-	char buf[PATH_MAX + 1] = { 0 };
+// synthetic load for PooledRuntime: `calls` short calls of export with single integer argument,
+// submitted in batches of `batch` calls; prints throughput and latency percentiles
+int bench_pool(const char *filename, const char *funcName, int64_t arg, uint32_t workers, uint32_t calls, uint32_t batch) {
+	wasm::ReadOptions opts;
+	opts.features.enableAll();
+	opts.features.setFuelMetering(false);
 
-	FILE *fp;
-	sprintf(buf, "%s/%s", dirname, filename);
-	fp = fopen(buf, "r");
-	if (fp) {
-		fseek(fp, 0, SEEK_END);
-		long int size = ftell(fp);
-		fseek(fp, 0, SEEK_SET);
-		uint8_t buf[size];
-		if (fread(buf, size, 1, fp) == 1) {
-			wasm::StringView name(filename, strlen(filename) - 7);
-			if (wasm::test::TestEnvironment::getInstance()->loadAsserts(name, buf, size)) {
-				//std::cout << "Test asserts " << name << " loaded\n";
+	wasm::Environment env;
+	if (!env.loadModuleFile("bench", filename, opts)) {
+		return -1;
+	}
+
+	wasm::PooledRuntimeOptions poolOpts;
+	poolOpts.workers = workers;
+
+	wasm::PooledRuntime runtime;
+	if (!runtime.init(&env, poolOpts)) {
+		return -1;
+	}
+
+	auto mod = runtime.getModule("bench");
+	auto func = runtime.getExportFunc("bench", funcName);
+	if (!mod || !func || func->sig->params.size() != 1) {
+		printf("no suitable export: %s\n", funcName);
+		return -1;
+	}
+
+	using Clock = std::chrono::steady_clock;
+
+	batch = std::max(batch, 1U);
+	wasm::Vector<double> latency(calls);
+	std::atomic<uint32_t> completed(0);
+	std::atomic<uint32_t> failed(0);
+
+	const auto start = Clock::now();
+	for (uint32_t i = 0; i < calls; i += batch) {
+		wasm::Vector<wasm::Vector<wasm::Value>> params(std::min(batch, calls - i));
+		for (auto &it : params) {
+			it.emplace_back(func->sig->params[0] == wasm::Type::I64 ? wasm::Value(uint64_t(arg)) : wasm::Value(uint32_t(arg)));
+		}
+
+		const auto submitted = Clock::now();
+		runtime.submit(*mod, *func, std::move(params), [&, i, submitted] (wasm::Index idx, wasm::PooledRuntime::CallResult &&ret) {
+			latency[i + idx] = std::chrono::duration<double, std::micro>(Clock::now() - submitted).count();
+			if (ret.result != wasm::Thread::Result::Ok && ret.result != wasm::Thread::Result::Returned) {
+				++ failed;
 			}
+			++ completed;
+		});
+	}
+
+	while (completed.load() < calls) {
+		std::this_thread::yield();
+	}
+
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	const uint32_t workersCount = runtime.getWorkersCount();
+	runtime.stop();
+
+	std::sort(latency.begin(), latency.end());
+	auto percentile = [&] (double p) { return calls ? latency[std::min(size_t(calls * p), size_t(calls - 1))] : 0.0; };
+
+	printf("workers: %u, calls: %u, batch: %u, failed: %u\n", workersCount, calls, batch, failed.load());
+	printf("throughput: %.0f calls/s\n", calls / seconds);
+	printf("latency: p50 %.1fus, p99 %.1fus, p999 %.1fus\n", percentile(0.5), percentile(0.99), percentile(0.999));
+	return 0;
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+// wall time of callback, in seconds
+template <typename Callback>
+static double bench_time(const Callback &cb) {
+	const auto start = BenchClock::now();
+	cb();
+	return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// (func $fib (param i32) (result i32)), recursive
+static wasm::test::ModuleBuilder::Code bench_fib(wasm::Index self) {
+	using wasm::Opcode;
+	wasm::test::ModuleBuilder::Code code;
+	code.op(Opcode::GetLocal, 0).i32(2).op(Opcode::I32LtU)
+	.block(Opcode::If, wasm::Type::I32)
+		.op(Opcode::GetLocal, 0)
+	.op(Opcode::Else)
+		.op(Opcode::GetLocal, 0).i32(1).op(Opcode::I32Sub).op(Opcode::Call, self)
+		.op(Opcode::GetLocal, 0).i32(2).op(Opcode::I32Sub).op(Opcode::Call, self)
+		.op(Opcode::I32Add)
+	.op(Opcode::End);
+	return code;
+}
+
+// countdown loop and recursive fib, loaded with and without fuel metering; runs of both modules
+// are interleaved, best of `runs` times is printed
+int bench_fuel(uint32_t iterations, uint32_t fib, uint32_t runs) {
+	wasm::test::ModuleBuilder builder;
+	auto type = builder.addType({ wasm::Type::I32 }, { wasm::Type::I32 });
+	builder.addFunc(type, wasm::test::makeCountdown(), "loop", { wasm::Type::I32 });
+	builder.addFunc(type, bench_fib(1), "fib");
+
+	wasm::Environment env[2];
+	wasm::ThreadedRuntime runtime[2];
+	for (int fuel = 0; fuel < 2; ++ fuel) {
+		wasm::ReadOptions opts;
+		opts.features.setFuelMetering(fuel != 0);
+		if (!builder.load(env[fuel], "bench", opts) || !runtime[fuel].init(&env[fuel])) {
+			return -1;
 		}
+	}
 
-		fclose(fp);
+	bool success = true;
+	auto call = [&] (int fuel, const char *name, uint32_t arg) {
+		return bench_time([&] {
+			wasm::Vector<wasm::Value> args{ wasm::Value(arg) };
+			auto func = runtime[fuel].getExportFunc("bench", name);
+			success = func && runtime[fuel].callSafe(*func, args) == wasm::Thread::Result::Ok && success;
+		});
+	};
+
+	double times[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };
+	for (uint32_t i = 0; i < std::max(runs, 1U); ++ i) {
+		for (int fuel = 0; fuel < 2; ++ fuel) {
+			const double loop = call(fuel, "loop", iterations);
+			const double fibTime = call(fuel, "fib", fib);
+			times[fuel][0] = (i == 0) ? loop : std::min(times[fuel][0], loop);
+			times[fuel][1] = (i == 0) ? fibTime : std::min(times[fuel][1], fibTime);
+		}
+	}
+
+	if (!success) {
+		printf("call failed\n");
+		return -1;
+	}
+
+	printf("loop(%u): %.3fs without fuel, %.3fs with fuel (%+.1f%%)\n", iterations,
+			times[0][0], times[1][0], (times[1][0] / times[0][0] - 1.0) * 100.0);
+	printf("fib(%u): %.3fs without fuel, %.3fs with fuel (%+.1f%%)\n", fib,
+			times[0][1], times[1][1], (times[1][1] / times[0][1] - 1.0) * 100.0);
+	return 0;
+}
+
+// loop of `body` for $i (local 1) from 0 to `end` with `step`
+static wasm::test::ModuleBuilder::Code bench_loop(uint32_t end, uint32_t step, const wasm::test::ModuleBuilder::Code &body) {
+	using wasm::Opcode;
+	wasm::test::ModuleBuilder::Code code;
+	code.block(Opcode::Block)
+		.block(Opcode::Loop)
+			.op(Opcode::GetLocal, 1).i32(end).op(Opcode::I32GeU).op(Opcode::BrIf, 1)
+			.append(body)
+			.op(Opcode::GetLocal, 1).i32(step).op(Opcode::I32Add).op(Opcode::SetLocal, 1)
+			.op(Opcode::Br, 0)
+		.op(Opcode::End)
+	.op(Opcode::End);
+	return code;
+}
+
+// saxpy (y = a * x + y, f32) over `elements` floats and 50% blend of two RGBA images of `elements` pixels,
+// as scalar and as SIMD wasm; both versions of kernel are checked for equal results, then runs of them
+// are interleaved, best of `runs` times for `passes` calls is printed
+int bench_simd(uint32_t elements, uint32_t passes, uint32_t runs) {
+	using wasm::Opcode;
+	using wasm::Type;
+	using Code = wasm::test::ModuleBuilder::Code;
+
+	elements = std::max(elements, 16U) / 16 * 16;
+	const uint32_t x = 0, y = elements * 4; // saxpy
+	const uint32_t a = 0, b = elements * 4, dst = elements * 8; // blend
+
+	wasm::test::ModuleBuilder builder;
+	builder.setMemory((elements * 12 + 0xFFFF) / 0x10000);
+	auto type = builder.addType({ Type::F32 }, { });
+
+	builder.addFunc(type, bench_loop(elements * 4, 4, Code()
+		.op(Opcode::GetLocal, 1)
+		.op(Opcode::GetLocal, 0).op(Opcode::GetLocal, 1).mem(Opcode::F32Load, x).op(Opcode::F32Mul)
+		.op(Opcode::GetLocal, 1).mem(Opcode::F32Load, y).op(Opcode::F32Add)
+		.mem(Opcode::F32Store, y)), "saxpy", { Type::I32 });
+
+	builder.addFunc(type, bench_loop(elements * 4, 16, Code()
+		.op(Opcode::GetLocal, 1)
+		.op(Opcode::GetLocal, 0).op(Opcode::F32X4Splat).op(Opcode::GetLocal, 1).mem(Opcode::V128Load, x).op(Opcode::F32X4Mul)
+		.op(Opcode::GetLocal, 1).mem(Opcode::V128Load, y).op(Opcode::F32X4Add)
+		.mem(Opcode::V128Store, y)), "saxpy_simd", { Type::I32 });
+
+	builder.addFunc(type, bench_loop(elements * 4, 1, Code()
+		.op(Opcode::GetLocal, 1)
+		.op(Opcode::GetLocal, 1).mem(Opcode::I32Load8U, a).op(Opcode::GetLocal, 1).mem(Opcode::I32Load8U, b)
+		.op(Opcode::I32Add).i32(1).op(Opcode::I32ShrU)
+		.mem(Opcode::I32Store8, dst)), "blend", { Type::I32 });
+
+	auto half = [] (Opcode extend) {
+		return Code().op(Opcode::GetLocal, 2).op(extend).op(Opcode::GetLocal, 3).op(extend)
+				.op(Opcode::I16X8Add).i32(1).op(Opcode::I16X8ShrU);
+	};
+	builder.addFunc(type, bench_loop(elements * 4, 16, Code()
+		.op(Opcode::GetLocal, 1).mem(Opcode::V128Load, a).op(Opcode::SetLocal, 2)
+		.op(Opcode::GetLocal, 1).mem(Opcode::V128Load, b).op(Opcode::SetLocal, 3)
+		.op(Opcode::GetLocal, 1)
+		.append(half(Opcode::I16X8ExtendLowI8X16U)).append(half(Opcode::I16X8ExtendHighI8X16U))
+		.op(Opcode::I8X16NarrowI16X8U)
+		.mem(Opcode::V128Store, dst)), "blend_simd", { Type::I32, Type::V128, Type::V128 });
+
+	wasm::ReadOptions opts;
+	opts.features.setSimdEnabled(true);
+
+	wasm::Environment env;
+	wasm::ThreadedRuntime runtime;
+	if (!builder.load(env, "bench", opts) || !runtime.init(&env)) {
+		return -1;
+	}
+
+	auto memory = runtime.getModule("bench")->memory[0];
+	auto fill = [&] {
+		uint32_t seed = 1;
+		for (uint32_t i = 0; i < elements * 12; ++ i) {
+			seed = seed * 1103515245 + 12345;
+			memory->data[i] = uint8_t(seed >> 16);
+		}
+		for (uint32_t i = 0; i < elements * 2; ++ i) {
+			const float value = float(i % 1000) / 8.0f;
+			memcpy(memory->data + i * 4, &value, sizeof(float));
+		}
+	};
+
+	bool success = true;
+	auto run = [&] (const char *name, uint32_t count) {
+		return bench_time([&] {
+			auto func = runtime.getExportFunc("bench", name);
+			for (uint32_t i = 0; i < count && func; ++ i) {
+				wasm::Vector<wasm::Value> args{ wasm::Value(2.5f) };
+				success = runtime.callSafe(*func, args) == wasm::Thread::Result::Ok && success;
+			}
+			success = func && success;
+		});
+	};
+
+	// kernels run in the same order on the same input, so memory after both versions should be equal
+	wasm::Vector<uint8_t> scalar;
+	fill();
+	run("saxpy", 1);
+	run("blend", 1);
+	scalar.assign(memory->data, memory->data + elements * 12);
+	fill();
+	run("saxpy_simd", 1);
+	run("blend_simd", 1);
+	if (!success || memcmp(scalar.data(), memory->data, elements * 12) != 0) {
+		printf("scalar and SIMD results differ\n");
+		return -1;
+	}
+
+	const char *names[4] = { "saxpy", "saxpy_simd", "blend", "blend_simd" };
+	double times[4] = { 0.0, 0.0, 0.0, 0.0 };
+	for (uint32_t i = 0; i < std::max(runs, 1U); ++ i) {
+		for (int k = 0; k < 4; ++ k) {
+			const double time = run(names[k], passes);
+			times[k] = (i == 0) ? time : std::min(times[k], time);
+		}
+	}
+
+	printf("saxpy, %u floats, %u passes: %.3fs scalar, %.3fs SIMD (x%.1f)\n", elements, passes,
+			times[0], times[1], times[0] / times[1]);
+	printf("RGBA blend, %u pixels, %u passes: %.3fs scalar, %.3fs SIMD (x%.1f)\n", elements, passes,
+			times[2], times[3], times[2] / times[3]);
+	return success ? 0 : -1;
+}
+
+// module with `functions` exported functions (param i32) (result i32) "f0", "f1"..., every with about
+// 100 instructions of arithmetic; with `callees`, "main" calls first `callees` of them
+static wasm::test::ModuleBuilder bench_module(uint32_t functions, uint32_t callees = 0) {
+	using wasm::Opcode;
+	wasm::test::ModuleBuilder builder;
+	auto type = builder.addType({ wasm::Type::I32 }, { wasm::Type::I32 });
+	for (uint32_t i = 0; i < functions; ++ i) {
+		wasm::test::ModuleBuilder::Code code;
+		code.op(Opcode::GetLocal, 0);
+		for (uint32_t j = 0; j < 25; ++ j) {
+			code.i32(i + j).op(Opcode::I32Add).i32(3).op(Opcode::I32Xor);
+		}
+		builder.addFunc(type, code, "f" + std::to_string(i));
+	}
+
+	if (callees) {
+		wasm::test::ModuleBuilder::Code code;
+		code.op(Opcode::GetLocal, 0);
+		for (uint32_t i = 0; i < std::min(callees, functions); ++ i) {
+			code.op(Opcode::Call, i);
+		}
+		builder.addFunc(type, code, "main");
+	}
+	return builder;
+}
+
+// eager load of module with `functions` bodies with ReadOptions::threads from 1 to `threads`, best of `runs` times
+int bench_load(uint32_t functions, uint32_t threads, uint32_t runs) {
+	auto binary = bench_module(functions).build();
+	printf("module: %u functions, %zu bytes\n", functions, binary.size());
+
+	double base = 0.0;
+	for (uint32_t t = 1; t <= std::max(threads, 1U); ++ t) {
+		wasm::ReadOptions opts;
+		opts.threads = t;
+
+		double best = 0.0;
+		for (uint32_t i = 0; i < std::max(runs, 1U); ++ i) {
+			wasm::Environment env;
+			bool success = false;
+			const double time = bench_time([&] { success = env.loadModule("bench", binary.data(), binary.size(), opts) != nullptr; });
+			if (!success) {
+				return -1;
+			}
+			best = (i == 0) ? time : std::min(best, time);
+		}
+		if (t == 1) {
+			base = best;
+		}
+		printf("threads: %u, load: %.1fms (x%.2f)\n", t, best * 1000.0, base / best);
+	}
+	return 0;
+}
+
+// memory of interpreter code of translated functions, same as CodeCache accounts it
+static size_t bench_code_size(const wasm::Module *mod) {
+	size_t ret = 0;
+	for (wasm::Index i = 0; auto func = mod->getFunc(i); ++ i) {
+		if (func->isTranslated()) {
+			ret += func->types.capacity() * sizeof(wasm::Type) + func->opcodes.capacity() * sizeof(wasm::Func::OpcodeRec);
+		}
+	}
+	return ret;
+}
+
+// eager and lazy load of module with `functions` bodies, then first call of function, that calls `callees` of them;
+// prints best of `runs` times and memory of translated code
+int bench_lazy(uint32_t functions, uint32_t callees, uint32_t runs) {
+	auto binary = bench_module(functions, callees).build();
+	printf("module: %u functions, %zu bytes, main calls %u\n", functions, binary.size(), callees);
+
+	for (int lazy = 0; lazy < 2; ++ lazy) {
+		wasm::ReadOptions opts;
+		opts.lazy = (lazy != 0);
+
+		double load = 0.0, call = 0.0;
+		size_t code = 0;
+		for (uint32_t i = 0; i < std::max(runs, 1U); ++ i) {
+			wasm::Environment env;
+			wasm::ThreadedRuntime runtime;
+			const wasm::Module *mod = nullptr;
+			const double loadTime = bench_time([&] { mod = env.loadModule("bench", binary.data(), binary.size(), opts); });
+			if (!mod || !runtime.init(&env)) {
+				return -1;
+			}
+
+			bool success = false;
+			const double callTime = bench_time([&] {
+				wasm::Vector<wasm::Value> args{ wasm::Value(uint32_t(1)) };
+				auto func = runtime.getExportFunc("bench", "main");
+				success = func && runtime.callSafe(*func, args) == wasm::Thread::Result::Ok;
+			});
+			if (!success) {
+				return -1;
+			}
+
+			load = (i == 0) ? loadTime : std::min(load, loadTime);
+			call = (i == 0) ? callTime : std::min(call, callTime);
+			code = bench_code_size(mod);
+		}
+
+		printf("%s: load %.1fms, first call %.2fms, code %.1f KiB\n", lazy ? "lazy" : "eager",
+				load * 1000.0, call * 1000.0, code / 1024.0);
 	}
+	return 0;
+}
+
+// bytes, allocated with malloc, including mmap-ed chunks
+static size_t bench_heap() {
+	auto info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+}
+
+// module with data segment of `size` bytes is loaded from file with Environment::loadModuleFile (mapping)
+// and from file buffer with Environment::loadModule; prints heap, used after load, and best of `runs` times
+int bench_file(uint32_t size, uint32_t runs) {
+	wasm::test::ModuleBuilder builder;
+	builder.setMemory((size + 0xFFFF) / 0x10000);
+	builder.addData(0, wasm::String(size, 'x'));
+	auto binary = builder.build();
+
+	char path[] = "/tmp/wasm-bench-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return -1;
+	}
+	const bool written = write(fd, binary.data(), binary.size()) == ssize_t(binary.size());
+	close(fd);
+	binary = wasm::Vector<uint8_t>();
+	if (!written) {
+		unlink(path);
+		return -1;
+	}
+
+	double times[2] = { 0.0, 0.0 };
+	size_t heap[3] = { 0, 0, 0 }; // mapped, buffer with module, module without buffer
+	bool success = true;
+	for (uint32_t i = 0; i < std::max(runs, 1U); ++ i) {
+		{
+			wasm::Environment env;
+			const size_t start = bench_heap();
+			const double time = bench_time([&] { success = env.loadModuleFile("bench", path) && success; });
+			heap[0] = bench_heap() - start;
+			times[0] = (i == 0) ? time : std::min(times[0], time);
+		}
+		{
+			wasm::Environment env;
+			const size_t start = bench_heap();
+			wasm::Vector<uint8_t> data;
+			const double time = bench_time([&] {
+				FILE *fp = fopen(path, "r");
+				if (!fp) {
+					success = false;
+					return;
+				}
+				fseek(fp, 0, SEEK_END);
+				data.resize(ftell(fp));
+				fseek(fp, 0, SEEK_SET);
+				success = fread(data.data(), data.size(), 1, fp) == 1 && success;
+				fclose(fp);
+				success = env.loadModule("bench", data.data(), data.size()) && success;
+			});
+			heap[1] = bench_heap() - start;
+			data = wasm::Vector<uint8_t>();
+			heap[2] = bench_heap() - start;
+			times[1] = (i == 0) ? time : std::min(times[1], time);
+		}
+	}
+	unlink(path);
+
+	if (!success) {
+		return -1;
+	}
+
+	printf("data segment: %u bytes\n", size);
+	printf("mapped file: load %.3fms, heap %zu bytes\n", times[0] * 1000.0, heap[0]);
+	printf("file buffer: load %.3fms, heap %zu bytes (%zu without buffer)\n", times[1] * 1000.0, heap[1], heap[2]);
+	return 0;
 }
 
 int main(int argc, char** argv) {
@@ -139,6 +568,42 @@ int main(int argc, char** argv) {
 
 	char *cwd = nullptr;
 
+	if (argc >= 5 && strcmp(argv[1], "--bench-pool") == 0) {
+		// --bench-pool <file.wasm> <export> <arg> [workers] [calls] [batch]
+		return bench_pool(argv[2], argv[3], strtoll(argv[4], nullptr, 0),
+				argc > 5 ? atoi(argv[5]) : 0, argc > 6 ? atoi(argv[6]) : 100000, argc > 7 ? atoi(argv[7]) : 1);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--bench-fuel") == 0) {
+		// --bench-fuel [iterations] [fib] [runs]
+		return bench_fuel(argc > 2 ? atoi(argv[2]) : 20000000, argc > 3 ? atoi(argv[3]) : 30, argc > 4 ? atoi(argv[4]) : 5);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--bench-simd") == 0) {
+		// --bench-simd [elements] [passes] [runs]
+		return bench_simd(argc > 2 ? atoi(argv[2]) : 4096, argc > 3 ? atoi(argv[3]) : 1000, argc > 4 ? atoi(argv[4]) : 5);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--bench-load") == 0) {
+		// --bench-load [functions] [threads] [runs]
+		return bench_load(argc > 2 ? atoi(argv[2]) : 20000, argc > 3 ? atoi(argv[3]) : 4, argc > 4 ? atoi(argv[4]) : 5);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--bench-lazy") == 0) {
+		// --bench-lazy [functions] [callees] [runs]
+		return bench_lazy(argc > 2 ? atoi(argv[2]) : 20000, argc > 3 ? atoi(argv[3]) : 100, argc > 4 ? atoi(argv[4]) : 5);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--bench-file") == 0) {
+		// --bench-file [size] [runs]
+		return bench_file(argc > 2 ? atoi(argv[2]) : 1024 * 1024, argc > 3 ? atoi(argv[3]) : 5);
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--runtime-tests") == 0) {
+		// --runtime-tests [filter]
+		return wasm::test::RuntimeTest::run(argc > 2 ? wasm::StringView(argv[2]) : wasm::StringView()) ? 0 : -1;
+	}
+
 	if (argc == 2) {
 		cwd = realpath(argv[1], buf);
 
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+
+namespace wasm {
+namespace test {
+
+// state, observed by host functions, while code of caller is evicted
+struct CacheHost {
+	CodeCache *cache = nullptr;
+	const Module *module = nullptr;
+	Index caller = kInvalidIndex;
+	CodeCache::Stats stats;
+	Func::State state = Func::State::Pending;
+};
+
+// evicts all code, while caller is executed
+static Result cache_evict(Thread *thread, const HostFunc *func, Value *buffer) {
+	auto host = (CacheHost *)func->ctx;
+	host->cache->setLimit(1);
+	host->cache->collect();
+	host->stats = host->cache->getStats();
+	host->state = getFuncState(host->module, host->caller);
+	return Result::Ok;
+}
+
+static Result cache_read(Thread *thread, const HostFunc *func, Value *buffer) {
+	return Result::Suspend;
+}
+
+// f0, f1, ... return argument; evict and read return result of host function plus one
+static const Module *loadCacheModule(ModuleBuilder &builder, Environment &env, CacheHost *host, Index funcs) {
+	env.getEnvModule()->addFunc("evict", &cache_evict, { Type::I32 }, { Type::I32 }, host);
+	env.getEnvModule()->addFunc("read", &cache_read, { Type::I32 }, { Type::I32 }, host);
+
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	auto evict = builder.addImport("env", "evict", type);
+	auto read = builder.addImport("env", "read", type);
+
+	auto filler = [] {
+		ModuleBuilder::Code code;
+		for (uint32_t i = 0; i < 100; ++ i) {
+			code.i32(1).op(Opcode::Drop);
+		}
+		return code;
+	};
+
+	for (Index i = 0; i < funcs; ++ i) {
+		builder.addFunc(type, filler().op(Opcode::GetLocal, 0), "f" + std::to_string(i));
+	}
+	builder.addFunc(type, filler().op(Opcode::GetLocal, 0).op(Opcode::Call, evict).i32(1).op(Opcode::I32Add), "evict");
+	builder.addFunc(type, filler().op(Opcode::GetLocal, 0).op(Opcode::Call, read).i32(1).op(Opcode::I32Add), "read");
+
+	ReadOptions opts;
+	opts.lazy = true;
+
+	auto mod = builder.load(env, "cache", opts);
+	if (mod) {
+		host->cache = env.getCodeCache();
+		host->module = mod;
+		host->caller = funcs;
+	}
+	return mod;
+}
+
+RUNTIME_TEST(CodeCacheEviction) {
+	CacheHost host;
+	ModuleBuilder builder;
+	Environment env;
+	auto cache = env.getCodeCache();
+	cache->setLimit(size_t(1) << 30);
+
+	auto mod = loadCacheModule(builder, env, &host, 16);
+	TEST_EXPECT(mod);
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	TEST_EXPECT(invoke(runtime, "cache", "f0", { Value(uint32_t(10)) }) == 10);
+	auto stats = cache->getStats();
+	TEST_EXPECT(stats.translations == 1 && stats.functions == 1 && stats.size > 0);
+
+	// limit for four functions, code of others is released after calls
+	const size_t size = stats.size;
+	cache->setLimit(size * 4);
+	for (Index i = 1; i < 16; ++ i) {
+		TEST_EXPECT(invoke(runtime, "cache", "f" + std::to_string(i), { Value(uint32_t(i)) }) == i);
+	}
+
+	stats = cache->getStats();
+	TEST_EXPECT(stats.translations == 16 && stats.retranslations == 0 && stats.evictions >= 12);
+	TEST_EXPECT(stats.evicting == 0 && stats.functions <= 4 && stats.size <= stats.limit);
+	TEST_EXPECT(stats.functions + stats.evicting + stats.evictions == stats.translations);
+	TEST_EXPECT(countFuncState(mod, Func::State::Pending, 16) == stats.evictions);
+
+	// evicted functions are translated again from module binary
+	for (Index i = 0; i < 16; ++ i) {
+		TEST_EXPECT(invoke(runtime, "cache", "f" + std::to_string(i), { Value(uint32_t(i + 100)) }) == i + 100);
+	}
+
+	stats = cache->getStats();
+	TEST_EXPECT(stats.retranslations >= 12 && stats.translations == 16 + stats.retranslations);
+	TEST_EXPECT(stats.functions + stats.evicting + stats.evictions == stats.translations);
+	TEST_EXPECT(stats.size <= stats.limit);
+	return true;
+}
+
+RUNTIME_TEST(CodeCacheRestore) {
+	CacheHost host;
+	ModuleBuilder builder;
+	Environment env;
+	auto cache = env.getCodeCache();
+	cache->setLimit(size_t(1) << 30);
+
+	auto mod = loadCacheModule(builder, env, &host, 4);
+	TEST_EXPECT(mod);
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+	for (Index i = 0; i < 4; ++ i) {
+		TEST_EXPECT(invoke(runtime, "cache", "f" + std::to_string(i), { Value(uint32_t(i)) }) == i);
+	}
+
+	// pinned reader holds evicted code; clock hand marks every function cold, then evicts first of them
+	CodeCache::Reader reader;
+	reader.pin(cache);
+
+	const size_t size = cache->getStats().size / 4;
+	cache->setLimit(size * 3 + size / 2);
+	TEST_EXPECT(countFuncState(mod, Func::State::Cold, 4) == 3 && countFuncState(mod, Func::State::Evicting, 4) == 1);
+
+	auto stats = cache->getStats();
+	TEST_EXPECT(stats.functions == 3 && stats.evicting == 1 && stats.evictions == 0);
+
+	// call of cold or evicting function makes it hot again without translation
+	for (Index i = 0; i < 4; ++ i) {
+		TEST_EXPECT(invoke(runtime, "cache", "f" + std::to_string(i), { Value(uint32_t(i + 10)) }) == i + 10);
+	}
+	TEST_EXPECT(countFuncState(mod, Func::State::Ready, 4) == 4);
+
+	stats = cache->getStats();
+	TEST_EXPECT(stats.translations == 4 && stats.retranslations == 0 && stats.evictions == 0);
+
+	reader.unpin();
+	cache->collect();
+	TEST_EXPECT(cache->getStats().retranslations == 0);
+	return true;
+}
+
+RUNTIME_TEST(CodeCachePinned) {
+	CacheHost host;
+	ModuleBuilder builder;
+	Environment env;
+	auto cache = env.getCodeCache();
+	cache->setLimit(size_t(1) << 30);
+
+	auto mod = loadCacheModule(builder, env, &host, 1);
+	TEST_EXPECT(mod);
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	// code of caller is evicted during nested host call, but not released, until call returns
+	TEST_EXPECT(invoke(runtime, "cache", "evict", { Value(uint32_t(5)) }) == 6);
+	TEST_EXPECT(host.stats.evictions == 0 && host.stats.evicting > 0);
+	TEST_EXPECT(host.state == Func::State::Evicting);
+
+	auto stats = cache->getStats();
+	TEST_EXPECT(stats.evictions > 0 && stats.evicting == 0 && getFuncState(mod, 1) == Func::State::Pending);
+
+	TEST_EXPECT(invoke(runtime, "cache", "evict", { Value(uint32_t(7)) }) == 8);
+	TEST_EXPECT(cache->getStats().retranslations > 0);
+
+	// suspended thread holds code, that was evicted after it started
+	auto read = runtime.getExportFunc("cache", "read");
+	TEST_EXPECT(read);
+
+	Thread thread(&runtime);
+	TEST_EXPECT(thread.init());
+	thread.setSuspendable(true);
+
+	cache->setLimit(size_t(1) << 30);
+	Value buffer[1] = { Value(uint32_t(20)) };
+	TEST_EXPECT(thread.Run(*runtime.getModule("cache"), *read, buffer, true) == Thread::Result::Suspended);
+
+	const auto evictions = cache->getStats().evictions;
+	cache->setLimit(1);
+	TEST_EXPECT(getFuncState(mod, 2) == Func::State::Evicting);
+
+	// other calls and collection do not release it
+	TEST_EXPECT(invoke(runtime, "cache", "f0", { Value(uint32_t(3)) }) == 3);
+	cache->collect();
+	TEST_EXPECT(getFuncState(mod, 2) == Func::State::Evicting);
+	TEST_EXPECT(cache->getStats().evicting > 0);
+
+	Value result(uint32_t(30));
+	TEST_EXPECT(thread.Resume(&result) == Thread::Result::Ok && buffer[0].i32 == 31);
+
+	// code is released, when suspended call is finished
+	TEST_EXPECT(getFuncState(mod, 2) == Func::State::Pending);
+	TEST_EXPECT(cache->getStats().evictions > evictions && cache->getStats().evicting == 0);
+	return true;
+}
+
+}
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// compiled with COROUTINE_CXXFLAGS (see Makefile), tests are skipped without coroutine support
+
+#include "RuntimeTests.h"
+#include "Coroutine.h"
+
+#if __cpp_impl_coroutine >= 201902L
+
+namespace wasm {
+namespace test {
+
+// resumes coroutine on other OS thread, like completion of asynchronous I/O
+struct DeferredValue {
+	uint32_t value;
+
+	bool await_ready() const { return false; }
+	void await_suspend(std::coroutine_handle<> h) {
+		std::thread([h] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			h.resume();
+		}).detach();
+	}
+	uint32_t await_resume() const { return value * 2; }
+};
+
+// holds coroutines, until test resumes them
+struct CoroutineGate {
+	std::mutex mutex;
+	Vector<std::coroutine_handle<>> handles;
+	std::atomic<uint32_t> completed = ATOMIC_VAR_INIT(0);
+
+	bool await_ready() const { return false; }
+	void await_suspend(std::coroutine_handle<> h) {
+		std::unique_lock<std::mutex> lock(mutex);
+		handles.emplace_back(h);
+	}
+	void await_resume() const { }
+
+	size_t waiting() {
+		std::unique_lock<std::mutex> lock(mutex);
+		return handles.size();
+	}
+};
+
+static CoroutineGate s_gate;
+
+static Task<Vector<Value>> coroutine_gate(Thread *thread, const HostFunc *func, Vector<Value> args) {
+	co_await s_gate;
+	++ s_gate.completed;
+	co_return Vector<Value>(1, Value(args[0].i32 + 1));
+}
+
+static Task<Vector<Value>> coroutine_double(Thread *thread, const HostFunc *func, Vector<Value> args) {
+	auto value = co_await DeferredValue{args[0].i32};
+	co_return Vector<Value>(1, Value(value));
+}
+
+static Task<uint32_t> coroutine_session(GreenRuntime &runtime, GreenThread *thread, const Func &func) {
+	auto first = co_await co_call(runtime, thread, func, Vector<Value>(1, Value(uint32_t(10))));
+	if (first.result != Thread::Result::Ok) {
+		co_return 0;
+	}
+
+	auto second = co_await co_call(runtime, thread, func, Vector<Value>(1, Value(first.values[0].i32 + 5)));
+	co_return (second.result == Thread::Result::Ok) ? second.values[0].i32 : 0;
+}
+
+// (func $quad (param i32) (result i32)): env.double(env.double(param)); (func $gate): env.gate(param)
+static bool loadCoroutineModule(ModuleBuilder &builder, Environment &env) {
+	addCoroutineFunc(*env.getEnvModule(), "double", &coroutine_double, { Type::I32 }, { Type::I32 });
+	addCoroutineFunc(*env.getEnvModule(), "gate", &coroutine_gate, { Type::I32 }, { Type::I32 });
+
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	auto fn = builder.addImport("env", "double", type);
+	auto gate = builder.addImport("env", "gate", type);
+	builder.addFunc(type, ModuleBuilder::Code().op(Opcode::GetLocal, 0).op(Opcode::Call, fn).op(Opcode::Call, fn), "quad");
+	builder.addFunc(type, ModuleBuilder::Code().op(Opcode::GetLocal, 0).op(Opcode::Call, gate), "gate");
+	builder.addFunc(type, makeCountdown(), "countdown", { Type::I32 });
+
+	return builder.load(env, "coroutine") != nullptr;
+}
+
+static uint32_t runTask(Task<uint32_t> &&task) {
+	std::promise<uint32_t> promise;
+	auto future = promise.get_future();
+	task.start([&] (uint32_t *ret) {
+		promise.set_value(ret ? *ret : 0);
+	});
+	return future.get();
+}
+
+RUNTIME_TEST(CoroutineGreenCall) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadCoroutineModule(builder, env));
+
+	GreenRuntimeOptions opts;
+	opts.workers = 2;
+
+	GreenRuntime runtime;
+	TEST_EXPECT(runtime.init(&env, opts));
+
+	auto countdown = runtime.getExportFunc("coroutine", "countdown");
+	auto quad = runtime.getExportFunc("coroutine", "quad");
+	TEST_EXPECT(countdown && quad);
+
+	auto thread = runtime.spawn();
+	TEST_EXPECT(runTask(coroutine_session(runtime, thread, *countdown)) == 15);
+
+	// coroutine import suspends green thread, while it waits
+	TEST_EXPECT(runTask(coroutine_session(runtime, thread, *quad)) == (10 * 4 + 5) * 4);
+
+	runtime.stop();
+	return true;
+}
+
+RUNTIME_TEST(CoroutineBlockingImport) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadCoroutineModule(builder, env));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	auto quad = runtime.getExportFunc("coroutine", "quad");
+	TEST_EXPECT(quad);
+
+	// thread is not suspendable, so caller waits for coroutine
+	Vector<Value> args{ Value(uint32_t(3)) };
+	TEST_EXPECT(runtime.callSafe(*quad, args) == Thread::Result::Ok && args[0].i32 == 12);
+	return true;
+}
+
+RUNTIME_TEST(CoroutineCompletesAfterStop) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadCoroutineModule(builder, env));
+
+	GreenRuntimeOptions opts;
+	opts.workers = 1;
+
+	std::mutex mutex;
+	Vector<Thread::Result> results;
+	{
+		GreenRuntime runtime;
+		TEST_EXPECT(runtime.init(&env, opts));
+
+		auto gate = runtime.getExportFunc("coroutine", "gate");
+		TEST_EXPECT(gate);
+
+		for (uint32_t i = 0; i < 2; ++ i) {
+			runtime.call(runtime.spawn(), *gate, Vector<Value>(1, Value(i)), [&] (GreenRuntime::CallResult &&ret) {
+				std::unique_lock<std::mutex> lock(mutex);
+				results.emplace_back(ret.result);
+			});
+		}
+
+		TEST_EXPECT(waitFor([&] { return s_gate.waiting() == 2; }));
+
+		// suspended calls are cancelled, coroutines still wait
+		runtime.stop();
+		TEST_EXPECT(results.size() == 2 && s_gate.completed == 0);
+		for (auto &it : results) {
+			TEST_EXPECT(it == Thread::Result::TrapHostTrapped);
+		}
+
+		// coroutine completes after stop, its results are dropped
+		s_gate.handles[0].resume();
+		TEST_EXPECT(s_gate.completed == 1);
+	}
+
+	// and after runtime is destroyed
+	s_gate.handles[1].resume();
+	TEST_EXPECT(s_gate.completed == 2 && results.size() == 2);
+	s_gate.handles.clear();
+	return true;
+}
+
+}
+}
+
+#endif
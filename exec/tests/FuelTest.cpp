@@ -0,0 +1,90 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+
+namespace wasm {
+namespace test {
+
+static bool loadCountdown(ModuleBuilder &builder, Environment &env, bool metered) {
+	builder.addFunc(builder.addType({ Type::I32 }, { Type::I32 }), makeCountdown(), "countdown", { Type::I32 });
+
+	ReadOptions opts;
+	opts.features.setFuelMetering(metered);
+	return builder.load(env, "fuel", opts) != nullptr;
+}
+
+RUNTIME_TEST(FuelExhaustion) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadCountdown(builder, env, true));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	auto func = runtime.getExportFunc("fuel", "countdown");
+	TEST_EXPECT(func);
+
+	Vector<Value> args{ Value(uint32_t(1000)) };
+	TEST_EXPECT(runtime.callSafe(*func, args) == Thread::Result::Ok && args[0].i32 == 1000);
+
+	args = Vector<Value>{ Value(uint32_t(1000)) };
+	TEST_EXPECT(runtime.callSafe(*func, args, CallLimits(100)) == Thread::Result::TrapFuelExhausted);
+	TEST_EXPECT(runtime.getRemainingFuel() == 0);
+
+	// exhausted limit is not carried into next call
+	args = Vector<Value>{ Value(uint32_t(10)) };
+	TEST_EXPECT(runtime.callSafe(*func, args, CallLimits(10000)) == Thread::Result::Ok && args[0].i32 == 10);
+	const uint64_t spent = 10000 - runtime.getRemainingFuel();
+	TEST_EXPECT(spent > 10);
+
+	args = Vector<Value>{ Value(uint32_t(20)) };
+	TEST_EXPECT(runtime.callSafe(*func, args, CallLimits(10000)) == Thread::Result::Ok && args[0].i32 == 20);
+	TEST_EXPECT(10000 - runtime.getRemainingFuel() > spent);
+
+	// metering is deterministic: exact amount is enough, one less is not
+	args = Vector<Value>{ Value(uint32_t(10)) };
+	TEST_EXPECT(runtime.callSafe(*func, args, CallLimits(spent)) == Thread::Result::Ok && args[0].i32 == 10);
+	TEST_EXPECT(runtime.getRemainingFuel() == 0);
+
+	args = Vector<Value>{ Value(uint32_t(10)) };
+	TEST_EXPECT(runtime.callSafe(*func, args, CallLimits(spent - 1)) == Thread::Result::TrapFuelExhausted);
+
+	args = Vector<Value>{ Value(uint32_t(1000)) };
+	TEST_EXPECT(runtime.callSafe(*func, args) == Thread::Result::Ok && args[0].i32 == 1000);
+	return true;
+}
+
+RUNTIME_TEST(FuelUnmetered) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadCountdown(builder, env, false));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	auto func = runtime.getExportFunc("fuel", "countdown");
+	TEST_EXPECT(func);
+
+	// limit is not charged by modules without fuel metering
+	Vector<Value> args{ Value(uint32_t(1000)) };
+	TEST_EXPECT(runtime.callSafe(*func, args, CallLimits(1)) == Thread::Result::Ok && args[0].i32 == 1000);
+	TEST_EXPECT(runtime.getRemainingFuel() == 1);
+	return true;
+}
+
+}
+}
@@ -0,0 +1,337 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+#include "GreenRuntime.h"
+
+namespace wasm {
+namespace test {
+
+struct GreenState {
+	std::mutex mutex;
+	std::condition_variable cond;
+
+	Map<uint32_t, std::thread::id> entered; // gates, entered by env.block
+	Map<uint32_t, bool> open;
+	Vector<std::thread::id> reads; // workers, that called env.read
+	Vector<GreenResumer> resumers; // links to threads, that called env.read
+	Vector<GreenRuntime::CallResult> results;
+
+	template <typename Pred>
+	bool wait(const Pred &pred) {
+		std::unique_lock<std::mutex> lock(mutex);
+		return cond.wait_for(lock, std::chrono::seconds(10), pred);
+	}
+
+	void notify() {
+		cond.notify_all();
+	}
+
+	GreenRuntime::Callback callback() {
+		return [this] (GreenRuntime::CallResult &&ret) {
+			std::unique_lock<std::mutex> lock(mutex);
+			results.emplace_back(std::move(ret));
+			cond.notify_all();
+		};
+	}
+};
+
+// holds worker until gate is opened
+static Result green_block(Thread *thread, const HostFunc *func, Value *buffer) {
+	auto state = (GreenState *)func->ctx;
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->entered[buffer[0].i32] = std::this_thread::get_id();
+	state->cond.notify_all();
+	state->cond.wait(lock, [&] { return state->open[buffer[0].i32]; });
+	return Result::Ok;
+}
+
+static Result green_read(Thread *thread, const HostFunc *func, Value *buffer) {
+	auto state = (GreenState *)func->ctx;
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->reads.emplace_back(std::this_thread::get_id());
+	state->resumers.emplace_back(static_cast<GreenThread *>(thread)->getResumer());
+	state->cond.notify_all();
+	return Result::Suspend;
+}
+
+static bool loadGreenModule(ModuleBuilder &builder, Environment &env, GreenState *state, const ReadOptions &opts) {
+	env.getEnvModule()->addFunc("block", &green_block, { Type::I32 }, { Type::I32 }, state);
+	env.getEnvModule()->addFunc("read", &green_read, { Type::I32 }, { Type::I32 }, state);
+
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	auto block = builder.addImport("env", "block", type);
+	auto read = builder.addImport("env", "read", type);
+	builder.addFunc(type, makeCountdown(), "countdown", { Type::I32 });
+	builder.addFunc(type, ModuleBuilder::Code().op(Opcode::GetLocal, 0).op(Opcode::Call, block), "block");
+	builder.addFunc(type, ModuleBuilder::Code()
+		.op(Opcode::GetLocal, 0).op(Opcode::Call, read)
+		.i32(1).op(Opcode::I32Add).op(Opcode::Call, read), "read2");
+
+	return builder.load(env, "green", opts) != nullptr;
+}
+
+static bool runLoops(std::ostream &stream, const ReadOptions &readOpts, const GreenRuntimeOptions &opts) {
+	GreenState state;
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadGreenModule(builder, env, &state, readOpts));
+
+	GreenRuntime runtime;
+	TEST_EXPECT(runtime.init(&env, opts));
+
+	auto func = runtime.getExportFunc("green", "countdown");
+	TEST_EXPECT(func);
+
+	// threads on one worker complete only if worker switches between them
+	const uint32_t count = 4;
+	for (uint32_t i = 0; i < count; ++ i) {
+		runtime.call(runtime.spawn(), *func, Vector<Value>{ Value(uint32_t(300000 + i)) }, state.callback());
+	}
+
+	TEST_EXPECT(state.wait([&] { return state.results.size() == count; }));
+	for (auto &it : state.results) {
+		TEST_EXPECT(it.result == Thread::Result::Ok && it.values.size() == 1 && it.values[0].i32 >= 300000);
+	}
+	TEST_EXPECT(runtime.getPreemptionsCount() >= count);
+
+	runtime.stop();
+	return true;
+}
+
+RUNTIME_TEST(GreenPreemptionFuel) {
+	ReadOptions readOpts;
+	readOpts.features.setFuelMetering(true);
+
+	GreenRuntimeOptions opts;
+	opts.workers = 1;
+	opts.sliceFuel = 10000;
+	opts.sliceTime = Watchdog::Clock::duration::zero();
+	return runLoops(stream, readOpts, opts);
+}
+
+RUNTIME_TEST(GreenPreemptionTime) {
+	ReadOptions readOpts;
+	readOpts.features.setEpochInterruption(true);
+
+	GreenRuntimeOptions opts;
+	opts.workers = 1;
+	opts.sliceFuel = 0;
+	opts.sliceTime = std::chrono::milliseconds(1);
+	return runLoops(stream, readOpts, opts);
+}
+
+RUNTIME_TEST(GreenMigration) {
+	GreenState state;
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadGreenModule(builder, env, &state, ReadOptions()));
+
+	GreenRuntimeOptions opts;
+	opts.workers = 2;
+
+	GreenRuntime runtime;
+	TEST_EXPECT(runtime.init(&env, opts));
+
+	auto block = runtime.getExportFunc("green", "block");
+	auto read2 = runtime.getExportFunc("green", "read2");
+	TEST_EXPECT(block && read2);
+
+	// b holds first worker
+	auto b = runtime.spawn();
+	runtime.call(b, *block, Vector<Value>{ Value(uint32_t(1)) }, state.callback());
+	TEST_EXPECT(state.wait([&] { return state.entered.find(1) != state.entered.end(); }));
+	TEST_EXPECT(!runtime.release(b));
+
+	// a is suspended on second worker
+	auto a = runtime.spawn();
+	runtime.call(a, *read2, Vector<Value>{ Value(uint32_t(5)) }, state.callback());
+	TEST_EXPECT(state.wait([&] { return state.reads.size() == 1; }));
+	TEST_EXPECT(state.reads[0] != state.entered[1]);
+
+	// c takes second worker, suspended a does not occupy it
+	auto c = runtime.spawn();
+	runtime.call(c, *block, Vector<Value>{ Value(uint32_t(2)) }, state.callback());
+	TEST_EXPECT(state.wait([&] { return state.entered.find(2) != state.entered.end(); }));
+	TEST_EXPECT(state.entered[2] == state.reads[0]);
+
+	// first worker is released, so a continues there
+	{
+		std::unique_lock<std::mutex> lock(state.mutex);
+		state.open[1] = true;
+		state.notify();
+	}
+	TEST_EXPECT(state.wait([&] { return state.results.size() == 1; }));
+	TEST_EXPECT(!runtime.release(a));
+
+	runtime.resume(a, Vector<Value>{ Value(uint32_t(50)) });
+	TEST_EXPECT(state.wait([&] { return state.reads.size() == 2; }));
+	TEST_EXPECT(state.reads[1] == state.entered[1]);
+
+	runtime.resume(a, Vector<Value>{ Value(uint32_t(510)) });
+	TEST_EXPECT(state.wait([&] { return state.results.size() == 2; }));
+
+	{
+		std::unique_lock<std::mutex> lock(state.mutex);
+		TEST_EXPECT(state.results[1].result == Thread::Result::Ok && state.results[1].values[0].i32 == 510);
+		state.open[2] = true;
+		state.notify();
+	}
+	TEST_EXPECT(state.wait([&] { return state.results.size() == 3; }));
+
+	runtime.stop();
+	return true;
+}
+
+RUNTIME_TEST(GreenRelease) {
+	GreenState state;
+	ModuleBuilder builder;
+	Environment env;
+
+	ReadOptions readOpts;
+	readOpts.features.setEpochInterruption(true);
+	TEST_EXPECT(loadGreenModule(builder, env, &state, readOpts));
+
+	// short slices, so timer often looks at threads, that complete their calls
+	GreenRuntimeOptions opts;
+	opts.workers = 2;
+	opts.sliceTime = std::chrono::milliseconds(1);
+
+	GreenRuntime runtime;
+	TEST_EXPECT(runtime.init(&env, opts));
+
+	auto func = runtime.getExportFunc("green", "countdown");
+	TEST_EXPECT(func);
+
+	for (uint32_t i = 0; i < 200; ++ i) {
+		Vector<GreenThread *> threads{ runtime.spawn(), runtime.spawn() };
+		for (auto &it : threads) {
+			runtime.call(it, *func, Vector<Value>{ Value(uint32_t(20000)) }, state.callback());
+		}
+
+		TEST_EXPECT(state.wait([&] { return state.results.size() == (i + 1) * threads.size(); }));
+
+		// thread is idle after callback returns
+		for (auto &it : threads) {
+			while (!runtime.release(it)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	TEST_EXPECT(runtime.getThreadsCount() == 0);
+	for (auto &it : state.results) {
+		TEST_EXPECT(it.result == Thread::Result::Ok && it.values[0].i32 == 20000);
+	}
+	runtime.stop();
+	return true;
+}
+
+RUNTIME_TEST(GreenStopCancels) {
+	GreenState state;
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadGreenModule(builder, env, &state, ReadOptions()));
+
+	GreenRuntimeOptions opts;
+	opts.workers = 2;
+
+	GreenRuntime runtime;
+	TEST_EXPECT(runtime.init(&env, opts));
+
+	auto read2 = runtime.getExportFunc("green", "read2");
+	auto countdown = runtime.getExportFunc("green", "countdown");
+	TEST_EXPECT(read2 && countdown);
+
+	// second call of the thread is suspended, when stop already cancels threads
+	auto a = runtime.spawn();
+	runtime.call(a, *read2, Vector<Value>{ Value(uint32_t(1)) }, state.callback());
+	runtime.call(a, *read2, Vector<Value>{ Value(uint32_t(2)) }, state.callback());
+
+	auto b = runtime.spawn();
+	runtime.call(b, *countdown, Vector<Value>{ Value(uint32_t(10)) }, state.callback());
+
+	TEST_EXPECT(state.wait([&] { return state.reads.size() == 1; }));
+
+	// suspended calls are never resumed
+	runtime.stop();
+
+	TEST_EXPECT(state.results.size() == 3);
+	size_t cancelled = 0;
+	for (auto &it : state.results) {
+		if (it.result == Thread::Result::TrapHostTrapped) {
+			++ cancelled;
+		} else {
+			TEST_EXPECT(it.result == Thread::Result::Ok && it.values[0].i32 == 10);
+		}
+	}
+	TEST_EXPECT(cancelled == 2);
+	return true;
+}
+
+RUNTIME_TEST(GreenResumeAfterStop) {
+	GreenState state;
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadGreenModule(builder, env, &state, ReadOptions()));
+
+	GreenRuntimeOptions opts;
+	opts.workers = 1;
+
+	GreenResumer stopped;
+	{
+		GreenRuntime runtime;
+		TEST_EXPECT(runtime.init(&env, opts));
+
+		auto read2 = runtime.getExportFunc("green", "read2");
+		TEST_EXPECT(read2);
+
+		// resumer continues suspended call, like GreenRuntime::resume
+		auto a = runtime.spawn();
+		runtime.call(a, *read2, Vector<Value>{ Value(uint32_t(5)) }, state.callback());
+		TEST_EXPECT(state.wait([&] { return state.reads.size() == 1; }));
+		TEST_EXPECT(state.resumers[0].resume(Vector<Value>{ Value(uint32_t(50)) }));
+		TEST_EXPECT(state.wait([&] { return state.reads.size() == 2; }));
+		TEST_EXPECT(state.resumers[1].resume(Vector<Value>{ Value(uint32_t(510)) }));
+		TEST_EXPECT(state.wait([&] { return state.results.size() == 1; }));
+		TEST_EXPECT(state.results[0].result == Thread::Result::Ok && state.results[0].values[0].i32 == 510);
+
+		// host completes after thread is released
+		while (!runtime.release(a)) {
+			std::this_thread::yield();
+		}
+		TEST_EXPECT(!state.resumers[1].resume(Vector<Value>{ Value(uint32_t(1)) }));
+
+		// host completes after suspended call is cancelled by stop, and after thread is destroyed
+		auto b = runtime.spawn();
+		runtime.call(b, *read2, Vector<Value>{ Value(uint32_t(7)) }, state.callback());
+		TEST_EXPECT(state.wait([&] { return state.reads.size() == 3; }));
+		stopped = state.resumers[2];
+
+		runtime.stop();
+		TEST_EXPECT(state.results.size() == 2 && state.results[1].result == Thread::Result::TrapHostTrapped);
+		TEST_EXPECT(runtime.getThreadsCount() == 0);
+		TEST_EXPECT(!stopped.resume(Vector<Value>{ Value(uint32_t(70)) }));
+	}
+
+	// and after runtime is destroyed
+	TEST_EXPECT(stopped && !stopped.resume(Vector<Value>{ Value(uint32_t(70)) }));
+	TEST_EXPECT(state.results.size() == 2);
+	return true;
+}
+
+}
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+
+namespace wasm {
+namespace test {
+
+RUNTIME_TEST(InterruptCall) {
+	ModuleBuilder builder;
+	builder.addFunc(builder.addType({ Type::I32 }, { Type::I32 }), makeCountdown(), "countdown", { Type::I32 });
+
+	ReadOptions opts;
+	opts.features.setEpochInterruption(true);
+
+	Environment env;
+	TEST_EXPECT(builder.load(env, "interrupt", opts));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	auto func = runtime.getExportFunc("interrupt", "countdown");
+	TEST_EXPECT(func);
+
+	// interrupt, that comes before call is started, is cleared by call, so it is repeated until call is stopped
+	std::atomic<bool> finished(false);
+	std::thread interrupter([&] {
+		while (!finished.load()) {
+			runtime.interrupt();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+
+	Vector<Value> args{ Value(uint32_t(0xFFFFFFFF)) };
+	auto res = runtime.callSafe(*func, args);
+	finished.store(true);
+	interrupter.join();
+	TEST_EXPECT(res == Thread::Result::TrapInterrupted);
+
+	args = Vector<Value>{ Value(uint32_t(10)) };
+	TEST_EXPECT(runtime.callSafe(*func, args) == Thread::Result::Ok && args[0].i32 == 10);
+
+	// interrupt of idle runtime does not stop next call
+	runtime.interrupt();
+	args = Vector<Value>{ Value(uint32_t(10)) };
+	TEST_EXPECT(runtime.callSafe(*func, args) == Thread::Result::Ok && args[0].i32 == 10);
+
+	args = Vector<Value>{ Value(uint32_t(0xFFFFFFFF)) };
+	TEST_EXPECT(runtime.callSafe(*func, args, CallLimits(std::chrono::milliseconds(10))) == Thread::Result::TrapInterrupted);
+
+	args = Vector<Value>{ Value(uint32_t(10)) };
+	TEST_EXPECT(runtime.callSafe(*func, args) == Thread::Result::Ok && args[0].i32 == 10);
+	return true;
+}
+
+
+RUNTIME_TEST(InterruptAtomicWait) {
+	// (func (param $timeout i64) (result i32) (i32.atomic.wait (i32.const 0) (i32.const 0) (get_local $timeout)))
+	ModuleBuilder builder;
+	builder.setMemory(1, 1, true);
+	builder.addFunc(builder.addType({ Type::I64 }, { Type::I32 }),
+			ModuleBuilder::Code().i32(0).i32(0).op(Opcode::GetLocal, 0).mem(Opcode::I32AtomicWait), "wait");
+
+	ReadOptions opts;
+	opts.features.setThreadsEnabled(true);
+
+	Environment env;
+	TEST_EXPECT(builder.load(env, "wait", opts));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	auto func = runtime.getExportFunc("wait", "wait");
+	TEST_EXPECT(func);
+
+	Vector<Value> args{ Value(uint64_t(1000000)) };
+	TEST_EXPECT(runtime.callSafe(*func, args) == Thread::Result::Ok && args[0].i32 == 2);
+
+	// untimed wait is not woken by watchdog ticks, interrupt wakes it without waiting for tick
+	auto watchdog = Watchdog::getInstance();
+	const auto tick = watchdog->getTick();
+	watchdog->setTick(std::chrono::seconds(2));
+
+	std::atomic<bool> finished(false);
+	std::thread interrupter([&] {
+		while (!finished.load()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			runtime.interrupt();
+		}
+	});
+
+	const auto start = std::chrono::steady_clock::now();
+	args = Vector<Value>{ Value(int64_t(-1)) };
+	auto res = runtime.callSafe(*func, args);
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	finished.store(true);
+	interrupter.join();
+	watchdog->setTick(tick);
+
+	TEST_EXPECT(res == Thread::Result::TrapInterrupted);
+	TEST_EXPECT(elapsed < std::chrono::seconds(1));
+
+	// deadline of call stops untimed wait
+	args = Vector<Value>{ Value(int64_t(-1)) };
+	TEST_EXPECT(runtime.callSafe(*func, args, CallLimits(std::chrono::milliseconds(10))) == Thread::Result::TrapInterrupted);
+	return true;
+}
+
+}
+}
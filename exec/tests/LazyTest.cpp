@@ -0,0 +1,302 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+
+namespace wasm {
+namespace test {
+
+// errors, reported by environment
+struct LazyErrors {
+	std::mutex mutex;
+	Vector<std::pair<std::thread::id, String>> errors;
+
+	void attach(Environment &env) {
+		env.setErrorCallback([this] (const StringView &tag, const StringStream &stream) {
+			std::unique_lock<std::mutex> lock(mutex);
+			errors.emplace_back(std::this_thread::get_id(), String(tag.data(), tag.size()) + ": " + stream.str());
+		});
+	}
+
+	size_t count(const StringView &str) {
+		std::unique_lock<std::mutex> lock(mutex);
+		size_t ret = 0;
+		for (auto &it : errors) {
+			if (StringView(it.second).find(str) != StringView::npos) {
+				++ ret;
+			}
+		}
+		return ret;
+	}
+};
+
+// countdown and bad, which body adds values of empty stack
+static bool loadLazyModule(ModuleBuilder &builder, Environment &env, const ReadOptions &opts) {
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	builder.addFunc(type, makeCountdown(), "countdown", { Type::I32 });
+	builder.addFunc(type, ModuleBuilder::Code().op(Opcode::I32Add), "bad");
+	return builder.load(env, "lazy", opts) != nullptr;
+}
+
+// body, that takes some time to validate and translate
+static ModuleBuilder::Code makeFiller(uint32_t ops) {
+	ModuleBuilder::Code code;
+	for (uint32_t i = 0; i < ops; ++ i) {
+		code.i32(1).op(Opcode::Drop);
+	}
+	return code;
+}
+
+// funcs functions with filler, which return argument; with bad, last function is invalid
+static const Module *loadFillerModule(ModuleBuilder &builder, Environment &env, const StringView &name, Index funcs,
+		uint32_t ops, const ReadOptions &opts, bool bad = false) {
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	for (Index i = 0; i < funcs; ++ i) {
+		builder.addFunc(type, makeFiller(ops).op(Opcode::GetLocal, 0), "f" + std::to_string(i));
+	}
+	if (bad) {
+		builder.addFunc(type, makeFiller(ops).op(Opcode::I32Add), "bad");
+	}
+	return builder.load(env, name, opts);
+}
+
+RUNTIME_TEST(LazyInvalidFunction) {
+	LazyErrors errors;
+	ModuleBuilder builder;
+	Environment env;
+	errors.attach(env);
+
+	ReadOptions opts;
+	opts.lazy = true;
+
+	// invalid body is not read on load
+	TEST_EXPECT(loadLazyModule(builder, env, opts));
+	TEST_EXPECT(errors.errors.empty());
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	auto countdown = runtime.getExportFunc("lazy", "countdown");
+	auto bad = runtime.getExportFunc("lazy", "bad");
+	TEST_EXPECT(countdown && bad);
+
+	Vector<Value> args{ Value(uint32_t(100)) };
+	TEST_EXPECT(runtime.callSafe(*countdown, args) == Thread::Result::Ok && args[0].i32 == 100);
+	TEST_EXPECT(errors.errors.empty());
+
+	// validation error is reported on first call, every call traps
+	args = Vector<Value>{ Value(uint32_t(1)) };
+	TEST_EXPECT(runtime.callSafe(*bad, args) == Thread::Result::TrapInvalidFunction);
+	const auto reported = errors.errors.size();
+	TEST_EXPECT(reported > 0);
+
+	args = Vector<Value>{ Value(uint32_t(1)) };
+	TEST_EXPECT(!runtime.call(*bad, args));
+	TEST_EXPECT(errors.count("lazily translated function is invalid") == 1);
+	TEST_EXPECT(errors.errors.size() == reported + 1);
+
+	args = Vector<Value>{ Value(uint32_t(10)) };
+	TEST_EXPECT(runtime.callSafe(*countdown, args) == Thread::Result::Ok && args[0].i32 == 10);
+	TEST_EXPECT(!env.translateAll());
+	return true;
+}
+
+RUNTIME_TEST(LazyBackgroundOrder) {
+	ModuleBuilder builder;
+	Environment env;
+
+	// e7 calls f5, e9 calls f3, other functions are not reachable from exports
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	for (Index i = 0; i < 10; ++ i) {
+		auto code = makeFiller(50000).op(Opcode::GetLocal, 0);
+		if (i == 7 || i == 9) {
+			code.op(Opcode::Call, i == 7 ? 5 : 3);
+		}
+		builder.addFunc(type, code, (i == 7 || i == 9) ? "e" + std::to_string(i) : String());
+	}
+
+	ReadOptions opts;
+	opts.lazy = true;
+	opts.backgroundThreads = 1;
+
+	auto mod = builder.load(env, "lazy", opts);
+	TEST_EXPECT(mod);
+	TEST_EXPECT(env.getTranslationPool()->getThreads() == 1);
+
+	// one thread translates exports, their callees, then others in index order; states are read from the end
+	// of order, so when function is ready, every function before it should be ready too
+	const Vector<Index> order{ 7, 9, 5, 3, 0, 1, 2, 4, 6, 8 };
+	bool ordered = true;
+	TEST_EXPECT(waitFor([&] {
+		bool ready = true, later = false;
+		for (auto it = order.rbegin(); it != order.rend(); ++ it) {
+			const bool translated = getFuncState(mod, *it) == Func::State::Ready;
+			if (!translated && later) {
+				ordered = false;
+			}
+			later = later || translated;
+			ready = ready && translated;
+		}
+		return ready;
+	}));
+	TEST_EXPECT(ordered);
+	return true;
+}
+
+RUNTIME_TEST(LazyBackgroundShared) {
+	ModuleBuilder builderA, builderB;
+	Environment env;
+
+	ReadOptions opts;
+	opts.lazy = true;
+	opts.backgroundThreads = 1;
+
+	auto a = loadFillerModule(builderA, env, "a", 64, 200, opts);
+	TEST_EXPECT(a && env.getTranslationPool()->getThreads() == 1);
+
+	// pool grows to the largest request, limited with hardware concurrency
+	opts.backgroundThreads = 64;
+	auto b = loadFillerModule(builderB, env, "b", 64, 200, opts);
+	TEST_EXPECT(b);
+	const size_t threads = std::max(std::thread::hardware_concurrency(), 1U);
+	TEST_EXPECT(env.getTranslationPool()->getThreads() == std::min(threads, size_t(64)));
+
+	TEST_EXPECT(waitFor([&] {
+		return countFuncState(a, Func::State::Ready) == 64 && countFuncState(b, Func::State::Ready) == 64;
+	}));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+	auto func = runtime.getExportFunc("b", "f63");
+	Vector<Value> args{ Value(uint32_t(42)) };
+	TEST_EXPECT(func && runtime.callSafe(*func, args) == Thread::Result::Ok && args[0].i32 == 42);
+	return true;
+}
+
+RUNTIME_TEST(LazyBackgroundCancel) {
+	ReadOptions opts;
+	opts.lazy = true;
+	opts.backgroundThreads = 4;
+
+	// environment is destroyed, while pool translates its modules
+	for (uint32_t i = 0; i < 4; ++ i) {
+		ModuleBuilder builderA, builderB;
+		Environment env;
+		TEST_EXPECT(loadFillerModule(builderA, env, "a", 256, 500, opts));
+		TEST_EXPECT(loadFillerModule(builderB, env, "b", 256, 500, opts, true));
+		std::this_thread::sleep_for(std::chrono::microseconds(i * 500));
+	}
+
+	// stopped pool does not translate, barrier translates remaining functions on calling thread
+	ModuleBuilder builderA, builderB;
+	Environment env;
+	auto mod = loadFillerModule(builderA, env, "a", 1024, 500, opts);
+	TEST_EXPECT(mod);
+
+	env.getTranslationPool()->stop();
+	TEST_EXPECT(env.getTranslationPool()->getThreads() == 0);
+
+	const auto ready = countFuncState(mod, Func::State::Ready);
+	TEST_EXPECT(ready < 1024 && countFuncState(mod, Func::State::Translating) == 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	TEST_EXPECT(countFuncState(mod, Func::State::Ready) == ready);
+
+	TEST_EXPECT(env.translateAll());
+	TEST_EXPECT(countFuncState(mod, Func::State::Ready) == 1024);
+
+	// modules, loaded after stop, are translated only on call
+	auto other = loadFillerModule(builderB, env, "b", 16, 10, opts);
+	TEST_EXPECT(other && env.getTranslationPool()->getThreads() == 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	TEST_EXPECT(countFuncState(other, Func::State::Pending) == 16);
+	return true;
+}
+
+RUNTIME_TEST(LazyBackgroundBarrier) {
+	LazyErrors errors;
+	ModuleBuilder builder;
+	Environment env;
+	errors.attach(env);
+
+	ReadOptions opts;
+	opts.lazy = true;
+	opts.backgroundThreads = 2;
+
+	auto mod = loadFillerModule(builder, env, "lazy", 256, 200, opts, true);
+	TEST_EXPECT(mod);
+
+	// all functions are ready after barrier, invalid body fails it and its errors are reported once,
+	// on calling thread
+	TEST_EXPECT(!env.translateAll());
+	TEST_EXPECT(countFuncState(mod, Func::State::Ready) == 256 && getFuncState(mod, 256) == Func::State::Invalid);
+
+	const auto reported = errors.errors.size();
+	TEST_EXPECT(reported > 0);
+	for (auto &it : errors.errors) {
+		TEST_EXPECT(it.first == std::this_thread::get_id());
+	}
+
+	TEST_EXPECT(!mod->translateAll());
+	TEST_EXPECT(errors.errors.size() == reported);
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+	auto bad = runtime.getExportFunc("lazy", "bad");
+	Vector<Value> args{ Value(uint32_t(1)) };
+	TEST_EXPECT(bad && runtime.callSafe(*bad, args) == Thread::Result::TrapInvalidFunction);
+	TEST_EXPECT(errors.errors.size() == reported);
+	return true;
+}
+
+RUNTIME_TEST(LazyBackgroundInvalid) {
+	LazyErrors errors;
+	ModuleBuilder builder;
+	Environment env;
+	errors.attach(env);
+
+	ReadOptions opts;
+	opts.lazy = true;
+	opts.backgroundThreads = 2;
+
+	auto mod = loadFillerModule(builder, env, "lazy", 8, 10, opts, true);
+	TEST_EXPECT(mod);
+
+	// invalid body, translated in background, is not reported from pool thread
+	TEST_EXPECT(waitFor([&] { return getFuncState(mod, 8) == Func::State::Invalid; }));
+	TEST_EXPECT(errors.errors.empty());
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+	auto bad = runtime.getExportFunc("lazy", "bad");
+	TEST_EXPECT(bad);
+
+	// errors are reported on first call, on thread of caller
+	Vector<Value> args{ Value(uint32_t(1)) };
+	TEST_EXPECT(runtime.callSafe(*bad, args) == Thread::Result::TrapInvalidFunction);
+	const auto reported = errors.errors.size();
+	TEST_EXPECT(reported > 0);
+	for (auto &it : errors.errors) {
+		TEST_EXPECT(it.first == std::this_thread::get_id());
+	}
+
+	args = Vector<Value>{ Value(uint32_t(1)) };
+	TEST_EXPECT(runtime.callSafe(*bad, args) == Thread::Result::TrapInvalidFunction);
+	TEST_EXPECT(errors.errors.size() == reported);
+	return true;
+}
+
+}
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+
+namespace wasm {
+namespace test {
+
+// 4 pages with segments on first and third page
+static const Module *loadImageModule(ModuleBuilder &builder, Environment &env) {
+	builder.setMemory(4);
+	builder.addData(16, "hello");
+	builder.addData(WABT_PAGE_SIZE * 2 + 8, "world");
+	return builder.load(env, "image");
+}
+
+static RuntimeMemory *getMemory(ThreadedRuntime &runtime) {
+	return runtime.getModule("image")->memory[0];
+}
+
+static bool hasSegments(const uint8_t *data) {
+	return memcmp(data + 16, "hello", 5) == 0 && memcmp(data + WABT_PAGE_SIZE * 2 + 8, "world", 5) == 0;
+}
+
+// allocator of linear memory, that does not support mapping
+static bool image_allocator(const RuntimeMemory &mem, uint32_t size, RuntimeMemory::Action action, void *ctx) {
+	++ *((uint32_t *)ctx);
+	switch (action) {
+	case RuntimeMemory::Action::Alloc:
+		mem.data = new uint8_t[size];
+		memset(mem.data, 0, size);
+		mem.size = size;
+		break;
+	case RuntimeMemory::Action::Realloc: {
+		auto data = new uint8_t[size];
+		memcpy(data, mem.data, mem.size);
+		memset(data + mem.size, 0, size - mem.size);
+		delete [] mem.data;
+		mem.data = data;
+		mem.size = size;
+		break;
+	}
+	case RuntimeMemory::Action::Free:
+		delete [] mem.data;
+		mem.data = nullptr;
+		mem.size = 0;
+		break;
+	}
+	return true;
+}
+
+RUNTIME_TEST(MemoryImageShared) {
+	ModuleBuilder builder;
+	Environment env;
+	auto mod = loadImageModule(builder, env);
+	TEST_EXPECT(mod);
+
+	// image is built once per module memory
+	auto image = env.getMemoryImage(mod, 0);
+	TEST_EXPECT(image && image->size() == WABT_PAGE_SIZE * 4);
+	TEST_EXPECT(env.getMemoryImage(mod, 0) == image);
+	TEST_EXPECT(!env.getMemoryImage(mod, 1));
+
+	ThreadedRuntime a, b;
+	TEST_EXPECT(a.init(&env) && b.init(&env));
+
+	auto memA = getMemory(a);
+	auto memB = getMemory(b);
+	TEST_EXPECT(memA->data != memB->data);
+	TEST_EXPECT(memA->mapped == image->isMappable() && memB->mapped == image->isMappable());
+	TEST_EXPECT(hasSegments(memA->data) && hasSegments(memB->data));
+
+	// writes are private to runtime, image and other runtimes are not changed
+	memA->data[16] = 'j';
+	memA->data[WABT_PAGE_SIZE * 3] = 1;
+	TEST_EXPECT(hasSegments(memB->data) && memB->data[WABT_PAGE_SIZE * 3] == 0);
+
+	ThreadedRuntime c;
+	TEST_EXPECT(c.init(&env));
+	TEST_EXPECT(hasSegments(getMemory(c)->data) && getMemory(c)->data[WABT_PAGE_SIZE * 3] == 0);
+
+	// grown memory is copied from mapping
+	TEST_EXPECT(b.growMemory(*memB, 2));
+	TEST_EXPECT(memB->size == WABT_PAGE_SIZE * 6 && !memB->mapped);
+	TEST_EXPECT(hasSegments(memB->data) && memB->data[WABT_PAGE_SIZE * 5] == 0);
+	TEST_EXPECT(hasSegments(getMemory(c)->data));
+	return true;
+}
+
+RUNTIME_TEST(MemoryImageAllocator) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadImageModule(builder, env));
+
+	// memory of custom allocator is initialized from segments, not mapped
+	uint32_t calls = 0;
+	LinkingThreadOptions opts;
+	opts.allocator = &image_allocator;
+	opts.context = &calls;
+
+	{
+		ThreadedRuntime runtime;
+		TEST_EXPECT(runtime.init(&env, opts));
+
+		auto mem = getMemory(runtime);
+		TEST_EXPECT(calls == 1 && !mem->mapped);
+		TEST_EXPECT(mem->size == WABT_PAGE_SIZE * 4 && hasSegments(mem->data));
+	}
+	TEST_EXPECT(calls == 2);
+	return true;
+}
+
+RUNTIME_TEST(MemoryImageOutOfBounds) {
+	ModuleBuilder builder;
+	Environment env;
+	builder.setMemory(1);
+	builder.addData(WABT_PAGE_SIZE - 2, "hello");
+	auto mod = builder.load(env, "image");
+	TEST_EXPECT(mod);
+
+	// invalid segment is reported by runtime initialization, not by image
+	TEST_EXPECT(!env.getMemoryImage(mod, 0));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(!runtime.init(&env));
+	return true;
+}
+
+}
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+#include "ModuleCache.h"
+#include "Binary.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <fstream>
+
+namespace wasm {
+namespace test {
+
+// temporary cache directory, removed with its entries
+struct CacheDir {
+	String path;
+
+	CacheDir() {
+		char buf[] = "/tmp/spwasm-cache-XXXXXX";
+		if (mkdtemp(buf)) {
+			path = buf;
+		}
+	}
+
+	~CacheDir() {
+		if (auto dir = opendir(path.data())) {
+			while (auto ent = readdir(dir)) {
+				if (ent->d_name[0] != '.') {
+					::unlink((path + "/" + ent->d_name).data());
+				}
+			}
+			closedir(dir);
+		}
+		::rmdir(path.data());
+	}
+};
+
+static Vector<uint8_t> readFile(const String &path) {
+	std::ifstream stream(path.data(), std::ios::binary);
+	return Vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+static bool writeFile(const String &path, const Vector<uint8_t> &data) {
+	std::ofstream stream(path.data(), std::ios::binary | std::ios::trunc);
+	stream.write((const char *)data.data(), data.size());
+	return stream.good();
+}
+
+static Vector<uint8_t> buildCacheModule(uint32_t seed) {
+	ModuleBuilder builder;
+	builder.setMemory(1);
+	builder.addData(16, "hello");
+	builder.addGlobal(Type::I64, true, seed);
+
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	builder.addFunc(type, makeCountdown(), "countdown", { Type::I32 });
+	builder.addFunc(type, ModuleBuilder::Code().op(Opcode::GetLocal, 0).mem(Opcode::I32Load), "load");
+	return builder.build();
+}
+
+static uint32_t invokeCached(const Environment &env, const StringView &name, uint32_t arg) {
+	ThreadedRuntime runtime;
+	if (!runtime.init(&env)) {
+		return 0xdeadbeef;
+	}
+	return invoke(runtime, "cached", name, { Value(arg) });
+}
+
+RUNTIME_TEST(ModuleCacheStoreLoad) {
+	CacheDir dir;
+	ModuleCache cache;
+	TEST_EXPECT(cache.init(dir.path));
+
+	auto binary = buildCacheModule(1);
+	auto key = cache.getKey(binary.data(), binary.size(), ReadOptions());
+
+	{
+		Environment env;
+		TEST_EXPECT(env.loadModule("cached", cache, binary.data(), binary.size()));
+		TEST_EXPECT(cache.getStats().misses == 1 && cache.getStats().stores == 1);
+		TEST_EXPECT(invokeCached(env, "countdown", 1000) == 1000);
+	}
+
+	auto entry = readFile(cache.getPath(key));
+	TEST_EXPECT(!entry.empty());
+
+	{
+		Environment env;
+		TEST_EXPECT(env.loadModule("cached", cache, binary.data(), binary.size()));
+		TEST_EXPECT(cache.getStats().hits == 1 && cache.getStats().stores == 1);
+		TEST_EXPECT(invokeCached(env, "countdown", 1000) == 1000);
+		TEST_EXPECT(invokeCached(env, "load", 16) == 0x6c6c6568); // "hell"
+	}
+
+	// entries do not depend on uninitialized padding, so same translation gives same bytes
+	{
+		Environment env;
+		Module mod;
+		TEST_EXPECT(mod.init(&env, binary.data(), binary.size(), ReadOptions()));
+
+		// padding of records is not initialized by translator, it can hold any garbage
+		const size_t padding = offsetof(Func::OpcodeRec, value64) - sizeof(Opcode::Enum);
+		for (Index i = 0; i < mod.getFuncIndexVec().size(); ++ i) {
+			for (auto &it : mod.getFunc(i)->opcodes) {
+				memset((uint8_t *)&it + sizeof(Opcode::Enum), 0xAA, padding);
+			}
+		}
+
+		TEST_EXPECT(::unlink(cache.getPath(key).data()) == 0);
+		TEST_EXPECT(cache.store(mod, &env, key));
+		TEST_EXPECT(readFile(cache.getPath(key)) == entry);
+	}
+	return true;
+}
+
+RUNTIME_TEST(ModuleCacheInvalidation) {
+	CacheDir dir;
+	ModuleCache cache;
+	TEST_EXPECT(cache.init(dir.path));
+
+	auto binary = buildCacheModule(1);
+	auto key = cache.getKey(binary.data(), binary.size(), ReadOptions());
+
+	// translation format is identified by explicit version, not by time of build
+	auto id = ModuleReader::getBuildId();
+	TEST_EXPECT(id.size() > 0 && id == ModuleReader::getBuildId());
+	auto prefix = "translation-" + std::to_string(ModuleReader::kTranslationVersion) + "-";
+	TEST_EXPECT(id.substr(0, prefix.size()) == StringView(prefix));
+
+	// options, that change translation, binary and build ID are parts of key
+	ReadOptions opts;
+	opts.features.setFuelMetering(true);
+	auto other = buildCacheModule(2);
+	TEST_EXPECT(cache.getKey(binary.data(), binary.size(), opts) != key);
+	TEST_EXPECT(cache.getKey(other.data(), other.size(), ReadOptions()) != key);
+
+	ModuleCache otherBuild;
+	TEST_EXPECT(otherBuild.init(dir.path, "other-build"));
+	TEST_EXPECT(otherBuild.getKey(binary.data(), binary.size(), ReadOptions()) != key);
+
+	Environment env;
+	TEST_EXPECT(env.loadModule("cached", cache, binary.data(), binary.size()));
+
+	// entry, stored with other build ID, is not used, even when it is found by key
+	Module mod;
+	TEST_EXPECT(!otherBuild.load(mod, &env, key));
+	TEST_EXPECT(otherBuild.getStats().misses == 1);
+
+	TEST_EXPECT(cache.load(mod, &env, key));
+	TEST_EXPECT(cache.getStats().hits == 1);
+	return true;
+}
+
+RUNTIME_TEST(ModuleCacheCorrupt) {
+	CacheDir dir;
+	ModuleCache cache;
+	TEST_EXPECT(cache.init(dir.path, StringView(), true));
+
+	auto binary = buildCacheModule(1);
+	auto key = cache.getKey(binary.data(), binary.size(), ReadOptions());
+	auto path = cache.getPath(key);
+
+	{
+		Environment env;
+		TEST_EXPECT(env.loadModule("cached", cache, binary.data(), binary.size()));
+	}
+
+	auto entry = readFile(path);
+	TEST_EXPECT(entry.size() > 128);
+
+	auto expectMiss = [&] (const Vector<uint8_t> &data) {
+		if (!writeFile(path, data)) {
+			return false;
+		}
+
+		Environment env;
+		Module mod;
+		auto misses = cache.getStats().misses;
+		if (cache.load(mod, &env, key) || cache.getStats().misses != misses + 1 || !mod.getFuncIndexVec().empty()) {
+			return false;
+		}
+
+		// environment reads module again and replaces entry
+		auto stores = cache.getStats().stores;
+		return env.loadModule("cached", cache, binary.data(), binary.size()) && cache.getStats().stores == stores + 1
+				&& invokeCached(env, "countdown", 100) == 100 && readFile(path) == entry;
+	};
+
+	// truncated entries
+	TEST_EXPECT(expectMiss(Vector<uint8_t>(entry.begin(), entry.begin() + 16)));
+	TEST_EXPECT(expectMiss(Vector<uint8_t>(entry.begin(), entry.end() - 8)));
+
+	// broken header
+	auto data = entry;
+	data[0] = 'X';
+	TEST_EXPECT(expectMiss(data));
+
+	// changed payload is detected by checksum
+	data = entry;
+	data[entry.size() - 32] ^= 0xFF;
+	TEST_EXPECT(expectMiss(data));
+
+	TEST_EXPECT(expectMiss(Vector<uint8_t>()));
+	return true;
+}
+
+}
+}
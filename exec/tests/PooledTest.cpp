@@ -0,0 +1,222 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+#include "PooledRuntime.h"
+#include <set>
+
+namespace wasm {
+namespace test {
+
+static Result pooled_pause(Thread *thread, const HostFunc *func, Value *buffer) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	return Result::Ok;
+}
+
+// (func $work (param i32) (result i32)): calls env.pause, then counts param down
+static bool loadPooledModule(ModuleBuilder &builder, Environment &env) {
+	env.getEnvModule()->addFunc("pause", &pooled_pause, { }, { });
+
+	auto pause = builder.addImport("env", "pause", builder.addType({ }, { }));
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	builder.addFunc(type, makeCountdown(), "countdown", { Type::I32 });
+	builder.addFunc(type, ModuleBuilder::Code().op(Opcode::Call, pause).append(makeCountdown()), "work", { Type::I32 });
+
+	return builder.load(env, "pooled", ReadOptions()) != nullptr;
+}
+
+RUNTIME_TEST(PooledResultDelivery) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadPooledModule(builder, env));
+
+	PooledRuntimeOptions opts;
+	opts.workers = 4;
+
+	PooledRuntime runtime;
+	TEST_EXPECT(runtime.init(&env, opts));
+
+	auto mod = runtime.getModule("pooled");
+	auto func = runtime.getExportFunc("pooled", "countdown");
+	TEST_EXPECT(mod && func);
+
+	Vector<std::future<PooledRuntime::CallResult>> futures;
+	for (uint32_t i = 0; i < 200; ++ i) {
+		futures.emplace_back(runtime.submit(*func, Vector<Value>{ Value(i) }));
+	}
+
+	for (uint32_t i = 0; i < futures.size(); ++ i) {
+		auto ret = futures[i].get();
+		TEST_EXPECT(ret.result == Thread::Result::Ok && ret.values.size() == 1 && ret.values[0].i32 == i);
+	}
+
+	// every call of batch is delivered once, with its own results
+	const uint32_t count = 500;
+	Vector<Vector<Value>> batch;
+	for (uint32_t i = 0; i < count; ++ i) {
+		batch.emplace_back(Vector<Value>{ Value(i * 3) });
+	}
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	Vector<uint32_t> delivered(count, 0);
+	uint32_t completed = 0;
+	bool valid = true;
+
+	runtime.submit(*mod, *func, std::move(batch), [&] (Index idx, PooledRuntime::CallResult &&ret) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (ret.result != Thread::Result::Ok || ret.values.size() != 1 || ret.values[0].i32 != idx * 3) {
+			valid = false;
+		}
+		++ delivered[idx];
+		if (++ completed == count) {
+			cond.notify_all();
+		}
+	});
+
+	std::unique_lock<std::mutex> lock(mutex);
+	cond.wait(lock, [&] { return completed == count; });
+	TEST_EXPECT(valid);
+	TEST_EXPECT(std::all_of(delivered.begin(), delivered.end(), [] (uint32_t n) { return n == 1; }));
+	lock.unlock();
+
+	runtime.stop();
+	TEST_EXPECT(runtime.getWorkersCount() == 0);
+	return true;
+}
+
+RUNTIME_TEST(PooledWorkStealing) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadPooledModule(builder, env));
+
+	PooledRuntimeOptions opts;
+	opts.workers = 4;
+
+	PooledRuntime runtime;
+	TEST_EXPECT(runtime.init(&env, opts));
+
+	auto mod = runtime.getModule("pooled");
+	auto func = runtime.getExportFunc("pooled", "work");
+	TEST_EXPECT(mod && func);
+
+	// whole batch is placed into inbox of one worker, other workers can only steal from it
+	const uint32_t count = 64;
+	Vector<Vector<Value>> batch;
+	for (uint32_t i = 0; i < count; ++ i) {
+		batch.emplace_back(Vector<Value>{ Value(i) });
+	}
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::set<std::thread::id> workers;
+	uint32_t completed = 0;
+	bool valid = true;
+
+	runtime.submit(*mod, *func, std::move(batch), [&] (Index idx, PooledRuntime::CallResult &&ret) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (ret.result != Thread::Result::Ok || ret.values.size() != 1 || ret.values[0].i32 != idx) {
+			valid = false;
+		}
+		workers.emplace(std::this_thread::get_id());
+		if (++ completed == count) {
+			cond.notify_all();
+		}
+	});
+
+	std::unique_lock<std::mutex> lock(mutex);
+	cond.wait(lock, [&] { return completed == count; });
+	TEST_EXPECT(valid);
+	TEST_EXPECT(workers.size() > 1);
+	return true;
+}
+
+
+// stops runtime from worker, ctx is pointer to runtime pointer
+static Result pooled_stop(Thread *thread, const HostFunc *func, Value *buffer) {
+	(*(PooledRuntime **)func->ctx)->stop();
+	return Result::Ok;
+}
+
+RUNTIME_TEST(PooledStop) {
+	PooledRuntime *target = nullptr;
+
+	ModuleBuilder builder;
+	Environment env;
+	env.getEnvModule()->addFunc("stop", &pooled_stop, { }, { }, &target);
+
+	auto stop = builder.addImport("env", "stop", builder.addType({ }, { }));
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	builder.addFunc(type, ModuleBuilder::Code().op(Opcode::Call, stop).op(Opcode::GetLocal, 0), "stop");
+	builder.addFunc(type, makeCountdown(), "countdown", { Type::I32 });
+	TEST_EXPECT(builder.load(env, "pooled", ReadOptions()));
+
+	PooledRuntimeOptions opts;
+	opts.workers = 2;
+
+	// stop from worker does not join it, but rejects calls from other threads
+	PooledRuntime runtime;
+	TEST_EXPECT(runtime.init(&env, opts));
+	target = &runtime;
+
+	auto func = runtime.getExportFunc("pooled", "stop");
+	auto countdown = runtime.getExportFunc("pooled", "countdown");
+	TEST_EXPECT(func && countdown);
+
+	auto ret = runtime.submit(*func, Vector<Value>{ Value(uint32_t(5)) }).get();
+	TEST_EXPECT(ret.result == Thread::Result::Ok && ret.values[0].i32 == 5);
+	TEST_EXPECT(runtime.submit(*countdown, Vector<Value>{ Value(uint32_t(5)) }).get().result == Thread::Result::TrapHostTrapped);
+
+	runtime.stop();
+	TEST_EXPECT(runtime.getWorkersCount() == 0);
+
+	// calls, submitted concurrently with stop, are completed or rejected
+	PooledRuntime concurrent;
+	TEST_EXPECT(concurrent.init(&env, opts));
+	countdown = concurrent.getExportFunc("pooled", "countdown");
+	TEST_EXPECT(countdown);
+
+	Vector<std::future<PooledRuntime::CallResult>> futures;
+	std::atomic<bool> started(false);
+	std::thread submitter([&] {
+		for (uint32_t i = 0; i < 2000; ++ i) {
+			futures.emplace_back(concurrent.submit(*countdown, Vector<Value>{ Value(i) }));
+			started.store(true);
+		}
+	});
+
+	const bool submitted = waitFor([&] { return started.load(); });
+	concurrent.stop();
+	submitter.join();
+	TEST_EXPECT(submitted);
+
+	uint32_t completed = 0;
+	for (uint32_t i = 0; i < futures.size(); ++ i) {
+		auto ret = futures[i].get();
+		if (ret.result == Thread::Result::Ok) {
+			TEST_EXPECT(ret.values[0].i32 == i);
+			++ completed;
+		} else {
+			TEST_EXPECT(ret.result == Thread::Result::TrapHostTrapped);
+		}
+	}
+	TEST_EXPECT(completed > 0 && concurrent.getWorkersCount() == 0);
+	TEST_EXPECT(concurrent.submit(*countdown, Vector<Value>{ Value(uint32_t(5)) }).get().result == Thread::Result::TrapHostTrapped);
+	return true;
+}
+
+}
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+#include "RuntimePool.h"
+
+namespace wasm {
+namespace test {
+
+// memory with store/load, mutable global counter with inc, and countdown
+static bool loadPoolModule(ModuleBuilder &builder, Environment &env) {
+	builder.setMemory(1);
+	builder.addGlobal(Type::I32, true, 0);
+
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	builder.addFunc(builder.addType({ Type::I32, Type::I32 }, { }), ModuleBuilder::Code()
+		.op(Opcode::GetLocal, 0).op(Opcode::GetLocal, 1).mem(Opcode::I32Store), "store");
+	builder.addFunc(type, ModuleBuilder::Code().op(Opcode::GetLocal, 0).mem(Opcode::I32Load), "load");
+	builder.addFunc(builder.addType({ }, { Type::I32 }), ModuleBuilder::Code()
+		.op(Opcode::GetGlobal, 0).i32(1).op(Opcode::I32Add).op(Opcode::SetGlobal, 0).op(Opcode::GetGlobal, 0), "inc");
+	builder.addFunc(type, makeCountdown(), "countdown", { Type::I32 });
+
+	return builder.load(env, "pool") != nullptr;
+}
+
+RUNTIME_TEST(RuntimePoolReset) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadPoolModule(builder, env));
+
+	RuntimePoolOptions opts;
+	opts.size = 2;
+
+	RuntimePool pool;
+	TEST_EXPECT(pool.init(&env, opts, [] (ThreadedRuntime &runtime) {
+		invoke(runtime, "pool", "store", { Value(uint32_t(100)), Value(uint32_t(7)) });
+		return invoke(runtime, "pool", "inc") == 1;
+	}));
+
+	std::atomic<uint32_t> callbacks(0);
+	pool.setResetCallback([&] (ThreadedRuntime &) {
+		++ callbacks;
+		return true;
+	});
+
+	TEST_EXPECT(waitFor([&] { return pool.getStats().ready == 2; }));
+
+	auto runtime = pool.acquire();
+	TEST_EXPECT(runtime);
+	TEST_EXPECT(invoke(*runtime, "pool", "load", { Value(uint32_t(100)) }) == 7);
+	TEST_EXPECT(invoke(*runtime, "pool", "inc") == 2);
+
+	// request leaves modified state, limits and pending interrupt
+	invoke(*runtime, "pool", "store", { Value(uint32_t(100)), Value(uint32_t(9)) });
+	invoke(*runtime, "pool", "inc");
+	auto &thread = runtime->getMainThread();
+	const auto stackPointer = thread.getUserStackPointer();
+	thread.setUserStackPointer(stackPointer + 16);
+	thread.setFuelSlice(10);
+	thread.setFuel(5);
+	thread.interrupt();
+
+	auto stats = pool.getStats();
+	TEST_EXPECT(stats.hits == 1 && stats.misses == 0 && stats.active == 1 && stats.ready == 1);
+
+	// instance is reset and returned to the top of ready list
+	pool.release(runtime);
+	TEST_EXPECT(waitFor([&] { return pool.getStats().ready == 2; }));
+	TEST_EXPECT(pool.acquire() == runtime);
+	TEST_EXPECT(callbacks == 1);
+
+	TEST_EXPECT(thread.getFuel() == Thread::kUnlimitedFuel && thread.getFuelSlice() == 0);
+	TEST_EXPECT(thread.getDeadline() == Thread::kNoDeadline && !thread.isInterrupted());
+	TEST_EXPECT(thread.NumValues() == 0);
+	TEST_EXPECT(thread.getUserStackPointer() == stackPointer);
+
+	TEST_EXPECT(invoke(*runtime, "pool", "load", { Value(uint32_t(100)) }) == 7);
+	TEST_EXPECT(invoke(*runtime, "pool", "inc") == 2);
+	TEST_EXPECT(invoke(*runtime, "pool", "countdown", { Value(uint32_t(1000)) }) == 1000);
+
+	// without refill, empty pool creates instance in place
+	pool.setSize(0);
+	auto second = pool.acquire();
+	auto third = pool.acquire();
+	TEST_EXPECT(second && third);
+	TEST_EXPECT(invoke(*third, "pool", "load", { Value(uint32_t(100)) }) == 7);
+
+	stats = pool.getStats();
+	TEST_EXPECT(stats.hits == 3 && stats.misses == 1 && stats.active == 3 && stats.ready == 0);
+
+	// instances above size are destroyed without reset
+	pool.release(runtime);
+	pool.release(second);
+	pool.release(third);
+	TEST_EXPECT(pool.getStats().active == 0);
+
+	pool.stop();
+	TEST_EXPECT(pool.getStats().resets == 1 && callbacks == 1);
+	return true;
+}
+
+RUNTIME_TEST(RuntimePoolResize) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadPoolModule(builder, env));
+
+	RuntimePoolOptions opts;
+	opts.size = 2;
+
+	RuntimePool pool;
+	TEST_EXPECT(pool.init(&env, opts));
+
+	// size is changed, while pool and acquire create instances
+	std::atomic<bool> done(false);
+	std::thread resizer([&] {
+		uint32_t size = 0;
+		while (!done) {
+			pool.setSize(size ++ % 4);
+			std::this_thread::yield();
+		}
+	});
+
+	bool valid = true;
+	for (uint32_t i = 0; i < 200; ++ i) {
+		auto runtime = pool.acquire();
+		if (!runtime) {
+			valid = false;
+			break;
+		}
+		if (invoke(*runtime, "pool", "inc") != 1) {
+			valid = false;
+		}
+		pool.release(runtime);
+	}
+
+	done = true;
+	resizer.join();
+	TEST_EXPECT(valid);
+
+	pool.setSize(1);
+	TEST_EXPECT(pool.getSize() == 1);
+	TEST_EXPECT(waitFor([&] { return pool.getStats().ready >= 1; }));
+
+	auto stats = pool.getStats();
+	TEST_EXPECT(stats.active == 0 && stats.hits + stats.misses == 200);
+
+	pool.stop();
+	return true;
+}
+
+}
+}
@@ -0,0 +1,340 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+#include <iostream>
+
+namespace wasm {
+namespace test {
+
+static Vector<RuntimeTest *> &getTests() {
+	// registered from static constructors of test files
+	static Vector<RuntimeTest *> s_tests;
+	return s_tests;
+}
+
+bool RuntimeTest::run(const StringView &filter) {
+	bool success = true;
+	for (auto &it : getTests()) {
+		StringView name(it->_name);
+		if (!filter.empty() && name.find(filter) == StringView::npos) {
+			continue;
+		}
+
+		StringStream stream;
+		std::cout << "== Begin " << name << " ==\n";
+		if (!it->_callback(stream)) {
+			std::cout << stream.str();
+			std::cout << "== Failed ==\n";
+			success = false;
+		} else {
+			std::cout << "== Success ==\n";
+		}
+	}
+	return success;
+}
+
+RuntimeTest::RuntimeTest(const char *name, Callback cb) : _name(name), _callback(cb) {
+	getTests().emplace_back(this);
+}
+
+static void writeU32(Vector<uint8_t> &out, uint32_t value) {
+	do {
+		uint8_t byte = value & 0x7f;
+		value >>= 7;
+		out.emplace_back(value ? (byte | 0x80) : byte);
+	} while (value);
+}
+
+static void writeS64(Vector<uint8_t> &out, int64_t value) {
+	bool more = true;
+	while (more) {
+		uint8_t byte = value & 0x7f;
+		value >>= 7;
+		more = !((value == 0 && (byte & 0x40) == 0) || (value == -1 && (byte & 0x40) != 0));
+		out.emplace_back(more ? (byte | 0x80) : byte);
+	}
+}
+
+static void writeType(Vector<uint8_t> &out, Type type) {
+	out.emplace_back(uint8_t(int(type) & 0x7f));
+}
+
+static void writeString(Vector<uint8_t> &out, const StringView &str) {
+	writeU32(out, str.size());
+	out.insert(out.end(), str.data(), str.data() + str.size());
+}
+
+static void writeSection(Vector<uint8_t> &out, uint8_t id, const Vector<uint8_t> &section) {
+	out.emplace_back(id);
+	writeU32(out, section.size());
+	out.insert(out.end(), section.begin(), section.end());
+}
+
+ModuleBuilder::Code &ModuleBuilder::Code::op(Opcode opcode) {
+	if (opcode.HasPrefix()) {
+		_data.emplace_back(opcode.GetPrefix());
+		writeU32(_data, opcode.GetCode());
+	} else {
+		_data.emplace_back(uint8_t(opcode.GetCode()));
+	}
+	return *this;
+}
+
+ModuleBuilder::Code &ModuleBuilder::Code::op(Opcode opcode, uint32_t imm) {
+	op(opcode);
+	writeU32(_data, imm);
+	return *this;
+}
+
+ModuleBuilder::Code &ModuleBuilder::Code::mem(Opcode opcode, uint32_t offset) {
+	uint32_t align = 0;
+	while ((1U << align) < opcode.GetMemorySize()) {
+		++ align;
+	}
+	op(opcode);
+	writeU32(_data, align);
+	writeU32(_data, offset);
+	return *this;
+}
+
+ModuleBuilder::Code &ModuleBuilder::Code::block(Opcode opcode, Type type) {
+	op(opcode);
+	writeType(_data, type);
+	return *this;
+}
+
+ModuleBuilder::Code &ModuleBuilder::Code::append(const Code &code) {
+	_data.insert(_data.end(), code._data.begin(), code._data.end());
+	return *this;
+}
+
+ModuleBuilder::Code &ModuleBuilder::Code::i32(int32_t value) {
+	op(Opcode::I32Const);
+	writeS64(_data, value);
+	return *this;
+}
+
+ModuleBuilder::Code &ModuleBuilder::Code::i64(int64_t value) {
+	op(Opcode::I64Const);
+	writeS64(_data, value);
+	return *this;
+}
+
+ModuleBuilder::Code &ModuleBuilder::Code::u32(uint32_t value) {
+	writeU32(_data, value);
+	return *this;
+}
+
+ModuleBuilder::Code &ModuleBuilder::Code::s64(int64_t value) {
+	writeS64(_data, value);
+	return *this;
+}
+
+Index ModuleBuilder::addType(TypeInitList params, TypeInitList results) {
+	_types.emplace_back(params, results);
+	return _types.size() - 1;
+}
+
+Index ModuleBuilder::addImport(const StringView &module, const StringView &field, Index type) {
+	_imports.emplace_back(Import{String(module.data(), module.size()), String(field.data(), field.size()), type});
+	return _imports.size() - 1;
+}
+
+Index ModuleBuilder::addFunc(Index type, const Code &code, const StringView &exportName, TypeInitList locals) {
+	const Index idx = _imports.size() + _funcs.size();
+	_funcs.emplace_back(Function{type, Vector<Type>(locals), code.data()});
+	if (!exportName.empty()) {
+		_exports.emplace_back(Export{String(exportName.data(), exportName.size()), ExternalKind::Func, idx});
+	}
+	return idx;
+}
+
+Index ModuleBuilder::addGlobal(Type type, bool mut, int64_t value, const StringView &exportName) {
+	_globals.emplace_back(Global{type, mut, value});
+	if (!exportName.empty()) {
+		_exports.emplace_back(Export{String(exportName.data(), exportName.size()), ExternalKind::Global, Index(_globals.size() - 1)});
+	}
+	return _globals.size() - 1;
+}
+
+void ModuleBuilder::setMemory(uint32_t initial, uint32_t max, bool shared, const StringView &exportName) {
+	_memory = true;
+	_shared = shared;
+	_initial = initial;
+	_max = max;
+	if (!exportName.empty()) {
+		_exports.emplace_back(Export{String(exportName.data(), exportName.size()), ExternalKind::Memory, 0});
+	}
+}
+
+void ModuleBuilder::addData(uint32_t offset, const StringView &data) {
+	_data.emplace_back(offset, String(data.data(), data.size()));
+}
+
+Vector<uint8_t> ModuleBuilder::build() const {
+	Vector<uint8_t> ret{ 0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00 };
+	Vector<uint8_t> section;
+
+	if (!_types.empty()) {
+		writeU32(section, _types.size());
+		for (auto &it : _types) {
+			section.emplace_back(0x60);
+			writeU32(section, it.params.size());
+			for (auto &t : it.params) { writeType(section, t); }
+			writeU32(section, it.results.size());
+			for (auto &t : it.results) { writeType(section, t); }
+		}
+		writeSection(ret, 1, section);
+		section.clear();
+	}
+
+	if (!_imports.empty()) {
+		writeU32(section, _imports.size());
+		for (auto &it : _imports) {
+			writeString(section, it.module);
+			writeString(section, it.field);
+			section.emplace_back(uint8_t(ExternalKind::Func));
+			writeU32(section, it.type);
+		}
+		writeSection(ret, 2, section);
+		section.clear();
+	}
+
+	if (!_funcs.empty()) {
+		writeU32(section, _funcs.size());
+		for (auto &it : _funcs) {
+			writeU32(section, it.type);
+		}
+		writeSection(ret, 3, section);
+		section.clear();
+	}
+
+	if (_memory) {
+		writeU32(section, 1);
+		section.emplace_back((_max || _shared ? 0x01 : 0x00) | (_shared ? 0x02 : 0x00));
+		writeU32(section, _initial);
+		if (_max || _shared) {
+			writeU32(section, _max ? _max : _initial);
+		}
+		writeSection(ret, 5, section);
+		section.clear();
+	}
+
+	if (!_globals.empty()) {
+		writeU32(section, _globals.size());
+		for (auto &it : _globals) {
+			writeType(section, it.type);
+			section.emplace_back(it.mut ? 0x01 : 0x00);
+			section.emplace_back(it.type == Type::I64 ? 0x42 : 0x41); // i64.const or i32.const
+			writeS64(section, it.type == Type::I64 ? it.value : int32_t(it.value));
+			section.emplace_back(0x0b); // end
+		}
+		writeSection(ret, 6, section);
+		section.clear();
+	}
+
+	if (!_exports.empty()) {
+		writeU32(section, _exports.size());
+		for (auto &it : _exports) {
+			writeString(section, it.name);
+			section.emplace_back(uint8_t(it.kind));
+			writeU32(section, it.index);
+		}
+		writeSection(ret, 7, section);
+		section.clear();
+	}
+
+	if (!_funcs.empty()) {
+		writeU32(section, _funcs.size());
+		for (auto &it : _funcs) {
+			Vector<uint8_t> body;
+			writeU32(body, it.locals.size());
+			for (auto &t : it.locals) {
+				writeU32(body, 1);
+				writeType(body, t);
+			}
+			body.insert(body.end(), it.code.begin(), it.code.end());
+			body.emplace_back(0x0b); // end
+
+			writeU32(section, body.size());
+			section.insert(section.end(), body.begin(), body.end());
+		}
+		writeSection(ret, 10, section);
+		section.clear();
+	}
+
+	if (!_data.empty()) {
+		writeU32(section, _data.size());
+		for (auto &it : _data) {
+			section.emplace_back(0x00); // active segment of memory 0
+			section.emplace_back(0x41); // i32.const
+			writeS64(section, int32_t(it.first));
+			section.emplace_back(0x0b); // end
+			writeString(section, it.second);
+		}
+		writeSection(ret, 11, section);
+		section.clear();
+	}
+
+	return ret;
+}
+
+Module *ModuleBuilder::load(Environment &env, const StringView &name, const ReadOptions &opts) {
+	_binary = build();
+	return env.loadModule(name, _binary.data(), _binary.size(), opts);
+}
+
+ModuleBuilder::Code makeCountdown() {
+	ModuleBuilder::Code code;
+	code.block(Opcode::Block)
+		.block(Opcode::Loop)
+			.op(Opcode::GetLocal, 0).op(Opcode::I32Eqz).op(Opcode::BrIf, 1)
+			.op(Opcode::GetLocal, 0).i32(1).op(Opcode::I32Sub).op(Opcode::SetLocal, 0)
+			.op(Opcode::GetLocal, 1).i32(1).op(Opcode::I32Add).op(Opcode::SetLocal, 1)
+			.op(Opcode::Br, 0)
+		.op(Opcode::End)
+	.op(Opcode::End)
+	.op(Opcode::GetLocal, 1);
+	return code;
+}
+
+uint32_t invoke(ThreadedRuntime &runtime, const StringView &module, const StringView &name, Vector<Value> args) {
+	auto func = runtime.getExportFunc(module, name);
+	if (!func || runtime.callSafe(*func, args) != Thread::Result::Ok) {
+		return 0xdeadbeef;
+	}
+	return args.empty() ? 0 : args[0].i32;
+}
+
+Func::State getFuncState(const Module *mod, Index idx) {
+	return mod->getFunc(idx)->state->load(std::memory_order_acquire);
+}
+
+size_t countFuncState(const Module *mod, Func::State state, Index funcs) {
+	size_t ret = 0;
+	for (Index i = 0; i < mod->getFuncIndexVec().size() && i < funcs; ++ i) {
+		if (auto func = mod->getFunc(i)) {
+			if (func->state && func->state->load(std::memory_order_acquire) == state) {
+				++ ret;
+			}
+		}
+	}
+	return ret;
+}
+
+}
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXEC_TESTS_RUNTIMETESTS_H_
+#define EXEC_TESTS_RUNTIMETESTS_H_
+
+#include "wasm/ThreadedRuntime.h"
+#include "Opcode.h"
+
+namespace wasm {
+namespace test {
+
+// Behavior tests for runtime API, that can not be expressed with spec scripts (limits, suspension,
+// scheduling, caches); run with `wasm-interp --runtime-tests [filter]`
+class RuntimeTest {
+public:
+	using Callback = bool (*) (std::ostream &);
+
+	// runs tests, which names contains filter, returns false if any test failed
+	static bool run(const StringView &filter = StringView());
+
+	RuntimeTest(const char *name, Callback);
+
+	const char *getName() const { return _name; }
+
+protected:
+	const char *_name;
+	Callback _callback;
+};
+
+// Assembles binary module for tests, spec tools are not required to run them
+class ModuleBuilder {
+public:
+	// function body, without locals declaration and final end
+	class Code {
+	public:
+		Code &op(Opcode);
+		Code &op(Opcode, uint32_t); // local, global, call, br and br_if
+		Code &mem(Opcode, uint32_t offset = 0); // load and store with natural alignment
+		Code &block(Opcode, Type = Type::Void); // block, loop and if
+		Code &append(const Code &);
+
+		Code &i32(int32_t);
+		Code &i64(int64_t);
+
+		Code &u32(uint32_t);
+		Code &s64(int64_t);
+
+		const Vector<uint8_t> &data() const { return _data; }
+
+	protected:
+		Vector<uint8_t> _data;
+	};
+
+	Index addType(TypeInitList params, TypeInitList results);
+
+	// imports should be added before functions
+	Index addImport(const StringView &module, const StringView &field, Index type);
+	Index addFunc(Index type, const Code &, const StringView &exportName = StringView(), TypeInitList locals = TypeInitList());
+
+	// i32 or i64 global with constant initializer
+	Index addGlobal(Type, bool mut, int64_t value, const StringView &exportName = StringView());
+
+	void setMemory(uint32_t initial, uint32_t max = 0, bool shared = false, const StringView &exportName = StringView());
+	void addData(uint32_t offset, const StringView &);
+
+	Vector<uint8_t> build() const;
+
+	// lazy modules refer to binary, so builder should outlive environment
+	Module *load(Environment &, const StringView &name, const ReadOptions & = ReadOptions());
+
+protected:
+	struct Import {
+		String module;
+		String field;
+		Index type;
+	};
+
+	struct Function {
+		Index type;
+		Vector<Type> locals;
+		Vector<uint8_t> code;
+	};
+
+	struct Global {
+		Type type;
+		bool mut;
+		int64_t value;
+	};
+
+	struct Export {
+		String name;
+		ExternalKind kind;
+		Index index;
+	};
+
+	Vector<Module::Signature> _types;
+	Vector<Import> _imports;
+	Vector<Function> _funcs;
+	Vector<Global> _globals;
+	Vector<Export> _exports;
+	Vector<std::pair<uint32_t, String>> _data;
+
+	bool _memory = false;
+	bool _shared = false;
+	uint32_t _initial = 0;
+	uint32_t _max = 0;
+
+	Vector<uint8_t> _binary;
+};
+
+// body of (func (param $n i32) (result i32) (local i32)), that counts $n down to zero in loop
+// and returns number of iterations
+ModuleBuilder::Code makeCountdown();
+
+// calls exported function on main thread of runtime, returns first result (0 without results)
+// or 0xdeadbeef, when call fails
+uint32_t invoke(ThreadedRuntime &, const StringView &module, const StringView &name, Vector<Value> args = Vector<Value>());
+
+// translation state of function, read with ReadOptions::lazy, by index of defined function
+Func::State getFuncState(const Module *, Index);
+
+// number of first funcs defined functions (all with kInvalidIndex) in state
+size_t countFuncState(const Module *, Func::State, Index funcs = kInvalidIndex);
+
+// polls predicate, returns false, when it is not true after 10 seconds
+template <typename Pred>
+inline bool waitFor(const Pred &pred) {
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (!pred()) {
+		if (std::chrono::steady_clock::now() > end) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	return true;
+}
+
+}
+}
+
+#define RUNTIME_TEST(Name) \
+	static bool Name##_test(std::ostream &); \
+	static wasm::test::RuntimeTest Name##_rec(#Name, &Name##_test); \
+	static bool Name##_test(std::ostream &stream)
+
+#define TEST_EXPECT(Expr) \
+	if (!(Expr)) { \
+		stream << __FILE__ << ":" << __LINE__ << ": expectation failed: " #Expr "\n"; \
+		return false; \
+	}
+
+#endif /* EXEC_TESTS_RUNTIMETESTS_H_ */
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+#include <unistd.h>
+
+namespace wasm {
+namespace test {
+
+// memory of 2 pages with "hello" at 16, mutable global counter, store/load/inc exports
+static bool loadMemoryModule(ModuleBuilder &builder, Environment &env) {
+	builder.setMemory(2, 0, false, "memory");
+	builder.addData(16, "hello");
+	builder.addGlobal(Type::I32, true, 0, "counter");
+
+	builder.addFunc(builder.addType({ Type::I32, Type::I32 }, { }), ModuleBuilder::Code()
+		.op(Opcode::GetLocal, 0).op(Opcode::GetLocal, 1).mem(Opcode::I32Store), "store");
+	builder.addFunc(builder.addType({ Type::I32 }, { Type::I32 }), ModuleBuilder::Code()
+		.op(Opcode::GetLocal, 0).mem(Opcode::I32Load), "load");
+	builder.addFunc(builder.addType({ }, { Type::I32 }), ModuleBuilder::Code()
+		.op(Opcode::GetGlobal, 0).i32(1).op(Opcode::I32Add).op(Opcode::SetGlobal, 0).op(Opcode::GetGlobal, 0), "inc");
+
+	return builder.load(env, "memory") != nullptr;
+}
+
+static const uint8_t *getMemory(ThreadedRuntime &runtime) {
+	return runtime.getModule("memory")->memory[0]->data;
+}
+
+RUNTIME_TEST(SnapshotRestore) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadMemoryModule(builder, env));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	invoke(runtime, "memory", "store", { Value(uint32_t(100)), Value(uint32_t(7)) });
+	TEST_EXPECT(invoke(runtime, "memory", "inc") == 1);
+
+	RuntimeSnapshot snap;
+	TEST_EXPECT(runtime.snapshot(snap) && !snap.empty());
+
+	invoke(runtime, "memory", "store", { Value(uint32_t(100)), Value(uint32_t(9)) });
+	invoke(runtime, "memory", "store", { Value(uint32_t(70000)), Value(uint32_t(5)) });
+	TEST_EXPECT(invoke(runtime, "memory", "inc") == 2);
+
+	TEST_EXPECT(runtime.restore(snap));
+	TEST_EXPECT(invoke(runtime, "memory", "load", { Value(uint32_t(100)) }) == 7);
+	TEST_EXPECT(invoke(runtime, "memory", "load", { Value(uint32_t(70000)) }) == 0);
+	TEST_EXPECT(memcmp(getMemory(runtime) + 16, "hello", 5) == 0);
+	TEST_EXPECT(invoke(runtime, "memory", "inc") == 2);
+
+	// new runtime starts from snapshot state
+	LinkingThreadOptions opts;
+	opts.snapshot = &snap;
+
+	ThreadedRuntime clone;
+	TEST_EXPECT(clone.init(&env, opts));
+	TEST_EXPECT(invoke(clone, "memory", "load", { Value(uint32_t(100)) }) == 7);
+	TEST_EXPECT(memcmp(getMemory(clone) + 16, "hello", 5) == 0);
+	TEST_EXPECT(invoke(clone, "memory", "inc") == 2);
+
+	// runtimes do not share modified pages
+	invoke(clone, "memory", "store", { Value(uint32_t(100)), Value(uint32_t(11)) });
+	TEST_EXPECT(invoke(runtime, "memory", "load", { Value(uint32_t(100)) }) == 7);
+
+	TEST_EXPECT(clone.reset());
+	TEST_EXPECT(invoke(clone, "memory", "load", { Value(uint32_t(100)) }) == 7);
+	TEST_EXPECT(invoke(clone, "memory", "inc") == 2);
+	return true;
+}
+
+RUNTIME_TEST(SnapshotResetDirtyPages) {
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadMemoryModule(builder, env));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+	TEST_EXPECT(!runtime.reset()); // no snapshot yet
+
+	RuntimeSnapshot snap;
+	TEST_EXPECT(runtime.snapshot(snap));
+
+	LinkingThreadOptions opts;
+	opts.snapshot = &snap;
+
+	ThreadedRuntime clone;
+	TEST_EXPECT(clone.init(&env, opts));
+
+	const uint32_t pageSize = sysconf(_SC_PAGESIZE);
+	auto memory = clone.getModule("memory")->memory[0];
+
+	Vector<Index> pages;
+	const bool tracked = memory->getDirtyPages(pages);
+	TEST_EXPECT(!tracked || pages.empty());
+
+	// reading does not make pages dirty
+	TEST_EXPECT(invoke(clone, "memory", "load", { Value(uint32_t(16)) }) == 0x6c6c6568); // "hell"
+
+	invoke(clone, "memory", "store", { Value(uint32_t(100)), Value(uint32_t(7)) });
+	invoke(clone, "memory", "store", { Value(uint32_t(pageSize * 5 + 8)), Value(uint32_t(9)) });
+	memory->data[pageSize * 9] = 1; // writes by host are tracked too
+
+	if (tracked) {
+		TEST_EXPECT(memory->getDirtyPages(pages));
+		TEST_EXPECT(pages == (Vector<Index>{ 0, 5, 9 }));
+	}
+
+	TEST_EXPECT(clone.reset());
+	TEST_EXPECT(invoke(clone, "memory", "load", { Value(uint32_t(100)) }) == 0);
+	TEST_EXPECT(invoke(clone, "memory", "load", { Value(uint32_t(pageSize * 5 + 8)) }) == 0);
+	TEST_EXPECT(memory->data[pageSize * 9] == 0);
+	TEST_EXPECT(memcmp(memory->data + 16, "hello", 5) == 0);
+
+	if (tracked) {
+		pages.clear();
+		TEST_EXPECT(memory->getDirtyPages(pages) && pages.empty());
+	}
+
+	// more than half of pages are modified, so memory is remapped
+	for (uint32_t i = 0; i < memory->size; i += pageSize) {
+		memory->data[i] = 1;
+	}
+	TEST_EXPECT(clone.reset());
+	TEST_EXPECT(memory->data[pageSize * 3] == 0);
+	TEST_EXPECT(memcmp(memory->data + 16, "hello", 5) == 0);
+	return true;
+}
+
+}
+}
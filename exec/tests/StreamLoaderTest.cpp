@@ -0,0 +1,147 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+#include "ModuleStreamLoader.h"
+
+namespace wasm {
+namespace test {
+
+static const uint32_t kStreamFuncs = 32;
+
+// memory with segment and kStreamFuncs countdown functions f0, f1, ...; with bad, last body is invalid
+static Vector<uint8_t> buildStreamModule(bool bad = false) {
+	ModuleBuilder builder;
+	builder.setMemory(1);
+	builder.addData(16, "hello");
+	builder.addGlobal(Type::I32, true, 5, "counter");
+
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	for (uint32_t i = 0; i < kStreamFuncs; ++ i) {
+		builder.addFunc(type, makeCountdown(), "f" + std::to_string(i), { Type::I32 });
+	}
+	builder.addFunc(type, ModuleBuilder::Code().op(Opcode::GetLocal, 0).mem(Opcode::I32Load), "load");
+	if (bad) {
+		builder.addFunc(type, ModuleBuilder::Code().op(Opcode::I32Add), "bad");
+	}
+	return builder.build();
+}
+
+static bool feedChunks(ModuleStreamLoader &loader, const Vector<uint8_t> &data, size_t chunk, size_t limit) {
+	for (size_t offset = 0; offset < std::min(data.size(), limit); offset += chunk) {
+		if (!loader.feed(data.data() + offset, std::min(chunk, std::min(data.size(), limit) - offset))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool hasModule(const Environment &env) {
+	return env.getExternalModules().find("stream") != env.getExternalModules().end();
+}
+
+RUNTIME_TEST(StreamLoaderChunks) {
+	auto binary = buildStreamModule();
+
+	for (size_t chunk : { size_t(1), size_t(3), size_t(7), size_t(64), size_t(1000), binary.size() }) {
+		Environment env;
+		ModuleStreamLoader loader;
+		TEST_EXPECT(loader.init(&env, "stream"));
+		TEST_EXPECT(feedChunks(loader, binary, chunk, binary.size()));
+
+		auto mod = loader.finish();
+		TEST_EXPECT(mod && hasModule(env));
+		TEST_EXPECT(loader.getBufferedSize() == 0);
+
+		// only incomplete section or body is buffered
+		if (chunk < 64) {
+			TEST_EXPECT(loader.getPeakBufferedSize() > 0 && loader.getPeakBufferedSize() < binary.size() / 4);
+		}
+
+		ThreadedRuntime runtime;
+		TEST_EXPECT(runtime.init(&env));
+
+		for (uint32_t i = 0; i < kStreamFuncs; ++ i) {
+			auto func = runtime.getExportFunc("stream", "f" + std::to_string(i));
+			Vector<Value> args{ Value(i + 10) };
+			TEST_EXPECT(func && runtime.callSafe(*func, args) == Thread::Result::Ok && args[0].i32 == i + 10);
+		}
+
+		auto load = runtime.getExportFunc("stream", "load");
+		Vector<Value> args{ Value(uint32_t(16)) };
+		TEST_EXPECT(load && runtime.callSafe(*load, args) == Thread::Result::Ok && args[0].i32 == 0x6c6c6568); // "hell"
+	}
+	return true;
+}
+
+RUNTIME_TEST(StreamLoaderIncomplete) {
+	auto binary = buildStreamModule();
+
+	// input ends in header, in section and in function body
+	for (size_t limit : { size_t(5), size_t(20), binary.size() / 2, binary.size() - 1 }) {
+		Environment env;
+		ModuleStreamLoader loader;
+		TEST_EXPECT(loader.init(&env, "stream"));
+		TEST_EXPECT(feedChunks(loader, binary, 7, limit));
+		TEST_EXPECT(hasModule(env));
+		TEST_EXPECT(!loader.finish());
+		TEST_EXPECT(!hasModule(env));
+	}
+
+	// loader, destroyed before finish, removes module
+	Environment env;
+	{
+		ModuleStreamLoader loader;
+		TEST_EXPECT(loader.init(&env, "stream"));
+		TEST_EXPECT(feedChunks(loader, binary, 16, binary.size()));
+	}
+	TEST_EXPECT(!hasModule(env));
+	return true;
+}
+
+RUNTIME_TEST(StreamLoaderInvalid) {
+	auto binary = buildStreamModule(true);
+
+	size_t errors = 0;
+	Environment env;
+	env.setErrorCallback([&] (const StringView &, const StringStream &) {
+		++ errors;
+	});
+
+	// invalid body fails feed, that completes it, later input is rejected
+	ModuleStreamLoader loader;
+	TEST_EXPECT(loader.init(&env, "stream"));
+	TEST_EXPECT(!feedChunks(loader, binary, 5, binary.size()));
+	TEST_EXPECT(errors > 0 && !hasModule(env));
+	TEST_EXPECT(!loader.feed(binary.data(), 1));
+	TEST_EXPECT(!loader.finish());
+
+	// malformed header
+	Vector<uint8_t> header{ 0, 'a', 's', 'x', 1, 0, 0, 0 };
+	TEST_EXPECT(loader.init(&env, "stream"));
+	TEST_EXPECT(!loader.feed(header.data(), header.size()));
+	TEST_EXPECT(!hasModule(env));
+
+	// loader can be reused after failure
+	binary = buildStreamModule();
+	TEST_EXPECT(loader.init(&env, "stream"));
+	TEST_EXPECT(feedChunks(loader, binary, 5, binary.size()));
+	TEST_EXPECT(loader.finish() && hasModule(env));
+	return true;
+}
+
+}
+}
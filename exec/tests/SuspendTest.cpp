@@ -0,0 +1,124 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimeTests.h"
+
+namespace wasm {
+namespace test {
+
+// arguments of suspended host calls
+static Result suspend_read(Thread *thread, const HostFunc *func, Value *buffer) {
+	((Vector<uint32_t> *)func->ctx)->emplace_back(buffer[0].i32);
+	return Result::Suspend;
+}
+
+// (func $read2 (param i32) (result i32)): env.read(env.read(param) + 1)
+static bool loadSuspendModule(ModuleBuilder &builder, Environment &env, Vector<uint32_t> *reads) {
+	env.getEnvModule()->addFunc("read", &suspend_read, { Type::I32 }, { Type::I32 }, reads);
+
+	auto type = builder.addType({ Type::I32 }, { Type::I32 });
+	auto read = builder.addImport("env", "read", type);
+	builder.addFunc(type, makeCountdown(), "countdown", { Type::I32 });
+	builder.addFunc(type, ModuleBuilder::Code()
+		.op(Opcode::GetLocal, 0).op(Opcode::Call, read)
+		.i32(1).op(Opcode::I32Add).op(Opcode::Call, read), "read2");
+
+	return builder.load(env, "suspend") != nullptr;
+}
+
+RUNTIME_TEST(SuspendResume) {
+	Vector<uint32_t> reads;
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadSuspendModule(builder, env, &reads));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	auto mod = runtime.getModule("suspend");
+	auto func = runtime.getExportFunc("suspend", "read2");
+	TEST_EXPECT(mod && func);
+
+	Thread thread(&runtime);
+	TEST_EXPECT(thread.init());
+	thread.setSuspendable(true);
+
+	Value buffer[1] = { Value(uint32_t(5)) };
+	TEST_EXPECT(thread.Run(*mod, *func, buffer, true) == Thread::Result::Suspended);
+	TEST_EXPECT(thread.isSuspended() && thread.getSuspendedFunc());
+	TEST_EXPECT(reads == Vector<uint32_t>{ 5 });
+
+	Value result(uint32_t(50));
+	TEST_EXPECT(thread.Resume(&result) == Thread::Result::Suspended);
+	TEST_EXPECT(reads == (Vector<uint32_t>{ 5, 51 }));
+
+	// suspended call can be continued from other OS thread
+	Thread::Result res = Thread::Result::Ok;
+	std::thread os([&] {
+		Value result(uint32_t(510));
+		res = thread.Resume(&result);
+	});
+	os.join();
+
+	TEST_EXPECT(res == Thread::Result::Ok && !thread.isSuspended());
+	TEST_EXPECT(buffer[0].i32 == 510);
+	TEST_EXPECT(thread.NumValues() == 0);
+
+	// Resume of thread, that is not suspended, fails
+	TEST_EXPECT(thread.Resume(&result) == Thread::Result::TrapHostTrapped);
+	return true;
+}
+
+RUNTIME_TEST(SuspendCancel) {
+	Vector<uint32_t> reads;
+	ModuleBuilder builder;
+	Environment env;
+	TEST_EXPECT(loadSuspendModule(builder, env, &reads));
+
+	ThreadedRuntime runtime;
+	TEST_EXPECT(runtime.init(&env));
+
+	auto mod = runtime.getModule("suspend");
+	auto func = runtime.getExportFunc("suspend", "read2");
+	auto countdown = runtime.getExportFunc("suspend", "countdown");
+	TEST_EXPECT(mod && func && countdown);
+
+	Thread thread(&runtime);
+	TEST_EXPECT(thread.init());
+	thread.setSuspendable(true);
+
+	Value buffer[1] = { Value(uint32_t(7)) };
+	TEST_EXPECT(thread.Run(*mod, *func, buffer, true) == Thread::Result::Suspended);
+	TEST_EXPECT(thread.Cancel() == Thread::Result::TrapHostTrapped);
+	TEST_EXPECT(!thread.isSuspended() && thread.NumValues() == 0);
+	TEST_EXPECT(thread.Cancel() == Thread::Result::TrapHostTrapped);
+
+	// stacks are unwound, so thread can run next call
+	buffer[0] = Value(uint32_t(10));
+	TEST_EXPECT(thread.Run(*mod, *countdown, buffer, true) == Thread::Result::Ok && buffer[0].i32 == 10);
+
+	// calls through ThreadedRuntime are not suspendable, suspension is handled as host trap
+	Vector<Value> args{ Value(uint32_t(7)) };
+	TEST_EXPECT(runtime.callSafe(*func, args) == Thread::Result::TrapHostTrapped);
+	TEST_EXPECT(!runtime.getMainThread().isSuspended());
+
+	args = Vector<Value>{ Value(uint32_t(10)) };
+	TEST_EXPECT(runtime.callSafe(*countdown, args) == Thread::Result::Ok && args[0].i32 == 10);
+	return true;
+}
+
+}
+}
@@ -340,6 +340,12 @@ bool Thread::call(const RuntimeModule &module, const Func &func, Value *paramsIn
 	case Thread::Result::Returned:
 	case Thread::Result::Ok:
 		break;
+	case Thread::Result::Suspended:
+		stream << "Execution suspended: host function suspended the thread";
+		break;
+	case Thread::Result::Preempted:
+		stream << "Execution suspended: time slice is over";
+		break;
 	case Thread::Result::TrapMemoryAccessOutOfBounds:
 		stream << "Execution failed: out of bounds memory access";
 		break;
@@ -376,6 +382,18 @@ bool Thread::call(const RuntimeModule &module, const Func &func, Value *paramsIn
 	case Thread::Result::TrapUserStackExhausted:
 		stream << "Execution failed: user stack exhausted";
 		break;
+	case Thread::Result::TrapFuelExhausted:
+		stream << "Execution failed: fuel exhausted, instruction limit for the call was reached";
+		break;
+	case Thread::Result::TrapInterrupted:
+		stream << "Execution failed: interrupted, deadline for the call was reached";
+		break;
+	case Thread::Result::TrapExpectedSharedMemory:
+		stream << "Execution failed: atomic wait on unshared memory";
+		break;
+	case Thread::Result::TrapInvalidFunction:
+		stream << "Execution failed: body of lazily translated function is invalid";
+		break;
 	case Thread::Result::TrapHostResultTypeMismatch:
 		stream << "Execution failed: host result type mismatch";
 		break;
@@ -211,6 +211,7 @@ struct ThreadContext {
 	void push(MemCtx &mem, MemPtr<Pool> pool);
 	void push(MemCtx &mem, Pool *pool);
 	void pop(MemCtx &mem);
+	void unwind(MemCtx &mem); // pops all pools, except root
 	MemPtr<Pool> getRoot() const;
 	MemPtr<Pool> top(MemCtx &mem) const;
 };
@@ -668,6 +669,12 @@ void ThreadContext::pop(MemCtx &mem) {
 	unused = tmpStack; // push to unused;
 }
 
+void ThreadContext::unwind(MemCtx &mem) {
+	while (poolStack != nullptr && poolStack.get(mem)->next != nullptr) {
+		pop(mem);
+	}
+}
+
 MemPtr<Pool> ThreadContext::getRoot() const {
 	return root;
 }
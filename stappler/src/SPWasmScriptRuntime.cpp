@@ -146,6 +146,16 @@ ScriptRuntime::MemoryContext *ScriptRuntime::getMemoryContext(const RuntimeMemor
 	return (ScriptRuntime::MemoryContext *)mem.ctx;
 }
 
+bool ScriptRuntime::snapshot() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	return _runtime->snapshot(_snapshot);
+}
+
+bool ScriptRuntime::reset() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	return !_snapshot.empty() && _runtime->restore(_snapshot);
+}
+
 bool ScriptRuntime::onImportMemory(RuntimeMemory &target, const Module::Import &import) {
 	return true;
 }
@@ -200,13 +210,35 @@ bool ScriptThread::init(const Arc<ScriptRuntime> &runtime, const Config & config
 		MemPtr<ThreadContext> ctxPtr = p->palloc(memCtx, sizeof(ThreadContext)).reinterpret<ThreadContext>();
 		new (ctxPtr.get(memCtx)) ThreadContext(memCtx, ADDRESS(memCtx, p));
 
-		_thread->setUserStackPointer(stackp.addr() + config.userStack, stackp.addr());
+		_userStackPointer = stackp.addr() + config.userStack;
+		_userStackGuard = stackp.addr();
+
+		_thread->setUserStackPointer(_userStackPointer, _userStackGuard);
 		_thread->setUserContext(ctxPtr.addr());
 	}
 
 	return true;
 }
 
+void ScriptThread::reset() {
+	_thread->Reset();
+	_thread->setFuelSlice(0);
+	_thread->setFuel(::wasm::Thread::kUnlimitedFuel);
+	_thread->setDeadline(::wasm::Thread::kNoDeadline);
+	_thread->setUserStackPointer(_userStackPointer, _userStackGuard);
+
+	auto runtime = static_cast<ScriptRuntime *>(_runtime.get());
+	auto &memVec = runtime->getRuntime()->getRuntimeMemory();
+	for (const RuntimeMemory &memIt : memVec) {
+		std::unique_lock<std::mutex> lock(runtime->getMutex());
+
+		MemCtx memCtx(_thread, &memIt);
+
+		MemPtr<ThreadContext> ctxPtr(_thread->getUserContext());
+		ctxPtr.get(memCtx)->unwind(memCtx);
+	}
+}
+
 uint32_t ScriptThread::pushString(const RuntimeMemory &mem, const StringView &str) {
 	MemCtx memCtx(_thread, &mem, static_cast<ScriptRuntime *>(_runtime.get())->getMutex());
 
@@ -46,6 +46,12 @@ public:
 	std::mutex &getMutex() const;
 	MemoryContext *getMemoryContext(const RuntimeMemory &) const;
 
+	// captures memory, tables and globals; should be called after threads for reuse are created
+	bool snapshot();
+
+	// restores state from snapshot, so runtime can be reused for next request
+	bool reset();
+
 protected:
 	virtual bool onImportMemory(RuntimeMemory &target, const Module::Import &import) override;
 	//virtual bool onImportTable(RuntimeTable &target, const Module::Import &import);
@@ -55,6 +61,7 @@ protected:
 	virtual bool onMemoryAction(const RuntimeMemory &, uint32_t, RuntimeMemory::Action) override;
 
 	mutable std::mutex _mutex;
+	::wasm::RuntimeSnapshot _snapshot;
 };
 
 class ScriptThread : public Thread {
@@ -77,7 +84,12 @@ public:
 	uint32_t pushString(const RuntimeMemory &, const StringView &);
 	uint32_t pushMemory(const RuntimeMemory &, uint8_t *, size_t s);
 
+	// clears stacks, fuel, deadline and interrupt, restores user stack and unwinds pool stack to root pool
+	void reset();
+
 protected:
+	uint32_t _userStackPointer = 0;
+	uint32_t _userStackGuard = 0;
 };
 
 NS_SP_EXT_END(wasm)
@@ -0,0 +1,53 @@
+;; Test atomic memory operations
+
+(module
+  (memory 1 1 shared)
+
+  (func (export "load") (param i32) (result i32)
+    (i32.atomic.load offset=8 (get_local 0))
+  )
+
+  (func (export "load64") (param i32) (result i64)
+    (i64.atomic.load offset=16 (get_local 0))
+  )
+
+  (func (export "store") (param i32 i32)
+    (i32.atomic.store offset=8 (get_local 0) (get_local 1))
+  )
+
+  (func (export "add") (param i32 i32) (result i32)
+    (i32.atomic.rmw.add offset=8 (get_local 0) (get_local 1))
+  )
+
+  (func (export "sub8") (param i32 i32) (result i32)
+    (i32.atomic.rmw8.sub_u offset=8 (get_local 0) (get_local 1))
+  )
+
+  (func (export "xchg") (param i32 i32) (result i32)
+    (i32.atomic.rmw.xchg offset=8 (get_local 0) (get_local 1))
+  )
+
+  (func (export "or64") (param i32 i64) (result i64)
+    (i64.atomic.rmw.or offset=16 (get_local 0) (get_local 1))
+  )
+
+  (func (export "cmpxchg") (param i32 i32 i32) (result i32)
+    (i32.atomic.rmw.cmpxchg offset=8 (get_local 0) (get_local 1) (get_local 2))
+  )
+
+  (func (export "cmpxchg16") (param i32 i32 i32) (result i32)
+    (i32.atomic.rmw16.cmpxchg_u offset=8 (get_local 0) (get_local 1) (get_local 2))
+  )
+
+  (func (export "wait") (param i32 i32 i64) (result i32)
+    (i32.atomic.wait offset=8 (get_local 0) (get_local 1) (get_local 2))
+  )
+
+  (func (export "wait64") (param i32 i64 i64) (result i32)
+    (i64.atomic.wait offset=16 (get_local 0) (get_local 1) (get_local 2))
+  )
+
+  (func (export "notify") (param i32 i32) (result i32)
+    (atomic.wake offset=8 (get_local 0) (get_local 1))
+  )
+)
@@ -0,0 +1,31 @@
+;; Test bulk memory operations
+
+(module
+  (memory 1)
+  (data (i32.const 16) "hello world")
+  (data passive "ABCDEFGH")
+
+  (func (export "load8") (param i32) (result i32)
+    (i32.load8_u (get_local 0))
+  )
+
+  (func (export "copy") (param i32 i32 i32)
+    (memory.copy (get_local 0) (get_local 1) (get_local 2))
+  )
+
+  (func (export "fill") (param i32 i32 i32)
+    (memory.fill (get_local 0) (get_local 1) (get_local 2))
+  )
+
+  (func (export "init") (param i32 i32 i32)
+    (memory.init 1 (get_local 0) (get_local 1) (get_local 2))
+  )
+
+  (func (export "init-active") (param i32 i32 i32)
+    (memory.init 0 (get_local 0) (get_local 1) (get_local 2))
+  )
+
+  (func (export "drop")
+    (data.drop 1)
+  )
+)
@@ -0,0 +1,40 @@
+;; Loops with induction variable, used as address; bounds checks for such
+;; accesses are hoisted before the loop when range check passes, and remain
+;; in place, when it fails
+
+(module
+  (memory 1 1)
+  (data (i32.const 0) "\01\00\00\00\02\00\00\00\03\00\00\00\04\00\00\00")
+
+  (func (export "sum") (param $p i32) (param $n i32) (result i32)
+    (local $acc i32)
+    (loop $cont
+      (set_local $acc (i32.add (get_local $acc) (i32.load (get_local $p))))
+      (br_if $cont (i32.lt_u (tee_local $p (i32.add (get_local $p) (i32.const 4))) (get_local $n)))
+    )
+    (get_local $acc)
+  )
+
+  (func (export "fill") (param $p i32) (param $n i32) (result i32)
+    (loop $cont
+      (i32.store offset=8 (get_local $p) (get_local $p))
+      (set_local $p (i32.add (get_local $p) (i32.const 4)))
+      (br_if $cont (i32.le_u (get_local $p) (get_local $n)))
+    )
+    (get_local $p)
+  )
+
+  (func (export "load") (param $p i32) (result i32)
+    (i32.load (get_local $p))
+  )
+)
+
+(assert_return (invoke "sum" (i32.const 0) (i32.const 16)) (i32.const 10))
+(assert_return (invoke "sum" (i32.const 8) (i32.const 0)) (i32.const 3))
+(assert_trap (invoke "sum" (i32.const 65536) (i32.const 0)) "out of bounds memory access")
+(assert_trap (invoke "sum" (i32.const 65520) (i32.const 65540)) "out of bounds memory access")
+(assert_return (invoke "fill" (i32.const 0) (i32.const 100)) (i32.const 104))
+(assert_return (invoke "load" (i32.const 104)) (i32.const 96))
+(assert_return (invoke "fill" (i32.const 65524) (i32.const 0)) (i32.const 65528))
+(assert_trap (invoke "fill" (i32.const 65500) (i32.const 65600)) "out of bounds memory access")
+(assert_return (invoke "load" (i32.const 65532)) (i32.const 65524))
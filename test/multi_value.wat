@@ -0,0 +1,68 @@
+;; Test multi-value functions and blocks
+
+(module
+  (type $i32-i32 (func (param i32) (result i32)))
+  (type $i32x2 (func (result i32 i32)))
+  (type $i32x2-i32x2 (func (param i32 i32) (result i32 i32)))
+  (type $i32x2-i32 (func (param i32 i32) (result i32)))
+
+  (func $swap (export "swap") (param i32 i32) (result i32 i32)
+    (get_local 1) (get_local 0)
+  )
+
+  (func (export "sub-swapped") (param i32 i32) (result i32)
+    (i32.sub (call $swap (get_local 0) (get_local 1)))
+  )
+
+  (func (export "pair-i64-f64") (param i64) (result i64 f64)
+    (get_local 0) (f64.convert_s/i64 (get_local 0))
+  )
+
+  (func (export "block-params") (param i32 i32) (result i32 i32 i32)
+    (local i32 i32)
+    (i32.const 7)
+    (get_local 0) (get_local 1)
+    (block (type $i32x2-i32x2)
+      (set_local 2) (set_local 3)
+      (get_local 2) (get_local 3)
+    )
+  )
+
+  (func (export "loop-sum") (param i32) (result i32)
+    (local i32 i32)
+    (i32.const 0) (get_local 0)
+    (loop (type $i32x2-i32)
+      (set_local 1) (set_local 2)
+      (i32.add (get_local 2) (get_local 1))
+      (tee_local 1 (i32.sub (get_local 1) (i32.const 1)))
+      (br_if 0 (get_local 1))
+      (drop)
+    )
+  )
+
+  (func (export "if-params") (param i32 i32) (result i32)
+    (get_local 0)
+    (if (type $i32-i32) (get_local 1)
+      (then (i32.add (i32.const 1)))
+      (else (i32.mul (i32.const 2)))
+    )
+  )
+
+  (func (export "br-pair") (param i32) (result i32 i32)
+    (block (type $i32x2)
+      (i32.const 1) (i32.const 5) (i32.const 6)
+      (br_if 0 (get_local 0))
+      (drop) (drop) (drop)
+      (i32.const 7) (i32.const 8)
+    )
+  )
+
+  (func (export "return-pair") (param i32) (result i32 i32)
+    (i32.const 99)
+    (block
+      (return (get_local 0) (i32.add (get_local 0) (i32.const 1)))
+    )
+    (drop)
+    (i32.const 0) (i32.const 0)
+  )
+)
@@ -0,0 +1,63 @@
+;; Test `return_call` and `return_call_indirect` operators
+
+(module
+  (type $i32-i32 (func (param i32) (result i32)))
+  (type $i64-i64-i64 (func (param i64 i64) (result i64)))
+
+  (table anyfunc (elem $even-indirect $odd-indirect $fac-acc))
+
+  ;; Recursion deeper than call stack
+
+  (func $even (export "even") (param i32) (result i32)
+    (if (result i32) (i32.eqz (get_local 0))
+      (then (i32.const 44))
+      (else (return_call $odd (i32.sub (get_local 0) (i32.const 1))))
+    )
+  )
+  (func $odd (export "odd") (param i32) (result i32)
+    (if (result i32) (i32.eqz (get_local 0))
+      (then (i32.const 99))
+      (else (return_call $even (i32.sub (get_local 0) (i32.const 1))))
+    )
+  )
+
+  (func $even-indirect (export "even-indirect") (param i32) (result i32)
+    (if (result i32) (i32.eqz (get_local 0))
+      (then (i32.const 44))
+      (else (return_call_indirect (type $i32-i32) (i32.sub (get_local 0) (i32.const 1)) (i32.const 1)))
+    )
+  )
+  (func $odd-indirect (export "odd-indirect") (param i32) (result i32)
+    (if (result i32) (i32.eqz (get_local 0))
+      (then (i32.const 99))
+      (else (return_call_indirect (type $i32-i32) (i32.sub (get_local 0) (i32.const 1)) (i32.const 0)))
+    )
+  )
+
+  ;; Declared locals of callee are zeroed in reused frame
+
+  (func $fac-acc (export "fac-acc") (param i64 i64) (result i64)
+    (local i64)
+    (if (result i64) (i64.eqz (get_local 2))
+      (then
+        (if (result i64) (i64.eqz (get_local 0))
+          (then (get_local 1))
+          (else
+            (set_local 2 (i64.const 1))
+            (return_call $fac-acc (i64.sub (get_local 0) (get_local 2)) (i64.mul (get_local 0) (get_local 1)))
+          )
+        )
+      )
+      (else (i64.const -1))
+    )
+  )
+
+  ;; Values of caller below the call are preserved
+
+  (func (export "call-fac") (param i64) (result i64)
+    (i64.add (i64.const 1000) (call $fac-acc (get_local 0) (i64.const 1)))
+  )
+  (func (export "indirect-fac") (param i64 i32) (result i64)
+    (return_call_indirect (type $i64-i64-i64) (get_local 0) (i64.const 1) (get_local 1))
+  )
+)
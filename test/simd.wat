@@ -0,0 +1,86 @@
+;; Test 128-bit SIMD operations
+
+(module
+  (memory 1)
+  (data (i32.const 0) "\00\01\02\03\04\05\06\07\08\09\0a\0b\0c\0d\0e\0f\10\11\12\13\14\15\16\17\18\19\1a\1b\1c\1d\1e\1f")
+
+  (func (export "i32x4.add") (param i32) (result i32)
+    (i32x4.extract_lane 2 (i32x4.add (v128.const i32x4 1 2 3 4) (i32x4.splat (get_local 0))))
+  )
+
+  (func (export "i32x4.mul") (param i32 i32) (result i32)
+    (i32x4.extract_lane 1 (i32x4.mul (i32x4.splat (get_local 0)) (i32x4.splat (get_local 1))))
+  )
+
+  (func (export "i32x4.min_s") (param i32 i32) (result i32)
+    (i32x4.extract_lane 3 (i32x4.min_s (i32x4.splat (get_local 0)) (i32x4.splat (get_local 1))))
+  )
+
+  (func (export "i32x4.min_u") (param i32 i32) (result i32)
+    (i32x4.extract_lane 3 (i32x4.min_u (i32x4.splat (get_local 0)) (i32x4.splat (get_local 1))))
+  )
+
+  (func (export "i8x16.add_sat_u") (param i32 i32) (result i32)
+    (i8x16.extract_lane_u 5 (i8x16.add_sat_u (i8x16.splat (get_local 0)) (i8x16.splat (get_local 1))))
+  )
+
+  (func (export "i8x16.add_sat_s") (param i32 i32) (result i32)
+    (i8x16.extract_lane_s 5 (i8x16.add_sat_s (i8x16.splat (get_local 0)) (i8x16.splat (get_local 1))))
+  )
+
+  (func (export "i8x16.shr_s") (param i32 i32) (result i32)
+    (i8x16.extract_lane_s 0 (i8x16.shr_s (i8x16.splat (get_local 0)) (get_local 1)))
+  )
+
+  (func (export "i16x8.narrow_i32x4_u") (param i32) (result i32)
+    (i16x8.extract_lane_u 7 (i16x8.narrow_i32x4_u (i32x4.splat (get_local 0)) (i32x4.splat (get_local 0))))
+  )
+
+  (func (export "i16x8.abs") (param i32) (result i32)
+    (i16x8.extract_lane_s 3 (i16x8.abs (i16x8.splat (get_local 0))))
+  )
+
+  (func (export "i32x4.all_true") (param i32) (result i32)
+    (i32x4.all_true (i32x4.splat (get_local 0)))
+  )
+
+  (func (export "v128.bitselect") (result i32)
+    (i32x4.extract_lane 0 (v128.bitselect
+      (v128.const i32x4 0xff00ff00 0 0 0)
+      (v128.const i32x4 0x11111111 0 0 0)
+      (v128.const i32x4 0xffff0000 0 0 0)))
+  )
+
+  (func (export "i8x16.shuffle") (result i32)
+    (i32x4.extract_lane 0 (i8x16.shuffle 31 0 30 1 29 2 28 3 27 4 26 5 25 6 24 7
+      (v128.load (i32.const 0)) (v128.load (i32.const 16))))
+  )
+
+  (func (export "i8x16.swizzle") (result i32)
+    (i32x4.extract_lane 0 (i8x16.swizzle (v128.load (i32.const 0)) (v128.const i32x4 0x10ff0203 0 0 0)))
+  )
+
+  (func (export "v128.load") (param i32) (result i32)
+    (i32x4.extract_lane 0 (v128.load (get_local 0)))
+  )
+
+  (func (export "v128.store") (param i32 i32)
+    (v128.store (get_local 0) (i32x4.splat (get_local 1)))
+  )
+
+  (func (export "f32x4.sqrt") (param f32 f32) (result f32)
+    (f32x4.extract_lane 2 (f32x4.sqrt (f32x4.mul (f32x4.splat (get_local 0)) (f32x4.splat (get_local 1)))))
+  )
+
+  (func (export "f32x4.min") (param f32 f32) (result f32)
+    (f32x4.extract_lane 1 (f32x4.min (f32x4.splat (get_local 0)) (f32x4.splat (get_local 1))))
+  )
+
+  (func (export "i32x4.trunc_sat_f32x4_s") (param f32) (result i32)
+    (i32x4.extract_lane 0 (i32x4.trunc_sat_f32x4_s (f32x4.splat (get_local 0))))
+  )
+
+  (func (export "i64x2.replace_lane") (param i64 i64) (result i64)
+    (i64x2.extract_lane 1 (i64x2.replace_lane 1 (i64x2.splat (get_local 0)) (get_local 1)))
+  )
+)
@@ -20,6 +20,8 @@
 #include <alloca.h>
 #include <string.h>
 #include <iomanip>
+#include <thread>
+#include <atomic>
 #include "Binary.h"
 #include "Module.h"
 #include "Environment.h"
@@ -37,6 +39,7 @@
 #include "BinaryCustom.cc"
 #include "BinaryData.cc"
 #include "BinaryObjects.cc"
+#include "BinaryOptimize.cc"
 #include "BinarySource.cc"
 
 namespace wasm {
@@ -362,7 +365,8 @@ enum class NameSectionSubsection {
 	V(Start, start, 8)                 \
 	V(Elem, elem, 9)                   \
 	V(Code, code, 10)                  \
-	V(Data, data, 11)
+	V(Data, data, 11)                   \
+	V(DataCount, data_count, 12)
 
 static const char* g_section_name[] = {
 	"Custom",
@@ -376,7 +380,8 @@ static const char* g_section_name[] = {
 	"Start",
 	"Elem",
 	"Code",
-	"Data"
+	"Data",
+	"DataCount"
 };
 
 static WABT_INLINE const char* GetSectionName(BinarySection sec) {
@@ -384,8 +389,20 @@ static WABT_INLINE const char* GetSectionName(BinarySection sec) {
 	return g_section_name[static_cast<size_t>(sec)];
 }
 
+// DataCount section has larger code, but should be placed between Elem and Code
+static WABT_INLINE int GetSectionOrder(BinarySection sec) {
+	if (sec == BinarySection::DataCount) {
+		return toInt(BinarySection::Elem) * 2 + 1;
+	}
+	return toInt(sec) * 2;
+}
+
 constexpr auto WABT_DEFAULT_SNPRINTF_ALLOCA_BUFSIZE = 256;
 
+// code section is read in parallel, when every thread gets at least this number of bodies
+constexpr Index kMinParallelFunctionBodies = 16;
+constexpr Offset kMinParallelCodeSectionSize = 64 * 1024;
+
 #define CHECK_RESULT(expr) do { if (expr == ::wasm::Result::Error) { return ::wasm::Result::Error; } } while (0)
 
 #define ERROR_UNLESS(expr, V)  \
@@ -408,7 +425,17 @@ public:
 
 	Result ReadModule();
 
+	// incremental reading, every call receives complete unit of input in ReaderState of delegate
+	Result ReadStreamHeader();
+	Result ReadStreamSection();
+	Result BeginStreamCode();
+	Result ReadStreamBody(Index func_index);
+	Result EndStreamCode();
+	Result EndStream();
+
 private:
+	friend class ModuleLazyCode;
+
 	// void WABT_PRINTF_FORMAT(2, 3) PrintError(const char* format, ...);
 
 	template <typename Callback>
@@ -427,6 +454,7 @@ private:
 	Result ReadS32Leb128(uint32_t* out_value, const char* desc) WABT_WARN_UNUSED;
 	Result ReadS64Leb128(uint64_t* out_value, const char* desc) WABT_WARN_UNUSED;
 	Result ReadType(Type* out_value, const char* desc) WABT_WARN_UNUSED;
+	Result ReadBlockSignature(Index* num_params, Type** param_types, Index* num_results, Type** result_types, const char* desc) WABT_WARN_UNUSED;
 	Result ReadStr(StringView* out_str, const char* desc) WABT_WARN_UNUSED;
 	Result ReadBytes(const void** out_data, Address* out_data_size, const char* desc) WABT_WARN_UNUSED;
 	Result ReadIndex(Index* index, const char* desc) WABT_WARN_UNUSED;
@@ -458,15 +486,22 @@ private:
 	Result ReadStartSection(Offset section_size) WABT_WARN_UNUSED;
 	Result ReadElemSection(Offset section_size) WABT_WARN_UNUSED;
 	Result ReadCodeSection(Offset section_size) WABT_WARN_UNUSED;
+	Result ReadCode(Index func_index) WABT_WARN_UNUSED;
+	bool SplitCodeSection(Vector<Offset> &, Offset &end);
+	Result ReadCodeParallel(const Vector<Offset> &, Offset end, uint32_t threads) WABT_WARN_UNUSED;
 	Result ReadDataSection(Offset section_size) WABT_WARN_UNUSED;
+	Result ReadDataCountSection(Offset section_size) WABT_WARN_UNUSED;
 	Result ReadExceptionSection(Offset section_size) WABT_WARN_UNUSED;
 	Result ReadSections() WABT_WARN_UNUSED;
+	Result ReadSection(Result &) WABT_WARN_UNUSED;
 	Result ReportUnexpectedOpcode(Opcode opcode, const char* message = nullptr);
 
 	size_t _read_end = 0; // Either the section end or data_size.
 	ReaderState *_state = nullptr;
 	ModuleReader* _delegate = nullptr;
 	TypeVector _param_types;
+	TypeVector _result_types;
+	Type _block_type = Type::Void;
 	Vector<Index> _target_depths;
 	const ReadOptions* _options = nullptr;
 	BinarySection _last_known_section = BinarySection::Invalid;
@@ -485,6 +520,7 @@ private:
 	Index _num_exports = 0;
 	Index _num_function_bodies = 0;
 	Index _num_exceptions = 0;
+	Index _num_data_segments = kInvalidIndex; // declared in DataCount section
 };
 
 ModuleReader::BinaryReader::BinaryReader(ModuleReader* delegate, const ReadOptions* options)
@@ -598,6 +634,7 @@ Result ModuleReader::BinaryReader::ReadType(Type* out_value, const char* desc) {
 	// Must be in the vs7 range: [-128, 127).
 	ERROR_UNLESS( (static_cast<int32_t>(type) >= -128 && static_cast<int32_t>(type) <= 127), "invalid type: " << type);
 	*out_value = static_cast<Type>(type);
+	ERROR_UNLESS(*out_value != Type::V128 || _options->features.isSimdEnabled(), "v128 type requires SIMD");
 	return Result::Ok;
 }
 
@@ -648,6 +685,7 @@ static bool is_concrete_type(Type type) {
 	case Type::I64:
 	case Type::F32:
 	case Type::F64:
+	case Type::V128:
 		return true;
 
 	default:
@@ -659,6 +697,32 @@ static bool is_inline_sig_type(Type type) {
 	return is_concrete_type(type) || type == Type::Void;
 }
 
+Result ModuleReader::BinaryReader::ReadBlockSignature(Index* num_params, Type** param_types,
+		Index* num_results, Type** result_types, const char* desc) {
+	uint32_t type = 0;
+	CHECK_RESULT(ReadS32Leb128(&type, desc));
+	if (static_cast<int32_t>(type) < 0) {
+		ERROR_UNLESS(static_cast<int32_t>(type) >= -128, "invalid type: " << type);
+		_block_type = static_cast<Type>(type);
+		ERROR_UNLESS(is_inline_sig_type(_block_type), "expected valid block signature type");
+		ERROR_UNLESS(_block_type != Type::V128 || _options->features.isSimdEnabled(), "v128 type requires SIMD");
+		*num_params = 0;
+		*param_types = nullptr;
+		*num_results = (_block_type == Type::Void) ? 0 : 1;
+		*result_types = &_block_type;
+	} else {
+		// multi-value block, typed with signature index
+		ERROR_UNLESS(_options->features.isMultiValueEnabled(), "expected valid block signature type");
+		ERROR_UNLESS(type < _num_signatures, "invalid block signature index: " << type);
+		auto sig = _delegate->_targetModule->getSignature(type);
+		*num_params = sig->params.size();
+		*param_types = sig->params.data();
+		*num_results = sig->results.size();
+		*result_types = sig->results.data();
+	}
+	return Result::Ok;
+}
+
 Index ModuleReader::BinaryReader::NumTotalFuncs() {
 	return _num_func_imports + _num_function_signatures;
 }
@@ -787,7 +851,8 @@ Result ModuleReader::BinaryReader::ReadGlobalHeader(Type* out_type, bool* out_mu
 	Type global_type = Type::Void;
 	uint8_t mutable_ = 0;
 	CHECK_RESULT(ReadType(&global_type, "global type"));
-	ERROR_UNLESS(is_concrete_type(global_type), "invalid global type: " << std::hex << static_cast<int>(global_type));
+	ERROR_UNLESS(is_concrete_type(global_type) && global_type != Type::V128,
+			"invalid global type: " << std::hex << static_cast<int>(global_type));
 
 	CHECK_RESULT(ReadU8(&mutable_, "global mutability"));
 	ERROR_UNLESS(mutable_ <= 1, "global mutability must be 0 or 1");
@@ -808,32 +873,26 @@ Result ModuleReader::BinaryReader::ReadFunctionBody(Offset end_offset) {
 			break;
 
 		case Opcode::Block: {
-			Type sig_type;
-			CHECK_RESULT(ReadType(&sig_type, "block signature type"));
-			ERROR_UNLESS(is_inline_sig_type(sig_type),
-					"expected valid block signature type");
-			Index num_types = sig_type == Type::Void ? 0 : 1;
-			CALLBACK(OnBlockExpr, num_types, &sig_type);
+			Index num_params, num_results;
+			Type *param_types, *result_types;
+			CHECK_RESULT(ReadBlockSignature(&num_params, &param_types, &num_results, &result_types, "block signature type"));
+			CALLBACK(OnBlockExpr, num_params, param_types, num_results, result_types);
 			break;
 		}
 
 		case Opcode::Loop: {
-			Type sig_type;
-			CHECK_RESULT(ReadType(&sig_type, "loop signature type"));
-			ERROR_UNLESS(is_inline_sig_type(sig_type),
-					"expected valid block signature type");
-			Index num_types = sig_type == Type::Void ? 0 : 1;
-			CALLBACK(OnLoopExpr, num_types, &sig_type);
+			Index num_params, num_results;
+			Type *param_types, *result_types;
+			CHECK_RESULT(ReadBlockSignature(&num_params, &param_types, &num_results, &result_types, "loop signature type"));
+			CALLBACK(OnLoopExpr, num_params, param_types, num_results, result_types);
 			break;
 		}
 
 		case Opcode::If: {
-			Type sig_type;
-			CHECK_RESULT(ReadType(&sig_type, "if signature type"));
-			ERROR_UNLESS(is_inline_sig_type(sig_type),
-					"expected valid block signature type");
-			Index num_types = sig_type == Type::Void ? 0 : 1;
-			CALLBACK(OnIfExpr, num_types, &sig_type);
+			Index num_params, num_results;
+			Type *param_types, *result_types;
+			CHECK_RESULT(ReadBlockSignature(&num_params, &param_types, &num_results, &result_types, "if signature type"));
+			CALLBACK(OnIfExpr, num_params, param_types, num_results, result_types);
 			break;
 		}
 
@@ -975,6 +1034,27 @@ Result ModuleReader::BinaryReader::ReadFunctionBody(Offset end_offset) {
 			break;
 		}
 
+		case Opcode::ReturnCall: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			Index func_index;
+			CHECK_RESULT(ReadIndex(&func_index, "return_call function index"));
+			ERROR_UNLESS(func_index < NumTotalFuncs(), "invalid return_call function index: " << func_index);
+			CALLBACK(OnReturnCallExpr, func_index);
+			break;
+		}
+
+		case Opcode::ReturnCallIndirect: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			Index sig_index;
+			CHECK_RESULT(ReadIndex(&sig_index, "return_call_indirect signature index"));
+			ERROR_UNLESS(sig_index < _num_signatures, "invalid return_call_indirect signature index");
+			uint32_t reserved;
+			CHECK_RESULT(ReadU32Leb128(&reserved, "return_call_indirect reserved"));
+			ERROR_UNLESS(reserved == 0, "return_call_indirect reserved value must be 0");
+			CALLBACK(OnReturnCallIndirectExpr, sig_index);
+			break;
+		}
+
 		case Opcode::TeeLocal: {
 			Index local_index;
 			CHECK_RESULT(ReadIndex(&local_index, "tee_local local index"));
@@ -1225,6 +1305,49 @@ Result ModuleReader::BinaryReader::ReadFunctionBody(Offset end_offset) {
 			CALLBACK(OnUnaryExpr, opcode);
 			break;
 
+		case Opcode::MemoryInit: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			Index segment;
+			CHECK_RESULT(ReadIndex(&segment, "memory.init segment index"));
+			uint8_t reserved;
+			CHECK_RESULT(ReadU8(&reserved, "memory.init reserved"));
+			ERROR_UNLESS(reserved == 0, "memory.init reserved value must be 0");
+			ERROR_UNLESS(_num_data_segments != kInvalidIndex, "memory.init requires DataCount section");
+			ERROR_UNLESS(segment < _num_data_segments, "invalid data segment index: " << segment);
+			CALLBACK(OnMemoryInitExpr, segment);
+			break;
+		}
+
+		case Opcode::DataDrop: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			Index segment;
+			CHECK_RESULT(ReadIndex(&segment, "data.drop segment index"));
+			ERROR_UNLESS(_num_data_segments != kInvalidIndex, "data.drop requires DataCount section");
+			ERROR_UNLESS(segment < _num_data_segments, "invalid data segment index: " << segment);
+			CALLBACK(OnDataDropExpr, segment);
+			break;
+		}
+
+		case Opcode::MemoryCopy: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			uint8_t reserved;
+			CHECK_RESULT(ReadU8(&reserved, "memory.copy reserved"));
+			ERROR_UNLESS(reserved == 0, "memory.copy reserved value must be 0");
+			CHECK_RESULT(ReadU8(&reserved, "memory.copy reserved"));
+			ERROR_UNLESS(reserved == 0, "memory.copy reserved value must be 0");
+			CALLBACK0(OnMemoryCopyExpr);
+			break;
+		}
+
+		case Opcode::MemoryFill: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			uint8_t reserved;
+			CHECK_RESULT(ReadU8(&reserved, "memory.fill reserved"));
+			ERROR_UNLESS(reserved == 0, "memory.fill reserved value must be 0");
+			CALLBACK0(OnMemoryFillExpr);
+			break;
+		}
+
 		case Opcode::I32TruncSSatF32:
 		case Opcode::I32TruncUSatF32:
 		case Opcode::I32TruncSSatF64:
@@ -1357,6 +1480,235 @@ Result ModuleReader::BinaryReader::ReadFunctionBody(Offset end_offset) {
 			break;
 		}
 
+		case Opcode::V128Load: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			uint32_t alignment_log2;
+			CHECK_RESULT(ReadU32Leb128(&alignment_log2, "load alignment"));
+			Address offset;
+			CHECK_RESULT(ReadU32Leb128(&offset, "load offset"));
+
+			CALLBACK(OnLoadExpr, opcode, alignment_log2, offset);
+			break;
+		}
+
+		case Opcode::V128Store: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			uint32_t alignment_log2;
+			CHECK_RESULT(ReadU32Leb128(&alignment_log2, "store alignment"));
+			Address offset;
+			CHECK_RESULT(ReadU32Leb128(&offset, "store offset"));
+
+			CALLBACK(OnStoreExpr, opcode, alignment_log2, offset);
+			break;
+		}
+
+		case Opcode::V128Const: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			V128 value;
+			CHECK_RESULT(ReadT(&value.lo, "uint64_t", "v128.const value"));
+			CHECK_RESULT(ReadT(&value.hi, "uint64_t", "v128.const value"));
+			CALLBACK(OnSimdConstExpr, value);
+			break;
+		}
+
+		case Opcode::I8X16Shuffle: {
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			uint8_t lanes[16];
+			for (auto &it : lanes) {
+				CHECK_RESULT(ReadU8(&it, "i8x16.shuffle lane index"));
+				ERROR_UNLESS(it < 32, "invalid i8x16.shuffle lane index: " << unsigned(it));
+			}
+			V128 value;
+			memcpy(&value, lanes, sizeof(V128));
+			CALLBACK(OnSimdShuffleExpr, opcode, value);
+			break;
+		}
+
+		case Opcode::I8X16ExtractLaneS:
+		case Opcode::I8X16ExtractLaneU:
+		case Opcode::I8X16ReplaceLane:
+		{
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			uint8_t lane;
+			CHECK_RESULT(ReadU8(&lane, "lane index"));
+			ERROR_UNLESS(lane < 16, "invalid lane index: " << unsigned(lane));
+			CALLBACK(OnSimdLaneOpExpr, opcode, lane);
+			break;
+		}
+
+		case Opcode::I16X8ExtractLaneS:
+		case Opcode::I16X8ExtractLaneU:
+		case Opcode::I16X8ReplaceLane:
+		{
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			uint8_t lane;
+			CHECK_RESULT(ReadU8(&lane, "lane index"));
+			ERROR_UNLESS(lane < 8, "invalid lane index: " << unsigned(lane));
+			CALLBACK(OnSimdLaneOpExpr, opcode, lane);
+			break;
+		}
+
+		case Opcode::I32X4ExtractLane:
+		case Opcode::I32X4ReplaceLane:
+		case Opcode::F32X4ExtractLane:
+		case Opcode::F32X4ReplaceLane:
+		{
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			uint8_t lane;
+			CHECK_RESULT(ReadU8(&lane, "lane index"));
+			ERROR_UNLESS(lane < 4, "invalid lane index: " << unsigned(lane));
+			CALLBACK(OnSimdLaneOpExpr, opcode, lane);
+			break;
+		}
+
+		case Opcode::I64X2ExtractLane:
+		case Opcode::I64X2ReplaceLane:
+		case Opcode::F64X2ExtractLane:
+		case Opcode::F64X2ReplaceLane:
+		{
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			uint8_t lane;
+			CHECK_RESULT(ReadU8(&lane, "lane index"));
+			ERROR_UNLESS(lane < 2, "invalid lane index: " << unsigned(lane));
+			CALLBACK(OnSimdLaneOpExpr, opcode, lane);
+			break;
+		}
+
+		case Opcode::V128BitSelect:
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			CALLBACK(OnTernaryExpr, opcode);
+			break;
+
+		case Opcode::I8X16Splat:
+		case Opcode::I16X8Splat:
+		case Opcode::I32X4Splat:
+		case Opcode::I64X2Splat:
+		case Opcode::F32X4Splat:
+		case Opcode::F64X2Splat:
+		case Opcode::V128Not:
+		case Opcode::V128AnyTrue:
+		case Opcode::I8X16Abs:
+		case Opcode::I8X16Neg:
+		case Opcode::I8X16AllTrue:
+		case Opcode::I16X8Abs:
+		case Opcode::I16X8Neg:
+		case Opcode::I16X8AllTrue:
+		case Opcode::I16X8ExtendLowI8X16S:
+		case Opcode::I16X8ExtendHighI8X16S:
+		case Opcode::I16X8ExtendLowI8X16U:
+		case Opcode::I16X8ExtendHighI8X16U:
+		case Opcode::I32X4Abs:
+		case Opcode::I32X4Neg:
+		case Opcode::I32X4AllTrue:
+		case Opcode::I32X4ExtendLowI16X8S:
+		case Opcode::I32X4ExtendHighI16X8S:
+		case Opcode::I32X4ExtendLowI16X8U:
+		case Opcode::I32X4ExtendHighI16X8U:
+		case Opcode::I64X2Neg:
+		case Opcode::F32X4Abs:
+		case Opcode::F32X4Neg:
+		case Opcode::F32X4Sqrt:
+		case Opcode::F64X2Abs:
+		case Opcode::F64X2Neg:
+		case Opcode::F64X2Sqrt:
+		case Opcode::I32X4TruncSatF32X4S:
+		case Opcode::I32X4TruncSatF32X4U:
+		case Opcode::F32X4ConvertI32X4S:
+		case Opcode::F32X4ConvertI32X4U:
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			CALLBACK(OnUnaryExpr, opcode);
+			break;
+
+		case Opcode::I8X16Swizzle:
+		case Opcode::I8X16Eq:
+		case Opcode::I8X16Ne:
+		case Opcode::I8X16LtS:
+		case Opcode::I8X16LtU:
+		case Opcode::I8X16GtS:
+		case Opcode::I8X16GtU:
+		case Opcode::I16X8Eq:
+		case Opcode::I16X8Ne:
+		case Opcode::I32X4Eq:
+		case Opcode::I32X4Ne:
+		case Opcode::I32X4LtS:
+		case Opcode::I32X4LtU:
+		case Opcode::I32X4GtS:
+		case Opcode::I32X4GtU:
+		case Opcode::F32X4Eq:
+		case Opcode::F32X4Ne:
+		case Opcode::F32X4Lt:
+		case Opcode::F32X4Gt:
+		case Opcode::F32X4Le:
+		case Opcode::F32X4Ge:
+		case Opcode::V128And:
+		case Opcode::V128Andnot:
+		case Opcode::V128Or:
+		case Opcode::V128Xor:
+		case Opcode::I8X16NarrowI16X8S:
+		case Opcode::I8X16NarrowI16X8U:
+		case Opcode::I8X16Shl:
+		case Opcode::I8X16ShrS:
+		case Opcode::I8X16ShrU:
+		case Opcode::I8X16Add:
+		case Opcode::I8X16AddSatS:
+		case Opcode::I8X16AddSatU:
+		case Opcode::I8X16Sub:
+		case Opcode::I8X16SubSatS:
+		case Opcode::I8X16SubSatU:
+		case Opcode::I8X16MinS:
+		case Opcode::I8X16MinU:
+		case Opcode::I8X16MaxS:
+		case Opcode::I8X16MaxU:
+		case Opcode::I8X16AvgrU:
+		case Opcode::I16X8NarrowI32X4S:
+		case Opcode::I16X8NarrowI32X4U:
+		case Opcode::I16X8Shl:
+		case Opcode::I16X8ShrS:
+		case Opcode::I16X8ShrU:
+		case Opcode::I16X8Add:
+		case Opcode::I16X8AddSatS:
+		case Opcode::I16X8AddSatU:
+		case Opcode::I16X8Sub:
+		case Opcode::I16X8SubSatS:
+		case Opcode::I16X8SubSatU:
+		case Opcode::I16X8Mul:
+		case Opcode::I16X8MinS:
+		case Opcode::I16X8MinU:
+		case Opcode::I16X8MaxS:
+		case Opcode::I16X8MaxU:
+		case Opcode::I16X8AvgrU:
+		case Opcode::I32X4Shl:
+		case Opcode::I32X4ShrS:
+		case Opcode::I32X4ShrU:
+		case Opcode::I32X4Add:
+		case Opcode::I32X4Sub:
+		case Opcode::I32X4Mul:
+		case Opcode::I32X4MinS:
+		case Opcode::I32X4MinU:
+		case Opcode::I32X4MaxS:
+		case Opcode::I32X4MaxU:
+		case Opcode::I64X2Shl:
+		case Opcode::I64X2ShrS:
+		case Opcode::I64X2ShrU:
+		case Opcode::I64X2Add:
+		case Opcode::I64X2Sub:
+		case Opcode::I64X2Mul:
+		case Opcode::F32X4Add:
+		case Opcode::F32X4Sub:
+		case Opcode::F32X4Mul:
+		case Opcode::F32X4Div:
+		case Opcode::F32X4Min:
+		case Opcode::F32X4Max:
+		case Opcode::F64X2Add:
+		case Opcode::F64X2Sub:
+		case Opcode::F64X2Mul:
+		case Opcode::F64X2Div:
+		case Opcode::F64X2Min:
+		case Opcode::F64X2Max:
+			ERROR_UNLESS_OPCODE_ENABLED(opcode);
+			CALLBACK(OnBinaryExpr, opcode);
+			break;
+
 		default:
 			return ReportUnexpectedOpcode(opcode);
 		}
@@ -1638,17 +1990,21 @@ Result ModuleReader::BinaryReader::ReadTypeSection(Offset section_size) {
 
 		Index num_results;
 		CHECK_RESULT(ReadIndex(&num_results, "function result count"));
-		ERROR_UNLESS(num_results <= 1, "result count must be 0 or 1");
+		ERROR_UNLESS(num_results <= 1 || _options->features.isMultiValueEnabled(), "result count must be 0 or 1");
+
+		_result_types.resize(num_results);
 
-		Type result_type = Type::Void;
-		if (num_results) {
+		for (Index j = 0; j < num_results; ++j) {
+			Type result_type;
 			CHECK_RESULT(ReadType(&result_type, "function result type"));
 			ERROR_UNLESS(is_concrete_type(result_type), "expected valid result type: " << static_cast<int>(result_type));
+			_result_types[j] = result_type;
 		}
 
 		Type* param_types = num_params ? _param_types.data() : nullptr;
+		Type* result_types = num_results ? _result_types.data() : nullptr;
 
-		CALLBACK(OnType, i, num_params, param_types, num_results, &result_type);
+		CALLBACK(OnType, i, num_params, param_types, num_results, result_types);
 	}
 	CALLBACK0(EndTypeSection);
 	return Result::Ok;
@@ -1869,32 +2225,147 @@ Result ModuleReader::BinaryReader::ReadCodeSection(Offset section_size) {
 	CHECK_RESULT(ReadIndex(&_num_function_bodies, "function body count"));
 	ERROR_UNLESS(_num_function_signatures == _num_function_bodies, "function signature count != function body count");
 	CALLBACK(OnFunctionBodyCount, _num_function_bodies);
+
+	uint32_t threads = _options->threads ? _options->threads : std::max(std::thread::hardware_concurrency(), 1U);
+	threads = std::min(threads, _num_function_bodies / kMinParallelFunctionBodies);
+
+	Vector<Offset> bodies;
+	Offset end = 0;
+	if (_options->lazy && SplitCodeSection(bodies, end)) {
+		auto lazy = std::make_unique<ModuleLazyCode>();
+		lazy->_env = _delegate->_env;
+		lazy->_module = _delegate->_targetModule;
+		lazy->_options = *_options;
+		lazy->_state = *_state;
+		lazy->_reader = std::make_unique<BinaryReader>(*this);
+		lazy->_reader->_options = &lazy->_options;
+		lazy->_states = std::make_unique<std::atomic<Func::State>[]>(bodies.size());
+		lazy->_released.assign(bodies.size(), 0);
+
+		auto &funcs = _delegate->_targetModule->_funcs;
+		for (Index i = 0; i < bodies.size(); ++i) {
+			lazy->_states[i].store(Func::State::Pending, std::memory_order_relaxed);
+			funcs[i].state = &lazy->_states[i];
+		}
+
+		_state->offset = end;
+		lazy->_bodies = std::move(bodies);
+		_delegate->_targetModule->_lazyCode = std::move(lazy);
+	} else if (threads > 1 && section_size >= kMinParallelCodeSectionSize && SplitCodeSection(bodies, end)) {
+		CHECK_RESULT(ReadCodeParallel(bodies, end, threads));
+	} else {
+		for (Index i = 0; i < _num_function_bodies; ++i) {
+			CHECK_RESULT(ReadCode(i));
+		}
+	}
+	CALLBACK0(EndCodeSection);
+	return Result::Ok;
+}
+
+Result ModuleReader::BinaryReader::ReadCode(Index func_index) {
+	CALLBACK(BeginFunctionBody, func_index);
+	uint32_t body_size;
+	CHECK_RESULT(ReadU32Leb128(&body_size, "function body size"));
+	Offset body_start_offset = _state->offset;
+	Offset end_offset = body_start_offset + body_size;
+
+	Index num_local_decls;
+	CHECK_RESULT(ReadIndex(&num_local_decls, "local declaration count"));
+	CALLBACK(OnLocalDeclCount, num_local_decls);
+	for (Index k = 0; k < num_local_decls; ++k) {
+		Index num_local_types;
+		CHECK_RESULT(ReadIndex(&num_local_types, "local type count"));
+		Type local_type;
+		CHECK_RESULT(ReadType(&local_type, "local type"));
+		ERROR_UNLESS(is_concrete_type(local_type), "expected valid local type");
+		CALLBACK(OnLocalDecl, k, num_local_types, local_type);
+	}
+
+	CHECK_RESULT(ReadFunctionBody(end_offset));
+	CALLBACK(EndFunctionBody, func_index);
+	return Result::Ok;
+}
+
+// finds offsets of function bodies by their sizes; returns false for malformed section,
+// that is read sequentially then to report errors in usual order
+bool ModuleReader::BinaryReader::SplitCodeSection(Vector<Offset> &bodies, Offset &end) {
+	bodies.reserve(_num_function_bodies);
+	Offset offset = _state->offset;
 	for (Index i = 0; i < _num_function_bodies; ++i) {
-		Index func_index = i;
-		Offset func_offset = _state->offset;
-		_state->offset = func_offset;
-		CALLBACK(BeginFunctionBody, func_index);
 		uint32_t body_size;
-		CHECK_RESULT(ReadU32Leb128(&body_size, "function body size"));
-		Offset body_start_offset = _state->offset;
-		Offset end_offset = body_start_offset + body_size;
+		size_t bytes_read = wasm::ReadU32Leb128(_state->data + offset, _state->data + _read_end, &body_size);
+		if (bytes_read == 0 || body_size > _read_end - offset - bytes_read) {
+			bodies.clear();
+			return false;
+		}
+		bodies.emplace_back(offset);
+		offset += bytes_read + body_size;
+	}
+	end = offset;
+	return true;
+}
 
-		Index num_local_decls;
-		CHECK_RESULT(ReadIndex(&num_local_decls, "local declaration count"));
-		CALLBACK(OnLocalDeclCount, num_local_decls);
-		for (Index k = 0; k < num_local_decls; ++k) {
-			Index num_local_types;
-			CHECK_RESULT(ReadIndex(&num_local_types, "local type count"));
-			Type local_type;
-			CHECK_RESULT(ReadType(&local_type, "local type"));
-			ERROR_UNLESS(is_concrete_type(local_type), "expected valid local type");
-			CALLBACK(OnLocalDecl, k, num_local_types, local_type);
+// bodies are independent after type, import and function sections, so every worker validates and translates
+// them with its own ModuleReader (TypeChecker and labels) into Func of module; errors are reported
+// only for first failed body, like for sequential read
+Result ModuleReader::BinaryReader::ReadCodeParallel(const Vector<Offset> &bodies, Offset end, uint32_t threads) {
+	struct Worker {
+		ModuleReader reader;
+		Index failed = kInvalidIndex;
+	};
+
+	std::atomic<Index> next(0);
+	std::atomic<Index> firstFailed(kInvalidIndex);
+
+	auto run = [&] (Worker &worker) {
+		BinaryReader reader(*this);
+		reader._delegate = &worker.reader;
+		reader._state = &worker.reader._state;
+
+		while (true) {
+			const Index i = next.fetch_add(1);
+			if (i >= bodies.size() || i > firstFailed.load()) {
+				break;
+			}
+
+			reader._state->offset = bodies[i];
+			if (Failed(reader.ReadCode(i))) {
+				worker.failed = i;
+				Index current = firstFailed.load();
+				while (i < current && !firstFailed.compare_exchange_weak(current, i)) { }
+				break;
+			}
 		}
+	};
 
-		CHECK_RESULT(ReadFunctionBody(end_offset));
-		CALLBACK(EndFunctionBody, func_index);
+	Vector<std::unique_ptr<Worker>> workers;
+	Vector<std::thread> os;
+	workers.reserve(threads);
+	os.reserve(threads - 1);
+	for (uint32_t i = 0; i < threads; ++ i) {
+		workers.emplace_back(new Worker());
+		workers.back()->reader.InitCodeReader(*_delegate);
 	}
-	CALLBACK0(EndCodeSection);
+	for (uint32_t i = 1; i < threads; ++ i) {
+		auto worker = workers[i].get();
+		os.emplace_back([&run, worker] { run(*worker); });
+	}
+	run(*workers.front());
+	for (auto &it : os) {
+		it.join();
+	}
+
+	if (firstFailed.load() != kInvalidIndex) {
+		for (auto &it : workers) {
+			if (it->failed == firstFailed.load()) {
+				_delegate->ReportErrors(it->reader._errors);
+				break;
+			}
+		}
+		return Result::Error;
+	}
+
+	_state->offset = end;
 	return Result::Ok;
 }
 
@@ -1902,15 +2373,30 @@ Result ModuleReader::BinaryReader::ReadDataSection(Offset section_size) {
 	CALLBACK(BeginDataSection, section_size);
 	Index num_data_segments;
 	CHECK_RESULT(ReadIndex(&num_data_segments, "data segment count"));
+	ERROR_UNLESS(_num_data_segments == kInvalidIndex || _num_data_segments == num_data_segments,
+			"data segment count does not match DataCount section");
 	CALLBACK(OnDataSegmentCount, num_data_segments);
-	ERROR_UNLESS(num_data_segments == 0 || NumTotalMemories() > 0, "data section without memory section");
 	for (Index i = 0; i < num_data_segments; ++i) {
 		Index memory_index;
+		bool passive = false;
 		CHECK_RESULT(ReadIndex(&memory_index, "data segment memory index"));
-		CALLBACK(BeginDataSegment, i, memory_index);
-		CALLBACK(BeginDataSegmentInitExpr, i);
-		CHECK_RESULT(ReadI32InitExpr(i));
-		CALLBACK(EndDataSegmentInitExpr, i);
+		if (_options->features.isBulkMemoryEnabled()) {
+			// with bulk memory, memory index field is reinterpreted as segment flags
+			ERROR_UNLESS(memory_index <= 2, "invalid data segment flags: " << memory_index);
+			passive = (memory_index == 1);
+			if (memory_index == 2) {
+				CHECK_RESULT(ReadIndex(&memory_index, "data segment memory index"));
+			} else {
+				memory_index = 0;
+			}
+		}
+		ERROR_UNLESS(passive || NumTotalMemories() > 0, "data section without memory section");
+		CALLBACK(BeginDataSegment, i, memory_index, passive);
+		if (!passive) {
+			CALLBACK(BeginDataSegmentInitExpr, i);
+			CHECK_RESULT(ReadI32InitExpr(i));
+			CALLBACK(EndDataSegmentInitExpr, i);
+		}
 
 		Address data_size;
 		const void* data;
@@ -1922,33 +2408,48 @@ Result ModuleReader::BinaryReader::ReadDataSection(Offset section_size) {
 	return Result::Ok;
 }
 
+Result ModuleReader::BinaryReader::ReadDataCountSection(Offset) {
+	ERROR_UNLESS(_options->features.isBulkMemoryEnabled(), "DataCount section requires bulk memory");
+	CHECK_RESULT(ReadIndex(&_num_data_segments, "data count"));
+	CALLBACK(OnDataCount, _num_data_segments);
+	return Result::Ok;
+}
+
 Result ModuleReader::BinaryReader::ReadSections() {
 	Result result = Result::Ok;
 
 	while (_state->offset < _state->size) {
-		uint32_t section_code;
-		Offset section_size;
 		// Temporarily reset read_end_ to the full data size so the next section
 		// can be read.
 		_read_end = _state->size;
-		CHECK_RESULT(ReadU32Leb128(&section_code, "section code"));
-		CHECK_RESULT(ReadOffset(&section_size, "section size"));
-		_read_end = _state->offset + section_size;
-		if (section_code >= kBinarySectionCount) {
-			PushErrorStream([&] (StringStream &stream) {
-				stream << "invalid section code: " << section_code << "; max is " << kBinarySectionCount - 1;
-			});
-			return Result::Error;
-		}
+		CHECK_RESULT(ReadSection(result));
+	}
 
-		BinarySection section = static_cast<BinarySection>(section_code);
+	return result;
+}
 
-		ERROR_UNLESS(_read_end <= _state->size,
-				"invalid section size: extends past end");
+// returns error, when reading should be stopped; errors of sections, after which reading can continue, are added to result
+Result ModuleReader::BinaryReader::ReadSection(Result &result) {
+	uint32_t section_code;
+	Offset section_size;
+	CHECK_RESULT(ReadU32Leb128(&section_code, "section code"));
+	CHECK_RESULT(ReadOffset(&section_size, "section size"));
+	_read_end = _state->offset + section_size;
+	if (section_code >= kBinarySectionCount) {
+		PushErrorStream([&] (StringStream &stream) {
+			stream << "invalid section code: " << section_code << "; max is " << kBinarySectionCount - 1;
+		});
+		return Result::Error;
+	}
+
+	BinarySection section = static_cast<BinarySection>(section_code);
 
-		ERROR_UNLESS(_last_known_section == BinarySection::Invalid
-			|| section == BinarySection::Custom || section > _last_known_section,
-			"section " << GetSectionName(section) << " out of order");
+	ERROR_UNLESS(_read_end <= _state->size,
+			"invalid section size: extends past end");
+
+	ERROR_UNLESS(_last_known_section == BinarySection::Invalid
+		|| section == BinarySection::Custom || GetSectionOrder(section) > GetSectionOrder(_last_known_section),
+		"section " << GetSectionName(section) << " out of order");
 
 #define V(Name, name, code)                             \
   case BinarySection::Name:                             \
@@ -1956,35 +2457,34 @@ Result ModuleReader::BinaryReader::ReadSections() {
     result = result | section_result;                   \
     break;
 
-		Result section_result = Result::Error;
+	Result section_result = Result::Error;
 
-		switch (section) {
-		WABT_FOREACH_BINARY_SECTION (V)
+	switch (section) {
+	WABT_FOREACH_BINARY_SECTION (V)
 	case BinarySection::Invalid:
 		WABT_UNREACHABLE;
-		}
+	}
 
 #undef V
 
-		if (Failed(section_result)) {
-			if (_options->stop_on_first_error) {
-				return Result::Error;
-			}
-
-			// If we're continuing after failing to read this section, move the
-			// offset to the expected section end. This way we may be able to read
-			// further sections.
-			_state->offset = _read_end;
+	if (Failed(section_result)) {
+		if (_options->stop_on_first_error) {
+			return Result::Error;
 		}
 
-		ERROR_UNLESS(_state->offset == _read_end, "unfinished section (expected end: 0x" << std::hex << _read_end << ")");
+		// If we're continuing after failing to read this section, move the
+		// offset to the expected section end. This way we may be able to read
+		// further sections.
+		_state->offset = _read_end;
+	}
 
-		if (section != BinarySection::Custom) {
-			_last_known_section = section;
-		}
+	ERROR_UNLESS(_state->offset == _read_end, "unfinished section (expected end: 0x" << std::hex << _read_end << ")");
+
+	if (section != BinarySection::Custom) {
+		_last_known_section = section;
 	}
 
-	return result;
+	return Result::Ok;
 }
 
 Result ModuleReader::BinaryReader::ReadModule() {
@@ -2000,8 +2500,304 @@ Result ModuleReader::BinaryReader::ReadModule() {
 	return Result::Ok;
 }
 
+Result ModuleReader::BinaryReader::ReadStreamHeader() {
+	_read_end = _state->size;
+	uint32_t magic = 0;
+	CHECK_RESULT(ReadU32(&magic, "magic"));
+	ERROR_UNLESS(magic == WABT_BINARY_MAGIC, "bad magic value");
+	uint32_t version = 0;
+	CHECK_RESULT(ReadU32(&version, "version"));
+	ERROR_UNLESS(version == WABT_BINARY_VERSION, "bad wasm file version: " << std::hex << version << " (expected " << WABT_BINARY_VERSION << ")");
+	CALLBACK(BeginModule, version);
+	return Result::Ok;
+}
+
+Result ModuleReader::BinaryReader::ReadStreamSection() {
+	_read_end = _state->size;
+	Result result = Result::Ok;
+	CHECK_RESULT(ReadSection(result));
+	return result;
+}
+
+// section header and function body count; bodies are read with ReadCode, when they are complete
+Result ModuleReader::BinaryReader::BeginStreamCode() {
+	_read_end = _state->size;
+	uint32_t section_code;
+	Offset section_size;
+	CHECK_RESULT(ReadU32Leb128(&section_code, "section code"));
+	CHECK_RESULT(ReadOffset(&section_size, "section size"));
+	ERROR_UNLESS(section_code == uint32_t(BinarySection::Code), "invalid section code: " << section_code);
+	ERROR_UNLESS(_last_known_section == BinarySection::Invalid
+		|| GetSectionOrder(BinarySection::Code) > GetSectionOrder(_last_known_section),
+		"section " << GetSectionName(BinarySection::Code) << " out of order");
+
+	CALLBACK(BeginCodeSection, section_size);
+	CHECK_RESULT(ReadIndex(&_num_function_bodies, "function body count"));
+	ERROR_UNLESS(_num_function_signatures == _num_function_bodies, "function signature count != function body count");
+	CALLBACK(OnFunctionBodyCount, _num_function_bodies);
+	return Result::Ok;
+}
+
+Result ModuleReader::BinaryReader::ReadStreamBody(Index func_index) {
+	_read_end = _state->size;
+	CHECK_RESULT(ReadCode(func_index));
+	ERROR_UNLESS(_state->offset == _read_end, "unfinished function body: " << func_index);
+	return Result::Ok;
+}
+
+Result ModuleReader::BinaryReader::EndStreamCode() {
+	CALLBACK0(EndCodeSection);
+	_last_known_section = BinarySection::Code;
+	return Result::Ok;
+}
+
+Result ModuleReader::BinaryReader::EndStream() {
+	CALLBACK0(EndModule);
+	return Result::Ok;
+}
+
+ModuleLazyCode::~ModuleLazyCode() {
+	if (_env) {
+		if (_background) {
+			_env->getTranslationPool()->remove(this);
+		}
+		_env->getCodeCache()->remove(this);
+	}
+}
+
+bool ModuleLazyCode::translate(Index idx, bool background) {
+	if (idx >= _bodies.size()) {
+		return false;
+	}
+
+	while (true) {
+		auto state = Func::State::Pending;
+		if (_states[idx].compare_exchange_strong(state, Func::State::Translating, std::memory_order_acquire)) {
+			break;
+		}
+
+		switch (state) {
+		case Func::State::Ready:
+			return true;
+		case Func::State::Invalid:
+			if (!background) {
+				reportDeferred(idx);
+			}
+			return false;
+		case Func::State::Cold:
+		case Func::State::Evicting:
+			// code was not released by CodeCache, function is hot again
+			if (_states[idx].compare_exchange_strong(state, Func::State::Ready)) {
+				return true;
+			}
+			break;
+		case Func::State::Translating: {
+			// translated by other thread or released by CodeCache
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (_states[idx].load(std::memory_order_acquire) == Func::State::Translating) {
+				_cond.wait(lock);
+			}
+			break;
+		}
+		case Func::State::Pending:
+			break;
+		}
+	}
+
+	// errors are collected and reported under lock, functions can be translated on several threads
+	ModuleReader reader;
+	reader._state = _state;
+	reader._state.offset = _bodies[idx];
+	reader._env = _env;
+	reader._targetModule = _module;
+	reader._options = &_options;
+	reader._deferErrors = true;
+	reader._typechecker.set_error_callback([&reader] (StringStream &message) {
+		reader._errors.emplace_back("Typechecker", message.str());
+	});
+
+	ModuleReader::BinaryReader binary(*_reader);
+	binary._delegate = &reader;
+	binary._state = &reader._state;
+
+	auto &func = _module->_funcs[idx];
+	const bool success = Succeeded(binary.ReadCode(idx));
+	if (!success) {
+		func.types.clear();
+		func.opcodes.clear();
+	} else {
+		// code is not read after it was published, CodeCache can release it
+		pushCallees(idx);
+	}
+
+	const size_t size = func.types.capacity() * sizeof(Type) + func.opcodes.capacity() * sizeof(Func::OpcodeRec);
+	const bool retranslated = _released[idx];
+
+	auto errors = std::move(reader._errors);
+	reader._deferErrors = false;
+
+	// callback of environment is not called on background threads
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (background && !success) {
+		_deferred.emplace(idx, std::move(errors));
+	} else {
+		reader.ReportErrors(errors);
+	}
+	_states[idx].store(success ? Func::State::Ready : Func::State::Invalid, std::memory_order_release);
+	lock.unlock();
+	_cond.notify_all();
+
+	if (success && _env && _env->getCodeCache()->isEnabled()) {
+		_env->getCodeCache()->insert(this, idx, size, retranslated);
+	}
+	return success;
+}
+
+void ModuleLazyCode::startBackground(uint32_t threads) {
+	_queued.assign(_bodies.size(), false);
+
+	auto push = [&] (const Module::IndexObject &obj) {
+		if (!obj.import && obj.index < _bodies.size() && !_queued[obj.index]) {
+			_queued[obj.index] = true;
+			_queue.emplace_back(obj.index);
+		}
+	};
+
+	push(_module->_startFunction);
+	for (auto &it : _module->_exports) {
+		if (it.kind == ExternalKind::Func) {
+			push(it.index);
+		}
+	}
+
+	if (_env && !_bodies.empty()) {
+		_background = true;
+		_env->getTranslationPool()->add(this, threads);
+	}
+}
+
+bool ModuleLazyCode::translateAll() {
+	Index idx;
+	while (nextPending(idx)) {
+		translate(idx);
+	}
+
+	bool success = true;
+	for (Index i = 0; i < _bodies.size(); ++ i) {
+		success = translate(i) && success;
+	}
+	return success;
+}
+
+// next pending function in order of speculative translation
+bool ModuleLazyCode::nextPending(Index &idx) {
+	std::unique_lock<std::mutex> lock(_queueMutex);
+	while (_queueNext < _queue.size()) {
+		idx = _queue[_queueNext ++];
+		if (_states[idx].load(std::memory_order_relaxed) == Func::State::Pending) {
+			return true;
+		}
+	}
+
+	while (_scanNext < _bodies.size()) {
+		idx = _scanNext ++;
+		if ((_queued.empty() || !_queued[idx]) && _states[idx].load(std::memory_order_relaxed) == Func::State::Pending) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void ModuleLazyCode::pushCallees(Index idx) {
+	if (_queued.empty()) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(_queueMutex);
+	for (auto &it : _module->_funcs[idx].opcodes) {
+		if ((it.opcode == Opcode::Call || it.opcode == Opcode::ReturnCall) && !it.value32.v2) {
+			auto obj = _module->getFunctionIndex(it.value32.v1);
+			if (obj && !obj->import && obj->index < _bodies.size() && !_queued[obj->index]) {
+				_queued[obj->index] = true;
+				_queue.emplace_back(obj->index);
+			}
+		}
+	}
+}
+
+// reports errors of body, that was translated in background, once
+void ModuleLazyCode::reportDeferred(Index idx) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto it = _deferred.find(idx);
+	if (it != _deferred.end()) {
+		ModuleReader reader;
+		reader._env = _env;
+		reader._targetModule = _module;
+		reader.ReportErrors(it->second);
+		_deferred.erase(it);
+	}
+}
+
+void ModuleLazyCode::release(Index idx) {
+	auto &func = _module->_funcs[idx];
+	func.types = Vector<Type>();
+	func.opcodes = Vector<Func::OpcodeRec>();
+	_released[idx] = 1;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_states[idx].store(Func::State::Pending, std::memory_order_release);
+	lock.unlock();
+	_cond.notify_all();
+}
+
+void ModuleReader::InitCodeReader(const ModuleReader &parent) {
+	_state = parent._state;
+	_env = parent._env;
+	_targetModule = parent._targetModule;
+	_options = parent._options;
+	_deferErrors = true;
+
+	_opcodes.reserve(256);
+	_labels.reserve(32);
+	_labelStack.reserve(32);
+
+	_typechecker.set_error_callback([this] (StringStream &message) {
+		_errors.emplace_back("Typechecker", message.str());
+	});
+}
+
+void ModuleReader::ReportErrors(const Vector<std::pair<StringView, String>> &errors) {
+	for (auto &it : errors) {
+		StringStream stream;
+		stream << it.second;
+		if (_env && it.first == "Typechecker") {
+			_env->onError(it.first, stream);
+		} else {
+			OnError(stream);
+		}
+	}
+}
+
+StringView ModuleReader::getBuildId() {
+	static const String id = "translation-" + std::to_string(kTranslationVersion)
+			+ "-" + std::to_string(uint32_t(Opcode::Invalid)) + "-" + std::to_string(sizeof(Func::OpcodeRec));
+	return StringView(id);
+}
+
+ModuleReader::ModuleReader() { }
+ModuleReader::~ModuleReader() { }
+
 bool ModuleReader::init(Module *module, Environment *env, const uint8_t *data, size_t size, const ReadOptions &opts) {
 	_state = ReaderState(data, size);
+	if (!prepare(module, env, opts)) {
+		return false;
+	}
+
+	BinaryReader reader(this, &opts);
+	return reader.ReadModule() != Result::Error;
+}
+
+bool ModuleReader::prepare(Module *module, Environment *env, const ReadOptions &opts) {
 	_env = env;
 	_targetModule = module;
 	_options = &opts;
@@ -2018,11 +2814,52 @@ bool ModuleReader::init(Module *module, Environment *env, const uint8_t *data, s
 		}
 	});
 
-	if (_targetModule) {
-		BinaryReader reader(this, &opts);
-		return reader.ReadModule() != Result::Error;
+	return _targetModule != nullptr;
+}
+
+bool ModuleReader::beginStream(Module *module, Environment *env, const ReadOptions &opts) {
+	_state = ReaderState();
+	if (!prepare(module, env, opts)) {
+		return false;
 	}
-	return false;
+
+	_stream = std::make_unique<BinaryReader>(this, &opts);
+	return true;
+}
+
+bool ModuleReader::readStreamHeader(const uint8_t *data, size_t size) {
+	_state = ReaderState(data, size);
+	return _stream && Succeeded(_stream->ReadStreamHeader());
+}
+
+bool ModuleReader::readStreamSection(const uint8_t *data, size_t size) {
+	_state = ReaderState(data, size);
+	return _stream && Succeeded(_stream->ReadStreamSection());
+}
+
+bool ModuleReader::beginStreamCode(const uint8_t *data, size_t size) {
+	_state = ReaderState(data, size);
+	return _stream && Succeeded(_stream->BeginStreamCode());
+}
+
+bool ModuleReader::readStreamBody(Index func, const uint8_t *data, size_t size) {
+	_state = ReaderState(data, size);
+	return _stream && Succeeded(_stream->ReadStreamBody(func));
+}
+
+bool ModuleReader::endStreamCode() {
+	return _stream && Succeeded(_stream->EndStreamCode());
+}
+
+bool ModuleReader::endStream() {
+	_state = ReaderState();
+	if (!_stream) {
+		return false;
+	}
+
+	auto ret = Succeeded(_stream->EndStream());
+	_stream.reset();
+	return ret;
 }
 
 }
@@ -20,6 +20,9 @@
 
 #include "TypeChecker.h"
 #include "Module.h"
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 namespace wasm {
 
@@ -32,10 +35,34 @@ struct ReaderState {
 	Offset offset = 0;
 };
 
+// returns number of bytes read, 0 for truncated or malformed value
+size_t ReadU32Leb128(const uint8_t* p, const uint8_t* end, uint32_t* out_value);
+
 class ModuleReader {
 public:
+	ModuleReader();
+	~ModuleReader();
+
 	bool init(Module *, Environment *env, const uint8_t *data, size_t size, const ReadOptions & = ReadOptions());
 
+	// incremental reading for ModuleStreamLoader: module header, then complete sections in order;
+	// code section is passed as section header with function body count, then body by body.
+	// Data is not used after call returns; options should outlive reading
+	bool beginStream(Module *, Environment *env, const ReadOptions &);
+	bool readStreamHeader(const uint8_t *data, size_t size);
+	bool readStreamSection(const uint8_t *data, size_t size);
+	bool beginStreamCode(const uint8_t *data, size_t size);
+	bool readStreamBody(Index func, const uint8_t *data, size_t size);
+	bool endStreamCode();
+	bool endStream();
+
+	// version of translated code (interpreter opcodes, layout of Func::OpcodeRec, translation rules);
+	// should be incremented with every change of it, so ModuleCache entries of previous version are not used
+	static constexpr uint32_t kTranslationVersion = 1;
+
+	// identifies translation format (version, number of opcodes and size of record), used as part of ModuleCache keys
+	static StringView getBuildId();
+
 	bool OnError(StringStream & message);
 
 	template <typename Callback>
@@ -120,12 +147,14 @@ public:
 	Result OnAtomicWaitExpr(Opcode opcode, uint32_t alignment_log2, Address offset);
 	Result OnAtomicWakeExpr(Opcode opcode, uint32_t alignment_log2, Address offset);
 	Result OnBinaryExpr(Opcode opcode);
-	Result OnBlockExpr(Index num_types, Type* sig_types);
+	Result OnBlockExpr(Index num_params, Type* param_types, Index num_results, Type* result_types);
 	Result OnBrExpr(Index depth);
 	Result OnBrIfExpr(Index depth);
 	Result OnBrTableExpr(Index num_targets, Index* target_depths, Index default_target_depth);
 	Result OnCallExpr(Index func_index);
 	Result OnCallIndirectExpr(Index sig_index);
+	Result OnReturnCallExpr(Index func_index);
+	Result OnReturnCallIndirectExpr(Index sig_index);
 	Result OnCatchExpr(Index except_index);
 	Result OnCatchAllExpr();
 	Result OnCompareExpr(Opcode opcode);
@@ -142,16 +171,24 @@ public:
 	Result OnGrowMemoryExpr();
 	Result OnI32ConstExpr(uint32_t value);
 	Result OnI64ConstExpr(uint64_t value);
-	Result OnIfExpr(Index num_types, Type* sig_types);
+	Result OnIfExpr(Index num_params, Type* param_types, Index num_results, Type* result_types);
 	Result OnLoadExpr(Opcode opcode, uint32_t alignment_log2, Address offset);
-	Result OnLoopExpr(Index num_types, Type* sig_types);
+	Result OnLoopExpr(Index num_params, Type* param_types, Index num_results, Type* result_types);
+	Result OnMemoryInitExpr(Index segment);
+	Result OnDataDropExpr(Index segment);
+	Result OnMemoryCopyExpr();
+	Result OnMemoryFillExpr();
 	Result OnRethrowExpr(Index depth);
 	Result OnReturnExpr();
 	Result OnSelectExpr();
 	Result OnSetGlobalExpr(Index global_index);
 	Result OnSetLocalExpr(Index local_index);
+	Result OnSimdConstExpr(V128 value);
+	Result OnSimdLaneOpExpr(Opcode opcode, uint8_t lane);
+	Result OnSimdShuffleExpr(Opcode opcode, V128 lanes);
 	Result OnStoreExpr(Opcode opcode, uint32_t alignment_log2, Address offset);
 	Result OnTeeLocalExpr(Index local_index);
+	Result OnTernaryExpr(Opcode opcode);
 	Result OnThrowExpr(Index except_index);
 	Result OnTryExpr(Index num_types, Type* sig_types);
 
@@ -171,10 +208,13 @@ public:
 	Result EndElemSegment(Index index);
 	Result EndElemSection();
 
+	/* DataCount section */
+	Result OnDataCount(Index count);
+
 	/* Data section */
 	Result BeginDataSection(Offset size);
 	Result OnDataSegmentCount(Index count);
-	Result BeginDataSegment(Index index, Index memory_index);
+	Result BeginDataSegment(Index index, Index memory_index, bool passive);
 	Result BeginDataSegmentInitExpr(Index index);
 	Result EndDataSegmentInitExpr(Index index);
 	Result OnDataSegmentData(Index index, const void* data, Address size);
@@ -224,6 +264,8 @@ public:
 	Result OnInitExprI64ConstExpr(Index index, uint64_t value);
 
 protected:
+	friend class ModuleLazyCode;
+
 	class BinaryReader;
 
 	void EmitOpcodeValue(Opcode opcode, uint32_t, uint32_t = 0);
@@ -232,6 +274,17 @@ protected:
 	void PushLabel(Index results, Index stack, Index position, Index origin = kInvalidIndex);
 	void PopLabel(Index position);
 
+	void HoistBoundsChecks(Func &);
+
+	bool prepare(Module *, Environment *env, const ReadOptions &);
+
+	// reader for function bodies on worker thread, errors are collected until ReportErrors
+	void InitCodeReader(const ModuleReader &);
+	void ReportErrors(const Vector<std::pair<StringView, String>> &);
+
+	void BeginFuelBlock();
+	void EndFuelBlock();
+
 	Environment *_env = nullptr;
 	Module *_targetModule = nullptr;
 	const ReadOptions *_options = nullptr;
@@ -244,6 +297,60 @@ protected:
 	Vector<Func::OpcodeRec> _opcodes;
 	Vector<Func::Label> _labels;
 	Vector<Index> _labelStack;
+	Index _fuelBlock = kInvalidIndex;
+
+	bool _deferErrors = false;
+	Vector<std::pair<StringView, String>> _errors; // tag and message of deferred errors
+
+	std::unique_ptr<BinaryReader> _stream; // reader state between calls of incremental reading
+};
+
+// Body ranges of module, read with ReadOptions::lazy, and state of reader after sections, that precede code
+class ModuleLazyCode {
+public:
+	~ModuleLazyCode();
+
+	// thread-safe; result is published with Func::state, function is translated by one thread,
+	// other callers wait for it; translated code is added into CodeCache of environment, when it is enabled;
+	// errors of body, translated in background, are reported by first call of translate on other thread
+	bool translate(Index func, bool background = false);
+
+	// speculative translation on threads of TranslationPool of environment, cancelled with module
+	void startBackground(uint32_t threads);
+
+	// translates pending functions on calling thread together with background threads
+	bool translateAll();
+
+protected:
+	friend class ModuleReader;
+	friend class CodeCache;
+	friend class TranslationPool;
+
+	bool nextPending(Index &);
+	void pushCallees(Index);
+	void reportDeferred(Index);
+
+	// called by CodeCache for evicted function in Translating state, that is not used by threads
+	void release(Index);
+
+	std::mutex _mutex; // guards waiting for functions in translation and error reporting
+	std::condition_variable _cond;
+	Environment *_env = nullptr;
+	Module *_module = nullptr;
+	ReadOptions _options;
+	ReaderState _state; // view of module data
+	std::unique_ptr<ModuleReader::BinaryReader> _reader;
+	Vector<Offset> _bodies;
+	std::unique_ptr<std::atomic<Func::State>[]> _states;
+	Vector<uint8_t> _released; // functions, which code was released by CodeCache
+	Map<Index, Vector<std::pair<StringView, String>>> _deferred; // errors of invalid bodies, translated in background
+
+	std::mutex _queueMutex; // guards order of speculative translation
+	Vector<Index> _queue;
+	Vector<bool> _queued;
+	size_t _queueNext = 0;
+	Index _scanNext = 0; // functions, unreachable from exports, in index order
+	bool _background = false; // module is source of TranslationPool
 };
 
 template <typename Callback>
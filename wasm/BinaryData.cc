@@ -59,14 +59,20 @@ Result ModuleReader::EndElemSegment(Index index) { return Result::Ok; }
 Result ModuleReader::EndElemSection() { return Result::Ok; }
 
 
+/* DataCount section */
+Result ModuleReader::OnDataCount(Index count) {
+	_targetModule->_data.reserve(count);
+	return Result::Ok;
+}
+
 /* Data section */
 Result ModuleReader::BeginDataSection(Offset size) { return Result::Ok; }
 Result ModuleReader::OnDataSegmentCount(Index count) {
 	_targetModule->_data.reserve(count);
 	return Result::Ok;
 }
-Result ModuleReader::BeginDataSegment(Index index, Index memory_index) {
-	_currentIndex = memory_index;
+Result ModuleReader::BeginDataSegment(Index index, Index memory_index, bool passive) {
+	_currentIndex = passive ? kInvalidIndex : memory_index;
 	return Result::Ok;
 }
 Result ModuleReader::BeginDataSegmentInitExpr(Index index) {
@@ -85,7 +91,13 @@ Result ModuleReader::OnDataSegmentData(Index index, const void* data, Address si
 		PushErrorStream([&] (StringStream &stream) { stream << "Invalid elements block index"; });
 		return Result::Error;
 	}
-	_targetModule->_data.emplace_back(_currentIndex, _initExprValue.value.i32, size, (const uint8_t *)data);
+	// module file is kept by module, so segments refer to it
+	const bool copy = !_targetModule->_file;
+	if (_currentIndex == kInvalidIndex) {
+		_targetModule->_data.emplace_back(0, 0, size, (const uint8_t *)data, true, copy);
+	} else {
+		_targetModule->_data.emplace_back(_currentIndex, _initExprValue.value.i32, size, (const uint8_t *)data, false, copy);
+	}
 	return Result::Ok;
 }
 Result ModuleReader::EndDataSegment(Index index) { return Result::Ok; }
@@ -25,6 +25,7 @@ static void printType(std::ostream &stream, Type t) {
 	case Type::I64: stream << "i64"; break;
 	case Type::F32: stream << "f32"; break;
 	case Type::F64: stream << "f64"; break;
+	case Type::V128: stream << "v128"; break;
 	case Type::Anyfunc: stream << "anyfunc"; break;
 	case Type::Func: stream << "func"; break;
 	case Type::Void: stream << "void"; break;
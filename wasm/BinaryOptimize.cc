@@ -0,0 +1,275 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Binary.h"
+#include "Module.h"
+
+namespace wasm {
+
+/* Bounds check hoisting
+ *
+ * Every loop is preceded by three InterpLoopGuard records:
+ *   (induction local, unchecked copy position)
+ *   (bound local or constant, LoopGuardFlags)
+ *   (max offset + access size, memory index)
+ *
+ * Loop is accepted when it has no nested loops and its only back-edge is
+ *   get_local/tee_local $i, get_local $n/i32.const N, i32.lt_u/i32.le_u, br_if $loop
+ * where $i is written once as $i = $i + const and $n is not written at all.
+ *
+ * In such loop every iteration starts with $i equal to its initial value or to the value,
+ * that passed the back-edge comparison, so accesses, that use $i as address before it is
+ * incremented, lie in {$i0} + [0, $n) (or [0, $n] for le_u). Guard checks this range once,
+ * and jumps to the copy of the loop, where those accesses are unchecked. When check fails,
+ * guard falls through to original loop with regular checks.
+ */
+
+// Stack effect of straight-line opcodes; returns false for control flow and calls
+static bool GetStackEffect(const Func::OpcodeRec &rec, Index &pop, Index &push) {
+	switch (rec.opcode) {
+	case Opcode::Nop: pop = 0; push = 0; return true;
+	case Opcode::GetLocal:
+	case Opcode::GetGlobal:
+	case Opcode::InterpGetStack: pop = 0; push = 1; return true;
+	case Opcode::SetLocal:
+	case Opcode::SetGlobal:
+	case Opcode::InterpSetStack:
+	case Opcode::Drop: pop = 1; push = 0; return true;
+	case Opcode::TeeLocal: pop = 1; push = 1; return true;
+	case Opcode::Select: pop = 3; push = 1; return true;
+	default: break;
+	}
+
+	Opcode opcode(rec.opcode);
+	if (opcode.IsInvalid() || opcode.HasPrefix()) {
+		return false;
+	}
+
+	pop = (opcode.GetParamType1() != Type::Void ? 1 : 0)
+		+ (opcode.GetParamType2() != Type::Void ? 1 : 0)
+		+ (opcode.GetParamType3() != Type::Void ? 1 : 0);
+	push = (opcode.GetResultType() != Type::Void ? 1 : 0);
+	return pop != 0 || push != 0;
+}
+
+static bool IsLoadOpcode(Opcode::Enum op) {
+	return op >= Opcode::I32Load && op <= Opcode::I64Load32U;
+}
+
+static bool IsStoreOpcode(Opcode::Enum op) {
+	return op >= Opcode::I32Store && op <= Opcode::I64Store32;
+}
+
+static Opcode::Enum GetUncheckedOpcode(Opcode::Enum op) {
+	static_assert(Opcode::I64Store32 - Opcode::I32Load == Opcode::I64Store32Unchecked - Opcode::I32LoadUnchecked,
+			"Unchecked memory opcodes should follow order of regular ones");
+	return Opcode::Enum(op - Opcode::I32Load + Opcode::I32LoadUnchecked);
+}
+
+// find load or store, that uses value, pushed at `pos`, as address
+static Index FindAddressConsumer(const Vector<Func::OpcodeRec> &code, Index pos, Index end) {
+	Index above = 0; // values on top of tracked one
+	for (Index i = pos + 1; i < end; ++ i) {
+		Index pop, push;
+		if (!GetStackEffect(code[i], pop, push)) {
+			return kInvalidIndex;
+		}
+		if (pop > above) {
+			if ((IsLoadOpcode(code[i].opcode) && above == 0) || (IsStoreOpcode(code[i].opcode) && above == 1)) {
+				return i;
+			}
+			return kInvalidIndex;
+		}
+		above = above - pop + push;
+	}
+	return kInvalidIndex;
+}
+
+static bool IsInductionUpdate(const Vector<Func::OpcodeRec> &code, Index head, Index pos, Index local) {
+	if (pos < head + 3 || code[pos - 1].opcode != Opcode::I32Add) {
+		return false;
+	}
+
+	auto &a = code[pos - 3];
+	auto &b = code[pos - 2];
+	return (a.opcode == Opcode::GetLocal && a.value32.v1 == local && b.opcode == Opcode::I32Const)
+		|| (a.opcode == Opcode::I32Const && b.opcode == Opcode::GetLocal && b.value32.v1 == local);
+}
+
+static bool HoistLoopBoundsCheck(Func &func, Index guard, bool &hasReturn) {
+	auto &code = func.opcodes;
+	const Index head = guard + 3;
+	const Index end = code[guard + 2].value32.v1; // position of loop's End
+
+	// find single back-edge, reject nested loops
+	Index backEdge = kInvalidIndex;
+	for (Index i = head; i < end; ++ i) {
+		auto &rec = code[i];
+		switch (rec.opcode) {
+		case Opcode::InterpLoopGuard:
+			return false;
+		case Opcode::Br:
+		case Opcode::BrIf:
+			if (rec.value32.v2 == head) {
+				if (backEdge != kInvalidIndex || rec.opcode != Opcode::BrIf) {
+					return false;
+				}
+				backEdge = i;
+			}
+			break;
+		case Opcode::BrTable:
+			for (Index j = i + 1; j <= i + 1 + rec.value32.v1; ++ j) {
+				if (code[j].value32.v2 == head) {
+					return false;
+				}
+			}
+			i += rec.value32.v1 + 1;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (backEdge == kInvalidIndex || backEdge < head + 3) {
+		return false;
+	}
+
+	// copies, code vector is extended below
+	const Func::OpcodeRec cmp = code[backEdge - 1];
+	const Func::OpcodeRec bound = code[backEdge - 2];
+	const Func::OpcodeRec var = code[backEdge - 3];
+
+	if ((cmp.opcode != Opcode::I32LtU && cmp.opcode != Opcode::I32LeU)
+			|| (var.opcode != Opcode::GetLocal && var.opcode != Opcode::TeeLocal)
+			|| (bound.opcode != Opcode::GetLocal && bound.opcode != Opcode::I32Const)) {
+		return false;
+	}
+
+	const Index local = var.value32.v1;
+	if (func.types[local] != Type::I32) {
+		return false;
+	}
+
+	if (bound.opcode == Opcode::GetLocal && (bound.value32.v1 == local || func.types[bound.value32.v1] != Type::I32)) {
+		return false;
+	}
+
+	// induction variable should be written once, bound should not be written
+	Index update = kInvalidIndex;
+	for (Index i = head; i < end; ++ i) {
+		auto &rec = code[i];
+		if (rec.opcode == Opcode::SetLocal || rec.opcode == Opcode::TeeLocal) {
+			if (rec.value32.v1 == local) {
+				if (update != kInvalidIndex) {
+					return false;
+				}
+				update = i;
+			} else if (bound.opcode == Opcode::GetLocal && rec.value32.v1 == bound.value32.v1) {
+				return false;
+			}
+		} else if (rec.opcode == Opcode::BrTable) {
+			i += rec.value32.v1 + 1;
+		}
+	}
+
+	if (update == kInvalidIndex || !IsInductionUpdate(code, head, update, local)) {
+		return false;
+	}
+
+	if ((var.opcode == Opcode::TeeLocal) != (update == backEdge - 3)) {
+		return false;
+	}
+
+	// collect accesses, addressed by induction variable before update
+	Vector<Index> accesses;
+	uint64_t extent = 0;
+	Index memory = kInvalidIndex;
+	for (Index i = head; i < update; ++ i) {
+		if (code[i].opcode == Opcode::GetLocal && code[i].value32.v1 == local) {
+			auto consumer = FindAddressConsumer(code, i, update);
+			if (consumer != kInvalidIndex) {
+				auto &rec = code[consumer];
+				if (memory != kInvalidIndex && memory != rec.value32.v2) {
+					continue;
+				}
+				memory = rec.value32.v2;
+				extent = std::max(extent, uint64_t(rec.value32.v1) + Opcode(rec.opcode).GetMemorySize());
+				accesses.emplace_back(consumer);
+			}
+		}
+	}
+
+	if (accesses.empty() || extent > UINT32_MAX) {
+		return false;
+	}
+
+	if (!hasReturn) {
+		// original function should not fall through into loop copies
+		code.emplace_back(Opcode::Return, Index(func.sig->results.size()), 0);
+		hasReturn = true;
+	}
+
+	const Index copy = code.size();
+	for (Index i = head; i <= end; ++ i) {
+		Func::OpcodeRec rec = code[i];
+		switch (rec.opcode) {
+		case Opcode::Br:
+		case Opcode::BrIf:
+		case Opcode::BrTable:
+		case Opcode::If:
+		case Opcode::Else:
+			if (rec.value32.v2 >= head && rec.value32.v2 <= end) {
+				rec.value32.v2 = rec.value32.v2 - head + copy;
+			}
+			break;
+		default:
+			break;
+		}
+		code.emplace_back(rec);
+	}
+	code.emplace_back(Opcode::Br, kInvalidIndex, end + 1);
+
+	for (auto &it : accesses) {
+		auto &rec = code[it - head + copy];
+		rec.opcode = GetUncheckedOpcode(rec.opcode);
+	}
+
+	uint32_t flags = (bound.opcode == Opcode::I32Const ? uint32_t(Func::LoopGuardConstBound) : uint32_t(0))
+			| (cmp.opcode == Opcode::I32LeU ? uint32_t(Func::LoopGuardInclusiveBound) : uint32_t(0));
+
+	code[guard].value32.v1 = local;
+	code[guard].value32.v2 = copy;
+	code[guard + 1].value32.v1 = bound.value32.v1;
+	code[guard + 1].value32.v2 = flags;
+	code[guard + 2].value32.v1 = uint32_t(extent);
+	code[guard + 2].value32.v2 = memory;
+	return true;
+}
+
+void ModuleReader::HoistBoundsChecks(Func &func) {
+	bool hasReturn = false;
+	const Index size = func.opcodes.size();
+	for (Index i = 0; i < size; ++ i) {
+		if (func.opcodes[i].opcode == Opcode::InterpLoopGuard) {
+			if (!HoistLoopBoundsCheck(func, i, hasReturn)) {
+				func.opcodes[i + 2].value32.v1 = 0;
+			}
+			i += 2;
+		}
+	}
+}
+
+}
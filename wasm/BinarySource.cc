@@ -75,7 +75,9 @@ static Result CheckGlobal(ModuleReader *reader, Module *module, Index global_ind
 
 
 bool ModuleReader::OnError(StringStream & message) {
-	if (!_env) {
+	if (_deferErrors) {
+		_errors.emplace_back("Reader", message.str());
+	} else if (!_env) {
 		BINARY_PRINTF("%s\n", message.str().data());
 	} else {
 		_env->onError("Reader", message);
@@ -113,11 +115,13 @@ Result ModuleReader::BeginFunctionBody(Index index) {
 
 	CHECK_RESULT(_typechecker.BeginFunction(&_currentFunc->sig->results));
 	PushLabel(_currentFunc->sig->results.size(), 0, kInvalidIndex);
+	BeginFuelBlock();
 
 	return Result::Ok;
 }
 Result ModuleReader::EndFunctionBody(Index index) {
 	CHECK_RESULT(_typechecker.EndFunction());
+	EndFuelBlock();
 	PopLabel(_opcodes.size());
 
 	_currentFunc->opcodes = _opcodes;
@@ -137,6 +141,10 @@ Result ModuleReader::EndFunctionBody(Index index) {
 		}
 	}
 
+	if (_options->features.isBoundsCheckHoistingEnabled()) {
+		HoistBoundsChecks(*_currentFunc);
+	}
+
 	_opcodes.clear();
 	_labels.clear();
 
@@ -165,7 +173,7 @@ Result ModuleReader::OnAtomicLoadExpr(Opcode opcode, uint32_t alignment_log2, Ad
 	CHECK_RESULT(CheckHasMemory(this, _targetModule, opcode));
 	CHECK_RESULT(CheckAtomicAlign(this, alignment_log2, opcode.GetMemorySize()));
 	CHECK_RESULT(_typechecker.OnAtomicLoad(opcode));
-	EmitOpcodeValue(opcode, 0, offset); // memory_index offset
+	EmitOpcodeValue(opcode, offset, 0); // offset memory_index
 	return Result::Ok;
 }
 Result ModuleReader::OnAtomicStoreExpr(Opcode opcode, uint32_t alignment_log2, Address offset) {
@@ -173,7 +181,7 @@ Result ModuleReader::OnAtomicStoreExpr(Opcode opcode, uint32_t alignment_log2, A
 	CHECK_RESULT(CheckHasMemory(this, _targetModule, opcode));
 	CHECK_RESULT(CheckAtomicAlign(this, alignment_log2, opcode.GetMemorySize()));
 	CHECK_RESULT(_typechecker.OnAtomicStore(opcode));
-	EmitOpcodeValue(opcode, 0, offset); // memory_index offset
+	EmitOpcodeValue(opcode, offset, 0); // offset memory_index
 	return Result::Ok;
 }
 Result ModuleReader::OnAtomicRmwExpr(Opcode opcode, uint32_t alignment_log2, Address offset) {
@@ -181,7 +189,7 @@ Result ModuleReader::OnAtomicRmwExpr(Opcode opcode, uint32_t alignment_log2, Add
 	CHECK_RESULT(CheckHasMemory(this, _targetModule, opcode));
 	CHECK_RESULT(CheckAtomicAlign(this, alignment_log2, opcode.GetMemorySize()));
 	CHECK_RESULT(_typechecker.OnAtomicRmw(opcode));
-	EmitOpcodeValue(opcode, 0, offset); // memory_index offset
+	EmitOpcodeValue(opcode, offset, 0); // offset memory_index
 	return Result::Ok;
 }
 Result ModuleReader::OnAtomicRmwCmpxchgExpr(Opcode opcode, uint32_t alignment_log2, Address offset) {
@@ -189,7 +197,7 @@ Result ModuleReader::OnAtomicRmwCmpxchgExpr(Opcode opcode, uint32_t alignment_lo
 	CHECK_RESULT(CheckHasMemory(this, _targetModule, opcode));
 	CHECK_RESULT(CheckAtomicAlign(this, alignment_log2, opcode.GetMemorySize()));
 	CHECK_RESULT(_typechecker.OnAtomicRmwCmpxchg(opcode));
-	EmitOpcodeValue(opcode, 0, offset);
+	EmitOpcodeValue(opcode, offset, 0);
 	return Result::Ok;
 }
 Result ModuleReader::OnAtomicWaitExpr(Opcode opcode, uint32_t alignment_log2, Address offset) {
@@ -197,16 +205,16 @@ Result ModuleReader::OnAtomicWaitExpr(Opcode opcode, uint32_t alignment_log2, Ad
 	CHECK_RESULT(CheckHasMemory(this, _targetModule, opcode));
 	CHECK_RESULT(CheckAtomicAlign(this, alignment_log2, opcode.GetMemorySize()));
 	CHECK_RESULT(_typechecker.OnAtomicWait(opcode));
-	EmitOpcodeValue(opcode, 0, offset);
-	return Result::Error;
+	EmitOpcodeValue(opcode, offset, 0);
+	return Result::Ok;
 }
 Result ModuleReader::OnAtomicWakeExpr(Opcode opcode, uint32_t alignment_log2, Address offset) {
 	BINARY_PRINTF("%s\n", __FUNCTION__);
 	CHECK_RESULT(CheckHasMemory(this, _targetModule, opcode));
 	CHECK_RESULT(CheckAtomicAlign(this, alignment_log2, opcode.GetMemorySize()));
 	CHECK_RESULT(_typechecker.OnAtomicWake(opcode));
-	EmitOpcodeValue(opcode, 0, offset);
-	return Result::Error;
+	EmitOpcodeValue(opcode, offset, 0);
+	return Result::Ok;
 }
 
 Result ModuleReader::OnUnaryExpr(Opcode opcode) {
@@ -221,12 +229,19 @@ Result ModuleReader::OnBinaryExpr(Opcode opcode) {
 	EmitOpcodeValue(opcode, 0, 0);
 	return Result::Ok;
 }
+Result ModuleReader::OnTernaryExpr(Opcode opcode) {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+	CHECK_RESULT(_typechecker.OnTernary(opcode));
+	EmitOpcodeValue(opcode, 0, 0);
+	return Result::Ok;
+}
 
-Result ModuleReader::OnBlockExpr(Index num_types, Type* sig_types) {
-	BINARY_PRINTF("%s %u\n", __FUNCTION__, num_types);
-	TypeVector sig(sig_types, sig_types + num_types);
-	CHECK_RESULT(_typechecker.OnBlock(&sig));
-	PushLabel(num_types, _typechecker.type_stack_size(), kInvalidIndex);
+Result ModuleReader::OnBlockExpr(Index num_params, Type* param_types, Index num_results, Type* result_types) {
+	BINARY_PRINTF("%s %u %u\n", __FUNCTION__, num_params, num_results);
+	TypeVector params(param_types, param_types + num_params);
+	TypeVector sig(result_types, result_types + num_results);
+	CHECK_RESULT(_typechecker.OnBlock(&params, &sig));
+	PushLabel(num_results, _typechecker.type_stack_size() - num_params, kInvalidIndex);
 	return Result::Ok;
 }
 Result ModuleReader::OnBrExpr(Index depth) {
@@ -258,19 +273,38 @@ Result ModuleReader::OnBrTableExpr(Index num_targets, Index* target_depths, Inde
 
 	return Result::Ok;
 }
-Result ModuleReader::OnLoopExpr(Index num_types, Type* sig_types) {
+Result ModuleReader::OnLoopExpr(Index num_params, Type* param_types, Index num_results, Type* result_types) {
 	BINARY_PRINTF("%s\n", __FUNCTION__);
-	TypeVector sig(sig_types, sig_types + num_types);
-	CHECK_RESULT(_typechecker.OnLoop(&sig));
-	PushLabel(num_types, _typechecker.type_stack_size(), _opcodes.size());
+	TypeVector params(param_types, param_types + num_params);
+	TypeVector sig(result_types, result_types + num_results);
+	CHECK_RESULT(_typechecker.OnLoop(&params, &sig));
+	const Index stack = _typechecker.type_stack_size() - num_params;
+	Index guard = kInvalidIndex;
+	if (_options->features.isBoundsCheckHoistingEnabled()) {
+		guard = _opcodes.size();
+		EmitOpcodeValue(Opcode::InterpLoopGuard, kInvalidIndex, kInvalidIndex); // induction local, unchecked copy
+		EmitOpcodeValue(Opcode::InterpLoopGuard, 0, 0); // bound, flags
+		EmitOpcodeValue(Opcode::InterpLoopGuard, 0, 0); // loop end (extent after analysis), memory index
+	}
+	PushLabel(num_results, stack, _opcodes.size(), guard);
+	if (num_params > 0) {
+		// branches to loop pass its params, move them to the bottom of loop's stack
+		EmitOpcodeValue(Opcode::End, stack, num_params);
+	}
+	BeginFuelBlock(); // charged on every back-edge
+	if (_options->features.isEpochInterruptionEnabled()) {
+		EmitOpcodeValue(Opcode::InterpCheckEpoch, 0, 0);
+	}
 	return Result::Ok;
 }
-Result ModuleReader::OnIfExpr(Index num_types, Type* sig_types) {
+Result ModuleReader::OnIfExpr(Index num_params, Type* param_types, Index num_results, Type* result_types) {
 	BINARY_PRINTF("%s\n", __FUNCTION__);
-	TypeVector sig(sig_types, sig_types + num_types);
-	CHECK_RESULT(_typechecker.OnIf(&sig));
-	PushLabel(num_types, _typechecker.type_stack_size(), kInvalidIndex, _opcodes.size());
+	TypeVector params(param_types, param_types + num_params);
+	TypeVector sig(result_types, result_types + num_results);
+	CHECK_RESULT(_typechecker.OnIf(&params, &sig));
+	PushLabel(num_results, _typechecker.type_stack_size() - num_params, kInvalidIndex, _opcodes.size());
 	EmitOpcodeValue(Opcode::If, _labelStack.back(), kInvalidIndex);
+	BeginFuelBlock();
 	return Result::Ok;
 }
 Result ModuleReader::OnElseExpr() {
@@ -279,14 +313,19 @@ Result ModuleReader::OnElseExpr() {
 	auto backLabel = _labels.at(_labelStack.back());
 	EmitOpcodeValue(Opcode::Else, _labelStack.back(), kInvalidIndex);
 	_opcodes[backLabel.origin].value32.v2 = _opcodes.size();
+	BeginFuelBlock();
 	return Result::Ok;
 }
 Result ModuleReader::OnEndExpr() {
 	BINARY_PRINTF("%s\n", __FUNCTION__);
 	CHECK_RESULT(_typechecker.OnEnd());
 	auto &backLabel = _labels[_labelStack.back()];
+	if (backLabel.origin != kInvalidIndex && _opcodes[backLabel.origin].opcode == Opcode::InterpLoopGuard) {
+		_opcodes[backLabel.origin + 2].value32.v1 = _opcodes.size();
+	}
 	PopLabel(_opcodes.size());
 	EmitOpcodeValue(Opcode::End, backLabel.stack, backLabel.results);
+	BeginFuelBlock(); // branches to this label lands on End
 	return Result::Ok;
 }
 Result ModuleReader::OnDropExpr() {
@@ -320,6 +359,30 @@ Result ModuleReader::OnCallIndirectExpr(Index sig_index) {
 	EmitOpcodeValue(Opcode::CallIndirect, sig_index, 0); // sig index, table index
 	return Result::Ok;
 }
+Result ModuleReader::OnReturnCallExpr(Index func_index) {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+
+	auto sig = _targetModule->getFuncSignature(func_index);
+	if (!sig.first) {
+		return Result::Error;
+	}
+
+	CHECK_RESULT(_typechecker.OnReturnCall(&sig.first->params, &sig.first->results));
+	EmitOpcodeValue(Opcode::ReturnCall, func_index, uint32_t(sig.second));
+	return Result::Ok;
+}
+Result ModuleReader::OnReturnCallIndirectExpr(Index sig_index) {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+	if (!_targetModule->hasTable()) {
+		PushErrorStream([&] (StringStream &stream) { stream << "found return_call_indirect operator, but no table"; });
+		return Result::Error;
+	}
+
+	Module::Signature* sig = _targetModule->getSignature(sig_index);
+	CHECK_RESULT(_typechecker.OnReturnCallIndirect(&sig->params, &sig->results));
+	EmitOpcodeValue(Opcode::ReturnCallIndirect, sig_index, 0); // sig index, table index
+	return Result::Ok;
+}
 
 Result ModuleReader::OnCompareExpr(Opcode opcode) {
 	BINARY_PRINTF("%s\n", __FUNCTION__);
@@ -338,6 +401,36 @@ Result ModuleReader::OnCurrentMemoryExpr() {
 	return Result::Ok;
 }
 
+Result ModuleReader::OnMemoryInitExpr(Index segment) {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+	CHECK_RESULT(CheckHasMemory(this, _targetModule, Opcode::MemoryInit));
+	CHECK_RESULT(_typechecker.OnMemoryInit());
+	EmitOpcodeValue(Opcode::MemoryInit, segment, 0); // segment, memory index
+	return Result::Ok;
+}
+
+Result ModuleReader::OnDataDropExpr(Index segment) {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+	EmitOpcodeValue(Opcode::DataDrop, segment);
+	return Result::Ok;
+}
+
+Result ModuleReader::OnMemoryCopyExpr() {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+	CHECK_RESULT(CheckHasMemory(this, _targetModule, Opcode::MemoryCopy));
+	CHECK_RESULT(_typechecker.OnMemoryCopy());
+	EmitOpcodeValue(Opcode::MemoryCopy, 0, 0); // memory index
+	return Result::Ok;
+}
+
+Result ModuleReader::OnMemoryFillExpr() {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+	CHECK_RESULT(CheckHasMemory(this, _targetModule, Opcode::MemoryFill));
+	CHECK_RESULT(_typechecker.OnMemoryFill());
+	EmitOpcodeValue(Opcode::MemoryFill, 0, 0); // memory index
+	return Result::Ok;
+}
+
 Result ModuleReader::OnI32ConstExpr(uint32_t value) {
 	BINARY_PRINTF("%s\n", __FUNCTION__);
 	CHECK_RESULT(_typechecker.OnConst(Type::I32));
@@ -446,6 +539,29 @@ Result ModuleReader::OnStoreExpr(Opcode opcode, uint32_t alignment_log2, Address
 }
 
 
+Result ModuleReader::OnSimdConstExpr(V128 value) {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+	CHECK_RESULT(_typechecker.OnConst(Type::V128));
+	EmitOpcodeValue(Opcode::V128Const, value.lo);
+	EmitOpcodeValue(Opcode::V128Const, value.hi); // second half, skipped by interpreter
+	return Result::Ok;
+}
+
+Result ModuleReader::OnSimdLaneOpExpr(Opcode opcode, uint8_t lane) {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+	CHECK_RESULT(_typechecker.OnSimdLaneOp(opcode));
+	EmitOpcodeValue(opcode, uint32_t(lane));
+	return Result::Ok;
+}
+
+Result ModuleReader::OnSimdShuffleExpr(Opcode opcode, V128 lanes) {
+	BINARY_PRINTF("%s\n", __FUNCTION__);
+	CHECK_RESULT(_typechecker.OnBinary(opcode));
+	EmitOpcodeValue(opcode, lanes.lo);
+	EmitOpcodeValue(opcode, lanes.hi); // second half, skipped by interpreter
+	return Result::Ok;
+}
+
 Result ModuleReader::OnTeeLocalExpr(Index local_index) {
 	BINARY_PRINTF("%s\n", __FUNCTION__);
 	CHECK_RESULT(CheckLocal(this, _currentFunc, local_index));
@@ -496,6 +612,21 @@ void ModuleReader::PushLabel(Index results, Index stack, Index position, Index o
 	_labelStack.push_back(_labels.size() - 1);
 }
 
+void ModuleReader::BeginFuelBlock() {
+	if (_options->features.isFuelMeteringEnabled()) {
+		EndFuelBlock();
+		_fuelBlock = _opcodes.size();
+		EmitOpcodeValue(Opcode::InterpChargeFuel, 0, 0); // instruction count
+	}
+}
+
+void ModuleReader::EndFuelBlock() {
+	if (_fuelBlock != kInvalidIndex) {
+		_opcodes[_fuelBlock].value32.v1 = _opcodes.size() - _fuelBlock - 1;
+		_fuelBlock = kInvalidIndex;
+	}
+}
+
 void ModuleReader::PopLabel(Index position) {
 	auto stackId = _labelStack.back();
 	if (_labels[stackId].offset == kInvalidIndex) {
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CodeCache.h"
+#include "Binary.h"
+#include <limits>
+
+namespace wasm {
+
+CodeCache::Reader::~Reader() {
+	if (_cache) {
+		_cache->detach(this);
+	}
+}
+
+void CodeCache::Reader::pin(CodeCache *cache) {
+	if (_cache != cache) {
+		if (_cache) {
+			_cache->detach(this);
+		}
+		cache->attach(this);
+		_cache = cache;
+	}
+
+	// reader, that pinned epoch after eviction, finds function in Evicting state or later
+	_epoch.store(cache->_epoch.load(), std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void CodeCache::Reader::unpin() {
+	_epoch.store(0, std::memory_order_release);
+	if (_cache->_trim.load(std::memory_order_relaxed)) {
+		// reader does not wait for other threads, code is released by next reader or translation
+		std::unique_lock<std::mutex> lock(_cache->_mutex, std::try_to_lock);
+		if (lock.owns_lock()) {
+			_cache->trim();
+		}
+	}
+}
+
+void CodeCache::setLimit(size_t limit) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_limit = limit;
+	if (limit) {
+		_enabled.store(true);
+		trim();
+	}
+}
+
+size_t CodeCache::getLimit() const {
+	std::unique_lock<std::mutex> lock(_mutex);
+	return _limit;
+}
+
+CodeCache::Stats CodeCache::getStats() const {
+	std::unique_lock<std::mutex> lock(_mutex);
+	Stats ret;
+	ret.limit = _limit;
+	ret.size = _size;
+	ret.evicting = _evicted.load();
+	ret.functions = _entries.size() - ret.evicting;
+	ret.translations = _translations;
+	ret.retranslations = _retranslations;
+	ret.evictions = _evictions;
+	return ret;
+}
+
+void CodeCache::collect() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	trim();
+}
+
+void CodeCache::insert(ModuleLazyCode *code, Index func, size_t size, bool retranslated) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_entries.emplace_back(Entry{code, func, size, 0});
+	_size += size;
+	++ _translations;
+	if (retranslated) {
+		++ _retranslations;
+	}
+
+	trim();
+}
+
+void CodeCache::remove(ModuleLazyCode *code) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	size_t i = 0;
+	while (i < _entries.size()) {
+		auto &it = _entries[i];
+		if (it.code != code) {
+			++ i;
+			continue;
+		}
+
+		_size -= it.size;
+		if (it.epoch) {
+			_evictedSize -= it.size;
+			_evicted.fetch_sub(1);
+		}
+		it = _entries.back();
+		_entries.pop_back();
+	}
+
+	if (_hand >= _entries.size()) {
+		_hand = 0;
+	}
+}
+
+void CodeCache::attach(Reader *reader) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_readers.emplace_back(reader);
+}
+
+void CodeCache::detach(Reader *reader) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (auto it = _readers.begin(); it != _readers.end(); ++ it) {
+		if (*it == reader) {
+			_readers.erase(it);
+			break;
+		}
+	}
+}
+
+void CodeCache::trim() {
+	// released code leaves space for resident code, that was used again after eviction
+	release();
+	evict();
+	release();
+
+	_trim.store(_evicted.load() > 0 || (_limit && _size > _limit));
+}
+
+// clock hand clears reference (Ready -> Cold), then evicts function, that was not called since (Cold -> Evicting)
+void CodeCache::evict() {
+	if (!_limit || _size <= _limit + _evictedSize) {
+		return;
+	}
+
+	size_t excess = _size - _limit - _evictedSize;
+	const uint64_t epoch = _epoch.load();
+	size_t marked = 0;
+
+	for (size_t i = 0; i < _entries.size() * 2 && excess > 0; ++ i) {
+		if (_hand >= _entries.size()) {
+			_hand = 0;
+		}
+
+		auto &it = _entries[_hand ++];
+		if (it.epoch) {
+			continue;
+		}
+
+		auto &state = getState(it);
+		auto value = Func::State::Ready;
+		if (state.compare_exchange_strong(value, Func::State::Cold)) {
+			continue;
+		}
+
+		if (value == Func::State::Cold && state.compare_exchange_strong(value, Func::State::Evicting)) {
+			it.epoch = epoch;
+			_evictedSize += it.size;
+			excess -= std::min(excess, it.size);
+			++ marked;
+		}
+	}
+
+	if (marked) {
+		if (!_oldestEviction) {
+			_oldestEviction = epoch;
+		}
+		_evicted.fetch_add(marked);
+
+		// readers, that pin code after this point, can not use evicted code without calling function again
+		_epoch.fetch_add(1);
+	}
+}
+
+// code, evicted in epoch, is released, when every pinned reader pinned code after it
+void CodeCache::release() {
+	if (_evicted.load() == 0) {
+		return;
+	}
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	uint64_t pinned = std::numeric_limits<uint64_t>::max();
+	for (auto &it : _readers) {
+		auto epoch = it->_epoch.load(std::memory_order_acquire);
+		if (epoch && epoch < pinned) {
+			pinned = epoch;
+		}
+	}
+
+	if (pinned <= _oldestEviction) {
+		return;
+	}
+
+	uint64_t oldest = 0;
+	size_t i = 0;
+	while (i < _entries.size()) {
+		auto &it = _entries[i];
+		if (!it.epoch) {
+			++ i;
+			continue;
+		} else if (it.epoch >= pinned) {
+			oldest = oldest ? std::min(oldest, it.epoch) : it.epoch;
+			++ i;
+			continue;
+		}
+
+		_evictedSize -= it.size;
+		_evicted.fetch_sub(1);
+
+		// function, called after eviction, holds its code
+		auto value = Func::State::Evicting;
+		if (!getState(it).compare_exchange_strong(value, Func::State::Translating)) {
+			it.epoch = 0;
+			++ i;
+			continue;
+		}
+
+		it.code->release(it.func);
+		_size -= it.size;
+		++ _evictions;
+
+		it = _entries.back();
+		_entries.pop_back();
+	}
+
+	if (_hand >= _entries.size()) {
+		_hand = 0;
+	}
+	_oldestEviction = oldest;
+}
+
+std::atomic<Func::State> &CodeCache::getState(const Entry &entry) const {
+	return entry.code->_states[entry.func];
+}
+
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_CODECACHE_H_
+#define SRC_CODECACHE_H_
+
+#include "Module.h"
+#include <atomic>
+#include <mutex>
+
+namespace wasm {
+
+// Budget for translated code of modules, read with ReadOptions::lazy. When translated code exceeds limit,
+// cold functions are evicted with clock algorithm: function, that was not called since previous pass of
+// clock hand, returns to pending state and is translated again from module binary on next call.
+//
+// Code of evicted function is released, when every thread, that could execute it, has empty call stack,
+// so suspended threads delay release of code, evicted after they started.
+class CodeCache {
+public:
+	struct Stats {
+		size_t limit = 0;
+		size_t size = 0; // bytes of translated code, including evicted code, that is not released yet
+		size_t functions = 0; // functions with resident translated code
+		size_t evicting = 0; // evicted functions, which code is not released yet
+		uint64_t translations = 0;
+		uint64_t retranslations = 0; // translations of functions, that was evicted before
+		uint64_t evictions = 0; // functions, which code was released
+	};
+
+	// code is pinned by reader, while its call stack is not empty (see Thread)
+	class Reader {
+	public:
+		Reader() = default;
+		~Reader();
+
+		Reader(const Reader &) = delete;
+		Reader &operator=(const Reader &) = delete;
+
+		bool isPinned() const { return _epoch.load(std::memory_order_relaxed) != 0; }
+
+		void pin(CodeCache *);
+		void unpin();
+
+	protected:
+		friend class CodeCache;
+
+		CodeCache *_cache = nullptr;
+		std::atomic<uint64_t> _epoch = ATOMIC_VAR_INIT(0); // epoch, when code was pinned, 0 for unpinned reader
+	};
+
+	// 0 means unlimited; cache is enabled with first non-zero limit, that should be set before modules are loaded
+	void setLimit(size_t);
+	size_t getLimit() const;
+
+	bool isEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+	Stats getStats() const;
+
+	// releases evicted code, that is not used by threads
+	void collect();
+
+protected:
+	friend class ModuleLazyCode;
+
+	struct Entry {
+		ModuleLazyCode *code;
+		Index func;
+		size_t size;
+		uint64_t epoch; // epoch of eviction, 0 for resident code
+	};
+
+	void insert(ModuleLazyCode *, Index func, size_t size, bool retranslated);
+	void remove(ModuleLazyCode *);
+
+	void attach(Reader *);
+	void detach(Reader *);
+
+	void trim();
+	void evict();
+	void release();
+
+	std::atomic<Func::State> &getState(const Entry &) const;
+
+	mutable std::mutex _mutex;
+	std::atomic<bool> _enabled = ATOMIC_VAR_INIT(false);
+	std::atomic<uint64_t> _epoch = ATOMIC_VAR_INIT(1);
+	std::atomic<size_t> _evicted = ATOMIC_VAR_INIT(0); // entries, that wait for release
+	std::atomic<bool> _trim = ATOMIC_VAR_INIT(false); // cache exceeds limit or has evicted code
+
+	size_t _limit = 0;
+	size_t _size = 0;
+	size_t _evictedSize = 0;
+	uint64_t _oldestEviction = 0;
+
+	Vector<Entry> _entries; // clock ring
+	size_t _hand = 0;
+	Vector<Reader *> _readers;
+
+	uint64_t _translations = 0;
+	uint64_t _retranslations = 0;
+	uint64_t _evictions = 0;
+};
+
+}
+
+#endif /* SRC_CODECACHE_H_ */
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_COROUTINE_H_
+#define SRC_COROUTINE_H_
+
+// Header-only C++20 coroutine API; library itself does not require C++20,
+// this header is available only for code, compiled with coroutine support
+
+#include "GreenRuntime.h"
+
+#if __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace wasm {
+
+// Lazy coroutine task: starts, when awaited or started with Task::start
+template <typename T>
+class Task {
+public:
+	struct promise_type;
+	using Handle = std::coroutine_handle<promise_type>;
+
+	struct promise_type {
+		std::optional<T> value;
+		std::exception_ptr error;
+		std::coroutine_handle<> continuation;
+		Function<void(T *)> detached; // result is nullptr, when coroutine throws
+
+		struct FinalAwaiter {
+			bool await_ready() noexcept { return false; }
+			std::coroutine_handle<> await_suspend(Handle h) noexcept {
+				auto &p = h.promise();
+				if (p.continuation) {
+					return p.continuation;
+				}
+				if (p.detached) {
+					auto cb = std::move(p.detached);
+					cb(p.value ? &*p.value : nullptr);
+					h.destroy();
+				}
+				return std::noop_coroutine();
+			}
+			void await_resume() noexcept { }
+		};
+
+		Task get_return_object() { return Task(Handle::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return std::suspend_always(); }
+		FinalAwaiter final_suspend() noexcept { return FinalAwaiter(); }
+		void return_value(T v) { value.emplace(std::move(v)); }
+		void unhandled_exception() { error = std::current_exception(); }
+	};
+
+	Task(Task &&other) : _handle(std::exchange(other._handle, nullptr)) { }
+	Task &operator=(Task &&other) {
+		if (_handle) {
+			_handle.destroy();
+		}
+		_handle = std::exchange(other._handle, nullptr);
+		return *this;
+	}
+
+	~Task() {
+		if (_handle) {
+			_handle.destroy();
+		}
+	}
+
+	bool await_ready() const { return false; }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) {
+		_handle.promise().continuation = c;
+		return _handle;
+	}
+	T await_resume() {
+		auto &p = _handle.promise();
+		if (p.error) {
+			std::rethrow_exception(p.error);
+		}
+		return std::move(*p.value);
+	}
+
+	// runs task without awaiting coroutine, callback can be called before start returns;
+	// task frame is destroyed after callback
+	void start(Function<void(T *)> &&cb) {
+		auto h = std::exchange(_handle, nullptr);
+		h.promise().detached = std::move(cb);
+		h.resume();
+	}
+
+protected:
+	explicit Task(Handle h) : _handle(h) { }
+
+	Handle _handle;
+};
+
+// Awaitable guest call: runs function on workers of runtime, coroutine is resumed on worker thread,
+// that completed the call
+template <typename RuntimeType>
+class CallAwaiter {
+public:
+	using CallResult = PooledRuntime::CallResult;
+
+	CallAwaiter(RuntimeType &runtime, GreenThread *thread, const Func &func, Vector<Value> &&params, const CallLimits &limits)
+	: _runtime(runtime), _thread(thread), _func(func), _params(std::move(params)), _limits(limits) { }
+
+	bool await_ready() const { return false; }
+
+	void await_suspend(std::coroutine_handle<> h) {
+		// coroutine can be resumed on other thread before submit returns, so awaiter is not touched after it
+		submit(h);
+	}
+
+	CallResult await_resume() { return std::move(_result); }
+
+protected:
+	void submit(std::coroutine_handle<> h);
+
+	RuntimeType &_runtime;
+	GreenThread *_thread;
+	const Func &_func;
+	Vector<Value> _params;
+	CallLimits _limits;
+	CallResult _result;
+};
+
+template <>
+inline void CallAwaiter<GreenRuntime>::submit(std::coroutine_handle<> h) {
+	_runtime.call(_thread, _func, std::move(_params), [this, h] (CallResult &&result) {
+		_result = std::move(result);
+		h.resume();
+	}, _limits);
+}
+
+template <>
+inline void CallAwaiter<PooledRuntime>::submit(std::coroutine_handle<> h) {
+	auto mod = _runtime.getModule(_func.module);
+	if (!mod) {
+		_result.result = Thread::Result::TrapHostTrapped;
+		h.resume();
+		return;
+	}
+
+	_runtime.submit(*mod, _func, std::move(_params), [this, h] (CallResult &&result) {
+		_result = std::move(result);
+		h.resume();
+	}, _limits);
+}
+
+inline CallAwaiter<GreenRuntime> co_call(GreenRuntime &runtime, GreenThread *thread, const Func &func,
+		Vector<Value> params, const CallLimits &limits = CallLimits()) {
+	return CallAwaiter<GreenRuntime>(runtime, thread, func, std::move(params), limits);
+}
+
+inline CallAwaiter<PooledRuntime> co_call(PooledRuntime &runtime, const Func &func,
+		Vector<Value> params, const CallLimits &limits = CallLimits()) {
+	return CallAwaiter<PooledRuntime>(runtime, nullptr, func, std::move(params), limits);
+}
+
+// Host import as coroutine: receives arguments, returns results of host function.
+// Green thread is suspended, while coroutine waits, and resumed by GreenRuntime on completion;
+// on other threads calling OS thread blocks until coroutine completes.
+using CoroutineHostFunc = Task<Vector<Value>> (*) (Thread *, const HostFunc *, Vector<Value> args);
+
+inline Result CoroutineHostCallback(Thread *thread, const HostFunc *func, Value *buf) {
+	enum Phase { Running, Suspended, Completed };
+
+	struct State {
+		std::atomic<int> phase = ATOMIC_VAR_INIT(Running);
+		bool success = false;
+		Vector<Value> results;
+		std::mutex mutex;
+		std::condition_variable cond;
+	};
+
+	auto fn = reinterpret_cast<CoroutineHostFunc>(func->ctx);
+	auto green = dynamic_cast<GreenRuntime *>(const_cast<Runtime *>(thread->getRuntime()));
+	const bool async = green && thread->isSuspendable();
+
+	// coroutine can complete after thread is released or runtime is stopped, so it holds only resumer
+	auto resumer = async ? static_cast<GreenThread *>(thread)->getResumer() : GreenResumer();
+	const auto nresults = func->getResultsCount();
+
+	auto state = std::make_shared<State>();
+	fn(thread, func, Vector<Value>(buf, buf + func->getParamsCount())).start([state, resumer, nresults] (Vector<Value> *results) {
+		if (results && results->size() >= nresults) {
+			state->results = std::move(*results);
+			state->success = true;
+		}
+
+		int expected = Running;
+		if (state->phase.compare_exchange_strong(expected, Completed)) {
+			// completed synchronously or caller is blocked until completion
+			std::unique_lock<std::mutex> lock(state->mutex);
+			state->cond.notify_all();
+			return;
+		}
+
+		if (expected == Suspended) {
+			// empty results trap suspended call, late results are dropped
+			resumer.resume(state->success ? std::move(state->results) : Vector<Value>());
+		}
+	});
+
+	if (async) {
+		int expected = Running;
+		if (state->phase.compare_exchange_strong(expected, Suspended)) {
+			return Result::Suspend;
+		}
+	} else {
+		// no scheduler to resume thread, wait for completion
+		std::unique_lock<std::mutex> lock(state->mutex);
+		while (state->phase.load() != Completed) {
+			state->cond.wait(lock);
+		}
+	}
+
+	if (!state->success) {
+		return Result::Error;
+	}
+
+	memcpy(buf, state->results.data(), func->getResultsCount() * sizeof(Value));
+	return Result::Ok;
+}
+
+inline void addCoroutineFunc(HostModule &module, const StringView &name, CoroutineHostFunc fn,
+		TypeInitList params, TypeInitList results) {
+	module.addFunc(name, &CoroutineHostCallback, params, results, reinterpret_cast<void *>(fn));
+}
+
+}
+
+#endif
+
+#endif /* SRC_COROUTINE_H_ */
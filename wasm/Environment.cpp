@@ -17,18 +17,70 @@
 #include <string.h>
 #include "Environment.h"
 #include "Thread.h"
+#include "ModuleCache.h"
+
+#if __linux__
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#ifndef PAGEMAP_SCAN
+// Linux 6.7, include/uapi/linux/fs.h
+#define PAGE_IS_FILE (1 << 2)
+#define PAGE_IS_PRESENT (1 << 3)
+#define PAGE_IS_SWAPPED (1 << 4)
+#define PAGE_IS_PFNZERO (1 << 5)
+
+struct page_region {
+	uint64_t start;
+	uint64_t end;
+	uint64_t categories;
+};
+
+struct pm_scan_arg {
+	uint64_t size;
+	uint64_t flags;
+	uint64_t start;
+	uint64_t end;
+	uint64_t walk_end;
+	uint64_t vec;
+	uint64_t vec_len;
+	uint64_t max_pages;
+	uint64_t category_inverted;
+	uint64_t category_mask;
+	uint64_t category_anyof_mask;
+	uint64_t return_mask;
+};
+
+#define PAGEMAP_SCAN _IOWR('f', 16, struct pm_scan_arg)
+#endif
+
+#endif
 
 namespace wasm {
 
+static void Runtime_release_data(uint8_t *data, uint32_t size, bool mapped) {
+#if __linux__
+	if (mapped) {
+		munmap(data, size);
+		return;
+	}
+#endif
+	delete [] data;
+}
+
 static void Runtime_free_mem(RuntimeMemory &mem) {
-	delete [] mem.data;
+	Runtime_release_data(mem.data, mem.size, mem.mapped);
 	mem.data = nullptr;
 	mem.size = 0;
+	mem.mapped = false;
 }
 
 static void Runtime_alloc_mem(RuntimeMemory &mem) {
 	mem.data = new uint8_t[mem.limits.initial * WABT_PAGE_SIZE];
-	memset(mem.data, 0, mem.limits.initial);
+	memset(mem.data, 0, mem.limits.initial * WABT_PAGE_SIZE);
 	mem.size = mem.limits.initial * WABT_PAGE_SIZE;
 }
 
@@ -37,9 +89,10 @@ static void Runtime_realloc_mem(const RuntimeMemory &mem, uint32_t new_size) {
 	auto oldData = mem.data;
 	memcpy(newData, oldData, mem.size);
 	memset(newData + mem.size, 0, new_size - mem.size);
+	Runtime_release_data(oldData, mem.size, mem.mapped);
 	mem.data = newData;
 	mem.size = new_size;
-	delete [] oldData;
+	mem.mapped = false;
 }
 
 HostFunc::HostFunc(TypeInitList params, TypeInitList results, HostFuncCallback cb, void *ctx)
@@ -57,6 +110,11 @@ Environment::Environment() {
 	_envModule = makeHostModule("env");
 }
 
+Environment::~Environment() {
+	// background translation is cancelled before modules are destroyed
+	_translationPool.stop();
+}
+
 Module * Environment::loadModule(const StringView &name, const uint8_t *data, size_t size, const ReadOptions &opts) {
 	auto it = _externalModules.emplace(String(name.data(), name.size()), Module()).first;
 	if (it->second.init(this, data, size, opts)) {
@@ -76,6 +134,56 @@ Module * Environment::loadModule(const StringView &name, ModuleReader &reader, c
 	return nullptr;
 }
 
+Module * Environment::loadModuleFile(const StringView &name, const StringView &path, const ReadOptions &opts) {
+	auto it = _externalModules.emplace(String(name.data(), name.size()), Module()).first;
+	if (it->second.initFile(this, path, opts)) {
+		return &it->second;
+	} else {
+		_externalModules.erase(it);
+	}
+	return nullptr;
+}
+
+Module * Environment::loadModule(const StringView &name, const ModuleCache &cache, const uint8_t *data, size_t size, const ReadOptions &opts) {
+	auto key = cache.getKey(data, size, opts);
+	auto it = _externalModules.emplace(String(name.data(), name.size()), Module()).first;
+	if (cache.load(it->second, this, key)) {
+		return &it->second;
+	}
+
+	// cache stores translated bodies
+	ReadOptions readOpts(opts);
+	readOpts.lazy = false;
+
+	if (it->second.init(this, data, size, readOpts)) {
+		if (!cache.store(it->second, this, key)) {
+			pushErrorStream("ModuleCache", [&] (StringStream &stream) {
+				stream << "Fail to store module '" << name << "' in " << cache.getPath(key);
+			});
+		}
+		return &it->second;
+	} else {
+		_externalModules.erase(it);
+	}
+	return nullptr;
+}
+
+bool Environment::translateAll() const {
+	bool success = true;
+	for (auto &it : _externalModules) {
+		success = it.second.translateAll() && success;
+	}
+	return success;
+}
+
+CodeCache *Environment::getCodeCache() const {
+	return &_codeCache;
+}
+
+TranslationPool *Environment::getTranslationPool() const {
+	return &_translationPool;
+}
+
 HostModule * Environment::makeHostModule(const StringView &name) {
 	auto it = _hostModules.emplace(String(name.data(), name.size()), HostModule()).first;
 	return &it->second;
@@ -101,6 +209,44 @@ const Map<String, HostModule> &Environment::getHostModules() const {
 	return _hostModules;
 }
 
+const MemoryImage *Environment::getMemoryImage(const Module *mod, Index memory) const {
+	auto &memoryVec = mod->getMemoryIndexVec();
+	if (memory >= memoryVec.size() || memoryVec[memory].import) {
+		return nullptr;
+	}
+
+	auto def = mod->getMemory(memoryVec[memory].index);
+	if (!def || def->limits.initial == 0 || def->limits.initial * WABT_PAGE_SIZE > UINT32_MAX) {
+		return nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock(_imagesMutex);
+	auto it = _images.find(std::make_pair(mod, memory));
+	if (it != _images.end()) {
+		return it->second.get();
+	}
+
+	const uint32_t size = def->limits.initial * WABT_PAGE_SIZE;
+	std::unique_ptr<MemoryImage> image(new MemoryImage());
+	if (!image->init(size, [&] (uint8_t *data) {
+		for (auto &it : mod->getMemoryData()) {
+			if (it.passive || it.memory != memory) {
+				continue;
+			}
+			if (size < it.offset + it.size()) {
+				return false;
+			}
+			memcpy(data + it.offset, it.data(), it.size());
+		}
+		return true;
+	})) {
+		// segments are out of bounds, runtime reports it on initialization
+		image.reset();
+	}
+
+	return _images.emplace(std::make_pair(mod, memory), std::move(image)).first->second.get();
+}
+
 bool Environment::getGlobalValue(TypedValue &value, const StringView &module, const StringView &field) const {
 	return getGlobalValueRecursive(value, module, field, 0);
 }
@@ -196,6 +342,54 @@ const RuntimeModule *Runtime::getModule(const StringView &name) const {
 	return nullptr;
 }
 
+const Func *Runtime::getExportFunc(const StringView &module, const StringView &name) const {
+	if (auto mod = getModule(module)) {
+		return getExportFunc(*mod, name);
+	}
+	return nullptr;
+}
+const Func *Runtime::getExportFunc(const RuntimeModule &module, const StringView &name) const {
+	auto it = module.exports.find(name);
+	if (it != module.exports.end() && it->second.second == ExternalKind::Func) {
+		if (module.func[it->second.first].first) {
+			return module.func[it->second.first].first;
+		}
+	}
+	return nullptr;
+}
+
+const RuntimeGlobal *Runtime::getGlobal(const StringView &module, const StringView &name) const {
+	if (auto mod = getModule(module)) {
+		return getGlobal(*mod, name);
+	}
+	return nullptr;
+}
+const RuntimeGlobal *Runtime::getGlobal(const RuntimeModule &module, const StringView &name) const {
+	auto it = module.exports.find(name);
+	if (it != module.exports.end() && it->second.second == ExternalKind::Global) {
+		return module.globals[it->second.first];
+	}
+	return nullptr;
+}
+
+bool Runtime::setGlobal(const StringView &module, const StringView &name, const Value &value) {
+	if (auto mod = getModule(module)) {
+		return setGlobal(*mod, name, value);
+	}
+	return false;
+}
+
+bool Runtime::setGlobal(const RuntimeModule &module, const StringView &name, const Value &value) {
+	auto it = module.exports.find(name);
+	if (it != module.exports.end() && it->second.second == ExternalKind::Global) {
+		if (module.globals[it->second.first]->mut) {
+			module.globals[it->second.first]->value.value = value;
+			return true;
+		}
+	}
+	return false;
+}
+
 const Map<String, RuntimeModule> &Runtime::getModules() const {
 	return _modules;
 }
@@ -817,8 +1011,31 @@ bool Runtime::loadRuntime(const LinkingPolicy &policy) {
 		return true;
 	}
 
+	if (policy.snapshot) {
+		return restore(*policy.snapshot);
+	}
+
+	// memory, defined by module, is mapped from module's image, so runtimes share pages with initial data
+	Map<const RuntimeMemory *, const Module *> mappedMemory;
+	if (!_memoryCallback) {
+		for (auto &it : _modules) {
+			if (auto mod = it.second.module) {
+				for (Index i = 0; i < it.second.memory.size(); ++ i) {
+					auto mem = it.second.memory[i];
+					auto image = mem ? _env->getMemoryImage(mod, i) : nullptr;
+					if (image && image->isMappable() && image->size() == mem->limits.initial * WABT_PAGE_SIZE
+							&& restoreMemory(*mem, *image, false)) {
+						mappedMemory.emplace(mem, mod);
+					}
+				}
+			}
+		}
+	}
+
 	for (auto &it : _memory) {
-		initMemory(it);
+		if (mappedMemory.find(&it) == mappedMemory.end()) {
+			initMemory(it);
+		}
 	}
 
 	for (auto &it : _tables) {
@@ -829,7 +1046,18 @@ bool Runtime::loadRuntime(const LinkingPolicy &policy) {
 		auto &name = it.first;
 		auto &mod = it.second;
 		if (mod.module) {
+			mod.droppedData.clear();
 			for (auto &it : mod.module->getMemoryData()) {
+				mod.droppedData.emplace_back(it.passive ? 0 : 1);
+				if (it.passive) {
+					continue;
+				}
+				auto mappedIt = mappedMemory.find(mod.memory[it.memory]);
+				if (mappedIt != mappedMemory.end() && mappedIt->second == mod.module) {
+					// segment is already in image
+					updateUserDataOffset(*mod.memory[it.memory], it);
+					continue;
+				}
 				if (!emplaceMemoryData(*mod.memory[it.memory], it)) {
 					pushErrorStream([&] (std::ostream &stream) {
 						stream << "Memory initialization failed for " << "\"" << name << "\"";
@@ -882,32 +1110,193 @@ bool Runtime::initMemory(RuntimeMemory &memory) {
 	return true;
 }
 
-static constexpr size_t ALIGN(size_t size, uint32_t boundary) { return (((size) + ((boundary) - 1)) & ~((boundary) - 1)); }
+#if __linux__
+static bool Runtime_drop_dirty(RuntimeMemory &memory) {
+	const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+	// when most of pages are modified, remapping whole memory is faster
+	Vector<Index> pages;
+	if (!memory.getDirtyPages(pages) || pages.size() * pageSize * 2 > memory.size) {
+		return false;
+	}
+
+	// private pages of file mapping are discarded, next access maps page of snapshot image
+	size_t i = 0;
+	while (i < pages.size()) {
+		size_t j = i + 1;
+		while (j < pages.size() && pages[j] == pages[j - 1] + 1) {
+			++ j;
+		}
+		if (madvise(memory.data + pages[i] * pageSize, (j - i) * pageSize, MADV_DONTNEED) != 0) {
+			return false;
+		}
+		i = j;
+	}
+	return true;
+}
+#endif
+
+bool Runtime::restoreMemory(RuntimeMemory &memory, const MemoryImage &source, bool dirtyOnly) {
+	if (_memoryCallback) {
+		if (memory.size != source.size() || !memory.data) {
+			if (memory.data) {
+				_memoryCallback(memory, 0, RuntimeMemory::Action::Free, _linkingContext);
+			}
+			if (source.size() > 0 && !_memoryCallback(memory, source.size(), RuntimeMemory::Action::Alloc, _linkingContext)) {
+				return false;
+			}
+		}
+		if (source.size() > 0) {
+			source.copy(memory.data);
+		}
+		return true;
+	}
+
+#if __linux__
+	if (source.isMappable()) {
+		// mapping over previous private mapping of same size drops its modified pages
+		const bool inplace = memory.mapped && memory.size == source.size();
+		if (inplace && dirtyOnly && Runtime_drop_dirty(memory)) {
+			return true;
+		}
+		auto ptr = source.map(inplace ? memory.data : nullptr);
+		if (!ptr) {
+			return false;
+		}
+		if (!inplace) {
+			Runtime_free_mem(memory);
+		}
+		memory.data = ptr;
+		memory.size = source.size();
+		memory.mapped = true;
+		return true;
+	}
+#endif
+
+	if (memory.size != source.size() || memory.mapped) {
+		Runtime_free_mem(memory);
+		if (source.size() > 0) {
+			memory.data = new uint8_t[source.size()];
+			memory.size = source.size();
+		}
+	}
+	if (source.size() > 0) {
+		source.copy(memory.data);
+	}
+	return true;
+}
+
+bool Runtime::snapshot(RuntimeSnapshot &snap) const {
+	snap.clear();
+
+	snap._memory.resize(_memory.size());
+	for (size_t i = 0; i < _memory.size(); ++ i) {
+		auto &memory = _memory[i];
+		auto &target = snap._memory[i];
+		target.limits = memory.limits;
+		target.userDataOffset = memory.userDataOffset;
+		if (memory.data && memory.size > 0) {
+			if (!target.image.init(memory.data, memory.size)) {
+				pushErrorStream([&] (std::ostream &stream) {
+					stream << "Fail to write snapshot image of memory " << i << " (" << memory.size << " bytes)";
+				});
+				snap.clear();
+				return false;
+			}
+		}
+	}
+
+	snap._tables = _tables;
+	snap._globals = _globals;
+
+	snap._droppedData.reserve(_modules.size());
+	for (auto &it : _modules) {
+		snap._droppedData.emplace_back(it.second.droppedData);
+	}
+
+	static std::atomic<uint64_t> s_snapshotId(0);
+	snap._id = ++ s_snapshotId;
+	return true;
+}
+
+bool Runtime::restore(const RuntimeSnapshot &snap) {
+	if (!snap._id || snap._memory.size() != _memory.size() || snap._tables.size() != _tables.size()
+			|| snap._globals.size() != _globals.size() || snap._droppedData.size() != _modules.size()) {
+		pushErrorStream([&] (std::ostream &stream) {
+			stream << "Snapshot does not match runtime";
+		});
+		return false;
+	}
+
+	// memory, mapped from same snapshot, can be restored page by page
+	const bool dirtyOnly = (_snapshot == &snap && _snapshotId == snap._id);
+	for (size_t i = 0; i < _memory.size(); ++ i) {
+		_memory[i].limits = snap._memory[i].limits;
+		_memory[i].userDataOffset = snap._memory[i].userDataOffset;
+		if (!restoreMemory(_memory[i], snap._memory[i].image, dirtyOnly)) {
+			pushErrorStream([&] (std::ostream &stream) {
+				stream << "Fail to restore memory " << i << " from snapshot";
+			});
+			return false;
+		}
+	}
+
+	// assignment keeps objects in place, RuntimeModule pointers stay valid
+	for (size_t i = 0; i < _tables.size(); ++ i) {
+		_tables[i] = snap._tables[i];
+	}
+
+	for (size_t i = 0; i < _globals.size(); ++ i) {
+		_globals[i] = snap._globals[i];
+	}
+
+	size_t i = 0;
+	for (auto &it : _modules) {
+		it.second.droppedData = snap._droppedData[i ++];
+	}
+
+	_snapshot = &snap;
+	_snapshotId = snap._id;
+	return true;
+}
+
+bool Runtime::reset() {
+	if (!_snapshot) {
+		return false;
+	}
+	return restore(*_snapshot);
+}
 
 bool Runtime::emplaceMemoryData(RuntimeMemory &memory, const Module::Data &data) {
-	if (!memory.data && !data.data.empty() && data.offset == 0 && data.data.size() < WABT_PAGE_SIZE) {
+	if (!memory.data && !data.empty() && data.offset == 0 && data.size() < WABT_PAGE_SIZE) {
 		if (_memoryCallback) {
 			_memoryCallback(memory, 1 * WABT_PAGE_SIZE, RuntimeMemory::Action::Alloc, _linkingContext);
 		} else {
 			Runtime_alloc_mem(memory);
 		}
 	}
-	if (memory.size < data.offset + data.data.size()) {
+	if (memory.size < data.offset + data.size()) {
 		pushErrorStream([&] (std::ostream &stream) {
-			stream << "Fail to emplace memory data, position out of bounds: " << data.offset << ":" << data.data.size();
+			stream << "Fail to emplace memory data, position out of bounds: " << data.offset << ":" << data.size();
 		});
 		return false;
 	}
 
 	auto ptr = memory.data + data.offset;
-	memcpy(ptr, data.data.data(), data.data.size());
+	memcpy(ptr, data.data(), data.size());
 
-	if (data.offset + data.data.size() > memory.userDataOffset) {
-		memory.userDataOffset = ALIGN(data.offset + data.data.size(), 16);
-	}
+	updateUserDataOffset(memory, data);
 	return true;
 }
 
+static constexpr size_t ALIGN(size_t size, uint32_t boundary) { return (((size) + ((boundary) - 1)) & ~((boundary) - 1)); }
+
+void Runtime::updateUserDataOffset(RuntimeMemory &memory, const Module::Data &data) {
+	if (data.offset + data.size() > memory.userDataOffset) {
+		memory.userDataOffset = ALIGN(data.offset + data.size(), 16);
+	}
+}
+
 bool Runtime::initTable(RuntimeTable &table) {
 	Value fillValue; fillValue.i32 = kInvalidIndex;
 	table.values.resize(table.limits.initial, fillValue);
@@ -932,6 +1321,226 @@ bool Runtime::emplaceTableElements(RuntimeTable &table, const Module::Elements &
 	return true;
 }
 
+RuntimeSnapshot::~RuntimeSnapshot() {
+	clear();
+}
+
+void RuntimeSnapshot::clear() {
+	_id = 0;
+	_memory.clear();
+	_tables.clear();
+	_globals.clear();
+	_droppedData.clear();
+}
+
+bool RuntimeSnapshot::empty() const {
+	return _id == 0;
+}
+
+size_t RuntimeSnapshot::getMemorySize() const {
+	size_t ret = 0;
+	for (auto &it : _memory) {
+		ret += it.image.size();
+	}
+	return ret;
+}
+
+MemoryImage::~MemoryImage() {
+	clear();
+}
+
+MemoryImage::MemoryImage(MemoryImage &&other)
+: _fd(other._fd), _data(other._data), _size(other._size), _extents(std::move(other._extents)) {
+	other._fd = -1;
+	other._data = nullptr;
+	other._size = 0;
+}
+
+MemoryImage &MemoryImage::operator=(MemoryImage &&other) {
+	if (this != &other) {
+		clear();
+		std::swap(_fd, other._fd);
+		std::swap(_data, other._data);
+		std::swap(_size, other._size);
+		std::swap(_extents, other._extents);
+	}
+	return *this;
+}
+
+bool MemoryImage::init(uint32_t size, const FillCallback &cb) {
+	clear();
+
+#if __linux__
+	int fd = memfd_create("wasm-memory", MFD_CLOEXEC);
+	if (fd >= 0) {
+		if (ftruncate(fd, size) == 0) {
+			auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (ptr != MAP_FAILED) {
+				if (!cb((uint8_t *)ptr)) {
+					munmap(ptr, size);
+					close(fd);
+					return false;
+				}
+				mprotect(ptr, size, PROT_READ);
+				_fd = fd;
+				_data = (uint8_t *)ptr;
+				_size = size;
+				updateExtents();
+				return true;
+			}
+		}
+		close(fd);
+	}
+#endif
+
+	auto data = new uint8_t[size];
+	memset(data, 0, size);
+	if (!cb(data)) {
+		delete [] data;
+		return false;
+	}
+	_data = data;
+	_size = size;
+	return true;
+}
+
+static bool MemoryImage_isZero(const uint8_t *data, size_t size) {
+	auto words = (const uint64_t *)data;
+	for (size_t i = 0; i < size / sizeof(uint64_t); ++ i) {
+		if (words[i]) {
+			return false;
+		}
+	}
+	for (size_t i = size & ~(sizeof(uint64_t) - 1); i < size; ++ i) {
+		if (data[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool MemoryImage::init(const uint8_t *data, uint32_t size) {
+	return init(size, [&] (uint8_t *target) {
+		// zero pages are left as holes in memfd
+		static constexpr uint32_t kPageSize = 4096;
+		for (uint32_t offset = 0; offset < size; offset += kPageSize) {
+			auto len = std::min(kPageSize, size - offset);
+			if (!MemoryImage_isZero(data + offset, len)) {
+				memcpy(target + offset, data + offset, len);
+			}
+		}
+		return true;
+	});
+}
+
+uint8_t *MemoryImage::map(uint8_t *addr) const {
+#if __linux__
+	if (_fd < 0) {
+		return nullptr;
+	}
+
+	auto ptr = mmap(addr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | (addr ? MAP_FIXED : 0), -1, 0);
+	if (ptr == MAP_FAILED) {
+		return nullptr;
+	}
+
+	auto ret = (uint8_t *)ptr;
+	for (auto &it : _extents) {
+		if (mmap(ret + it.first, it.second - it.first, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, _fd, it.first) == MAP_FAILED) {
+			if (!addr) {
+				munmap(ret, _size);
+			}
+			return nullptr;
+		}
+	}
+	return ret;
+#else
+	return nullptr;
+#endif
+}
+
+void MemoryImage::copy(uint8_t *target) const {
+	if (_fd < 0) {
+		memcpy(target, _data, _size);
+		return;
+	}
+
+	// holes are not read, reading them would allocate pages in memfd
+	uint32_t offset = 0;
+	for (auto &it : _extents) {
+		memset(target + offset, 0, it.first - offset);
+		memcpy(target + it.first, _data + it.first, it.second - it.first);
+		offset = it.second;
+	}
+	memset(target + offset, 0, _size - offset);
+}
+
+void MemoryImage::updateExtents() {
+	_extents.clear();
+
+#if __linux__
+	// every extent is separate mapping, so close extents are merged to limit number of mappings
+	static constexpr size_t kMaxExtents = 64;
+	static constexpr uint32_t kMinGap = 64 * 1024;
+
+	Vector<std::pair<uint32_t, uint32_t>> extents;
+	off_t pos = 0;
+	while (pos < off_t(_size)) {
+		auto data = lseek(_fd, pos, SEEK_DATA);
+		if (data < 0) {
+			if (errno != ENXIO) {
+				// SEEK_DATA is not supported
+				extents.clear();
+				extents.emplace_back(0, _size);
+			}
+			break;
+		}
+		if (data >= off_t(_size)) {
+			break;
+		}
+		auto hole = lseek(_fd, data, SEEK_HOLE);
+		if (hole < 0 || hole > off_t(_size)) {
+			hole = _size;
+		}
+		extents.emplace_back(uint32_t(data), uint32_t(hole));
+		pos = hole;
+	}
+
+	uint32_t gap = kMinGap;
+	do {
+		_extents.clear();
+		for (auto &it : extents) {
+			if (!_extents.empty() && it.first - _extents.back().second < gap) {
+				_extents.back().second = it.second;
+			} else {
+				_extents.emplace_back(it);
+			}
+		}
+		gap *= 2;
+	} while (_extents.size() > kMaxExtents);
+#endif
+}
+
+void MemoryImage::clear() {
+	if (!_data) {
+		return;
+	}
+#if __linux__
+	if (_fd >= 0) {
+		munmap(_data, _size);
+		close(_fd);
+	} else {
+		delete [] _data;
+	}
+#else
+	delete [] _data;
+#endif
+	_fd = -1;
+	_data = nullptr;
+	_size = 0;
+	_extents.clear();
+}
+
 static constexpr uint32_t DEFAULT_BOUNDARY = 4;
 static constexpr uint32_t ALIGN_FORWARD(uint32_t size) { return (((size) + (DEFAULT_BOUNDARY - 1)) & ~(DEFAULT_BOUNDARY - 1)); }
 static constexpr uint32_t ALIGN_BACKWARD(uint32_t size) { return (size & ~(DEFAULT_BOUNDARY - 1)); }
@@ -950,6 +1559,81 @@ uint8_t *RuntimeMemory::get(Index offset, Index size) const {
 	return nullptr;
 }
 
+bool RuntimeMemory::getDirtyPages(Vector<Index> &pages) const {
+#if __linux__
+	if (!mapped || !data) {
+		return false;
+	}
+
+	static int pagemap = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	if (pagemap < 0) {
+		return false;
+	}
+
+	// in private file mapping modified page is anonymous: present or swapped, but not file page
+	// (and not shared zero page, that is mapped on read from anonymous range)
+	static constexpr size_t kBatch = 512;
+
+	const size_t pageSize = sysconf(_SC_PAGESIZE);
+	const size_t first = uintptr_t(data) / pageSize;
+	const size_t count = (size + pageSize - 1) / pageSize;
+	const size_t initial = pages.size();
+
+	// PAGEMAP_SCAN returns matching ranges and skips unpopulated tables
+	page_region regions[kBatch / 8];
+	pm_scan_arg arg;
+	memset(&arg, 0, sizeof(pm_scan_arg));
+	arg.size = sizeof(pm_scan_arg);
+	arg.start = first * pageSize;
+	arg.end = (first + count) * pageSize;
+	arg.vec = uintptr_t(regions);
+	arg.category_inverted = PAGE_IS_FILE | PAGE_IS_PFNZERO;
+	arg.category_mask = PAGE_IS_FILE | PAGE_IS_PFNZERO;
+	arg.category_anyof_mask = PAGE_IS_PRESENT | PAGE_IS_SWAPPED;
+	arg.return_mask = PAGE_IS_PRESENT | PAGE_IS_SWAPPED;
+	while (arg.start < arg.end) {
+		arg.vec_len = kBatch / 8;
+		auto n = ioctl(pagemap, PAGEMAP_SCAN, &arg);
+		if (n < 0) {
+			break;
+		}
+		for (long i = 0; i < n; ++ i) {
+			for (auto addr = regions[i].start; addr < regions[i].end; addr += pageSize) {
+				pages.emplace_back(Index(addr / pageSize - first));
+			}
+		}
+		if (arg.walk_end <= arg.start) {
+			break;
+		}
+		arg.start = arg.walk_end;
+	}
+	if (arg.start >= arg.end) {
+		return true;
+	}
+
+	// older kernels: read entry for every page (present or swapped - bits 63, 62, file page - bit 61)
+	static constexpr uint64_t kPresentOrSwapped = (3ULL << 62);
+	static constexpr uint64_t kFilePage = (1ULL << 61);
+
+	pages.resize(initial);
+	uint64_t entries[kBatch];
+	for (size_t i = 0; i < count; i += kBatch) {
+		const size_t n = std::min(kBatch, count - i);
+		if (pread(pagemap, entries, n * sizeof(uint64_t), (first + i) * sizeof(uint64_t)) != ssize_t(n * sizeof(uint64_t))) {
+			return false;
+		}
+		for (size_t j = 0; j < n; ++ j) {
+			if ((entries[j] & kPresentOrSwapped) && !(entries[j] & kFilePage)) {
+				pages.emplace_back(Index(i + j));
+			}
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
 void RuntimeMemory::print(std::ostream &stream, uint32_t address, uint32_t size) const {
 	auto addr = ALIGN_BACKWARD(address);
 	size += (address - addr);
@@ -17,10 +17,17 @@
 #ifndef SRC_ENVIRONMENT_H_
 #define SRC_ENVIRONMENT_H_
 
-#include "Module.h"
+#include "CodeCache.h"
+#include "TranslationPool.h"
+#include <memory>
+#include <mutex>
 
 namespace wasm {
 
+class RuntimeSnapshot;
+class ModuleCache;
+class ModuleStreamLoader;
+
 struct HostFunc {
 	Module::Signature sig;
 	HostFuncCallback callback = nullptr;
@@ -58,10 +65,15 @@ struct RuntimeMemory {
 	mutable uint32_t size = 0;
 	Index userDataOffset = 0;
 	mutable void *ctx = nullptr;
+	mutable bool mapped = false; // data is copy-on-write mapping of RuntimeSnapshot image
 
 	uint8_t *get(Index offset) const;
 	uint8_t *get(Index offset, Index size) const;
 
+	// indexes of system pages, modified after memory was mapped from snapshot (including writes by host
+	// and kernel); returns false, when memory is not mapped or modifications can not be detected
+	bool getDirtyPages(Vector<Index> &) const;
+
 	void print(std::ostream &stream, uint32_t address, uint32_t size) const;
 };
 
@@ -81,6 +93,10 @@ struct RuntimeModule {
 
 	Map<String, std::pair<Index, ExternalKind>> exports;
 
+	// data.drop state, active segments are dropped after instantiation; threads of one runtime
+	// access flags with __atomic builtins, vector itself is changed only by init and restore
+	mutable Vector<uint8_t> droppedData;
+
 	const Module *module = nullptr;
 	const HostModule *hostModule = nullptr;
 };
@@ -105,9 +121,87 @@ struct LinkingPolicy {
 
 	AllocatorFn allocator = nullptr;
 
+	// when set, memory, tables and globals are restored from snapshot instead of data and element segments
+	const RuntimeSnapshot *snapshot = nullptr;
+
 	void *context = nullptr;
 };
 
+// Read-only image of linear memory; on Linux it is stored in memfd (zero pages take no space)
+// and mapped copy-on-write into runtimes, so they share unmodified pages
+class MemoryImage {
+public:
+	// fills zero-initialized buffer of image size
+	using FillCallback = Function<bool(uint8_t *)>;
+
+	MemoryImage() { }
+	~MemoryImage();
+
+	MemoryImage(MemoryImage &&);
+	MemoryImage &operator=(MemoryImage &&);
+
+	MemoryImage(const MemoryImage &) = delete;
+	MemoryImage &operator=(const MemoryImage &) = delete;
+
+	bool init(uint32_t size, const FillCallback &);
+	bool init(const uint8_t *, uint32_t size);
+
+	void clear();
+
+	uint32_t size() const { return _size; }
+
+	// true, when image can be mapped
+	bool isMappable() const { return _fd >= 0; }
+
+	// maps image copy-on-write at address (or at new address, when nullptr), returns nullptr on failure;
+	// zero ranges are mapped as anonymous memory, so reading them does not allocate pages of image
+	uint8_t *map(uint8_t *addr = nullptr) const;
+
+	void copy(uint8_t *) const;
+
+protected:
+	void updateExtents();
+
+	int _fd = -1; // memfd, -1 when image is allocated in heap
+	uint8_t *_data = nullptr;
+	uint32_t _size = 0;
+	Vector<std::pair<uint32_t, uint32_t>> _extents; // ranges with data in memfd
+};
+
+// State of Runtime after initialization (and, optionally, warm-up calls): linear memory, mutable globals,
+// tables and data.drop flags. On Linux memory images are stored in memfd and restored as private
+// copy-on-write mappings, so runtimes, restored from one snapshot, share unmodified pages.
+class RuntimeSnapshot {
+public:
+	RuntimeSnapshot() { }
+	~RuntimeSnapshot();
+
+	RuntimeSnapshot(const RuntimeSnapshot &) = delete;
+	RuntimeSnapshot &operator=(const RuntimeSnapshot &) = delete;
+
+	void clear();
+
+	bool empty() const;
+
+	// size of all memory images in bytes
+	size_t getMemorySize() const;
+
+protected:
+	friend class Runtime;
+
+	struct Memory {
+		Limits limits;
+		Index userDataOffset = 0;
+		MemoryImage image;
+	};
+
+	uint64_t _id = 0; // unique for every snapshot taken
+	Vector<Memory> _memory;
+	Vector<RuntimeTable> _tables;
+	Vector<RuntimeGlobal> _globals;
+	Vector<Vector<uint8_t>> _droppedData; // in order of Runtime::getModules
+};
+
 class Runtime {
 public:
 	using AllocatorFn = bool (*) (const RuntimeMemory &, uint32_t, RuntimeMemory::Action, void *);
@@ -123,6 +217,15 @@ public:
 
 	const RuntimeModule *getModule(const Module *) const;
 
+	const Func *getExportFunc(const StringView &module, const StringView &name) const;
+	const Func *getExportFunc(const RuntimeModule &module, const StringView &name) const;
+
+	const RuntimeGlobal *getGlobal(const StringView &module, const StringView &name) const;
+	const RuntimeGlobal *getGlobal(const RuntimeModule &module, const StringView &name) const;
+
+	bool setGlobal(const StringView &module, const StringView &name, const Value &);
+	bool setGlobal(const RuntimeModule &module, const StringView &name, const Value &);
+
 	bool isSignatureMatch(const Module::Signature &, const std::pair<const Func *, const HostFunc *> &func, bool silent = false) const;
 	bool isSignatureMatch(const Module::Signature &, const Module::Signature &, bool silent = false) const;
 
@@ -139,6 +242,17 @@ public:
 
 	bool growMemory(const RuntimeMemory &, Index pages) const;
 
+	// captures current state of runtime; should not be called, while runtime executes code
+	bool snapshot(RuntimeSnapshot &) const;
+
+	// resets memory, tables and globals to state from snapshot of this runtime or of runtime,
+	// initialized with same environment and policy; should not be called, while runtime executes code
+	bool restore(const RuntimeSnapshot &);
+
+	// restores snapshot, runtime was initialized or last restored with; only modified pages of mapped memory
+	// are restored, so snapshot should outlive runtime; returns false, when there is no snapshot
+	bool reset();
+
 	const Vector<RuntimeTable> &getRuntimeTables() const;
 	const Vector<RuntimeMemory> &getRuntimeMemory() const;
 
@@ -157,18 +271,22 @@ protected:
 	bool loadRuntime(const LinkingPolicy &);
 
 	bool initMemory(RuntimeMemory &);
+	bool restoreMemory(RuntimeMemory &, const MemoryImage &, bool dirtyOnly);
 	bool emplaceMemoryData(RuntimeMemory &, const Module::Data &);
+	void updateUserDataOffset(RuntimeMemory &, const Module::Data &);
 
 	bool initTable(RuntimeTable &);
 	bool emplaceTableElements(RuntimeTable &, const Module::Elements &);
 
 	bool _lazyInit = false;
 	const Environment *_env = nullptr;
+	const RuntimeSnapshot *_snapshot = nullptr; // source of mapped memory
+	uint64_t _snapshotId = 0;
 	Map<String, RuntimeModule> _modules;
 	Map<const Module *, const RuntimeModule *> _runtimeModules;
 
 	void *_linkingContext = nullptr;
-	AllocatorFn _memoryCallback;
+	AllocatorFn _memoryCallback = nullptr;
 	Vector<RuntimeTable> _tables;
 	Vector<RuntimeMemory> _memory;
 	Vector<RuntimeGlobal> _globals;
@@ -180,10 +298,27 @@ public:
 	using ErrorCallback = Function<void(const StringView &, const StringStream &)>;
 
 	Environment();
+	~Environment();
 
 	Module * loadModule(const StringView &, const uint8_t *, size_t, const ReadOptions & = ReadOptions());
 	Module * loadModule(const StringView &, ModuleReader &, const uint8_t *, size_t, const ReadOptions & = ReadOptions());
+
+	// maps module file, data segments of module refer to mapping (see Module::initFile)
+	Module * loadModuleFile(const StringView &, const StringView &path, const ReadOptions & = ReadOptions());
+
+	// loads translated module from cache, or reads module and stores it in cache (ReadOptions::lazy is ignored)
+	Module * loadModule(const StringView &, const ModuleCache &, const uint8_t *, size_t, const ReadOptions & = ReadOptions());
 	HostModule * makeHostModule(const StringView &);
+
+	// barrier for modules, read with ReadOptions::lazy: translates all pending functions, see Module::translateAll
+	bool translateAll() const;
+
+	// budget and statistics for translated code of modules, read with ReadOptions::lazy
+	CodeCache *getCodeCache() const;
+
+	// threads for ReadOptions::backgroundThreads, shared by modules; stopped first on destruction of environment
+	TranslationPool *getTranslationPool() const;
+
 	HostModule * getEnvModule() const;
 
 	void setErrorCallback(const ErrorCallback &);
@@ -192,6 +327,10 @@ public:
 	const Map<String, Module> &getExternalModules() const;
 	const Map<String, HostModule> &getHostModules() const;
 
+	// initial image of memory, defined by module, with active data segments of module applied;
+	// built on first use and shared by all runtimes, returns nullptr for imported or empty memory
+	const MemoryImage *getMemoryImage(const Module *, Index memory) const;
+
 	bool getGlobalValue(TypedValue &, const StringView &module, const StringView &field) const;
 
 	void onError(const StringView &, const StringStream &) const;
@@ -200,12 +339,19 @@ public:
 	void pushErrorStream(const StringView &, const Callback &cb) const;
 
 private:
+	friend class ModuleStreamLoader;
+
 	bool getGlobalValueRecursive(TypedValue &, const StringView &module, const StringView &field, Index depth) const;
 
 	ErrorCallback _errorCallback;
 	HostModule *_envModule = nullptr;
 	Map<String, HostModule> _hostModules;
+	mutable CodeCache _codeCache; // destroyed after modules
+	mutable TranslationPool _translationPool;
 	Map<String, Module> _externalModules;
+
+	mutable std::mutex _imagesMutex;
+	mutable Map<std::pair<const Module *, Index>, std::unique_ptr<MemoryImage>> _images;
 };
 
 template <typename Callback>
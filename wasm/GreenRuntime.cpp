@@ -0,0 +1,388 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GreenRuntime.h"
+
+namespace wasm {
+
+bool GreenResumer::resume(Vector<Value> results) const {
+	if (!_link) {
+		return false;
+	}
+
+	// thread is not destroyed, while link is locked
+	std::unique_lock<std::mutex> lock(_link->mutex);
+	if (!_link->thread) {
+		return false;
+	}
+	return _link->thread->getGreenRuntime()->resume(_link->thread, std::move(results));
+}
+
+GreenThread::GreenThread(GreenRuntime *runtime, Index tag)
+: Thread(runtime, tag), _green(runtime), _link(std::make_shared<GreenResumer::Link>()) {
+	_link->thread = this;
+}
+
+GreenThread::~GreenThread() {
+	std::unique_lock<std::mutex> lock(_link->mutex);
+	_link->thread = nullptr;
+}
+
+GreenRuntime::~GreenRuntime() {
+	stop();
+}
+
+bool GreenRuntime::init(const Environment *env, const GreenRuntimeOptions &opts) {
+	if (!Runtime::init(env, opts)) {
+		return false;
+	}
+
+	_valueStackSize = opts.valueStackSize;
+	_callStackSize = opts.callStackSize;
+	_sliceFuel = opts.sliceFuel;
+	_sliceTime = opts.sliceTime;
+
+	_context.stopFlag.store(false);
+	_exit = false;
+	_stopping.store(false);
+
+	uint32_t count = opts.workers ? opts.workers : std::max(std::thread::hardware_concurrency(), 1U);
+	_workers.reserve(count);
+	for (uint32_t i = 0; i < count; ++ i) {
+		_workers.emplace_back(new Worker());
+	}
+
+	for (auto &it : _workers) {
+		auto worker = it.get();
+		worker->os = std::thread([this, worker] { runWorker(*worker); });
+	}
+
+	if (_sliceTime != Watchdog::Clock::duration::zero()) {
+		_timer = std::thread([this] { runTimer(); });
+	}
+
+	return true;
+}
+
+GreenThread *GreenRuntime::spawn() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	std::unique_ptr<GreenThread> thread(new GreenThread(this, _nextTag ++));
+	if (!thread->init(_valueStackSize, _callStackSize)) {
+		return nullptr;
+	}
+
+	thread->setSyncContext(&_context);
+	thread->setSuspendable(true);
+	thread->setFuelSlice(_sliceFuel);
+
+	_threads.emplace_back(std::move(thread));
+	return _threads.back().get();
+}
+
+bool GreenRuntime::release(GreenThread *thread) {
+	// thread is destroyed without runtime's lock, resumer can hold its link and wait for runtime's lock
+	std::unique_ptr<GreenThread> released;
+	std::unique_lock<std::mutex> lock(_mutex);
+	{
+		std::unique_lock<std::mutex> threadLock(thread->_mutex);
+		if (thread->_state != GreenThread::State::Idle) {
+			return false;
+		}
+	}
+
+	// timer can hold pointer to thread only under runtime's lock
+	for (auto it = _threads.begin(); it != _threads.end(); ++ it) {
+		if (it->get() == thread) {
+			released = std::move(*it);
+			_threads.erase(it);
+			lock.unlock();
+			return true;
+		}
+	}
+	return false;
+}
+
+void GreenRuntime::call(GreenThread *thread, const RuntimeModule &module, const Func &func, Vector<Value> params,
+		Callback &&callback, const CallLimits &limits) {
+	if (_workers.empty()) {
+		CallResult ret;
+		ret.result = Thread::Result::TrapHostTrapped;
+		callback(std::move(ret));
+		return;
+	}
+
+	params.resize(std::max(func.sig->params.size(), func.sig->results.size()));
+
+	std::unique_lock<std::mutex> lock(thread->_mutex);
+	thread->_calls.emplace_back(GreenThread::Call{&module, &func, std::move(params), limits, std::move(callback), false});
+	if (thread->_state == GreenThread::State::Idle) {
+		thread->_state = GreenThread::State::Runnable;
+		lock.unlock();
+		_busy.fetch_add(1);
+		schedule(thread);
+	}
+}
+
+void GreenRuntime::call(GreenThread *thread, const Func &func, Vector<Value> params, Callback &&callback, const CallLimits &limits) {
+	if (auto mod = getModule(func.module)) {
+		call(thread, *mod, func, std::move(params), std::move(callback), limits);
+	} else {
+		CallResult ret;
+		ret.result = Thread::Result::TrapHostTrapped;
+		callback(std::move(ret));
+	}
+}
+
+bool GreenRuntime::resume(Thread *t, Vector<Value> results) {
+	auto thread = static_cast<GreenThread *>(t);
+
+	std::unique_lock<std::mutex> lock(thread->_mutex);
+	if (thread->_cancelled) {
+		return false;
+	}
+
+	thread->_results = std::move(results);
+	if (thread->_state == GreenThread::State::Parked) {
+		thread->_state = GreenThread::State::Runnable;
+		lock.unlock();
+		schedule(thread);
+	} else {
+		// host function completed, before worker returned from Run
+		thread->_resumed = true;
+	}
+	return true;
+}
+
+void GreenRuntime::stop() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_stopping.store(true);
+
+	// thread, that is suspended later, is cancelled by worker (see runSlice)
+	Vector<GreenThread *> parked;
+	for (auto &it : _threads) {
+		std::unique_lock<std::mutex> threadLock(it->_mutex);
+		if (it->_state == GreenThread::State::Parked) {
+			it->_state = GreenThread::State::Runnable;
+			it->_cancelled = true;
+			parked.emplace_back(it.get());
+		}
+	}
+
+	lock.unlock();
+	for (auto &it : parked) {
+		schedule(it);
+	}
+	lock.lock();
+
+	while (_busy.load() > 0) {
+		_idleCond.wait(lock);
+	}
+
+	_exit = true;
+	lock.unlock();
+	_cond.notify_all();
+	_timerCond.notify_all();
+
+	for (auto &it : _workers) {
+		if (it->os.joinable()) {
+			it->os.join();
+		}
+	}
+	if (_timer.joinable()) {
+		_timer.join();
+	}
+
+	_workers.clear();
+
+	lock.lock();
+	auto threads = std::move(_threads);
+	lock.unlock();
+}
+
+uint32_t GreenRuntime::getWorkersCount() const {
+	return _workers.size();
+}
+
+size_t GreenRuntime::getThreadsCount() const {
+	std::unique_lock<std::mutex> lock(_mutex);
+	return _threads.size();
+}
+
+uint64_t GreenRuntime::getPreemptionsCount() const {
+	return _preemptions.load();
+}
+
+void GreenRuntime::schedule(GreenThread *thread) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_runQueue.emplace_back(thread);
+	if (_running == 0) {
+		_timerCond.notify_one();
+	}
+	lock.unlock();
+	_cond.notify_one();
+}
+
+void GreenRuntime::runWorker(Worker &worker) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		if (!_runQueue.empty()) {
+			auto thread = _runQueue.front();
+			_runQueue.pop_front();
+			++ _running;
+			lock.unlock();
+
+			worker.slice.fetch_add(1);
+			worker.current.store(thread);
+			runSlice(worker, thread);
+
+			lock.lock();
+			-- _running;
+		} else if (_exit) {
+			break;
+		} else {
+			_cond.wait(lock);
+		}
+	}
+}
+
+void GreenRuntime::runTimer() {
+	// thread, that runs same slice for two ticks, is preempted
+	Vector<uint64_t> slices(_workers.size(), 0);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_exit) {
+		if (_running == 0 && _runQueue.empty()) {
+			_timerCond.wait(lock);
+			continue;
+		}
+
+		_timerCond.wait_for(lock, _sliceTime);
+
+		for (size_t i = 0; i < _workers.size(); ++ i) {
+			auto &worker = *_workers[i];
+			const auto slice = worker.slice.load();
+			if (slice == slices[i]) {
+				if (auto thread = worker.current.load()) {
+					thread->preempt();
+				}
+			}
+			slices[i] = slice;
+		}
+	}
+}
+
+void GreenRuntime::runSlice(Worker &worker, GreenThread *thread) {
+	GreenThread::Call *call = nullptr;
+	bool cancelled = false;
+	{
+		// references to deque elements are not invalidated by emplace_back in GreenRuntime::call
+		std::unique_lock<std::mutex> lock(thread->_mutex);
+		thread->_state = GreenThread::State::Running;
+		call = &thread->_calls.front();
+		cancelled = thread->_cancelled;
+	}
+
+	Thread::Result res;
+	if (thread->isSuspended()) {
+		// results are ignored for preempted thread
+		auto host = thread->getSuspendedFunc();
+		if (cancelled || (host && thread->_results.size() < host->getResultsCount())) {
+			res = thread->Cancel();
+		} else {
+			res = thread->Resume(thread->_results.data());
+		}
+	} else {
+		thread->setFuel(call->limits.fuel);
+		call->hasTimeout = call->limits.timeout != CallLimits::Duration::zero();
+		thread->setDeadline(call->hasTimeout ? Watchdog::getInstance()->acquire(call->limits.timeout) : Thread::kNoDeadline);
+		res = thread->Run(*call->module, *call->func, call->params.data(), true);
+	}
+
+	{
+		// timer uses current thread only under runtime's lock, so thread can be released, when it is idle
+		std::unique_lock<std::mutex> lock(_mutex);
+		worker.current.store(nullptr);
+	}
+
+	switch (res) {
+	case Thread::Result::Preempted: {
+		_preemptions.fetch_add(1);
+		std::unique_lock<std::mutex> lock(thread->_mutex);
+		thread->_state = GreenThread::State::Runnable;
+		lock.unlock();
+		schedule(thread);
+		break;
+	}
+	case Thread::Result::Suspended: {
+		// stop() sets flag before it checks parked threads under their locks, so thread can not be parked unnoticed
+		std::unique_lock<std::mutex> lock(thread->_mutex);
+		if (_stopping.load()) {
+			thread->_cancelled = true;
+		}
+		if (thread->_resumed || thread->_cancelled) {
+			thread->_resumed = false;
+			thread->_state = GreenThread::State::Runnable;
+			lock.unlock();
+			schedule(thread);
+		} else {
+			thread->_state = GreenThread::State::Parked;
+		}
+		break;
+	}
+	default:
+		finishCall(thread, res);
+		break;
+	}
+}
+
+void GreenRuntime::finishCall(GreenThread *thread, Thread::Result res) {
+	std::unique_lock<std::mutex> lock(thread->_mutex);
+	GreenThread::Call call(std::move(thread->_calls.front()));
+	thread->_calls.pop_front();
+	lock.unlock();
+
+	if (call.hasTimeout) {
+		Watchdog::getInstance()->release();
+	}
+	thread->setDeadline(Thread::kNoDeadline);
+
+	CallResult ret;
+	ret.result = res;
+	ret.remainingFuel = thread->getFuel();
+	if (res == Thread::Result::Ok || res == Thread::Result::Returned) {
+		call.params.resize(call.func->sig->results.size());
+		ret.values = std::move(call.params);
+	}
+
+	// next call is started after callback, so callbacks of one thread are ordered
+	call.callback(std::move(ret));
+
+	lock.lock();
+	if (thread->_calls.empty()) {
+		thread->_state = GreenThread::State::Idle;
+		lock.unlock();
+		if (_busy.fetch_sub(1) == 1) {
+			std::unique_lock<std::mutex> runtimeLock(_mutex);
+			_idleCond.notify_all();
+		}
+	} else {
+		thread->_state = GreenThread::State::Runnable;
+		lock.unlock();
+		schedule(thread);
+	}
+}
+
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_GREENRUNTIME_H_
+#define SRC_GREENRUNTIME_H_
+
+#include "PooledRuntime.h"
+#include <deque>
+
+namespace wasm {
+
+class GreenRuntime;
+class GreenThread;
+
+// Shared link to green thread for hosts, that complete suspended calls asynchronously: unlike pointer to thread,
+// it can outlive thread and runtime; results, that come after thread is released or runtime is stopped, are dropped
+class GreenResumer {
+public:
+	GreenResumer() = default;
+
+	// see GreenRuntime::resume; returns false, when thread does not exist or its suspended call was cancelled
+	bool resume(Vector<Value> results) const;
+
+	explicit operator bool() const { return _link != nullptr; }
+
+protected:
+	friend class GreenThread;
+
+	struct Link {
+		std::mutex mutex;
+		GreenThread *thread; // nullptr, when thread is destroyed
+	};
+
+	GreenResumer(const std::shared_ptr<Link> &link) : _link(link) { }
+
+	std::shared_ptr<Link> _link;
+};
+
+struct GreenRuntimeOptions : LinkingThreadOptions {
+	// number of OS worker threads, 0 for std::thread::hardware_concurrency
+	uint32_t workers = 0;
+
+	// instruction budget of time slice (for modules with Features::setFuelMetering), 0 - no limit
+	uint64_t sliceFuel = 100000;
+
+	// wall-clock time slice (checked on calls and, with Features::setEpochInterruption, on loops), zero - no limit
+	Watchdog::Clock::duration sliceTime = std::chrono::milliseconds(2);
+};
+
+// Guest execution context of one session; calls of green thread are executed one by one,
+// in order of submission, on any worker of GreenRuntime
+class GreenThread : public Thread {
+public:
+	~GreenThread();
+
+	GreenRuntime *getGreenRuntime() const { return _green; }
+
+	GreenResumer getResumer() const { return GreenResumer(_link); }
+
+protected:
+	friend class GreenRuntime;
+
+	enum class State {
+		Idle, // no calls
+		Runnable, // in run queue
+		Running, // on worker
+		Parked, // suspended by host function, waits for GreenRuntime::resume
+	};
+
+	struct Call {
+		const RuntimeModule *module;
+		const Func *func;
+		Vector<Value> params;
+		CallLimits limits;
+		PooledRuntime::Callback callback;
+		bool hasTimeout;
+	};
+
+	GreenThread(GreenRuntime *, Index tag);
+
+	GreenRuntime *_green;
+	std::shared_ptr<GreenResumer::Link> _link;
+
+	std::mutex _mutex; // guards fields below
+	State _state = State::Idle;
+	std::deque<Call> _calls; // front call is current
+	Vector<Value> _results; // results for suspended host function
+	bool _resumed = false; // resumed, before worker noticed suspension
+	bool _cancelled = false; // suspended call is cancelled by GreenRuntime::stop
+};
+
+// M:N scheduler: many green threads on few OS threads. Worker switches to next runnable thread,
+// when time slice of current one is over (Thread::Result::Preempted) or when host function
+// suspends it (Thread::Result::Suspended); preempted threads are placed at the end of FIFO run queue.
+class GreenRuntime : public Runtime {
+public:
+	using CallResult = PooledRuntime::CallResult;
+	using Callback = PooledRuntime::Callback;
+
+	virtual ~GreenRuntime();
+	GreenRuntime() { }
+
+	bool init(const Environment *, const GreenRuntimeOptions & = GreenRuntimeOptions());
+
+	// thread is owned by runtime, until released; user stack can be assigned with setUserStackPointer
+	GreenThread *spawn();
+
+	// returns false, if thread still has calls; thread becomes idle, when callback of its last call returns
+	bool release(GreenThread *);
+
+	// can be called from any thread, callback is called on worker thread
+	void call(GreenThread *, const RuntimeModule &, const Func &, Vector<Value> params, Callback &&,
+			const CallLimits & = CallLimits());
+	void call(GreenThread *, const Func &, Vector<Value> params, Callback &&, const CallLimits & = CallLimits());
+
+	// continues green thread, suspended by host function (wasm::Result::Suspend), can be called from any thread;
+	// when there are less results, than host function returns, call traps with TrapHostTrapped;
+	// thread should exist, hosts, that can complete after stop() or release(), should use GreenThread::getResumer
+	bool resume(Thread *, Vector<Value> results);
+
+	// waits for all submitted calls to complete, then stops workers and destroys threads; calls, suspended
+	// by host functions and not resumed yet, are cancelled (Thread::Cancel) and complete with TrapHostTrapped
+	void stop();
+
+	uint32_t getWorkersCount() const;
+	size_t getThreadsCount() const;
+
+	// number of preemptions, happened so far
+	uint64_t getPreemptionsCount() const;
+
+protected:
+	struct Worker {
+		std::thread os;
+		std::atomic<GreenThread *> current = ATOMIC_VAR_INIT(nullptr);
+		std::atomic<uint64_t> slice = ATOMIC_VAR_INIT(0);
+	};
+
+	void schedule(GreenThread *);
+
+	void runWorker(Worker &);
+	void runTimer();
+	void runSlice(Worker &, GreenThread *);
+	void finishCall(GreenThread *, Thread::Result);
+
+	ThreadContext _context;
+	uint32_t _valueStackSize = Thread::kDefaultValueStackSize;
+	uint32_t _callStackSize = Thread::kDefaultCallStackSize;
+	uint64_t _sliceFuel = 0;
+	Watchdog::Clock::duration _sliceTime = Watchdog::Clock::duration::zero();
+
+	Vector<std::unique_ptr<Worker>> _workers;
+	std::thread _timer;
+
+	mutable std::mutex _mutex; // guards fields below
+	std::condition_variable _cond;
+	std::condition_variable _idleCond;
+	std::condition_variable _timerCond;
+	std::deque<GreenThread *> _runQueue;
+	Vector<std::unique_ptr<GreenThread>> _threads;
+	uint32_t _running = 0; // slices in progress
+	Index _nextTag = 0;
+	bool _exit = false;
+
+	std::atomic<bool> _stopping = ATOMIC_VAR_INIT(false); // suspended calls are cancelled instead of parking
+	std::atomic<uint32_t> _busy = ATOMIC_VAR_INIT(0); // threads with calls
+	std::atomic<uint64_t> _preemptions = ATOMIC_VAR_INIT(0);
+};
+
+}
+
+#endif /* SRC_GREENRUNTIME_H_ */
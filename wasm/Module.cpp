@@ -16,8 +16,16 @@
 
 #include "Module.h"
 #include "Binary.h"
+#include "Environment.h"
 
 #include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if __linux__
+#include <sys/mman.h>
+#endif
 
 namespace wasm {
 
@@ -27,6 +35,7 @@ static void printType(std::ostream &stream, Type t) {
 	case Type::I64: stream << "i64"; break;
 	case Type::F32: stream << "f32"; break;
 	case Type::F64: stream << "f64"; break;
+	case Type::V128: stream << "v128"; break;
 	case Type::Anyfunc: stream << "anyfunc"; break;
 	case Type::Func: stream << "func"; break;
 	case Type::Void: stream << "void"; break;
@@ -161,11 +170,80 @@ Module::Elements::Elements(Index t, Index off, Index capacity)
 }
 
 
-Module::Data::Data(Index m, Address offset, Address size, const uint8_t *bytes)
-: memory(m), offset(offset) {
-	data.assign(bytes, bytes + size);
+Module::Data::Data(Index m, Address offset, Address size, const uint8_t *bytes, bool passive, bool copy)
+: memory(m), offset(offset), passive(passive), _size(size) {
+	if (copy) {
+		_storage.assign(bytes, bytes + size);
+	} else {
+		_view = bytes;
+	}
 }
 
+// Read-only private mapping of module file; file is read into heap, when it can not be mapped
+class ModuleFile {
+public:
+	~ModuleFile() {
+#if __linux__
+		if (_mapped) {
+			::munmap(_data, _size);
+			return;
+		}
+#endif
+		delete [] _data;
+	}
+
+	bool init(const StringView &path) {
+		String name(path.data(), path.size());
+		int fd = ::open(name.data(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+			::close(fd);
+			return false;
+		}
+
+		_size = size_t(st.st_size);
+#if __linux__
+		auto data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			::close(fd);
+			_data = (uint8_t *)data;
+			_mapped = true;
+			return true;
+		}
+#endif
+
+		_data = new uint8_t[_size];
+		size_t offset = 0;
+		while (offset < _size) {
+			auto ret = ::read(fd, _data + offset, _size - offset);
+			if (ret <= 0) {
+				break;
+			}
+			offset += size_t(ret);
+		}
+		::close(fd);
+		return offset == _size;
+	}
+
+	const uint8_t *data() const { return _data; }
+	size_t size() const { return _size; }
+
+protected:
+	uint8_t *_data = nullptr;
+	size_t _size = 0;
+	bool _mapped = false;
+};
+
+Module::Module() { }
+Module::~Module() { }
+
+Module::Module(Module &&) = default;
+Module &Module::operator=(Module &&) = default;
+
 bool Module::init(const uint8_t *data, size_t size, const ReadOptions &opts) {
 	return init(nullptr, data, size, opts);
 }
@@ -176,7 +254,30 @@ bool Module::init(Environment *env, const uint8_t *data, size_t size, const Read
 }
 
 bool Module::init(Environment *env, ModuleReader &reader, const uint8_t *data, size_t size, const ReadOptions &opts) {
-	return reader.init(this, env, data, size, opts);
+	if (!reader.init(this, env, data, size, opts)) {
+		return false;
+	}
+
+	if (_lazyCode && opts.backgroundThreads) {
+		_lazyCode->startBackground(opts.backgroundThreads);
+	}
+	return true;
+}
+
+bool Module::initFile(Environment *env, const StringView &path, const ReadOptions &opts) {
+	auto file = std::make_unique<ModuleFile>();
+	if (!file->init(path)) {
+		if (env) {
+			env->pushErrorStream("Reader", [&] (StringStream &stream) {
+				stream << "Fail to read module file: " << path;
+			});
+		}
+		return false;
+	}
+
+	// set before reading, so reader does not copy data segments
+	_file = std::move(file);
+	return init(env, _file->data(), _file->size(), opts);
 }
 
 bool Module::hasMemory() const {
@@ -389,6 +490,20 @@ Offset Module::getLinkingOffset() const {
 	return _dataSize;
 }
 
+bool Module::translate(const Func &func) const {
+	if (func.isTranslated()) {
+		return true;
+	}
+	if (!_lazyCode || func.module != this) {
+		return false;
+	}
+	return _lazyCode->translate(Index(&func - _funcs.data()));
+}
+
+bool Module::translateAll() const {
+	return !_lazyCode || _lazyCode->translateAll();
+}
+
 void Func::printInfo(std::ostream &stream) const {
 	printSignature(stream, *sig);
 	stream << "\n";
@@ -569,6 +684,7 @@ void Module::printInfo(std::ostream &stream) const {
 			case Type::I64: stream << ":" << it.value.value.i64; break;
 			case Type::F32: stream << ":" << it.value.value.f32_bits; break;
 			case Type::F64: stream << ":" << it.value.value.f64_bits; break;
+			case Type::V128: stream << ":" << it.value.value.v128_bits.lo << ":" << it.value.value.v128_bits.hi; break;
 			case Type::Anyfunc: stream << ":" << it.value.value.i32; break;
 			case Type::Func: stream << ":" << it.value.value.i32; break;
 			case Type::Any: stream << ":" << it.value.value.i32; break;
@@ -587,9 +703,10 @@ void Module::printInfo(std::ostream &stream) const {
 		stream << "Data: (" << _data.size() << ")\n";
 		i = 0;
 		for (auto &it : _data) {
-			stream << "\t(" << i << ") (" << it.offset << ":" << it.data.size() << ":\"";
+			stream << "\t(" << i << ") (" << it.offset << ":" << it.size() << ":\"";
 			stream << std::hex;
-			for (auto &b : it.data) {
+			for (Address j = 0; j < it.size(); ++ j) {
+				auto b = it.data()[j];
 				if (b < 127 && b >= 32) {
 					stream << char(b);
 				} else {
@@ -597,7 +714,11 @@ void Module::printInfo(std::ostream &stream) const {
 				}
 			}
 			stream << std::dec << std::setw(1);
-			stream << "\") -> memory:" << it.memory << "\n";
+			if (it.passive) {
+				stream << "\") passive\n";
+			} else {
+				stream << "\") -> memory:" << it.memory << "\n";
+			}
 			++ i;
 		}
 	}
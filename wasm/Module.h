@@ -19,6 +19,8 @@
 
 #include "Utils.h"
 #include "Opcode.h"
+#include <atomic>
+#include <memory>
 
 namespace wasm {
 
@@ -28,6 +30,8 @@ class Runtime;
 class RuntimeModule;
 class Module;
 class ModuleReader;
+class ModuleLazyCode;
+class ModuleFile;
 
 struct HostFunc;
 
@@ -36,6 +40,12 @@ using ValueInitList = std::initializer_list<Value>;
 using HostFuncCallback = Result (*)(Thread *, const HostFunc * func, Value* buf);
 
 struct Func {
+	// flags for the bound record of Opcode::InterpLoopGuard
+	enum LoopGuardFlags : uint32_t {
+		LoopGuardConstBound = 1,
+		LoopGuardInclusiveBound = 2,
+	};
+
 	struct Local {
 		Local(Type, Index);
 
@@ -93,15 +103,29 @@ struct Func {
 		Vector<Type> results;
 	};
 
+	// translation state of module, read with ReadOptions::lazy
+	enum class State : uint8_t {
+		Pending,
+		Translating,
+		Ready,
+		Invalid, // body failed validation
+		Cold, // translated, not called since last pass of CodeCache clock hand
+		Evicting, // translated, code waits for release by CodeCache, unless function is called again
+	};
+
 	Func(const Signature *sig, const Module *);
 
 	void printInfo(std::ostream &) const;
 
+	// types and opcodes are valid only for translated function, see Module::translate
+	bool isTranslated() const { return !state || state->load(std::memory_order_acquire) == State::Ready; }
+
 	const Signature *sig = nullptr;
 	const Module *module = nullptr;
 	Vector<Type> types;
 	Vector<OpcodeRec> opcodes;
 	String name;
+	std::atomic<State> *state = nullptr; // nullptr, when function was translated on load
 };
 
 // Module should store only headers and constant data, not runtime data
@@ -190,18 +214,38 @@ public:
 		Vector<Index> values;
 	};
 
+	// bytes of segment are copied, or refer to module file, mapped by Module::initFile
 	struct Data {
-		Data(Index, Address offset, Address size, const uint8_t *data);
+		Data(Index, Address offset, Address size, const uint8_t *data, bool passive = false, bool copy = true);
+
+		const uint8_t *data() const { return _view ? _view : _storage.data(); }
+		Address size() const { return _size; }
+		bool empty() const { return _size == 0; }
 
 		Index memory;
 		Address offset;
-		Vector<uint8_t> data;
+		bool passive = false; // not applied on instantiation, used by memory.init
+
+	protected:
+		const uint8_t *_view = nullptr;
+		Address _size = 0;
+		Vector<uint8_t> _storage;
 	};
 
+	Module();
+	~Module();
+
+	Module(Module &&);
+	Module &operator=(Module &&);
+
 	bool init(const uint8_t *, size_t, const ReadOptions & = ReadOptions());
 	bool init(Environment *, const uint8_t *, size_t, const ReadOptions & = ReadOptions());
 	bool init(Environment *, ModuleReader &reader, const uint8_t *, size_t, const ReadOptions & = ReadOptions());
 
+	// maps module file and reads module from mapping, that is kept, while module exists;
+	// data segments refer to mapping instead of copies
+	bool initFile(Environment *, const StringView &path, const ReadOptions & = ReadOptions());
+
 	bool hasMemory() const;
 	bool hasTable() const;
 
@@ -247,10 +291,20 @@ public:
 
 	Offset getLinkingOffset() const;
 
+	// validates and translates body of function, read with ReadOptions::lazy, on first call; thread-safe,
+	// returns false, when body is invalid
+	bool translate(const Func &) const;
+
+	// translates all pending functions (with background threads, if any); for callers, that need every function
+	// ready before serving, returns false, when some body is invalid
+	bool translateAll() const;
+
 	void printInfo(std::ostream &) const;
 
 protected:
 	friend class ModuleReader;
+	friend class ModuleCache;
+	friend class ModuleLazyCode;
 
 	Vector<Signature> _types;
 	Vector<Import> _imports;
@@ -272,6 +326,10 @@ protected:
 	IndexObject _startFunction;
 	Index _stackPointer = kInvalidIndex;
 	Offset _dataSize = kInvalidOffset;
+
+	// lazy code (and its background translation) is destroyed before mapping of module file
+	std::unique_ptr<ModuleFile> _file;
+	std::unique_ptr<ModuleLazyCode> _lazyCode;
 };
 
 }
@@ -0,0 +1,672 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ModuleCache.h"
+#include "Environment.h"
+#include "Binary.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if __linux__
+#include <sys/mman.h>
+#endif
+
+namespace wasm {
+
+struct ModuleCacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t opcodeSize; // sizeof(Func::OpcodeRec), entries are not portable between ABIs
+	uint64_t key[2];
+	uint64_t payloadSize;
+	uint64_t payloadHash[2];
+	char buildId[64];
+};
+
+static constexpr char ModuleCache_magic[8] = { 'S', 'P', 'W', 'A', 'S', 'M', 'C', 0 };
+
+static inline uint64_t ModuleCache_rotl(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t ModuleCache_mix(uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xFF51AFD7ED558CCDULL;
+	x ^= x >> 33;
+	x *= 0xC4CEB9FE1A85EC53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+// bytes of value, that are not used by its type, can be uninitialized
+static Value ModuleCache_value(const TypedValue &value) {
+	Value ret;
+	memset(&ret, 0, sizeof(Value));
+	switch (value.type) {
+	case Type::I32:
+	case Type::F32:
+		memcpy(&ret, &value.value, sizeof(uint32_t));
+		break;
+	case Type::I64:
+	case Type::F64:
+		memcpy(&ret, &value.value, sizeof(uint64_t));
+		break;
+	case Type::V128:
+		ret = value.value;
+		break;
+	default:
+		break;
+	}
+	return ret;
+}
+
+// Payload is sequence of fields in native byte order; arrays of trivial types are aligned to 8 bytes,
+// so they are copied from mapped file with single memcpy
+class ModuleCacheWriter {
+public:
+	template <typename T>
+	void write(const T &value) {
+		static_assert(std::is_trivially_copyable<T>::value, "Trivially copyable type required");
+		writeBytes(&value, sizeof(T));
+	}
+
+	void writeBytes(const void *data, size_t size) {
+		auto ptr = (const uint8_t *)data;
+		buffer.insert(buffer.end(), ptr, ptr + size);
+	}
+
+	template <typename T>
+	void writeArray(const T *data, size_t count) {
+		write(uint64_t(count));
+		buffer.resize((buffer.size() + 7) & ~size_t(7), 0);
+		writeBytes(data, count * sizeof(T));
+	}
+
+	template <typename T>
+	void writeArray(const Vector<T> &vec) {
+		writeArray(vec.data(), vec.size());
+	}
+
+	void writeString(const String &str) {
+		write(uint32_t(str.size()));
+		writeBytes(str.data(), str.size());
+	}
+
+	void writeLimits(const Limits &l) {
+		write(l.initial);
+		write(l.max);
+		write(uint8_t(l.has_max));
+		write(uint8_t(l.is_shared));
+	}
+
+	void writeIndex(const Module::IndexObject &idx) {
+		write(uint8_t(idx.exported));
+		write(uint8_t(idx.import));
+		write(idx.index);
+	}
+
+	void writeValue(const TypedValue &value) {
+		write(value.type);
+		write(ModuleCache_value(value));
+	}
+
+	// padding between opcode and its values is not initialized, so records are copied by fields
+	void writeOpcodes(const Vector<Func::OpcodeRec> &vec) {
+		write(uint64_t(vec.size()));
+		buffer.resize((buffer.size() + 7) & ~size_t(7), 0);
+
+		auto offset = buffer.size();
+		buffer.resize(offset + vec.size() * sizeof(Func::OpcodeRec), 0);
+		for (auto &it : vec) {
+			memcpy(buffer.data() + offset + offsetof(Func::OpcodeRec, opcode), &it.opcode, sizeof(it.opcode));
+			memcpy(buffer.data() + offset + offsetof(Func::OpcodeRec, value64), &it.value64, sizeof(it.value64));
+			offset += sizeof(Func::OpcodeRec);
+		}
+	}
+
+	Vector<uint8_t> buffer;
+};
+
+class ModuleCacheReader {
+public:
+	ModuleCacheReader(const uint8_t *data, size_t size) : _ptr(data), _begin(data), _end(data + size) { }
+
+	bool valid() const { return _valid; }
+
+	template <typename T>
+	T read() {
+		T ret = T();
+		if (auto ptr = readBytes(sizeof(T))) {
+			memcpy(&ret, ptr, sizeof(T));
+		}
+		return ret;
+	}
+
+	const uint8_t *readBytes(size_t size) {
+		if (!_valid || size_t(_end - _ptr) < size) {
+			_valid = false;
+			return nullptr;
+		}
+		auto ret = _ptr;
+		_ptr += size;
+		return ret;
+	}
+
+	template <typename T>
+	const T *readArray(size_t &count) {
+		count = read<uint64_t>();
+		auto offset = ((_ptr - _begin) + 7) & ~size_t(7);
+		if (!_valid || offset > size_t(_end - _begin) || count > size_t(_end - _begin - offset) / sizeof(T)) {
+			_valid = false;
+			count = 0;
+			return nullptr;
+		}
+		_ptr = _begin + offset;
+		return (const T *)readBytes(count * sizeof(T));
+	}
+
+	template <typename T>
+	bool readArray(Vector<T> &vec) {
+		size_t count = 0;
+		auto ptr = readArray<T>(count);
+		if (!_valid) {
+			return false;
+		}
+		vec.assign(ptr, ptr + count);
+		return true;
+	}
+
+	String readString() {
+		auto size = read<uint32_t>();
+		if (auto ptr = readBytes(size)) {
+			return String((const char *)ptr, size);
+		}
+		return String();
+	}
+
+	Limits readLimits() {
+		Limits ret;
+		ret.initial = read<uint64_t>();
+		ret.max = read<uint64_t>();
+		ret.has_max = read<uint8_t>();
+		ret.is_shared = read<uint8_t>();
+		return ret;
+	}
+
+	Module::IndexObject readIndex() {
+		Module::IndexObject ret;
+		ret.exported = read<uint8_t>();
+		ret.import = read<uint8_t>();
+		ret.index = read<Index>();
+		return ret;
+	}
+
+	TypedValue readValue() {
+		auto type = read<Type>();
+		return TypedValue(type, read<Value>());
+	}
+
+	// returns count, that is not larger than number of remaining bytes
+	uint32_t readCount() {
+		auto ret = read<uint32_t>();
+		if (ret > size_t(_end - _ptr)) {
+			_valid = false;
+			return 0;
+		}
+		return ret;
+	}
+
+protected:
+	const uint8_t *_ptr;
+	const uint8_t *_begin;
+	const uint8_t *_end;
+	bool _valid = true;
+};
+
+// values of imported globals, that were available for init expressions, when module was read;
+// entry is valid only for environment with same values
+static void ModuleCache_writeImportedGlobals(ModuleCacheWriter &w, const Module &mod, const Environment *env) {
+	for (auto &it : mod.getImports()) {
+		if (it.kind == ExternalKind::Global) {
+			TypedValue value;
+			const bool found = env && env->getGlobalValue(value, it.module, it.field);
+			w.write(uint8_t(found));
+			w.writeValue(found ? value : TypedValue());
+		}
+	}
+}
+
+static bool ModuleCache_checkImportedGlobals(ModuleCacheReader &r, const Module &mod, const Environment *env) {
+	for (auto &it : mod.getImports()) {
+		if (it.kind == ExternalKind::Global) {
+			const bool expectedFound = r.read<uint8_t>();
+			auto expected = r.readValue();
+
+			TypedValue value;
+			const bool found = env && env->getGlobalValue(value, it.module, it.field);
+			if (!r.valid() || found != expectedFound) {
+				return false;
+			}
+			if (found) {
+				auto current = ModuleCache_value(value);
+				if (value.type != expected.type || memcmp(&current, &expected.value, sizeof(Value)) != 0) {
+					return false;
+				}
+			}
+		}
+	}
+	return r.valid();
+}
+
+bool ModuleCache::init(const StringView &dir, const StringView &buildId, bool verify) {
+	_dir = String(dir.data(), dir.size());
+	while (_dir.size() > 1 && _dir.back() == '/') {
+		_dir.pop_back();
+	}
+
+	auto id = buildId.empty() ? ModuleReader::getBuildId() : buildId;
+	_buildId = String(id.data(), std::min(id.size(), sizeof(ModuleCacheHeader::buildId) - 1));
+	_verify = verify;
+
+	if (_dir.empty()) {
+		return false;
+	}
+
+	struct stat st;
+	if (::stat(_dir.data(), &st) == 0) {
+		return S_ISDIR(st.st_mode);
+	}
+	return ::mkdir(_dir.data(), 0755) == 0 || errno == EEXIST;
+}
+
+ModuleCache::Key ModuleCache::getKey(const uint8_t *data, size_t size, const ReadOptions &opts) const {
+	// options, that affect translation
+	const auto &f = opts.features;
+	const uint64_t flags = uint64_t(f.isExceptionsEnabled()) | uint64_t(f.isSatFloatToIntEnabled()) << 1
+			| uint64_t(f.isThreadsEnabled()) << 2 | uint64_t(f.isTailCallEnabled()) << 3
+			| uint64_t(f.isMultiValueEnabled()) << 4 | uint64_t(f.isBulkMemoryEnabled()) << 5
+			| uint64_t(f.isSimdEnabled()) << 6 | uint64_t(f.isStackPointerEnabled()) << 7
+			| uint64_t(f.isBoundsCheckHoistingEnabled()) << 8 | uint64_t(f.isFuelMeteringEnabled()) << 9
+			| uint64_t(f.isEpochInterruptionEnabled()) << 10 | uint64_t(opts.read_debug_names) << 11;
+
+	uint64_t build[2];
+	hash((const uint8_t *)_buildId.data(), _buildId.size(), kFormatVersion, build);
+
+	Key ret;
+	hash(data, size, build[0] ^ ModuleCache_mix(build[1] + flags), ret.hash);
+	return ret;
+}
+
+String ModuleCache::getPath(const Key &key) const {
+	char buf[40];
+	snprintf(buf, sizeof(buf), "%016llx%016llx.wcache", (unsigned long long)key.hash[0], (unsigned long long)key.hash[1]);
+	return _dir + "/" + buf;
+}
+
+bool ModuleCache::load(Module &mod, const Environment *env, const Key &key) const {
+	auto path = getPath(key);
+	int fd = ::open(path.data(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		_misses.fetch_add(1);
+		return false;
+	}
+
+	bool success = false;
+	struct stat st;
+	if (::fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(ModuleCacheHeader)) {
+		const size_t size = st.st_size;
+#if __linux__
+		auto data = (const uint8_t *)::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+		if (data != MAP_FAILED) {
+			success = loadEntry(mod, env, key, data, size);
+			::munmap((void *)data, size);
+		}
+#else
+		Vector<uint8_t> data(size);
+		if (::read(fd, data.data(), size) == ssize_t(size)) {
+			success = loadEntry(mod, env, key, data.data(), size);
+		}
+#endif
+	}
+	::close(fd);
+
+	if (success) {
+		_hits.fetch_add(1);
+	} else {
+		_misses.fetch_add(1);
+		mod = Module();
+	}
+	return success;
+}
+
+bool ModuleCache::loadEntry(Module &mod, const Environment *env, const Key &key, const uint8_t *data, size_t size) const {
+	ModuleCacheHeader header;
+	memcpy(&header, data, sizeof(ModuleCacheHeader));
+	if (memcmp(header.magic, ModuleCache_magic, sizeof(ModuleCache_magic)) != 0 || header.version != kFormatVersion
+			|| header.opcodeSize != sizeof(Func::OpcodeRec) || header.key[0] != key.hash[0] || header.key[1] != key.hash[1]
+			|| header.payloadSize != size - sizeof(ModuleCacheHeader)
+			|| strncmp(header.buildId, _buildId.data(), sizeof(header.buildId)) != 0) {
+		return false;
+	}
+
+	const uint8_t *payload = data + sizeof(ModuleCacheHeader);
+	if (_verify) {
+		uint64_t h[2];
+		hash(payload, header.payloadSize, kFormatVersion, h);
+		if (h[0] != header.payloadHash[0] || h[1] != header.payloadHash[1]) {
+			return false;
+		}
+	}
+
+	ModuleCacheReader r(payload, header.payloadSize);
+
+	mod._types.resize(r.readCount());
+	for (auto &it : mod._types) {
+		r.readArray(it.params);
+		r.readArray(it.results);
+	}
+
+	auto getSig = [&] (Index idx) -> const Module::Signature * {
+		return mod.getSignature(idx);
+	};
+
+	auto importsCount = r.readCount();
+	mod._imports.reserve(importsCount);
+	for (uint32_t i = 0; i < importsCount && r.valid(); ++ i) {
+		auto &imp = mod._imports.emplace_back(r.read<ExternalKind>());
+		imp.module = r.readString();
+		imp.field = r.readString();
+		switch (imp.kind) {
+		case ExternalKind::Func:
+			if (!(imp.func.sig = getSig(r.read<Index>()))) {
+				return false;
+			}
+			break;
+		case ExternalKind::Table:
+			imp.table.limits = r.readLimits();
+			imp.table.type = r.read<Type>();
+			break;
+		case ExternalKind::Memory:
+			imp.memory.limits = r.readLimits();
+			break;
+		case ExternalKind::Global:
+			imp.global.type = r.read<Type>();
+			imp.global.mut = r.read<uint8_t>();
+			break;
+		default:
+			break;
+		}
+	}
+
+	// values of init expressions depend on imported globals of environment
+	if (!ModuleCache_checkImportedGlobals(r, mod, env)) {
+		return false;
+	}
+
+	auto funcsCount = r.readCount();
+	mod._funcs.reserve(funcsCount);
+	for (uint32_t i = 0; i < funcsCount && r.valid(); ++ i) {
+		auto sig = getSig(r.read<Index>());
+		if (!sig) {
+			return false;
+		}
+		auto &func = mod._funcs.emplace_back(sig, &mod);
+		r.readArray(func.types);
+		r.readArray(func.opcodes);
+		func.name = r.readString();
+	}
+
+	auto tablesCount = r.readCount();
+	mod._tables.reserve(tablesCount);
+	for (uint32_t i = 0; i < tablesCount && r.valid(); ++ i) {
+		auto type = r.read<Type>();
+		mod._tables.emplace_back(type, r.readLimits());
+	}
+
+	auto memoryCount = r.readCount();
+	mod._memory.reserve(memoryCount);
+	for (uint32_t i = 0; i < memoryCount && r.valid(); ++ i) {
+		mod._memory.emplace_back(r.readLimits());
+	}
+
+	auto globalsCount = r.readCount();
+	mod._globals.reserve(globalsCount);
+	for (uint32_t i = 0; i < globalsCount && r.valid(); ++ i) {
+		auto value = r.readValue();
+		mod._globals.emplace_back(value, bool(r.read<uint8_t>()));
+	}
+
+	for (auto vec : { &mod._funcIndex, &mod._globalIndex, &mod._memoryIndex, &mod._tableIndex }) {
+		vec->resize(r.readCount());
+		for (auto &it : *vec) {
+			it = r.readIndex();
+		}
+	}
+
+	auto exportsCount = r.readCount();
+	mod._exports.reserve(exportsCount);
+	for (uint32_t i = 0; i < exportsCount && r.valid(); ++ i) {
+		auto kind = r.read<ExternalKind>();
+		auto object = r.read<Index>();
+		auto index = r.readIndex();
+		mod._exports.emplace_back(kind, object, index, StringView(r.readString()));
+	}
+
+	auto elementsCount = r.readCount();
+	mod._elements.reserve(elementsCount);
+	for (uint32_t i = 0; i < elementsCount && r.valid(); ++ i) {
+		auto table = r.read<Index>();
+		auto &elem = mod._elements.emplace_back(table, r.read<Index>(), 0);
+		r.readArray(elem.values);
+	}
+
+	auto dataCount = r.readCount();
+	mod._data.reserve(dataCount);
+	for (uint32_t i = 0; i < dataCount && r.valid(); ++ i) {
+		auto memory = r.read<Index>();
+		auto offset = r.read<Address>();
+		auto passive = r.read<uint8_t>();
+		size_t size = 0;
+		auto bytes = r.readArray<uint8_t>(size);
+		mod._data.emplace_back(memory, offset, size, bytes, passive);
+	}
+
+	mod._startFunction = r.readIndex();
+	mod._stackPointer = r.read<Index>();
+	mod._dataSize = r.read<uint64_t>();
+
+	return r.valid();
+}
+
+bool ModuleCache::store(const Module &mod, const Environment *env, const Key &key) const {
+	if (_dir.empty() || mod._lazyCode) {
+		return false;
+	}
+
+	ModuleCacheWriter w;
+	w.buffer.reserve(sizeof(ModuleCacheHeader) + 4096);
+	w.buffer.resize(sizeof(ModuleCacheHeader), 0);
+
+	auto getSigIndex = [&] (const Module::Signature *sig) -> Index {
+		return Index(sig - mod._types.data());
+	};
+
+	w.write(uint32_t(mod._types.size()));
+	for (auto &it : mod._types) {
+		w.writeArray(it.params);
+		w.writeArray(it.results);
+	}
+
+	w.write(uint32_t(mod._imports.size()));
+	for (auto &it : mod._imports) {
+		w.write(it.kind);
+		w.writeString(it.module);
+		w.writeString(it.field);
+		switch (it.kind) {
+		case ExternalKind::Func:
+			w.write(getSigIndex(it.func.sig));
+			break;
+		case ExternalKind::Table:
+			w.writeLimits(it.table.limits);
+			w.write(it.table.type);
+			break;
+		case ExternalKind::Memory:
+			w.writeLimits(it.memory.limits);
+			break;
+		case ExternalKind::Global:
+			w.write(it.global.type);
+			w.write(uint8_t(it.global.mut));
+			break;
+		default:
+			break;
+		}
+	}
+
+	ModuleCache_writeImportedGlobals(w, mod, env);
+
+	w.write(uint32_t(mod._funcs.size()));
+	for (auto &it : mod._funcs) {
+		w.write(getSigIndex(it.sig));
+		w.writeArray(it.types);
+		w.writeOpcodes(it.opcodes);
+		w.writeString(it.name);
+	}
+
+	w.write(uint32_t(mod._tables.size()));
+	for (auto &it : mod._tables) {
+		w.write(it.type);
+		w.writeLimits(it.limits);
+	}
+
+	w.write(uint32_t(mod._memory.size()));
+	for (auto &it : mod._memory) {
+		w.writeLimits(it.limits);
+	}
+
+	w.write(uint32_t(mod._globals.size()));
+	for (auto &it : mod._globals) {
+		w.writeValue(it.value);
+		w.write(uint8_t(it.mut));
+	}
+
+	for (auto vec : { &mod._funcIndex, &mod._globalIndex, &mod._memoryIndex, &mod._tableIndex }) {
+		w.write(uint32_t(vec->size()));
+		for (auto &it : *vec) {
+			w.writeIndex(it);
+		}
+	}
+
+	w.write(uint32_t(mod._exports.size()));
+	for (auto &it : mod._exports) {
+		w.write(it.kind);
+		w.write(it.object);
+		w.writeIndex(it.index);
+		w.writeString(it.name);
+	}
+
+	w.write(uint32_t(mod._elements.size()));
+	for (auto &it : mod._elements) {
+		w.write(it.table);
+		w.write(it.offset);
+		w.writeArray(it.values);
+	}
+
+	w.write(uint32_t(mod._data.size()));
+	for (auto &it : mod._data) {
+		w.write(it.memory);
+		w.write(it.offset);
+		w.write(uint8_t(it.passive));
+		w.writeArray(it.data(), it.size());
+	}
+
+	w.writeIndex(mod._startFunction);
+	w.write(mod._stackPointer);
+	w.write(uint64_t(mod._dataSize));
+
+	ModuleCacheHeader header;
+	memset(&header, 0, sizeof(ModuleCacheHeader));
+	memcpy(header.magic, ModuleCache_magic, sizeof(ModuleCache_magic));
+	header.version = kFormatVersion;
+	header.opcodeSize = sizeof(Func::OpcodeRec);
+	header.key[0] = key.hash[0];
+	header.key[1] = key.hash[1];
+	header.payloadSize = w.buffer.size() - sizeof(ModuleCacheHeader);
+	hash(w.buffer.data() + sizeof(ModuleCacheHeader), header.payloadSize, kFormatVersion, header.payloadHash);
+	memcpy(header.buildId, _buildId.data(), _buildId.size());
+	memcpy(w.buffer.data(), &header, sizeof(ModuleCacheHeader));
+
+	auto path = getPath(key);
+	auto tmp = path + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(_stores.load());
+
+	bool success = false;
+	if (auto f = fopen(tmp.data(), "wb")) {
+		success = fwrite(w.buffer.data(), w.buffer.size(), 1, f) == 1;
+		success = (fclose(f) == 0) && success;
+	}
+
+	if (success && ::rename(tmp.data(), path.data()) == 0) {
+		_stores.fetch_add(1);
+		return true;
+	}
+
+	::unlink(tmp.data());
+	return false;
+}
+
+ModuleCache::Stats ModuleCache::getStats() const {
+	Stats ret;
+	ret.hits = _hits.load();
+	ret.misses = _misses.load();
+	ret.stores = _stores.load();
+	return ret;
+}
+
+void ModuleCache::hash(const uint8_t *data, size_t size, uint64_t seed, uint64_t out[2]) {
+	// not cryptographic: two independent 64-bit lanes over 16-byte blocks
+	static constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+	static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+
+	uint64_t a = seed + P1;
+	uint64_t b = seed ^ P2;
+
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		uint64_t v1, v2;
+		memcpy(&v1, data + i, sizeof(uint64_t));
+		memcpy(&v2, data + i + 8, sizeof(uint64_t));
+		a = ModuleCache_rotl(a + v1 * P2, 31) * P1;
+		b = ModuleCache_rotl(b + v2 * P1, 27) * P2;
+	}
+
+	uint8_t tail[16] = { 0 };
+	memcpy(tail, data + i, size - i);
+	uint64_t v1, v2;
+	memcpy(&v1, tail, sizeof(uint64_t));
+	memcpy(&v2, tail + 8, sizeof(uint64_t));
+	a = ModuleCache_rotl(a + v1 * P2, 31) * P1;
+	b = ModuleCache_rotl(b + v2 * P1, 27) * P2;
+
+	a ^= size;
+	b += size;
+	out[0] = ModuleCache_mix(a + b);
+	out[1] = ModuleCache_mix(b ^ ModuleCache_rotl(a, 17));
+}
+
+}
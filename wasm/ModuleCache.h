@@ -0,0 +1,77 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_MODULECACHE_H_
+#define SRC_MODULECACHE_H_
+
+#include "Module.h"
+#include <atomic>
+
+namespace wasm {
+
+// On-disk cache of translated modules: signatures, imports, exports, interpreter opcodes and segments.
+// Entry is keyed by hash of module binary, ReadOptions and interpreter build ID, and loaded with mmap
+// without reading and validating module again, so cache directory should be trusted.
+class ModuleCache {
+public:
+	static constexpr uint32_t kFormatVersion = 1;
+
+	struct Key {
+		uint64_t hash[2] = { 0, 0 };
+
+		bool operator==(const Key &other) const { return hash[0] == other.hash[0] && hash[1] == other.hash[1]; }
+		bool operator!=(const Key &other) const { return !(*this == other); }
+	};
+
+	struct Stats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t stores = 0;
+	};
+
+	// directory is created, when it does not exist; empty buildId means ModuleReader::getBuildId;
+	// with verify, checksum of every entry is checked on load
+	bool init(const StringView &dir, const StringView &buildId = StringView(), bool verify = false);
+
+	Key getKey(const uint8_t *, size_t, const ReadOptions &) const;
+	String getPath(const Key &) const;
+
+	// returns false, when there is no valid entry for key; module should be empty
+	bool load(Module &, const Environment *, const Key &) const;
+
+	// entry is written into temporary file, then renamed, so concurrent readers see complete entries;
+	// modules, read with ReadOptions::lazy, are not stored
+	bool store(const Module &, const Environment *, const Key &) const;
+
+	Stats getStats() const;
+
+	static void hash(const uint8_t *, size_t, uint64_t seed, uint64_t out[2]);
+
+protected:
+	bool loadEntry(Module &, const Environment *, const Key &, const uint8_t *, size_t) const;
+
+	String _dir;
+	String _buildId;
+	bool _verify = false;
+
+	mutable std::atomic<uint64_t> _hits = ATOMIC_VAR_INIT(0);
+	mutable std::atomic<uint64_t> _misses = ATOMIC_VAR_INIT(0);
+	mutable std::atomic<uint64_t> _stores = ATOMIC_VAR_INIT(0);
+};
+
+}
+
+#endif /* SRC_MODULECACHE_H_ */
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ModuleStreamLoader.h"
+#include "Environment.h"
+
+namespace wasm {
+
+constexpr size_t kModuleHeaderSize = 8;
+constexpr size_t kMaxLeb128U32Size = 5;
+
+enum class StreamLeb {
+	Ok,
+	Incomplete,
+	Malformed
+};
+
+static StreamLeb ModuleStreamLoader_readLeb(const uint8_t *data, size_t size, uint32_t &value, size_t &bytes) {
+	bytes = ReadU32Leb128(data, data + size, &value);
+	if (bytes) {
+		return StreamLeb::Ok;
+	}
+
+	// every available byte has continuation bit
+	return (size < kMaxLeb128U32Size) ? StreamLeb::Incomplete : StreamLeb::Malformed;
+}
+
+ModuleStreamLoader::~ModuleStreamLoader() {
+	if (_module && _state != State::Finished) {
+		fail();
+	}
+}
+
+bool ModuleStreamLoader::init(Environment *env, const StringView &name, const ReadOptions &opts) {
+	if (_module && _state != State::Finished) {
+		fail();
+	}
+
+	_env = env;
+	_name = String(name.data(), name.size());
+	_options = opts;
+	_options.lazy = false;
+	_options.stop_on_first_error = true;
+
+	_buffer.clear();
+	_peakBufferedSize = 0;
+	_numBodies = 0;
+	_nextBody = 0;
+	_codeRemains = 0;
+
+	_module = &_env->_externalModules.emplace(_name, Module()).first->second;
+	if (!_reader.beginStream(_module, _env, _options)) {
+		return fail();
+	}
+
+	_state = State::Header;
+	return true;
+}
+
+bool ModuleStreamLoader::feed(const uint8_t *data, size_t size) {
+	if (_state == State::Failed || _state == State::Finished) {
+		return false;
+	}
+
+	if (_buffer.empty()) {
+		// complete units are read directly from input
+		size_t used = 0;
+		if (!consume(data, size, used)) {
+			return false;
+		}
+		_buffer.assign(data + used, data + size);
+		_peakBufferedSize = std::max(_peakBufferedSize, _buffer.size());
+	} else {
+		_buffer.insert(_buffer.end(), data, data + size);
+		_peakBufferedSize = std::max(_peakBufferedSize, _buffer.size());
+		size_t used = 0;
+		if (!consume(_buffer.data(), _buffer.size(), used)) {
+			return false;
+		}
+		_buffer.erase(_buffer.begin(), _buffer.begin() + used);
+	}
+
+	return true;
+}
+
+Module *ModuleStreamLoader::finish() {
+	if (_state == State::Finished) {
+		return _module;
+	} else if (_state == State::Failed) {
+		return nullptr;
+	}
+
+	if (_state != State::Section || !_buffer.empty()) {
+		_env->pushErrorStream("Reader", [&] (StringStream &stream) {
+			stream << "unexpected end of module '" << _name << "': ";
+			switch (_state) {
+			case State::Header: stream << "incomplete header"; break;
+			case State::Code: stream << "incomplete function body " << _nextBody << " of " << _numBodies; break;
+			default: stream << _buffer.size() << " bytes of incomplete section"; break;
+			}
+		});
+		fail();
+		return nullptr;
+	}
+
+	if (!_reader.endStream()) {
+		fail();
+		return nullptr;
+	}
+
+	_buffer = Vector<uint8_t>();
+	_state = State::Finished;
+	return _module;
+}
+
+bool ModuleStreamLoader::consume(const uint8_t *data, size_t size, size_t &offset) {
+	while (true) {
+		const uint8_t *ptr = data + offset;
+		const size_t available = size - offset;
+
+		switch (_state) {
+		case State::Header:
+			if (available < kModuleHeaderSize) {
+				return true;
+			}
+			if (!_reader.readStreamHeader(ptr, kModuleHeaderSize)) {
+				return fail();
+			}
+			offset += kModuleHeaderSize;
+			_state = State::Section;
+			break;
+
+		case State::Section: {
+			if (available == 0) {
+				return true;
+			}
+
+			uint32_t code = 0, sectionSize = 0;
+			size_t codeBytes = 0, sizeBytes = 0;
+			auto res = ModuleStreamLoader_readLeb(ptr, available, code, codeBytes);
+			if (res == StreamLeb::Ok) {
+				res = ModuleStreamLoader_readLeb(ptr + codeBytes, available - codeBytes, sectionSize, sizeBytes);
+			}
+			if (res == StreamLeb::Incomplete) {
+				return true;
+			} else if (res == StreamLeb::Malformed) {
+				// reader reports error for malformed header
+				_reader.readStreamSection(ptr, available);
+				return fail();
+			}
+
+			const size_t headerSize = codeBytes + sizeBytes;
+			if (code != uint32_t(BinarySection::Code)) {
+				if (available - headerSize < sectionSize) {
+					return true;
+				}
+				if (!_reader.readStreamSection(ptr, headerSize + sectionSize)) {
+					return fail();
+				}
+				offset += headerSize + sectionSize;
+				break;
+			}
+
+			// code section is read by function bodies
+			uint32_t count = 0;
+			size_t countBytes = 0;
+			const size_t countAvailable = std::min(available - headerSize, size_t(sectionSize));
+			res = ModuleStreamLoader_readLeb(ptr + headerSize, countAvailable, count, countBytes);
+			if (res == StreamLeb::Incomplete && countAvailable < sectionSize) {
+				return true;
+			} else if (res != StreamLeb::Ok) {
+				_env->pushErrorStream("Reader", [&] (StringStream &stream) {
+					stream << "unable to read u32 leb128: function body count";
+				});
+				return fail();
+			}
+
+			if (!_reader.beginStreamCode(ptr, headerSize + countBytes)) {
+				return fail();
+			}
+
+			offset += headerSize + countBytes;
+			_numBodies = count;
+			_nextBody = 0;
+			_codeRemains = sectionSize - countBytes;
+			_state = State::Code;
+			break;
+		}
+
+		case State::Code: {
+			if (_nextBody == _numBodies) {
+				if (_codeRemains != 0) {
+					_env->pushErrorStream("Reader", [&] (StringStream &stream) {
+						stream << "unfinished section (" << _codeRemains << " bytes after last function body)";
+					});
+					return fail();
+				}
+				if (!_reader.endStreamCode()) {
+					return fail();
+				}
+				_state = State::Section;
+				break;
+			}
+
+			uint32_t bodySize = 0;
+			size_t sizeBytes = 0;
+			const size_t bodyAvailable = std::min(available, size_t(_codeRemains));
+			auto res = ModuleStreamLoader_readLeb(ptr, bodyAvailable, bodySize, sizeBytes);
+			if (res == StreamLeb::Incomplete && bodyAvailable < _codeRemains) {
+				return true;
+			} else if (res != StreamLeb::Ok) {
+				// reader reports error for malformed body size
+				_reader.readStreamBody(_nextBody, ptr, bodyAvailable);
+				return fail();
+			}
+
+			if (sizeBytes + bodySize > _codeRemains) {
+				_env->pushErrorStream("Reader", [&] (StringStream &stream) {
+					stream << "function body " << _nextBody << " extends past end of code section";
+				});
+				return fail();
+			}
+
+			if (available < sizeBytes + bodySize) {
+				return true;
+			}
+
+			if (!_reader.readStreamBody(_nextBody, ptr, sizeBytes + bodySize)) {
+				return fail();
+			}
+
+			offset += sizeBytes + bodySize;
+			_codeRemains -= sizeBytes + bodySize;
+			++ _nextBody;
+			break;
+		}
+
+		case State::Finished:
+		case State::Failed:
+			return true;
+		}
+	}
+}
+
+bool ModuleStreamLoader::fail() {
+	if (_module) {
+		_env->_externalModules.erase(_name);
+		_module = nullptr;
+	}
+	_buffer.clear();
+	_state = State::Failed;
+	return false;
+}
+
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_MODULESTREAMLOADER_H_
+#define SRC_MODULESTREAMLOADER_H_
+
+#include "Binary.h"
+
+namespace wasm {
+
+// Reads module from incremental input (pipe, socket or chunked file read): every section is read,
+// when it is complete, and function bodies of code section are validated and translated one by one,
+// as their bytes arrive, so only incomplete section or function body is buffered.
+// Code is translated on feeding thread (ReadOptions::lazy and ReadOptions::threads are ignored);
+// reading stops on first error (ReadOptions::stop_on_first_error is implied).
+class ModuleStreamLoader {
+public:
+	~ModuleStreamLoader();
+
+	// module is added into environment with name; it is removed, when loading fails or loader is not finished
+	bool init(Environment *, const StringView &name, const ReadOptions & = ReadOptions());
+
+	// returns false for malformed or invalid input, errors are reported into environment
+	bool feed(const uint8_t *, size_t);
+
+	// returns nullptr, when input is incomplete or invalid
+	Module *finish();
+
+	// input, that waits for complete section or function body
+	size_t getBufferedSize() const { return _buffer.size(); }
+	size_t getPeakBufferedSize() const { return _peakBufferedSize; }
+
+protected:
+	enum class State {
+		Header,
+		Section,
+		Code, // between function bodies of code section
+		Finished,
+		Failed,
+	};
+
+	// reads all complete units of input, offset is set to number of bytes used
+	bool consume(const uint8_t *, size_t, size_t &offset);
+
+	bool fail();
+
+	State _state = State::Failed;
+	Environment *_env = nullptr;
+	String _name;
+	Module *_module = nullptr;
+	ReadOptions _options;
+	ModuleReader _reader;
+
+	Vector<uint8_t> _buffer;
+	size_t _peakBufferedSize = 0;
+
+	Index _numBodies = 0;
+	Index _nextBody = 0;
+	Offset _codeRemains = 0; // bytes of code section after bodies, that was read
+};
+
+}
+
+#endif /* SRC_MODULESTREAMLOADER_H_ */
@@ -103,6 +103,16 @@ bool Opcode::IsEnabled(const Features& features) const {
 	case Opcode::I64TruncUSatF64:
 		return features.isSatFloatToIntEnabled();
 
+	case Opcode::ReturnCall:
+	case Opcode::ReturnCallIndirect:
+		return features.isTailCallEnabled();
+
+	case Opcode::MemoryInit:
+	case Opcode::DataDrop:
+	case Opcode::MemoryCopy:
+	case Opcode::MemoryFill:
+		return features.isBulkMemoryEnabled();
+
 	case Opcode::I32Extend8S:
 	case Opcode::I32Extend16S:
 	case Opcode::I64Extend8S:
@@ -177,8 +187,14 @@ bool Opcode::IsEnabled(const Features& features) const {
 		return features.isThreadsEnabled();
 
 	default:
-		return true;
+		break;
 	}
+
+	if (_enum >= Opcode::V128Load && _enum <= Opcode::F32X4ConvertI32X4U) {
+		return features.isSimdEnabled();
+	}
+
+	return true;
 }
 
 }  // end anonymous namespace
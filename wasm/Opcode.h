@@ -67,7 +67,7 @@ struct Opcode {
 	Address GetAlignment(Address alignment) const;
 
 	static bool IsPrefixByte(uint8_t byte) {
-		return byte == kMathPrefix || byte == kThreadsPrefix;
+		return byte == kMathPrefix || byte == kSimdPrefix || byte == kThreadsPrefix;
 	}
 
 	bool IsEnabled(const Features& features) const;
@@ -75,6 +75,7 @@ struct Opcode {
 
 private:
 	static const uint32_t kMathPrefix = 0xfc;
+	static const uint32_t kSimdPrefix = 0xfd;
 	static const uint32_t kThreadsPrefix = 0xfe;
 
 	struct Info {
@@ -53,6 +53,8 @@ WABT_OPCODE(___, ___, ___, ___, 0, 0,     0x0e, BrTable, "br_table")
 WABT_OPCODE(___, ___, ___, ___, 0, 0,     0x0f, Return, "return")
 WABT_OPCODE(___, ___, ___, ___, 0, 0,     0x10, Call, "call")
 WABT_OPCODE(___, ___, ___, ___, 0, 0,     0x11, CallIndirect, "call_indirect")
+WABT_OPCODE(___, ___, ___, ___, 0, 0,     0x12, ReturnCall, "return_call")
+WABT_OPCODE(___, ___, ___, ___, 0, 0,     0x13, ReturnCallIndirect, "return_call_indirect")
 WABT_OPCODE(___, ___, ___, ___, 0, 0,     0x1a, Drop, "drop")
 WABT_OPCODE(___, ___, ___, ___, 0, 0,     0x1b, Select, "select")
 WABT_OPCODE(___, ___, ___, ___, 0, 0,     0x20, GetLocal, "get_local")
@@ -221,6 +223,32 @@ WABT_OPCODE(I64, I64, ___, ___, 0, 0,     0xC4, I64Extend32S, "i64.extend32_s")
 
 WABT_OPCODE(___, ___, ___, ___, 0, 0,     0xe0, InterpSetStack, "set_stackp")
 WABT_OPCODE(___, ___, ___, ___, 0, 0,     0xe1, InterpGetStack, "get_stackp")
+WABT_OPCODE(___, ___, ___, ___, 0, 0,     0xe2, InterpLoopGuard, "loop_guard")
+WABT_OPCODE(I32, I32, ___, ___, 4, 0,     0xe3, I32LoadUnchecked, "i32.load/unchecked")
+WABT_OPCODE(I64, I32, ___, ___, 8, 0,     0xe4, I64LoadUnchecked, "i64.load/unchecked")
+WABT_OPCODE(F32, I32, ___, ___, 4, 0,     0xe5, F32LoadUnchecked, "f32.load/unchecked")
+WABT_OPCODE(F64, I32, ___, ___, 8, 0,     0xe6, F64LoadUnchecked, "f64.load/unchecked")
+WABT_OPCODE(I32, I32, ___, ___, 1, 0,     0xe7, I32Load8SUnchecked, "i32.load8_s/unchecked")
+WABT_OPCODE(I32, I32, ___, ___, 1, 0,     0xe8, I32Load8UUnchecked, "i32.load8_u/unchecked")
+WABT_OPCODE(I32, I32, ___, ___, 2, 0,     0xe9, I32Load16SUnchecked, "i32.load16_s/unchecked")
+WABT_OPCODE(I32, I32, ___, ___, 2, 0,     0xea, I32Load16UUnchecked, "i32.load16_u/unchecked")
+WABT_OPCODE(I64, I32, ___, ___, 1, 0,     0xeb, I64Load8SUnchecked, "i64.load8_s/unchecked")
+WABT_OPCODE(I64, I32, ___, ___, 1, 0,     0xec, I64Load8UUnchecked, "i64.load8_u/unchecked")
+WABT_OPCODE(I64, I32, ___, ___, 2, 0,     0xed, I64Load16SUnchecked, "i64.load16_s/unchecked")
+WABT_OPCODE(I64, I32, ___, ___, 2, 0,     0xee, I64Load16UUnchecked, "i64.load16_u/unchecked")
+WABT_OPCODE(I64, I32, ___, ___, 4, 0,     0xef, I64Load32SUnchecked, "i64.load32_s/unchecked")
+WABT_OPCODE(I64, I32, ___, ___, 4, 0,     0xf0, I64Load32UUnchecked, "i64.load32_u/unchecked")
+WABT_OPCODE(___, I32, I32, ___, 4, 0,     0xf1, I32StoreUnchecked, "i32.store/unchecked")
+WABT_OPCODE(___, I32, I64, ___, 8, 0,     0xf2, I64StoreUnchecked, "i64.store/unchecked")
+WABT_OPCODE(___, I32, F32, ___, 4, 0,     0xf3, F32StoreUnchecked, "f32.store/unchecked")
+WABT_OPCODE(___, I32, F64, ___, 8, 0,     0xf4, F64StoreUnchecked, "f64.store/unchecked")
+WABT_OPCODE(___, I32, I32, ___, 1, 0,     0xf5, I32Store8Unchecked, "i32.store8/unchecked")
+WABT_OPCODE(___, I32, I32, ___, 2, 0,     0xf6, I32Store16Unchecked, "i32.store16/unchecked")
+WABT_OPCODE(___, I32, I64, ___, 1, 0,     0xf7, I64Store8Unchecked, "i64.store8/unchecked")
+WABT_OPCODE(___, I32, I64, ___, 2, 0,     0xf8, I64Store16Unchecked, "i64.store16/unchecked")
+WABT_OPCODE(___, I32, I64, ___, 4, 0,     0xf9, I64Store32Unchecked, "i64.store32/unchecked")
+WABT_OPCODE(___, ___, ___, ___, 0, 0,     0xfa, InterpChargeFuel, "charge_fuel")
+WABT_OPCODE(___, ___, ___, ___, 0, 0,     0xfb, InterpCheckEpoch, "check_epoch")
 
 WABT_OPCODE(I32, F32, ___, ___, 0, 0xfc,  0x00, I32TruncSSatF32, "i32.trunc_s:sat/f32")
 WABT_OPCODE(I32, F32, ___, ___, 0, 0xfc,  0x01, I32TruncUSatF32, "i32.trunc_u:sat/f32")
@@ -230,6 +258,152 @@ WABT_OPCODE(I64, F32, ___, ___, 0, 0xfc,  0x04, I64TruncSSatF32, "i64.trunc_s:sa
 WABT_OPCODE(I64, F32, ___, ___, 0, 0xfc,  0x05, I64TruncUSatF32, "i64.trunc_u:sat/f32")
 WABT_OPCODE(I64, F64, ___, ___, 0, 0xfc,  0x06, I64TruncSSatF64, "i64.trunc_s:sat/f64")
 WABT_OPCODE(I64, F64, ___, ___, 0, 0xfc,  0x07, I64TruncUSatF64, "i64.trunc_u:sat/f64")
+WABT_OPCODE(___, I32, I32, I32, 0, 0xfc,  0x08, MemoryInit, "memory.init")
+WABT_OPCODE(___, ___, ___, ___, 0, 0xfc,  0x09, DataDrop, "data.drop")
+WABT_OPCODE(___, I32, I32, I32, 0, 0xfc,  0x0a, MemoryCopy, "memory.copy")
+WABT_OPCODE(___, I32, I32, I32, 0, 0xfc,  0x0b, MemoryFill, "memory.fill")
+
+WABT_OPCODE(V128, I32,  ___,  ___,  16, 0xfd,  0x00, V128Load, "v128.load")
+WABT_OPCODE(___,  I32,  V128, ___,  16, 0xfd,  0x0b, V128Store, "v128.store")
+WABT_OPCODE(V128, ___,  ___,  ___,  0,  0xfd,  0x0c, V128Const, "v128.const")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x0d, I8X16Shuffle, "i8x16.shuffle")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x0e, I8X16Swizzle, "i8x16.swizzle")
+WABT_OPCODE(V128, I32,  ___,  ___,  0,  0xfd,  0x0f, I8X16Splat, "i8x16.splat")
+WABT_OPCODE(V128, I32,  ___,  ___,  0,  0xfd,  0x10, I16X8Splat, "i16x8.splat")
+WABT_OPCODE(V128, I32,  ___,  ___,  0,  0xfd,  0x11, I32X4Splat, "i32x4.splat")
+WABT_OPCODE(V128, I64,  ___,  ___,  0,  0xfd,  0x12, I64X2Splat, "i64x2.splat")
+WABT_OPCODE(V128, F32,  ___,  ___,  0,  0xfd,  0x13, F32X4Splat, "f32x4.splat")
+WABT_OPCODE(V128, F64,  ___,  ___,  0,  0xfd,  0x14, F64X2Splat, "f64x2.splat")
+WABT_OPCODE(I32,  V128, ___,  ___,  0,  0xfd,  0x15, I8X16ExtractLaneS, "i8x16.extract_lane_s")
+WABT_OPCODE(I32,  V128, ___,  ___,  0,  0xfd,  0x16, I8X16ExtractLaneU, "i8x16.extract_lane_u")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0x17, I8X16ReplaceLane, "i8x16.replace_lane")
+WABT_OPCODE(I32,  V128, ___,  ___,  0,  0xfd,  0x18, I16X8ExtractLaneS, "i16x8.extract_lane_s")
+WABT_OPCODE(I32,  V128, ___,  ___,  0,  0xfd,  0x19, I16X8ExtractLaneU, "i16x8.extract_lane_u")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0x1a, I16X8ReplaceLane, "i16x8.replace_lane")
+WABT_OPCODE(I32,  V128, ___,  ___,  0,  0xfd,  0x1b, I32X4ExtractLane, "i32x4.extract_lane")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0x1c, I32X4ReplaceLane, "i32x4.replace_lane")
+WABT_OPCODE(I64,  V128, ___,  ___,  0,  0xfd,  0x1d, I64X2ExtractLane, "i64x2.extract_lane")
+WABT_OPCODE(V128, V128, I64,  ___,  0,  0xfd,  0x1e, I64X2ReplaceLane, "i64x2.replace_lane")
+WABT_OPCODE(F32,  V128, ___,  ___,  0,  0xfd,  0x1f, F32X4ExtractLane, "f32x4.extract_lane")
+WABT_OPCODE(V128, V128, F32,  ___,  0,  0xfd,  0x20, F32X4ReplaceLane, "f32x4.replace_lane")
+WABT_OPCODE(F64,  V128, ___,  ___,  0,  0xfd,  0x21, F64X2ExtractLane, "f64x2.extract_lane")
+WABT_OPCODE(V128, V128, F64,  ___,  0,  0xfd,  0x22, F64X2ReplaceLane, "f64x2.replace_lane")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x23, I8X16Eq, "i8x16.eq")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x24, I8X16Ne, "i8x16.ne")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x25, I8X16LtS, "i8x16.lt_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x26, I8X16LtU, "i8x16.lt_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x27, I8X16GtS, "i8x16.gt_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x28, I8X16GtU, "i8x16.gt_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x2d, I16X8Eq, "i16x8.eq")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x2e, I16X8Ne, "i16x8.ne")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x37, I32X4Eq, "i32x4.eq")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x38, I32X4Ne, "i32x4.ne")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x39, I32X4LtS, "i32x4.lt_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x3a, I32X4LtU, "i32x4.lt_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x3b, I32X4GtS, "i32x4.gt_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x3c, I32X4GtU, "i32x4.gt_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x41, F32X4Eq, "f32x4.eq")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x42, F32X4Ne, "f32x4.ne")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x43, F32X4Lt, "f32x4.lt")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x44, F32X4Gt, "f32x4.gt")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x45, F32X4Le, "f32x4.le")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x46, F32X4Ge, "f32x4.ge")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0x4d, V128Not, "v128.not")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x4e, V128And, "v128.and")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x4f, V128Andnot, "v128.andnot")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x50, V128Or, "v128.or")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x51, V128Xor, "v128.xor")
+WABT_OPCODE(V128, V128, V128, V128, 0,  0xfd,  0x52, V128BitSelect, "v128.bitselect")
+WABT_OPCODE(I32,  V128, ___,  ___,  0,  0xfd,  0x53, V128AnyTrue, "v128.any_true")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0x60, I8X16Abs, "i8x16.abs")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0x61, I8X16Neg, "i8x16.neg")
+WABT_OPCODE(I32,  V128, ___,  ___,  0,  0xfd,  0x63, I8X16AllTrue, "i8x16.all_true")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x65, I8X16NarrowI16X8S, "i8x16.narrow_i16x8_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x66, I8X16NarrowI16X8U, "i8x16.narrow_i16x8_u")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0x6b, I8X16Shl, "i8x16.shl")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0x6c, I8X16ShrS, "i8x16.shr_s")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0x6d, I8X16ShrU, "i8x16.shr_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x6e, I8X16Add, "i8x16.add")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x6f, I8X16AddSatS, "i8x16.add_sat_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x70, I8X16AddSatU, "i8x16.add_sat_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x71, I8X16Sub, "i8x16.sub")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x72, I8X16SubSatS, "i8x16.sub_sat_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x73, I8X16SubSatU, "i8x16.sub_sat_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x76, I8X16MinS, "i8x16.min_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x77, I8X16MinU, "i8x16.min_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x78, I8X16MaxS, "i8x16.max_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x79, I8X16MaxU, "i8x16.max_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x7b, I8X16AvgrU, "i8x16.avgr_u")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0x80, I16X8Abs, "i16x8.abs")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0x81, I16X8Neg, "i16x8.neg")
+WABT_OPCODE(I32,  V128, ___,  ___,  0,  0xfd,  0x83, I16X8AllTrue, "i16x8.all_true")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x85, I16X8NarrowI32X4S, "i16x8.narrow_i32x4_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x86, I16X8NarrowI32X4U, "i16x8.narrow_i32x4_u")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0x87, I16X8ExtendLowI8X16S, "i16x8.extend_low_i8x16_s")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0x88, I16X8ExtendHighI8X16S, "i16x8.extend_high_i8x16_s")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0x89, I16X8ExtendLowI8X16U, "i16x8.extend_low_i8x16_u")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0x8a, I16X8ExtendHighI8X16U, "i16x8.extend_high_i8x16_u")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0x8b, I16X8Shl, "i16x8.shl")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0x8c, I16X8ShrS, "i16x8.shr_s")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0x8d, I16X8ShrU, "i16x8.shr_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x8e, I16X8Add, "i16x8.add")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x8f, I16X8AddSatS, "i16x8.add_sat_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x90, I16X8AddSatU, "i16x8.add_sat_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x91, I16X8Sub, "i16x8.sub")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x92, I16X8SubSatS, "i16x8.sub_sat_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x93, I16X8SubSatU, "i16x8.sub_sat_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x95, I16X8Mul, "i16x8.mul")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x96, I16X8MinS, "i16x8.min_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x97, I16X8MinU, "i16x8.min_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x98, I16X8MaxS, "i16x8.max_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x99, I16X8MaxU, "i16x8.max_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0x9b, I16X8AvgrU, "i16x8.avgr_u")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xa0, I32X4Abs, "i32x4.abs")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xa1, I32X4Neg, "i32x4.neg")
+WABT_OPCODE(I32,  V128, ___,  ___,  0,  0xfd,  0xa3, I32X4AllTrue, "i32x4.all_true")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xa7, I32X4ExtendLowI16X8S, "i32x4.extend_low_i16x8_s")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xa8, I32X4ExtendHighI16X8S, "i32x4.extend_high_i16x8_s")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xa9, I32X4ExtendLowI16X8U, "i32x4.extend_low_i16x8_u")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xaa, I32X4ExtendHighI16X8U, "i32x4.extend_high_i16x8_u")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0xab, I32X4Shl, "i32x4.shl")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0xac, I32X4ShrS, "i32x4.shr_s")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0xad, I32X4ShrU, "i32x4.shr_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xae, I32X4Add, "i32x4.add")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xb1, I32X4Sub, "i32x4.sub")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xb5, I32X4Mul, "i32x4.mul")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xb6, I32X4MinS, "i32x4.min_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xb7, I32X4MinU, "i32x4.min_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xb8, I32X4MaxS, "i32x4.max_s")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xb9, I32X4MaxU, "i32x4.max_u")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xc1, I64X2Neg, "i64x2.neg")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0xcb, I64X2Shl, "i64x2.shl")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0xcc, I64X2ShrS, "i64x2.shr_s")
+WABT_OPCODE(V128, V128, I32,  ___,  0,  0xfd,  0xcd, I64X2ShrU, "i64x2.shr_u")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xce, I64X2Add, "i64x2.add")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xd1, I64X2Sub, "i64x2.sub")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xd5, I64X2Mul, "i64x2.mul")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xe0, F32X4Abs, "f32x4.abs")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xe1, F32X4Neg, "f32x4.neg")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xe3, F32X4Sqrt, "f32x4.sqrt")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xe4, F32X4Add, "f32x4.add")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xe5, F32X4Sub, "f32x4.sub")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xe6, F32X4Mul, "f32x4.mul")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xe7, F32X4Div, "f32x4.div")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xe8, F32X4Min, "f32x4.min")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xe9, F32X4Max, "f32x4.max")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xec, F64X2Abs, "f64x2.abs")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xed, F64X2Neg, "f64x2.neg")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xef, F64X2Sqrt, "f64x2.sqrt")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xf0, F64X2Add, "f64x2.add")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xf1, F64X2Sub, "f64x2.sub")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xf2, F64X2Mul, "f64x2.mul")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xf3, F64X2Div, "f64x2.div")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xf4, F64X2Min, "f64x2.min")
+WABT_OPCODE(V128, V128, V128, ___,  0,  0xfd,  0xf5, F64X2Max, "f64x2.max")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xf8, I32X4TruncSatF32X4S, "i32x4.trunc_sat_f32x4_s")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xf9, I32X4TruncSatF32X4U, "i32x4.trunc_sat_f32x4_u")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xfa, F32X4ConvertI32X4S, "f32x4.convert_i32x4_s")
+WABT_OPCODE(V128, V128, ___,  ___,  0,  0xfd,  0xfb, F32X4ConvertI32X4U, "f32x4.convert_i32x4_u")
 
 WABT_OPCODE(I32, I32, I32, ___, 4, 0xfe,  0x00, AtomicWake, "atomic.wake")
 WABT_OPCODE(I32, I32, I32, I64, 4, 0xfe,  0x01, I32AtomicWait, "i32.atomic.wait")
@@ -0,0 +1,319 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PooledRuntime.h"
+
+namespace wasm {
+
+PooledRuntime::~PooledRuntime() {
+	stop();
+}
+
+bool PooledRuntime::init(const Environment *env, const PooledRuntimeOptions &opts) {
+	if (!Runtime::init(env, opts)) {
+		return false;
+	}
+
+	uint32_t count = opts.workers ? opts.workers : std::max(std::thread::hardware_concurrency(), 1U);
+
+	if (opts.userStackSize) {
+		auto mod = getModule(opts.stackModule);
+		if (!mod || mod->memory.empty()) {
+			pushErrorStream([&] (std::ostream &stream) {
+				stream << "PooledRuntime: no memory for user stacks in module \"" << opts.stackModule << "\"";
+			});
+			return false;
+		}
+		if (uint64_t(opts.userStackBase) + uint64_t(opts.userStackSize) * count > mod->memory[0]->size) {
+			pushErrorStream([&] (std::ostream &stream) {
+				stream << "PooledRuntime: user stacks for " << count << " workers does not fit into memory";
+			});
+			return false;
+		}
+	}
+
+	_context.stopFlag.store(false);
+	_exit = false;
+
+	_workers.reserve(count);
+	for (uint32_t i = 0; i < count; ++ i) {
+		_workers.emplace_back(new Worker(this, i));
+		auto &thread = _workers.back()->thread;
+		if (!thread.init(opts.valueStackSize, opts.callStackSize)) {
+			_workers.pop_back();
+			stop();
+			return false;
+		}
+		thread.setSyncContext(&_context);
+		if (opts.userStackSize) {
+			const uint32_t guard = opts.userStackBase + i * opts.userStackSize;
+			thread.setUserStackPointer(guard + opts.userStackSize, guard);
+		}
+	}
+
+	for (auto &it : _workers) {
+		auto worker = it.get();
+		worker->os = std::thread([this, worker] { runWorker(*worker); });
+	}
+
+	return true;
+}
+
+// worker, that runs on current OS thread, if any
+static thread_local const void *s_currentRuntime = nullptr;
+static thread_local void *s_currentWorker = nullptr;
+
+std::future<PooledRuntime::CallResult> PooledRuntime::submit(const RuntimeModule &module, const Func &func,
+		Vector<Value> params, const CallLimits &limits) {
+	auto promise = std::make_shared<std::promise<CallResult>>();
+	auto ret = promise->get_future();
+	submit(module, func, std::move(params), [promise] (CallResult &&result) {
+		promise->set_value(std::move(result));
+	}, limits);
+	return ret;
+}
+
+std::future<PooledRuntime::CallResult> PooledRuntime::submit(const Func &func, Vector<Value> params, const CallLimits &limits) {
+	if (auto mod = getModule(func.module)) {
+		return submit(*mod, func, std::move(params), limits);
+	}
+
+	CallResult ret;
+	ret.result = Thread::Result::TrapHostTrapped;
+
+	std::promise<CallResult> promise;
+	promise.set_value(std::move(ret));
+	return promise.get_future();
+}
+
+void PooledRuntime::submit(const RuntimeModule &module, const Func &func, Vector<Value> params,
+		Callback &&callback, const CallLimits &limits) {
+	params.resize(std::max(func.sig->params.size(), func.sig->results.size()));
+
+	Vector<Task *> tasks{ new Task{&module, &func, std::move(params), limits, std::move(callback)} };
+	enqueue(tasks);
+}
+
+void PooledRuntime::submit(const RuntimeModule &module, const Func &func, Vector<Vector<Value>> &&batch,
+		const BatchCallback &callback, const CallLimits &limits) {
+	auto cb = std::make_shared<BatchCallback>(callback);
+	const size_t size = std::max(func.sig->params.size(), func.sig->results.size());
+
+	Vector<Task *> tasks;
+	tasks.reserve(batch.size());
+	for (Index i = 0; i < batch.size(); ++ i) {
+		batch[i].resize(size);
+		tasks.emplace_back(new Task{&module, &func, std::move(batch[i]), limits, [cb, i] (CallResult &&result) {
+			(*cb)(i, std::move(result));
+		}});
+	}
+	enqueue(tasks);
+}
+
+void PooledRuntime::stop() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_exit.store(true);
+	lock.unlock();
+	_cond.notify_all();
+
+	if (s_currentRuntime == this) {
+		// worker can not join itself, workers are joined by stop from other thread or by destructor
+		return;
+	}
+
+	for (auto &it : _workers) {
+		if (it->os.joinable()) {
+			it->os.join();
+		}
+	}
+	_workers.clear();
+}
+
+uint32_t PooledRuntime::getWorkersCount() const {
+	return _workers.size();
+}
+
+void PooledRuntime::enqueue(Vector<Task *> &tasks) {
+	if (tasks.empty()) {
+		return;
+	}
+
+	const bool nested = (s_currentRuntime == this);
+	if (nested) {
+		// nested call from host function, owner can push into its own deque;
+		// counter is incremented before tasks are published, so it never underflows
+		_pending.fetch_add(tasks.size());
+		auto worker = (Worker *)s_currentWorker;
+		for (auto &it : tasks) {
+			worker->deque.push(it);
+		}
+	} else {
+		// stop takes the same mutex, so workers are not destroyed, while tasks are placed into inbox,
+		// and calls after stop are rejected
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_exit.load() || _workers.empty()) {
+			lock.unlock();
+			for (auto &it : tasks) {
+				CallResult ret;
+				ret.result = Thread::Result::TrapHostTrapped;
+				it->callback(std::move(ret));
+				delete it;
+			}
+			return;
+		}
+
+		_pending.fetch_add(tasks.size());
+		auto &worker = *_workers[_nextWorker.fetch_add(1) % _workers.size()];
+		std::unique_lock<std::mutex> inboxLock(worker.inboxMutex);
+		worker.inbox.insert(worker.inbox.end(), tasks.begin(), tasks.end());
+	}
+
+	if (_sleeping.load() > 0) {
+		if (nested) {
+			// pass through mutex, so parking worker can not miss notification
+			_mutex.lock();
+			_mutex.unlock();
+		}
+		if (tasks.size() > 1) {
+			_cond.notify_all();
+		} else {
+			_cond.notify_one();
+		}
+	}
+}
+
+bool PooledRuntime::drainInbox(Worker &self, Worker &from) {
+	std::unique_lock<std::mutex> lock(from.inboxMutex, std::defer_lock);
+	if (&self == &from) {
+		lock.lock();
+	} else if (!lock.try_lock()) {
+		return false;
+	}
+
+	if (from.inbox.empty()) {
+		return false;
+	}
+
+	Vector<Task *> tasks(std::move(from.inbox));
+	from.inbox.clear();
+	lock.unlock();
+
+	// push in reverse, so first submitted task is popped first
+	for (auto it = tasks.rbegin(); it != tasks.rend(); ++ it) {
+		self.deque.push(*it);
+	}
+	return true;
+}
+
+PooledRuntime::Task *PooledRuntime::findTask(Worker &self) {
+	if (auto task = self.deque.pop()) {
+		return task;
+	}
+
+	if (drainInbox(self, self)) {
+		if (auto task = self.deque.pop()) {
+			return task;
+		}
+	}
+
+	const size_t count = _workers.size();
+	if (count < 2) {
+		return nullptr;
+	}
+
+	for (size_t i = 0; i < count * 2; ++ i) {
+		self.random ^= self.random << 13;
+		self.random ^= self.random >> 7;
+		self.random ^= self.random << 17;
+
+		auto &victim = *_workers[self.random % count];
+		if (&victim == &self) {
+			continue;
+		}
+
+		if (auto task = victim.deque.steal()) {
+			return task;
+		}
+
+		if (drainInbox(self, victim)) {
+			if (auto task = self.deque.pop()) {
+				return task;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+void PooledRuntime::runWorker(Worker &worker) {
+	s_currentRuntime = this;
+	s_currentWorker = &worker;
+
+	while (true) {
+		if (auto task = findTask(worker)) {
+			_pending.fetch_sub(1);
+			runTask(worker, *task);
+			delete task;
+			continue;
+		}
+
+		if (_pending.load() > 0) {
+			// task is published, but not visible yet, or it was taken by other thief
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		++ _sleeping;
+		while (_pending.load() == 0 && !_exit.load()) {
+			_cond.wait(lock);
+		}
+		-- _sleeping;
+
+		if (_exit.load() && _pending.load() == 0) {
+			break;
+		}
+	}
+
+	s_currentRuntime = nullptr;
+	s_currentWorker = nullptr;
+}
+
+void PooledRuntime::runTask(Worker &worker, Task &task) {
+	auto &thread = worker.thread;
+	thread.setFuel(task.limits.fuel);
+
+	const bool hasTimeout = task.limits.timeout != CallLimits::Duration::zero();
+	thread.setDeadline(hasTimeout ? Watchdog::getInstance()->acquire(task.limits.timeout) : Thread::kNoDeadline);
+
+	CallResult ret;
+	ret.result = thread.Run(*task.module, *task.func, task.params.data(), true);
+
+	if (hasTimeout) {
+		Watchdog::getInstance()->release();
+	}
+	thread.setDeadline(Thread::kNoDeadline);
+
+	ret.remainingFuel = thread.getFuel();
+	if (ret.result == Thread::Result::Ok || ret.result == Thread::Result::Returned) {
+		task.params.resize(task.func->sig->results.size());
+		ret.values = std::move(task.params);
+	}
+
+	task.callback(std::move(ret));
+}
+
+}
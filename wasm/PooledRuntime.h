@@ -0,0 +1,123 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_POOLEDRUNTIME_H_
+#define SRC_POOLEDRUNTIME_H_
+
+#include "ThreadedRuntime.h"
+#include "WorkStealingDeque.h"
+#include <future>
+#include <functional>
+
+namespace wasm {
+
+struct PooledRuntimeOptions : LinkingThreadOptions {
+	// number of worker threads, 0 for std::thread::hardware_concurrency
+	uint32_t workers = 0;
+
+	// user stacks are carved from region of memory 0 of stackModule, starting at userStackBase,
+	// worker N owns [userStackBase + N * userStackSize, userStackBase + (N + 1) * userStackSize)
+	StringView stackModule;
+	uint32_t userStackBase = 0;
+	uint32_t userStackSize = 0; // 0 - workers have no user stack
+};
+
+// Runtime with pool of worker threads, each with its own wasm::Thread; workers share
+// linear memory and synchronize memory growth through common ThreadContext.
+//
+// Every worker owns work-stealing deque; calls, submitted from outside, are placed in batches
+// into worker's inbox (round-robin), calls, submitted from host functions, go directly into
+// current worker's deque. Idle worker drains its inbox, then steals from random victims.
+class PooledRuntime : public Runtime {
+public:
+	struct CallResult {
+		Thread::Result result = Thread::Result::Ok;
+		Vector<Value> values; // function results on success
+		uint64_t remainingFuel = Thread::kUnlimitedFuel;
+	};
+
+	// called on worker thread, when call is completed
+	using Callback = std::function<void(CallResult &&)>;
+	using BatchCallback = std::function<void(Index, CallResult &&)>;
+
+	virtual ~PooledRuntime();
+	PooledRuntime() { }
+
+	bool init(const Environment *, const PooledRuntimeOptions & = PooledRuntimeOptions());
+
+	// call can be submitted from any thread, including workers (from host functions)
+	std::future<CallResult> submit(const RuntimeModule &, const Func &, Vector<Value> params, const CallLimits & = CallLimits());
+	std::future<CallResult> submit(const Func &, Vector<Value> params, const CallLimits & = CallLimits());
+
+	// callback versions do not allocate shared state for future
+	void submit(const RuntimeModule &, const Func &, Vector<Value> params, Callback &&, const CallLimits & = CallLimits());
+
+	// all calls of the batch are enqueued at once, callback receives index of call in batch
+	void submit(const RuntimeModule &, const Func &, Vector<Vector<Value>> &&batch, const BatchCallback &,
+			const CallLimits & = CallLimits());
+
+	// waits for submitted calls to complete, then stops workers; calls, submitted from other threads
+	// after stop, fail with TrapHostTrapped. Called from worker (host function or callback), it only
+	// stops accepting calls, workers are joined by next stop from other thread or by destructor
+	void stop();
+
+	uint32_t getWorkersCount() const;
+
+protected:
+	struct Task {
+		const RuntimeModule *module;
+		const Func *func;
+		Vector<Value> params;
+		CallLimits limits;
+		Callback callback;
+	};
+
+	struct Worker {
+		Worker(const Runtime *runtime, Index tag) : thread(runtime, tag), random(tag * 0x9E3779B97F4A7C15ULL + 1) { }
+
+		Thread thread;
+		std::thread os;
+		WorkStealingDeque<Task *> deque;
+
+		std::mutex inboxMutex;
+		Vector<Task *> inbox;
+
+		uint64_t random; // xorshift state for victim selection
+	};
+
+	void enqueue(Vector<Task *> &);
+
+	Task *findTask(Worker &);
+	bool drainInbox(Worker &self, Worker &from);
+
+	void runWorker(Worker &);
+	void runTask(Worker &, Task &);
+
+	ThreadContext _context;
+	Vector<std::unique_ptr<Worker>> _workers;
+
+	std::atomic<uint64_t> _pending = ATOMIC_VAR_INIT(0); // tasks, that are not started yet
+	std::atomic<uint32_t> _sleeping = ATOMIC_VAR_INIT(0);
+	std::atomic<uint32_t> _nextWorker = ATOMIC_VAR_INIT(0);
+	std::atomic<bool> _exit = ATOMIC_VAR_INIT(false);
+
+	std::mutex _mutex; // guards parking of idle workers, stop and submission from other threads
+	std::condition_variable _cond;
+};
+
+}
+
+#endif /* SRC_POOLEDRUNTIME_H_ */
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RuntimePool.h"
+
+namespace wasm {
+
+RuntimePool::~RuntimePool() {
+	stop();
+}
+
+bool RuntimePool::init(const Environment *env, const RuntimePoolOptions &opts, const WarmUpCallback &warmUp) {
+	_env = env;
+	_options = opts;
+	_options.snapshot = nullptr;
+
+	ThreadedRuntime source;
+	if (!source.init(env, _options)) {
+		return false;
+	}
+
+	if (warmUp && !warmUp(source)) {
+		return false;
+	}
+
+	if (!source.snapshot(_snapshot)) {
+		return false;
+	}
+
+	_userStackPointer = source.getMainThread().getUserStackPointer();
+	_userStackGuard = source.getMainThread().getUserStackGuard();
+	_options.snapshot = &_snapshot;
+
+	for (uint32_t i = 0; i < _options.size; ++ i) {
+		if (auto runtime = create()) {
+			_ready.emplace_back(runtime);
+		}
+	}
+
+	_exit = false;
+	_worker = std::thread([this] { runWorker(); });
+	return true;
+}
+
+void RuntimePool::setResetCallback(const ResetCallback &cb) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_resetCallback = cb;
+}
+
+ThreadedRuntime *RuntimePool::acquire() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (!_ready.empty()) {
+		auto ret = _ready.back();
+		_ready.pop_back();
+		++ _stats.hits;
+		++ _stats.active;
+		_cond.notify_one(); // refill
+		return ret;
+	}
+
+	++ _stats.misses;
+	lock.unlock();
+
+	auto ret = create();
+	if (ret) {
+		lock.lock();
+		++ _stats.active;
+	}
+	return ret;
+}
+
+void RuntimePool::release(ThreadedRuntime *runtime) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	-- _stats.active;
+	if (_exit) {
+		lock.unlock();
+		delete runtime;
+		return;
+	}
+
+	_released.emplace_back(runtime);
+	lock.unlock();
+	_cond.notify_one();
+}
+
+void RuntimePool::setSize(uint32_t size) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_options.size = size;
+	_cond.notify_one();
+}
+
+uint32_t RuntimePool::getSize() const {
+	std::unique_lock<std::mutex> lock(_mutex);
+	return _options.size;
+}
+
+RuntimePool::Stats RuntimePool::getStats() const {
+	std::unique_lock<std::mutex> lock(_mutex);
+	Stats ret = _stats;
+	ret.ready = _ready.size();
+	return ret;
+}
+
+const RuntimeSnapshot &RuntimePool::getSnapshot() const {
+	return _snapshot;
+}
+
+void RuntimePool::stop() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_exit = true;
+	lock.unlock();
+	_cond.notify_all();
+
+	if (_worker.joinable()) {
+		_worker.join();
+	}
+
+	for (auto &it : _ready) {
+		delete it;
+	}
+	for (auto &it : _released) {
+		delete it;
+	}
+	_ready.clear();
+	_released.clear();
+}
+
+ThreadedRuntime *RuntimePool::create() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto opts = _options; // size can be changed concurrently
+	lock.unlock();
+
+	auto ret = new ThreadedRuntime();
+	if (!ret->init(_env, opts)) {
+		delete ret;
+		return nullptr;
+	}
+	ret->getMainThread().setUserStackPointer(_userStackPointer, _userStackGuard);
+	return ret;
+}
+
+bool RuntimePool::reset(ThreadedRuntime *runtime) {
+	if (!runtime->reset()) {
+		return false;
+	}
+
+	// limits and interrupt of previous owner should not affect next one
+	auto &thread = runtime->getMainThread();
+	thread.Reset();
+	thread.setFuelSlice(0);
+	thread.setFuel(Thread::kUnlimitedFuel);
+	thread.setDeadline(Thread::kNoDeadline);
+	thread.setUserStackPointer(_userStackPointer, _userStackGuard);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto cb = _resetCallback;
+	lock.unlock();
+
+	return !cb || cb(*runtime);
+}
+
+void RuntimePool::runWorker() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_exit) {
+		if (!_released.empty()) {
+			auto runtime = _released.front();
+			_released.pop_front();
+			const bool keep = _ready.size() < _options.size;
+			lock.unlock();
+
+			auto success = keep && reset(runtime);
+
+			lock.lock();
+			if (keep) {
+				++ _stats.resets;
+			}
+			if (success && _ready.size() < _options.size) {
+				_ready.emplace_back(runtime);
+			} else {
+				lock.unlock();
+				delete runtime;
+				lock.lock();
+			}
+		} else if (_ready.size() < (_options.size + 1) / 2) {
+			// new instances are created below low watermark, above it pool waits for released instances
+			lock.unlock();
+			auto runtime = create();
+			lock.lock();
+			if (!runtime) {
+				// do not spin on failed creation, retry on next acquire or release
+				_cond.wait(lock);
+			} else if (_ready.size() < _options.size && !_exit) {
+				_ready.emplace_back(runtime);
+			} else {
+				lock.unlock();
+				delete runtime;
+				lock.lock();
+			}
+		} else {
+			_cond.wait(lock);
+		}
+	}
+}
+
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_RUNTIMEPOOL_H_
+#define SRC_RUNTIMEPOOL_H_
+
+#include "ThreadedRuntime.h"
+#include <deque>
+#include <thread>
+
+namespace wasm {
+
+struct RuntimePoolOptions : LinkingThreadOptions {
+	// number of initialized instances, kept ready for acquire; when less than half of them is ready,
+	// new instances are created from snapshot, otherwise released instances are reused
+	uint32_t size = 4;
+};
+
+// Pool of pre-initialized ThreadedRuntime instances for per-request isolation. Instances are created
+// from snapshot of warmed-up runtime; released instances are reset to it on background thread,
+// so acquire does not pay for Runtime::init on request path.
+class RuntimePool {
+public:
+	// called once, on instance, that becomes source of snapshot
+	using WarmUpCallback = Function<bool(ThreadedRuntime &)>;
+
+	// called on background thread after instance and its main thread were reset;
+	// instance is destroyed, when false is returned
+	using ResetCallback = Function<bool(ThreadedRuntime &)>;
+
+	struct Stats {
+		uint64_t hits = 0; // acquired from ready instances
+		uint64_t misses = 0; // created on acquire, when there was no ready instance
+		uint64_t resets = 0;
+		uint32_t ready = 0;
+		uint32_t active = 0; // acquired and not released
+	};
+
+	~RuntimePool();
+	RuntimePool() { }
+
+	bool init(const Environment *, const RuntimePoolOptions & = RuntimePoolOptions(), const WarmUpCallback & = nullptr);
+
+	void setResetCallback(const ResetCallback &);
+
+	// can be called from any thread; returns nullptr, when instance can not be created
+	ThreadedRuntime *acquire();
+	void release(ThreadedRuntime *);
+
+	// number of ready instances to keep
+	void setSize(uint32_t);
+	uint32_t getSize() const;
+
+	Stats getStats() const;
+
+	const RuntimeSnapshot &getSnapshot() const;
+
+	// destroys ready instances; instances, released after stop, are destroyed
+	void stop();
+
+protected:
+	ThreadedRuntime *create();
+	bool reset(ThreadedRuntime *);
+
+	void runWorker();
+
+	const Environment *_env = nullptr;
+	RuntimePoolOptions _options;
+	RuntimeSnapshot _snapshot;
+	uint32_t _userStackPointer = 0;
+	uint32_t _userStackGuard = 0;
+
+	std::thread _worker;
+
+	mutable std::mutex _mutex; // guards fields below
+	std::condition_variable _cond;
+	ResetCallback _resetCallback;
+	Vector<ThreadedRuntime *> _ready;
+	std::deque<ThreadedRuntime *> _released;
+	Stats _stats;
+	bool _exit = false;
+};
+
+}
+
+#endif /* SRC_RUNTIMEPOOL_H_ */
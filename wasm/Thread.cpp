@@ -24,6 +24,7 @@
 
 #include "ThreadOps.cc"
 #include "ThreadUtils.cc"
+#include "ThreadSimd.cc"
 
 namespace wasm {
 
@@ -31,6 +32,10 @@ Thread::Result Thread::Run(Index stackMax) {
 	Result result = Result::Ok;
 	while (_callStackTop > stackMax) {
 		TrySync();
+		if (WABT_UNLIKELY(Watchdog::getEpoch() >= _checkEpoch.load(std::memory_order_relaxed))) {
+			// frame positions are consistent here, between calls and returns
+			CHECK_TRAP(CheckEpoch());
+		}
 		_currentFrame = &_callStack[_callStackTop - 1];
 		const auto func = _currentFrame->func;
 		const auto module = _currentFrame->module;
@@ -177,6 +182,35 @@ Thread::Result Thread::Run(Index stackMax) {
 				break;
 			}
 
+			case Opcode::ReturnCall: {
+				auto result = ReplaceCall(*module, it->value32.v1, it->value32.v2);
+				switch (result) {
+				case Result::Ok: goto exit_opcode_loop; break; // frame was replaced with callee
+				case Result::Returned: it = end; continue; break; // host function results are ours
+				default: return result; break;
+				}
+				break;
+			}
+
+			case Opcode::ReturnCallIndirect: {
+				RuntimeTable* table = module->tables[it->value32.v2];
+				auto reqSig = module->module->getSignature(it->value32.v1);
+				Index entry_index = Pop<uint32_t>();
+				TRAP_IF(entry_index >= table->values.size(), UndefinedTableIndex);
+				Index func_index = table->values[entry_index].i32;
+				TRAP_IF(func_index == kInvalidIndex, UninitializedTableElement);
+				auto sig = module->module->getFuncSignature(func_index);
+				TRAP_IF(sig.first == nullptr, IndirectCallSignatureMismatch);
+				TRAP_UNLESS(_runtime->isSignatureMatch(*sig.first, *reqSig), IndirectCallSignatureMismatch);
+				auto result = ReplaceCall(*module, func_index, sig.second);
+				switch (result) {
+				case Result::Ok: goto exit_opcode_loop; break; // frame was replaced with callee
+				case Result::Returned: it = end; continue; break; // host function results are ours
+				default: return result; break;
+				}
+				break;
+			}
+
 			case Opcode::I32Load8S:
 				CHECK_TRAP(Load<int8_t, uint32_t>(it));
 				break;
@@ -269,6 +303,133 @@ Thread::Result Thread::Run(Index stackMax) {
 				CHECK_TRAP(Store<double>(it));
 				break;
 
+			case Opcode::InterpChargeFuel:
+				if (WABT_UNLIKELY(_fuel < it->value32.v1)) {
+					CHECK_TRAP(ChargeFuel(it->value32.v1));
+				} else {
+					_fuel -= it->value32.v1;
+				}
+				break;
+
+			case Opcode::InterpCheckEpoch:
+				if (WABT_UNLIKELY(Watchdog::getEpoch() >= _checkEpoch.load(std::memory_order_relaxed))) {
+					CHECK_TRAP(CheckEpoch());
+				}
+				break;
+
+			case Opcode::InterpLoopGuard: {
+				// see BinaryOptimize.cc for guard layout
+				if (it->value32.v2 != kInvalidIndex) {
+					const auto bound = it + 1;
+					const auto extent = it + 2;
+					const auto memory = module->memory[extent->value32.v2];
+					uint64_t first = locals[it->value32.v1].i32;
+					uint64_t last = (bound->value32.v2 & Func::LoopGuardConstBound) ? bound->value32.v1 : locals[bound->value32.v1].i32;
+					if ((bound->value32.v2 & Func::LoopGuardInclusiveBound) == 0 && last > 0) {
+						-- last;
+					}
+					if (first + extent->value32.v1 <= memory->size && last + extent->value32.v1 <= memory->size) {
+						it = data + it->value32.v2;
+						continue;
+					}
+				}
+				it += 3;
+				continue;
+				break;
+			}
+
+			case Opcode::I32Load8SUnchecked:
+				CHECK_TRAP(LoadUnchecked<int8_t, uint32_t>(it));
+				break;
+
+			case Opcode::I32Load8UUnchecked:
+				CHECK_TRAP(LoadUnchecked<uint8_t, uint32_t>(it));
+				break;
+
+			case Opcode::I32Load16SUnchecked:
+				CHECK_TRAP(LoadUnchecked<int16_t, uint32_t>(it));
+				break;
+
+			case Opcode::I32Load16UUnchecked:
+				CHECK_TRAP(LoadUnchecked<uint16_t, uint32_t>(it));
+				break;
+
+			case Opcode::I64Load8SUnchecked:
+				CHECK_TRAP(LoadUnchecked<int8_t, uint64_t>(it));
+				break;
+
+			case Opcode::I64Load8UUnchecked:
+				CHECK_TRAP(LoadUnchecked<uint8_t, uint64_t>(it));
+				break;
+
+			case Opcode::I64Load16SUnchecked:
+				CHECK_TRAP(LoadUnchecked<int16_t, uint64_t>(it));
+				break;
+
+			case Opcode::I64Load16UUnchecked:
+				CHECK_TRAP(LoadUnchecked<uint16_t, uint64_t>(it));
+				break;
+
+			case Opcode::I64Load32SUnchecked:
+				CHECK_TRAP(LoadUnchecked<int32_t, uint64_t>(it));
+				break;
+
+			case Opcode::I64Load32UUnchecked:
+				CHECK_TRAP(LoadUnchecked<uint32_t, uint64_t>(it));
+				break;
+
+			case Opcode::I32LoadUnchecked:
+				CHECK_TRAP(LoadUnchecked<uint32_t>(it));
+				break;
+
+			case Opcode::I64LoadUnchecked:
+				CHECK_TRAP(LoadUnchecked<uint64_t>(it));
+				break;
+
+			case Opcode::F32LoadUnchecked:
+				CHECK_TRAP(LoadUnchecked<float>(it));
+				break;
+
+			case Opcode::F64LoadUnchecked:
+				CHECK_TRAP(LoadUnchecked<double>(it));
+				break;
+
+			case Opcode::I32Store8Unchecked:
+				StoreUnchecked<uint8_t, uint32_t>(it);
+				break;
+
+			case Opcode::I32Store16Unchecked:
+				StoreUnchecked<uint16_t, uint32_t>(it);
+				break;
+
+			case Opcode::I64Store8Unchecked:
+				StoreUnchecked<uint8_t, uint64_t>(it);
+				break;
+
+			case Opcode::I64Store16Unchecked:
+				StoreUnchecked<uint16_t, uint64_t>(it);
+				break;
+
+			case Opcode::I64Store32Unchecked:
+				StoreUnchecked<uint32_t, uint64_t>(it);
+				break;
+
+			case Opcode::I32StoreUnchecked:
+				StoreUnchecked<uint32_t>(it);
+				break;
+
+			case Opcode::I64StoreUnchecked:
+				StoreUnchecked<uint64_t>(it);
+				break;
+
+			case Opcode::F32StoreUnchecked:
+				StoreUnchecked<float>(it);
+				break;
+
+			case Opcode::F64StoreUnchecked:
+				StoreUnchecked<double>(it);
+				break;
+
 			case Opcode::I32AtomicLoad8U:
 				CHECK_TRAP(AtomicLoad<uint8_t, uint32_t>(it));
 				break;
@@ -333,27 +494,27 @@ Thread::Result Thread::Run(Index stackMax) {
 				CHECK_TRAP(AtomicRmw<uint64_t, uint64_t>(func<uint64_t>, it)); \
 				break;                                                          \
 			case Opcode::I32AtomicRmw8U##rmwop:                               \
-				CHECK_TRAP(AtomicRmw<uint8_t, uint32_t>(func<uint32_t>, it));  \
+				CHECK_TRAP(AtomicRmw<uint8_t, uint32_t>(func<uint8_t>, it));   \
 				break;                                                          \
 			case Opcode::I32AtomicRmw16U##rmwop:                              \
-				CHECK_TRAP(AtomicRmw<uint16_t, uint32_t>(func<uint32_t>, it)); \
+				CHECK_TRAP(AtomicRmw<uint16_t, uint32_t>(func<uint16_t>, it)); \
 				break;                                                          \
 			case Opcode::I64AtomicRmw8U##rmwop:                               \
-				CHECK_TRAP(AtomicRmw<uint8_t, uint64_t>(func<uint64_t>, it));  \
+				CHECK_TRAP(AtomicRmw<uint8_t, uint64_t>(func<uint8_t>, it));   \
 				break;                                                          \
 			case Opcode::I64AtomicRmw16U##rmwop:                              \
-				CHECK_TRAP(AtomicRmw<uint16_t, uint64_t>(func<uint64_t>, it)); \
+				CHECK_TRAP(AtomicRmw<uint16_t, uint64_t>(func<uint16_t>, it)); \
 				break;                                                          \
 			case Opcode::I64AtomicRmw32U##rmwop:                              \
-				CHECK_TRAP(AtomicRmw<uint32_t, uint64_t>(func<uint64_t>, it)); \
+				CHECK_TRAP(AtomicRmw<uint32_t, uint64_t>(func<uint32_t>, it)); \
 				break /* no semicolon */
 
-			ATOMIC_RMW(Add, Add);
-			ATOMIC_RMW(Sub, Sub);
-			ATOMIC_RMW(And, IntAnd);
-			ATOMIC_RMW(Or, IntOr);
-			ATOMIC_RMW(Xor, IntXor);
-			ATOMIC_RMW(Xchg, Xchg);
+			ATOMIC_RMW(Add, AtomicFetchAdd);
+			ATOMIC_RMW(Sub, AtomicFetchSub);
+			ATOMIC_RMW(And, AtomicFetchAnd);
+			ATOMIC_RMW(Or, AtomicFetchOr);
+			ATOMIC_RMW(Xor, AtomicFetchXor);
+			ATOMIC_RMW(Xchg, AtomicExchange);
 
 #undef ATOMIC_RMW
 
@@ -400,6 +561,22 @@ Thread::Result Thread::Run(Index stackMax) {
 				break;
 			}
 
+			case Opcode::MemoryInit:
+				CHECK_TRAP(MemoryInit(it));
+				break;
+
+			case Opcode::DataDrop:
+				DataDrop(it);
+				break;
+
+			case Opcode::MemoryCopy:
+				CHECK_TRAP(MemoryCopy(it));
+				break;
+
+			case Opcode::MemoryFill:
+				CHECK_TRAP(MemoryFill(it));
+				break;
+
 			case Opcode::I32Add:
 				CHECK_TRAP(Binop(Add<uint32_t>));
 				break;
@@ -964,6 +1141,572 @@ Thread::Result Thread::Run(Index stackMax) {
 				CHECK_TRAP(Unop(IntExtendS<uint64_t, int32_t>));
 				break;
 
+			case Opcode::V128Load:
+				CHECK_TRAP(SimdLoad(it));
+				break;
+
+			case Opcode::V128Store:
+				CHECK_TRAP(SimdStore(it));
+				break;
+
+			case Opcode::V128Const:
+				CHECK_TRAP(PushRep<V128>(V128{it->value64, (it + 1)->value64}));
+				++ it;
+				break;
+
+			case Opcode::I8X16Shuffle:
+				CHECK_TRAP(SimdShuffle(it));
+				++ it;
+				break;
+
+			case Opcode::I8X16Swizzle:
+				CHECK_TRAP(Binop(s_simdDispatch.swizzle));
+				break;
+
+			case Opcode::I8X16Splat:
+				CHECK_TRAP(Unop(SimdSplat<uint8_t, uint32_t>));
+				break;
+
+			case Opcode::I16X8Splat:
+				CHECK_TRAP(Unop(SimdSplat<uint16_t, uint32_t>));
+				break;
+
+			case Opcode::I32X4Splat:
+				CHECK_TRAP(Unop(SimdSplat<uint32_t, uint32_t>));
+				break;
+
+			case Opcode::I64X2Splat:
+				CHECK_TRAP(Unop(SimdSplat<uint64_t, uint64_t>));
+				break;
+
+			case Opcode::F32X4Splat:
+				CHECK_TRAP(Unop(SimdSplat<float, float>));
+				break;
+
+			case Opcode::F64X2Splat:
+				CHECK_TRAP(Unop(SimdSplat<double, double>));
+				break;
+
+			case Opcode::I8X16ExtractLaneS:
+				CHECK_TRAP((SimdExtractLane<int8_t, int32_t>(it)));
+				break;
+
+			case Opcode::I8X16ExtractLaneU:
+				CHECK_TRAP((SimdExtractLane<uint8_t, uint32_t>(it)));
+				break;
+
+			case Opcode::I8X16ReplaceLane:
+				CHECK_TRAP((SimdReplaceLane<uint8_t, uint32_t>(it)));
+				break;
+
+			case Opcode::I16X8ExtractLaneS:
+				CHECK_TRAP((SimdExtractLane<int16_t, int32_t>(it)));
+				break;
+
+			case Opcode::I16X8ExtractLaneU:
+				CHECK_TRAP((SimdExtractLane<uint16_t, uint32_t>(it)));
+				break;
+
+			case Opcode::I16X8ReplaceLane:
+				CHECK_TRAP((SimdReplaceLane<uint16_t, uint32_t>(it)));
+				break;
+
+			case Opcode::I32X4ExtractLane:
+				CHECK_TRAP((SimdExtractLane<uint32_t, uint32_t>(it)));
+				break;
+
+			case Opcode::I32X4ReplaceLane:
+				CHECK_TRAP((SimdReplaceLane<uint32_t, uint32_t>(it)));
+				break;
+
+			case Opcode::I64X2ExtractLane:
+				CHECK_TRAP((SimdExtractLane<uint64_t, uint64_t>(it)));
+				break;
+
+			case Opcode::I64X2ReplaceLane:
+				CHECK_TRAP((SimdReplaceLane<uint64_t, uint64_t>(it)));
+				break;
+
+			case Opcode::F32X4ExtractLane:
+				CHECK_TRAP((SimdExtractLane<float, float>(it)));
+				break;
+
+			case Opcode::F32X4ReplaceLane:
+				CHECK_TRAP((SimdReplaceLane<float, float>(it)));
+				break;
+
+			case Opcode::F64X2ExtractLane:
+				CHECK_TRAP((SimdExtractLane<double, double>(it)));
+				break;
+
+			case Opcode::F64X2ReplaceLane:
+				CHECK_TRAP((SimdReplaceLane<double, double>(it)));
+				break;
+
+			case Opcode::I8X16Eq:
+				CHECK_TRAP(Binop(SimdEq<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16Ne:
+				CHECK_TRAP(Binop(SimdNe<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16LtS:
+				CHECK_TRAP(Binop(SimdLt<simd_i8x16>));
+				break;
+
+			case Opcode::I8X16LtU:
+				CHECK_TRAP(Binop(SimdLt<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16GtS:
+				CHECK_TRAP(Binop(SimdGt<simd_i8x16>));
+				break;
+
+			case Opcode::I8X16GtU:
+				CHECK_TRAP(Binop(SimdGt<simd_u8x16>));
+				break;
+
+			case Opcode::I16X8Eq:
+				CHECK_TRAP(Binop(SimdEq<simd_u16x8>));
+				break;
+
+			case Opcode::I16X8Ne:
+				CHECK_TRAP(Binop(SimdNe<simd_u16x8>));
+				break;
+
+			case Opcode::I32X4Eq:
+				CHECK_TRAP(Binop(SimdEq<simd_u32x4>));
+				break;
+
+			case Opcode::I32X4Ne:
+				CHECK_TRAP(Binop(SimdNe<simd_u32x4>));
+				break;
+
+			case Opcode::I32X4LtS:
+				CHECK_TRAP(Binop(SimdLt<simd_i32x4>));
+				break;
+
+			case Opcode::I32X4LtU:
+				CHECK_TRAP(Binop(SimdLt<simd_u32x4>));
+				break;
+
+			case Opcode::I32X4GtS:
+				CHECK_TRAP(Binop(SimdGt<simd_i32x4>));
+				break;
+
+			case Opcode::I32X4GtU:
+				CHECK_TRAP(Binop(SimdGt<simd_u32x4>));
+				break;
+
+			case Opcode::F32X4Eq:
+				CHECK_TRAP(Binop(SimdEq<simd_f32x4>));
+				break;
+
+			case Opcode::F32X4Ne:
+				CHECK_TRAP(Binop(SimdNe<simd_f32x4>));
+				break;
+
+			case Opcode::F32X4Lt:
+				CHECK_TRAP(Binop(SimdLt<simd_f32x4>));
+				break;
+
+			case Opcode::F32X4Gt:
+				CHECK_TRAP(Binop(SimdGt<simd_f32x4>));
+				break;
+
+			case Opcode::F32X4Le:
+				CHECK_TRAP(Binop(SimdLe<simd_f32x4>));
+				break;
+
+			case Opcode::F32X4Ge:
+				CHECK_TRAP(Binop(SimdGe<simd_f32x4>));
+				break;
+
+			case Opcode::V128Not:
+				CHECK_TRAP(Unop(SimdNot));
+				break;
+
+			case Opcode::V128And:
+				CHECK_TRAP(Binop(SimdAnd));
+				break;
+
+			case Opcode::V128Andnot:
+				CHECK_TRAP(Binop(SimdAndNot));
+				break;
+
+			case Opcode::V128Or:
+				CHECK_TRAP(Binop(SimdOr));
+				break;
+
+			case Opcode::V128Xor:
+				CHECK_TRAP(Binop(SimdXor));
+				break;
+
+			case Opcode::V128BitSelect:
+				CHECK_TRAP(SimdTernop(SimdBitSelect));
+				break;
+
+			case Opcode::V128AnyTrue:
+				CHECK_TRAP(Unop(SimdAnyTrue));
+				break;
+
+			case Opcode::I8X16Abs:
+				CHECK_TRAP(Unop(SimdAbs<simd_i8x16, simd_u8x16>));
+				break;
+
+			case Opcode::I8X16Neg:
+				CHECK_TRAP(Unop(SimdNeg<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16AllTrue:
+				CHECK_TRAP(Unop(SimdAllTrue<uint8_t>));
+				break;
+
+			case Opcode::I8X16NarrowI16X8S:
+				CHECK_TRAP(Binop(SimdNarrow<int8_t, int16_t>));
+				break;
+
+			case Opcode::I8X16NarrowI16X8U:
+				CHECK_TRAP(Binop(SimdNarrow<uint8_t, int16_t>));
+				break;
+
+			case Opcode::I8X16Shl:
+				CHECK_TRAP(SimdShift(SimdShl<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16ShrS:
+				CHECK_TRAP(SimdShift(SimdShr<simd_i8x16>));
+				break;
+
+			case Opcode::I8X16ShrU:
+				CHECK_TRAP(SimdShift(SimdShr<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16Add:
+				CHECK_TRAP(Binop(SimdAdd<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16AddSatS:
+				CHECK_TRAP(Binop(SimdAddSat<int8_t, int32_t>));
+				break;
+
+			case Opcode::I8X16AddSatU:
+				CHECK_TRAP(Binop(SimdAddSat<uint8_t, int32_t>));
+				break;
+
+			case Opcode::I8X16Sub:
+				CHECK_TRAP(Binop(SimdSub<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16SubSatS:
+				CHECK_TRAP(Binop(SimdSubSat<int8_t, int32_t>));
+				break;
+
+			case Opcode::I8X16SubSatU:
+				CHECK_TRAP(Binop(SimdSubSat<uint8_t, int32_t>));
+				break;
+
+			case Opcode::I8X16MinS:
+				CHECK_TRAP(Binop(s_simdDispatch.i8x16MinS));
+				break;
+
+			case Opcode::I8X16MinU:
+				CHECK_TRAP(Binop(SimdMin<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16MaxS:
+				CHECK_TRAP(Binop(s_simdDispatch.i8x16MaxS));
+				break;
+
+			case Opcode::I8X16MaxU:
+				CHECK_TRAP(Binop(SimdMax<simd_u8x16>));
+				break;
+
+			case Opcode::I8X16AvgrU:
+				CHECK_TRAP(Binop(SimdAvgr<uint8_t>));
+				break;
+
+			case Opcode::I16X8Abs:
+				CHECK_TRAP(Unop(SimdAbs<simd_i16x8, simd_u16x8>));
+				break;
+
+			case Opcode::I16X8Neg:
+				CHECK_TRAP(Unop(SimdNeg<simd_u16x8>));
+				break;
+
+			case Opcode::I16X8AllTrue:
+				CHECK_TRAP(Unop(SimdAllTrue<uint16_t>));
+				break;
+
+			case Opcode::I16X8NarrowI32X4S:
+				CHECK_TRAP(Binop(SimdNarrow<int16_t, int32_t>));
+				break;
+
+			case Opcode::I16X8NarrowI32X4U:
+				CHECK_TRAP(Binop(s_simdDispatch.i16x8NarrowU));
+				break;
+
+			case Opcode::I16X8ExtendLowI8X16S:
+				CHECK_TRAP(Unop(SimdExtend<int16_t, int8_t, 0>));
+				break;
+
+			case Opcode::I16X8ExtendHighI8X16S:
+				CHECK_TRAP(Unop(SimdExtend<int16_t, int8_t, 8>));
+				break;
+
+			case Opcode::I16X8ExtendLowI8X16U:
+				CHECK_TRAP(Unop(SimdExtend<uint16_t, uint8_t, 0>));
+				break;
+
+			case Opcode::I16X8ExtendHighI8X16U:
+				CHECK_TRAP(Unop(SimdExtend<uint16_t, uint8_t, 8>));
+				break;
+
+			case Opcode::I16X8Shl:
+				CHECK_TRAP(SimdShift(SimdShl<simd_u16x8>));
+				break;
+
+			case Opcode::I16X8ShrS:
+				CHECK_TRAP(SimdShift(SimdShr<simd_i16x8>));
+				break;
+
+			case Opcode::I16X8ShrU:
+				CHECK_TRAP(SimdShift(SimdShr<simd_u16x8>));
+				break;
+
+			case Opcode::I16X8Add:
+				CHECK_TRAP(Binop(SimdAdd<simd_u16x8>));
+				break;
+
+			case Opcode::I16X8AddSatS:
+				CHECK_TRAP(Binop(SimdAddSat<int16_t, int32_t>));
+				break;
+
+			case Opcode::I16X8AddSatU:
+				CHECK_TRAP(Binop(SimdAddSat<uint16_t, int32_t>));
+				break;
+
+			case Opcode::I16X8Sub:
+				CHECK_TRAP(Binop(SimdSub<simd_u16x8>));
+				break;
+
+			case Opcode::I16X8SubSatS:
+				CHECK_TRAP(Binop(SimdSubSat<int16_t, int32_t>));
+				break;
+
+			case Opcode::I16X8SubSatU:
+				CHECK_TRAP(Binop(SimdSubSat<uint16_t, int32_t>));
+				break;
+
+			case Opcode::I16X8Mul:
+				CHECK_TRAP(Binop(SimdMul<simd_u16x8>));
+				break;
+
+			case Opcode::I16X8MinS:
+				CHECK_TRAP(Binop(SimdMin<simd_i16x8>));
+				break;
+
+			case Opcode::I16X8MinU:
+				CHECK_TRAP(Binop(s_simdDispatch.i16x8MinU));
+				break;
+
+			case Opcode::I16X8MaxS:
+				CHECK_TRAP(Binop(SimdMax<simd_i16x8>));
+				break;
+
+			case Opcode::I16X8MaxU:
+				CHECK_TRAP(Binop(s_simdDispatch.i16x8MaxU));
+				break;
+
+			case Opcode::I16X8AvgrU:
+				CHECK_TRAP(Binop(SimdAvgr<uint16_t>));
+				break;
+
+			case Opcode::I32X4Abs:
+				CHECK_TRAP(Unop(SimdAbs<simd_i32x4, simd_u32x4>));
+				break;
+
+			case Opcode::I32X4Neg:
+				CHECK_TRAP(Unop(SimdNeg<simd_u32x4>));
+				break;
+
+			case Opcode::I32X4AllTrue:
+				CHECK_TRAP(Unop(SimdAllTrue<uint32_t>));
+				break;
+
+			case Opcode::I32X4ExtendLowI16X8S:
+				CHECK_TRAP(Unop(SimdExtend<int32_t, int16_t, 0>));
+				break;
+
+			case Opcode::I32X4ExtendHighI16X8S:
+				CHECK_TRAP(Unop(SimdExtend<int32_t, int16_t, 4>));
+				break;
+
+			case Opcode::I32X4ExtendLowI16X8U:
+				CHECK_TRAP(Unop(SimdExtend<uint32_t, uint16_t, 0>));
+				break;
+
+			case Opcode::I32X4ExtendHighI16X8U:
+				CHECK_TRAP(Unop(SimdExtend<uint32_t, uint16_t, 4>));
+				break;
+
+			case Opcode::I32X4Shl:
+				CHECK_TRAP(SimdShift(SimdShl<simd_u32x4>));
+				break;
+
+			case Opcode::I32X4ShrS:
+				CHECK_TRAP(SimdShift(SimdShr<simd_i32x4>));
+				break;
+
+			case Opcode::I32X4ShrU:
+				CHECK_TRAP(SimdShift(SimdShr<simd_u32x4>));
+				break;
+
+			case Opcode::I32X4Add:
+				CHECK_TRAP(Binop(SimdAdd<simd_u32x4>));
+				break;
+
+			case Opcode::I32X4Sub:
+				CHECK_TRAP(Binop(SimdSub<simd_u32x4>));
+				break;
+
+			case Opcode::I32X4Mul:
+				CHECK_TRAP(Binop(s_simdDispatch.i32x4Mul));
+				break;
+
+			case Opcode::I32X4MinS:
+				CHECK_TRAP(Binop(s_simdDispatch.i32x4MinS));
+				break;
+
+			case Opcode::I32X4MinU:
+				CHECK_TRAP(Binop(s_simdDispatch.i32x4MinU));
+				break;
+
+			case Opcode::I32X4MaxS:
+				CHECK_TRAP(Binop(s_simdDispatch.i32x4MaxS));
+				break;
+
+			case Opcode::I32X4MaxU:
+				CHECK_TRAP(Binop(s_simdDispatch.i32x4MaxU));
+				break;
+
+			case Opcode::I64X2Neg:
+				CHECK_TRAP(Unop(SimdNeg<simd_u64x2>));
+				break;
+
+			case Opcode::I64X2Shl:
+				CHECK_TRAP(SimdShift(SimdShl<simd_u64x2>));
+				break;
+
+			case Opcode::I64X2ShrS:
+				CHECK_TRAP(SimdShift(SimdShr<simd_i64x2>));
+				break;
+
+			case Opcode::I64X2ShrU:
+				CHECK_TRAP(SimdShift(SimdShr<simd_u64x2>));
+				break;
+
+			case Opcode::I64X2Add:
+				CHECK_TRAP(Binop(SimdAdd<simd_u64x2>));
+				break;
+
+			case Opcode::I64X2Sub:
+				CHECK_TRAP(Binop(SimdSub<simd_u64x2>));
+				break;
+
+			case Opcode::I64X2Mul:
+				CHECK_TRAP(Binop(SimdMul<simd_u64x2>));
+				break;
+
+			case Opcode::F32X4Abs:
+				CHECK_TRAP(Unop(SimdF32X4Abs));
+				break;
+
+			case Opcode::F32X4Neg:
+				CHECK_TRAP(Unop(SimdF32X4Neg));
+				break;
+
+			case Opcode::F32X4Sqrt:
+				CHECK_TRAP(Unop(SimdFloatUnop<float, FloatSqrt<float>>));
+				break;
+
+			case Opcode::F32X4Add:
+				CHECK_TRAP(Binop(SimdAdd<simd_f32x4>));
+				break;
+
+			case Opcode::F32X4Sub:
+				CHECK_TRAP(Binop(SimdSub<simd_f32x4>));
+				break;
+
+			case Opcode::F32X4Mul:
+				CHECK_TRAP(Binop(SimdMul<simd_f32x4>));
+				break;
+
+			case Opcode::F32X4Div:
+				CHECK_TRAP(Binop(SimdDiv<simd_f32x4>));
+				break;
+
+			case Opcode::F32X4Min:
+				CHECK_TRAP(Binop(SimdFloatBinop<float, FloatMin<float>>));
+				break;
+
+			case Opcode::F32X4Max:
+				CHECK_TRAP(Binop(SimdFloatBinop<float, FloatMax<float>>));
+				break;
+
+			case Opcode::F64X2Abs:
+				CHECK_TRAP(Unop(SimdF64X2Abs));
+				break;
+
+			case Opcode::F64X2Neg:
+				CHECK_TRAP(Unop(SimdF64X2Neg));
+				break;
+
+			case Opcode::F64X2Sqrt:
+				CHECK_TRAP(Unop(SimdFloatUnop<double, FloatSqrt<double>>));
+				break;
+
+			case Opcode::F64X2Add:
+				CHECK_TRAP(Binop(SimdAdd<simd_f64x2>));
+				break;
+
+			case Opcode::F64X2Sub:
+				CHECK_TRAP(Binop(SimdSub<simd_f64x2>));
+				break;
+
+			case Opcode::F64X2Mul:
+				CHECK_TRAP(Binop(SimdMul<simd_f64x2>));
+				break;
+
+			case Opcode::F64X2Div:
+				CHECK_TRAP(Binop(SimdDiv<simd_f64x2>));
+				break;
+
+			case Opcode::F64X2Min:
+				CHECK_TRAP(Binop(SimdFloatBinop<double, FloatMin<double>>));
+				break;
+
+			case Opcode::F64X2Max:
+				CHECK_TRAP(Binop(SimdFloatBinop<double, FloatMax<double>>));
+				break;
+
+			case Opcode::I32X4TruncSatF32X4S:
+				CHECK_TRAP(Unop(SimdTruncSat<int32_t>));
+				break;
+
+			case Opcode::I32X4TruncSatF32X4U:
+				CHECK_TRAP(Unop(SimdTruncSat<uint32_t>));
+				break;
+
+			case Opcode::F32X4ConvertI32X4S:
+				CHECK_TRAP(Unop(SimdConvert<int32_t>));
+				break;
+
+			case Opcode::F32X4ConvertI32X4U:
+				CHECK_TRAP(Unop(SimdConvert<uint32_t>));
+				break;
+
 			case Opcode::Drop:
 				(void)Pop();
 				break;
@@ -972,10 +1715,15 @@ Thread::Result Thread::Run(Index stackMax) {
 				break;
 
 			case Opcode::I32AtomicWait:
+				CHECK_TRAP(AtomicWait<uint32_t>(it));
+				break;
+
 			case Opcode::I64AtomicWait:
+				CHECK_TRAP(AtomicWait<uint64_t>(it));
+				break;
+
 			case Opcode::AtomicWake:
-				// TODO(binji): Implement.
-				TRAP(Unreachable);
+				CHECK_TRAP(AtomicNotify(it));
 				break;
 
 				// The following opcodes are either never generated or should never be
@@ -21,7 +21,9 @@
 #include <shared_mutex>
 #include <atomic>
 #include <condition_variable>
-#include "Module.h"
+#include <chrono>
+#include <thread>
+#include "CodeCache.h"
 
 #define WABT_WARN_UNUSED __attribute__ ((warn_unused_result))
 
@@ -31,6 +33,10 @@ namespace wasm {
 	V(Ok, "ok")                                                               \
 	/* returned from the top-most function */                                 \
 	V(Returned, "returned")                                                   \
+	/* host function suspended the thread, see Thread::Resume */              \
+	V(Suspended, "suspended")                                                 \
+	/* time slice of suspendable thread is over, see Thread::Resume */        \
+	V(Preempted, "preempted")                                                 \
 	/* memory access is out of bounds */                                      \
 	V(TrapMemoryAccessOutOfBounds, "out of bounds memory access")             \
 	/* atomic memory access is unaligned  */                                  \
@@ -55,6 +61,14 @@ namespace wasm {
 	V(TrapValueStackExhausted, "value stack exhausted")                       \
 	/* ran out of value stack space */                                        \
 	V(TrapUserStackExhausted, "user stack exhausted")                         \
+	/* fuel limit for the call was reached */                                 \
+	V(TrapFuelExhausted, "fuel exhausted")                                    \
+	/* deadline was reached or thread was interrupted by Thread::interrupt */ \
+	V(TrapInterrupted, "interrupted")                                         \
+	/* atomic wait on memory, that is not shared */                           \
+	V(TrapExpectedSharedMemory, "expected shared memory")                     \
+	/* body of lazily translated function failed validation */               \
+	V(TrapInvalidFunction, "invalid function")                                \
 	/* we called a host function, but the return value didn't match the */    \
 	/* expected type */                                                       \
 	V(TrapHostResultTypeMismatch, "host result type mismatch")                \
@@ -76,6 +90,78 @@ struct ThreadContext {
 	std::condition_variable_any cond;
 };
 
+// Process-wide epoch counter; watchdog thread increments it every tick while there are
+// active deadlines, and threads compare it with their deadline epoch on loop back-edges and calls
+class Watchdog {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr Clock::duration kDefaultTick = std::chrono::milliseconds(1);
+
+	static Watchdog *getInstance();
+
+	static uint64_t getEpoch() { return s_epoch.load(std::memory_order_relaxed); }
+
+	// returns deadline epoch, reached after timeout (rounded up to tick);
+	// every acquire should be followed by release, when deadline is no longer needed
+	uint64_t acquire(Clock::duration timeout);
+	void release();
+
+	void setTick(Clock::duration);
+	Clock::duration getTick() const;
+
+private:
+	Watchdog() { }
+	~Watchdog();
+
+	void run();
+
+	static std::atomic<uint64_t> s_epoch;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _cond;
+	std::thread _thread;
+	Clock::duration _tick = kDefaultTick;
+	size_t _active = 0;
+	bool _exit = false;
+};
+
+// Process-wide parking table for atomic wait/notify; waiters are keyed by (memory, address)
+// and hashed into buckets, each with its own mutex and condition variable
+class AtomicWaitTable {
+public:
+	static constexpr size_t kBucketsCount = 256;
+
+	struct Waiter {
+		const RuntimeMemory *memory;
+		uint32_t address;
+		bool notified;
+		Waiter *next;
+	};
+
+	struct Bucket {
+		std::mutex mutex;
+		std::condition_variable cond;
+		Waiter *waiters = nullptr; // FIFO list, guarded by mutex
+	};
+
+	static AtomicWaitTable *getInstance();
+
+	Bucket &getBucket(const RuntimeMemory *, uint32_t address);
+
+	// should be called with bucket mutex locked
+	void park(Bucket &, Waiter &);
+	void unpark(Bucket &, Waiter &);
+
+	// wakes up to count waiters in FIFO order, returns number of woken waiters
+	uint32_t notify(const RuntimeMemory *, uint32_t address, uint32_t count);
+
+private:
+	AtomicWaitTable() { }
+
+	Bucket _buckets[kBucketsCount];
+};
+
 class Thread {
 public:
 	enum class Result {
@@ -86,6 +172,8 @@ public:
 
 	static const uint32_t kDefaultValueStackSize = 1024;
 	static const uint32_t kDefaultCallStackSize = 256;
+	static const uint64_t kUnlimitedFuel = ~uint64_t(0);
+	static const uint64_t kNoDeadline = ~uint64_t(0);
 
 	struct CallStackFrame {
 		const RuntimeModule *module = nullptr;
@@ -98,6 +186,8 @@ public:
 
 	bool init(uint32_t = kDefaultValueStackSize, uint32_t = kDefaultCallStackSize);
 
+	const Runtime *getRuntime() const;
+
 	void setSyncContext(ThreadContext *ctx);
 	ThreadContext *getSyncContext() const;
 
@@ -111,6 +201,28 @@ public:
 	uint32_t getUserStackPointer() const;
 	uint32_t getUserStackGuard() const;
 
+	// fuel is charged only by modules, loaded with Features::setFuelMetering
+	void setFuel(uint64_t);
+	uint64_t getFuel() const;
+
+	// instruction budget of time slice for suspendable thread: when slice is spent, outermost Run
+	// returns Result::Preempted (fuel is still charged against limit from setFuel); 0 - no slices
+	void setFuelSlice(uint64_t);
+	uint64_t getFuelSlice() const;
+
+	// thread traps with TrapInterrupted, when Watchdog epoch reaches deadline epoch (see Watchdog::acquire)
+	void setDeadline(uint64_t epoch);
+	uint64_t getDeadline() const;
+
+	// can be called from any thread; running code traps on next loop back-edge or call,
+	// thread, parked in atomic wait, is woken immediately
+	void interrupt();
+	bool isInterrupted() const;
+
+	// can be called from any thread; suspendable thread returns Result::Preempted on next
+	// loop back-edge (in modules with epoch interruption), call or return; ignored by other threads
+	void preempt();
+
 	Result allocStack(uint32_t size, uint32_t &result);
 	void freeStack(uint32_t size);
 
@@ -135,6 +247,22 @@ public:
 
 	Result Run(const RuntimeModule &, const Func &, Value *buffer = nullptr, bool silent = false);
 
+	// Host function can return wasm::Result::Suspend, when thread is suspendable and host call
+	// is made from outermost Run; Run returns Result::Suspended, all guest state stays in thread's
+	// stacks, and call can be continued with Resume from any OS thread. Results of the call are
+	// written into buffer, passed into Run, when call is completed.
+	void setSuspendable(bool);
+	bool isSuspendable() const;
+
+	bool isSuspended() const;
+	const HostFunc *getSuspendedFunc() const;
+
+	// results of suspended host function (as specified by its signature), nothing for preempted thread
+	Result Resume(const Value *results = nullptr);
+
+	// unwinds suspended call, as if host function was trapped
+	Result Cancel();
+
 	RuntimeMemory *GetMemoryPtr(Index memIndex) const;
 
 	uint8_t *GetMemory(Index memIndex, Index offset) const;
@@ -156,6 +284,9 @@ private:
 	template<typename MemType>
 	Result GetAtomicAccessAddress(const Func::OpcodeRec * pc, void** out_address);
 
+	template<typename MemType>
+	void *GetUncheckedAccessAddress(const Func::OpcodeRec * pc);
+
 	Value& Top();
 	Value& Pick(Index depth);
 
@@ -175,29 +306,62 @@ private:
 
 	void TrySync();
 
+	// translated code of environment's CodeCache is pinned, while call stack is not empty
+	void PinCode();
+	void UnpinCode();
+
 	Result Run(Index stackTop);
+	Result ChargeFuel(uint32_t);
+	Result CheckEpoch();
+	Result FinishRun(Result, const Func &, Value *buffer, Index origStack, Index origValue, bool silent);
 	Result PushCall(const RuntimeModule &module, const Func &func) WABT_WARN_UNUSED;
 	Result PushCall(const RuntimeModule &module, Index idx, bool import) WABT_WARN_UNUSED;
+	Result EnterCall(const RuntimeModule &module, const Func &func) WABT_WARN_UNUSED;
+	Result ReplaceCall(const RuntimeModule &module, Index idx, bool import) WABT_WARN_UNUSED;
 	void PopCall(Index);
 
 	template<typename R, typename T> using UnopFunc = R(T);
 	template<typename R, typename T> using UnopTrapFunc = Result(T, R*);
 	template<typename R, typename T> using BinopFunc = R(T, T);
 	template<typename R, typename T> using BinopTrapFunc = Result(T, T, R*);
+	template<typename T> using AtomicRmwFunc = T(T *, T);
 
 	template<typename MemType, typename ResultType = MemType>
 	Result Load(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
 	template<typename MemType, typename ResultType = MemType>
 	Result Store(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
 	template<typename MemType, typename ResultType = MemType>
+	Result LoadUnchecked(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+	template<typename MemType, typename ResultType = MemType>
+	void StoreUnchecked(const Func::OpcodeRec * pc);
+	template<typename MemType, typename ResultType = MemType>
 	Result AtomicLoad(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
 	template<typename MemType, typename ResultType = MemType>
 	Result AtomicStore(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
 	template<typename MemType, typename ResultType = MemType>
-	Result AtomicRmw(BinopFunc<ResultType, ResultType>, const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+	Result AtomicRmw(AtomicRmwFunc<MemType>, const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
 	template<typename MemType, typename ResultType = MemType>
 	Result AtomicRmwCmpxchg(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
 
+	template<typename MemType>
+	Result AtomicWait(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+	Result AtomicNotify(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+
+	Result MemoryInit(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+	void DataDrop(const Func::OpcodeRec * pc);
+	Result MemoryCopy(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+	Result MemoryFill(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+
+	Result SimdLoad(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+	Result SimdStore(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+	Result SimdShift(V128 (*func)(V128, uint32_t)) WABT_WARN_UNUSED;
+	Result SimdTernop(V128 (*func)(V128, V128, V128)) WABT_WARN_UNUSED;
+	Result SimdShuffle(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+	template<typename T, typename R>
+	Result SimdExtractLane(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+	template<typename T, typename S>
+	Result SimdReplaceLane(const Func::OpcodeRec * pc) WABT_WARN_UNUSED;
+
 	template<typename R, typename T = R>
 	Result Unop(UnopFunc<R, T> func) WABT_WARN_UNUSED;
 	template<typename R, typename T = R>
@@ -227,27 +391,62 @@ private:
 	uint32_t _userStackGuard = 0;
 	uint32_t _userContext = 0;
 	void *_threadContext = nullptr;
+
+	uint64_t _fuel = kUnlimitedFuel; // fuel of current slice
+	uint64_t _fuelReserve = 0; // fuel for next slices
+	uint64_t _fuelSlice = 0;
+
+	std::atomic<uint64_t> _deadline = ATOMIC_VAR_INIT(kNoDeadline);
+	std::atomic<uint64_t> _checkEpoch = ATOMIC_VAR_INIT(kNoDeadline); // min of deadline and preemption request
+	std::atomic<bool> _preempt = ATOMIC_VAR_INIT(false);
+	std::atomic<AtomicWaitTable::Bucket *> _waitBucket = ATOMIC_VAR_INIT(nullptr); // bucket of current atomic wait
+
+	bool _suspendable = false;
+	bool _canSuspend = false; // current Run is outermost call on suspendable thread
+
+	CodeCache::Reader _codeReader;
+
+	struct SuspendedCall {
+		const HostFunc *host = nullptr; // nullptr for preempted call
+		const Func *func = nullptr;
+		Value *buffer = nullptr;
+		Index origStack = 0;
+		Index origValue = 0;
+		bool silent = false;
+	} _suspended;
 };
 
 
 template <typename Callback>
 inline Thread::Result Thread::Prepare(const RuntimeModule &module, const Func &func, const Callback &cb, bool silent) {
+	PinCode();
+	if (!func.isTranslated() && !func.module->translate(func)) {
+		UnpinCode();
+		return Result::TrapInvalidFunction;
+	}
+
 	auto origStack = _callStackTop;
 	auto origValue = _valueStackTop;
 
 	const Index extraStackSpace = std::max(func.types.size(), func.sig->results.size());
 
 	if (_valueStackTop + extraStackSpace > _valueStack.size()) {
+		UnpinCode();
 		return Result::TrapValueStackExhausted;
 	}
 
 	if (_callStackTop >= _callStack.size()) {
+		UnpinCode();
 		return Result::TrapCallStackExhausted;
 	}
 
 	memset(_valueStack.data() + _valueStackTop, 0, sizeof(Value) * extraStackSpace);
 
-	return cb(_valueStack.data() + _valueStackTop, [&] () -> Result {
+	auto ret = cb(_valueStack.data() + _valueStackTop, [&] () -> Result {
+		// results are consumed by callback, so this call can not be suspended
+		const bool canSuspend = _canSuspend;
+		_canSuspend = false;
+
 		bool locked = false;
 		if (_contextLock.mutex() && !_contextLock.owns_lock()) {
 			_contextLock.lock();
@@ -256,12 +455,12 @@ inline Thread::Result Thread::Prepare(const RuntimeModule &module, const Func &f
 
 		const auto nParams = func.types.size();
 		_valueStackTop += nParams;
+		// failed push goes through the same cleanup, as failed run
 		auto res = PushCall(module, func);
-		if (res != Result::Ok) {
-			return res;
+		if (res == Result::Ok) {
+			res = Run(origStack);
 		}
 
-		res = Run(origStack);
 		if (res == Result::Ok || res == Result::Returned) {
 			Index nResults = func.sig->results.size();
 			if (nParams != 0) {
@@ -275,12 +474,16 @@ inline Thread::Result Thread::Prepare(const RuntimeModule &module, const Func &f
 
 		_callStackTop = origStack;
 		_valueStackTop = origValue;
+		_canSuspend = canSuspend;
 
 		if (locked) {
 			_contextLock.unlock();
 		}
 		return res;
 	});
+
+	UnpinCode();
+	return ret;
 }
 
 }
@@ -49,6 +49,7 @@ uint32_t ToRep(int32_t x) { return Bitcast<uint32_t>(x); }
 uint64_t ToRep(int64_t x) { return Bitcast<uint64_t>(x); }
 uint32_t ToRep(float x) { return Bitcast<uint32_t>(x); }
 uint64_t ToRep(double x) { return Bitcast<uint64_t>(x); }
+V128 ToRep(V128 x) { return x; }
 
 template <typename Dst, typename Src>
 Dst FromRep(Src x);
@@ -59,6 +60,7 @@ template <> int32_t FromRep<int32_t>(uint32_t x) { return Bitcast<int32_t>(x); }
 template <> int64_t FromRep<int64_t>(uint64_t x) { return Bitcast<int64_t>(x); }
 template <> float FromRep<float>(uint32_t x) { return Bitcast<float>(x); }
 template <> double FromRep<double>(uint64_t x) { return Bitcast<double>(x); }
+template <> V128 FromRep<V128>(V128 x) { return x; }
 
 template <typename T>
 struct FloatTraits;
@@ -325,6 +327,13 @@ Value MakeValue<double>(uint64_t v) {
 	return result;
 }
 
+template<>
+Value MakeValue<V128>(V128 v) {
+	Value result;
+	result.v128_bits = v;
+	return result;
+}
+
 template <typename T> ValueTypeRep<T> GetValue(Value);
 template<> uint32_t GetValue<int32_t>(Value v) { return v.i32; }
 template<> uint32_t GetValue<uint32_t>(Value v) { return v.i32; }
@@ -332,6 +341,7 @@ template<> uint64_t GetValue<int64_t>(Value v) { return v.i64; }
 template<> uint64_t GetValue<uint64_t>(Value v) { return v.i64; }
 template<> uint32_t GetValue<float>(Value v) { return v.f32_bits; }
 template<> uint64_t GetValue<double>(Value v) { return v.f64_bits; }
+template<> V128 GetValue<V128>(Value v) { return v.v128_bits; }
 
 // Differs from the normal CHECK_RESULT because this one is meant to return the
 // interp Result type.
@@ -727,10 +737,23 @@ ValueTypeRep<T> IntExtendS(ValueTypeRep<T> v_rep) {
 	return ToRep(static_cast<TS>(Bitcast<E>(static_cast<EU>(v_rep))));
 }
 
-// i{32,64}.atomic.rmw(8,16,32}_u.xchg
+// i{32,64}.atomic.rmw{8,16,32}_u.{add,sub,and,or,xor,xchg}, returns old value
 template <typename T>
-ValueTypeRep<T> Xchg(ValueTypeRep<T> lhs_rep, ValueTypeRep<T> rhs_rep) {
-	return rhs_rep;
-}
+T AtomicFetchAdd(T *addr, T value) { return __atomic_fetch_add(addr, value, __ATOMIC_SEQ_CST); }
+
+template <typename T>
+T AtomicFetchSub(T *addr, T value) { return __atomic_fetch_sub(addr, value, __ATOMIC_SEQ_CST); }
+
+template <typename T>
+T AtomicFetchAnd(T *addr, T value) { return __atomic_fetch_and(addr, value, __ATOMIC_SEQ_CST); }
+
+template <typename T>
+T AtomicFetchOr(T *addr, T value) { return __atomic_fetch_or(addr, value, __ATOMIC_SEQ_CST); }
+
+template <typename T>
+T AtomicFetchXor(T *addr, T value) { return __atomic_fetch_xor(addr, value, __ATOMIC_SEQ_CST); }
+
+template <typename T>
+T AtomicExchange(T *addr, T value) { return __atomic_exchange_n(addr, value, __ATOMIC_SEQ_CST); }
 
 }
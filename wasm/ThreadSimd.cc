@@ -0,0 +1,423 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Thread.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WASM_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace wasm {
+
+/* v128 handlers
+ *
+ * Lane-wise operations are written with GCC vector extensions, so compiler lowers them to
+ * SSE2 on x86-64, NEON on ARM, or scalar code elsewhere. Operations, that have no direct SSE2
+ * equivalent (byte shuffles, 32-bit multiply and min/max, unsigned narrowing), are selected
+ * from SimdDispatch table, that is filled by CPUID at startup.
+ */
+
+typedef int8_t simd_i8x16 __attribute__((vector_size(16)));
+typedef uint8_t simd_u8x16 __attribute__((vector_size(16)));
+typedef int16_t simd_i16x8 __attribute__((vector_size(16)));
+typedef uint16_t simd_u16x8 __attribute__((vector_size(16)));
+typedef int32_t simd_i32x4 __attribute__((vector_size(16)));
+typedef uint32_t simd_u32x4 __attribute__((vector_size(16)));
+typedef int64_t simd_i64x2 __attribute__((vector_size(16)));
+typedef uint64_t simd_u64x2 __attribute__((vector_size(16)));
+typedef float simd_f32x4 __attribute__((vector_size(16)));
+typedef double simd_f64x2 __attribute__((vector_size(16)));
+
+template <typename T>
+inline T SimdFrom(V128 v) {
+	T ret;
+	memcpy(&ret, &v, sizeof(V128));
+	return ret;
+}
+
+template <typename T>
+inline V128 SimdTo(T v) {
+	V128 ret;
+	memcpy(&ret, &v, sizeof(V128));
+	return ret;
+}
+
+template <typename T>
+inline T SimdLane(V128 v, Index lane) {
+	T ret;
+	memcpy(&ret, reinterpret_cast<const uint8_t *>(&v) + lane * sizeof(T), sizeof(T));
+	return ret;
+}
+
+template <typename T>
+inline void SimdSetLane(V128 &v, Index lane, T value) {
+	memcpy(reinterpret_cast<uint8_t *>(&v) + lane * sizeof(T), &value, sizeof(T));
+}
+
+// {i8x16,i16x8,i32x4,i64x2,f32x4,f64x2}.splat
+template <typename Lane, typename T>
+V128 SimdSplat(ValueTypeRep<T> v) {
+	V128 ret;
+	for (Index i = 0; i < sizeof(V128) / sizeof(Lane); ++ i) {
+		SimdSetLane<Lane>(ret, i, Lane(FromRep<T>(v)));
+	}
+	return ret;
+}
+
+// lane-wise arithmetic, integer ops use unsigned vectors to wrap on overflow
+template <typename Vec> V128 SimdAdd(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) + SimdFrom<Vec>(b)); }
+template <typename Vec> V128 SimdSub(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) - SimdFrom<Vec>(b)); }
+template <typename Vec> V128 SimdMul(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) * SimdFrom<Vec>(b)); }
+template <typename Vec> V128 SimdDiv(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) / SimdFrom<Vec>(b)); }
+template <typename Vec> V128 SimdNeg(V128 a) { return SimdTo(-SimdFrom<Vec>(a)); }
+
+template <typename Vec> V128 SimdEq(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) == SimdFrom<Vec>(b)); }
+template <typename Vec> V128 SimdNe(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) != SimdFrom<Vec>(b)); }
+template <typename Vec> V128 SimdLt(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) < SimdFrom<Vec>(b)); }
+template <typename Vec> V128 SimdLe(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) <= SimdFrom<Vec>(b)); }
+template <typename Vec> V128 SimdGt(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) > SimdFrom<Vec>(b)); }
+template <typename Vec> V128 SimdGe(V128 a, V128 b) { return SimdTo(SimdFrom<Vec>(a) >= SimdFrom<Vec>(b)); }
+
+template <typename Vec> V128 SimdMin(V128 a, V128 b) {
+	auto l = SimdFrom<Vec>(a), r = SimdFrom<Vec>(b);
+	return SimdTo(l < r ? l : r);
+}
+
+template <typename Vec> V128 SimdMax(V128 a, V128 b) {
+	auto l = SimdFrom<Vec>(a), r = SimdFrom<Vec>(b);
+	return SimdTo(l > r ? l : r);
+}
+
+// i{8x16,16x8,32x4}.abs, Signed and Unsigned are vector types of same lane width
+template <typename Signed, typename Unsigned>
+V128 SimdAbs(V128 a) {
+	auto mask = SimdFrom<Signed>(a) >> int(sizeof(Signed{}[0]) * 8 - 1);
+	auto v = SimdFrom<Unsigned>(a);
+	return SimdTo((v ^ (Unsigned)mask) - (Unsigned)mask);
+}
+
+// i{8x16,16x8,32x4,64x2}.{shl,shr_s,shr_u}, shift count is taken modulo lane width
+template <typename Vec> V128 SimdShl(V128 a, uint32_t count) {
+	return SimdTo(SimdFrom<Vec>(a) << int(count & (sizeof(Vec{}[0]) * 8 - 1)));
+}
+
+template <typename Vec> V128 SimdShr(V128 a, uint32_t count) {
+	return SimdTo(SimdFrom<Vec>(a) >> int(count & (sizeof(Vec{}[0]) * 8 - 1)));
+}
+
+// f{32x4,64x2}.{min,max,sqrt} with scalar NaN and signed zero rules
+template <typename T, ValueTypeRep<T> (*Fn)(ValueTypeRep<T>, ValueTypeRep<T>)>
+V128 SimdFloatBinop(V128 a, V128 b) {
+	typedef ValueTypeRep<T> Rep;
+	V128 ret;
+	for (Index i = 0; i < sizeof(V128) / sizeof(Rep); ++ i) {
+		SimdSetLane<Rep>(ret, i, Fn(SimdLane<Rep>(a, i), SimdLane<Rep>(b, i)));
+	}
+	return ret;
+}
+
+template <typename T, ValueTypeRep<T> (*Fn)(ValueTypeRep<T>)>
+V128 SimdFloatUnop(V128 a) {
+	typedef ValueTypeRep<T> Rep;
+	V128 ret;
+	for (Index i = 0; i < sizeof(V128) / sizeof(Rep); ++ i) {
+		SimdSetLane<Rep>(ret, i, Fn(SimdLane<Rep>(a, i)));
+	}
+	return ret;
+}
+
+V128 SimdF32X4Abs(V128 a) { return SimdTo(SimdFrom<simd_u32x4>(a) & 0x7fffffffU); }
+V128 SimdF64X2Abs(V128 a) { return SimdTo(SimdFrom<simd_u64x2>(a) & uint64_t(0x7fffffffffffffffULL)); }
+V128 SimdF32X4Neg(V128 a) { return SimdTo(SimdFrom<simd_u32x4>(a) ^ 0x80000000U); }
+V128 SimdF64X2Neg(V128 a) { return SimdTo(SimdFrom<simd_u64x2>(a) ^ uint64_t(0x8000000000000000ULL)); }
+
+// v128.{not,and,andnot,or,xor,bitselect,any_true}
+V128 SimdNot(V128 a) { return V128{~a.lo, ~a.hi}; }
+V128 SimdAnd(V128 a, V128 b) { return V128{a.lo & b.lo, a.hi & b.hi}; }
+V128 SimdAndNot(V128 a, V128 b) { return V128{a.lo & ~b.lo, a.hi & ~b.hi}; }
+V128 SimdOr(V128 a, V128 b) { return V128{a.lo | b.lo, a.hi | b.hi}; }
+V128 SimdXor(V128 a, V128 b) { return V128{a.lo ^ b.lo, a.hi ^ b.hi}; }
+
+V128 SimdBitSelect(V128 a, V128 b, V128 c) {
+	return V128{(a.lo & c.lo) | (b.lo & ~c.lo), (a.hi & c.hi) | (b.hi & ~c.hi)};
+}
+
+uint32_t SimdAnyTrue(V128 a) { return (a.lo | a.hi) != 0; }
+
+// i{8x16,16x8,32x4}.all_true
+template <typename T>
+uint32_t SimdAllTrue(V128 a) {
+	for (Index i = 0; i < sizeof(V128) / sizeof(T); ++ i) {
+		if (SimdLane<T>(a, i) == 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// saturating and rounding ops, lanes are computed in wider type W
+template <typename T, typename W>
+inline T SimdSaturate(W v) {
+	return T(std::min<W>(std::max<W>(v, std::numeric_limits<T>::min()), std::numeric_limits<T>::max()));
+}
+
+template <typename T, typename W>
+V128 SimdAddSat(V128 a, V128 b) {
+	V128 ret;
+	for (Index i = 0; i < sizeof(V128) / sizeof(T); ++ i) {
+		SimdSetLane<T>(ret, i, SimdSaturate<T, W>(W(SimdLane<T>(a, i)) + W(SimdLane<T>(b, i))));
+	}
+	return ret;
+}
+
+template <typename T, typename W>
+V128 SimdSubSat(V128 a, V128 b) {
+	V128 ret;
+	for (Index i = 0; i < sizeof(V128) / sizeof(T); ++ i) {
+		SimdSetLane<T>(ret, i, SimdSaturate<T, W>(W(SimdLane<T>(a, i)) - W(SimdLane<T>(b, i))));
+	}
+	return ret;
+}
+
+template <typename T>
+V128 SimdAvgr(V128 a, V128 b) {
+	V128 ret;
+	for (Index i = 0; i < sizeof(V128) / sizeof(T); ++ i) {
+		SimdSetLane<T>(ret, i, T((uint32_t(SimdLane<T>(a, i)) + uint32_t(SimdLane<T>(b, i)) + 1) / 2));
+	}
+	return ret;
+}
+
+#if __SSE2__
+template <> V128 SimdAddSat<int8_t, int32_t>(V128 a, V128 b) { return SimdTo(_mm_adds_epi8(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdAddSat<uint8_t, int32_t>(V128 a, V128 b) { return SimdTo(_mm_adds_epu8(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdAddSat<int16_t, int32_t>(V128 a, V128 b) { return SimdTo(_mm_adds_epi16(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdAddSat<uint16_t, int32_t>(V128 a, V128 b) { return SimdTo(_mm_adds_epu16(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdSubSat<int8_t, int32_t>(V128 a, V128 b) { return SimdTo(_mm_subs_epi8(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdSubSat<uint8_t, int32_t>(V128 a, V128 b) { return SimdTo(_mm_subs_epu8(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdSubSat<int16_t, int32_t>(V128 a, V128 b) { return SimdTo(_mm_subs_epi16(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdSubSat<uint16_t, int32_t>(V128 a, V128 b) { return SimdTo(_mm_subs_epu16(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdAvgr<uint8_t>(V128 a, V128 b) { return SimdTo(_mm_avg_epu8(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdAvgr<uint16_t>(V128 a, V128 b) { return SimdTo(_mm_avg_epu16(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+#endif
+
+// i8x16.narrow_i16x8_{s,u}, i16x8.narrow_i32x4_{s,u}: lanes of a, then lanes of b, saturated to R
+template <typename R, typename T>
+V128 SimdNarrow(V128 a, V128 b) {
+	constexpr Index n = sizeof(V128) / sizeof(T);
+	V128 ret;
+	for (Index i = 0; i < n; ++ i) {
+		SimdSetLane<R>(ret, i, SimdSaturate<R, int64_t>(SimdLane<T>(a, i)));
+		SimdSetLane<R>(ret, i + n, SimdSaturate<R, int64_t>(SimdLane<T>(b, i)));
+	}
+	return ret;
+}
+
+#if __SSE2__
+template <> V128 SimdNarrow<int8_t, int16_t>(V128 a, V128 b) { return SimdTo(_mm_packs_epi16(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdNarrow<uint8_t, int16_t>(V128 a, V128 b) { return SimdTo(_mm_packus_epi16(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+template <> V128 SimdNarrow<int16_t, int32_t>(V128 a, V128 b) { return SimdTo(_mm_packs_epi32(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+#endif
+
+// i16x8.extend_{low,high}_i8x16_{s,u}, i32x4.extend_{low,high}_i16x8_{s,u}
+template <typename R, typename T, Index Offset>
+V128 SimdExtend(V128 a) {
+	V128 ret;
+	for (Index i = 0; i < sizeof(V128) / sizeof(R); ++ i) {
+		SimdSetLane<R>(ret, i, R(SimdLane<T>(a, i + Offset)));
+	}
+	return ret;
+}
+
+// i32x4.trunc_sat_f32x4_{s,u}
+template <typename R>
+V128 SimdTruncSat(V128 a) {
+	V128 ret;
+	for (Index i = 0; i < 4; ++ i) {
+		SimdSetLane<uint32_t>(ret, i, IntTruncSat<R, float>(SimdLane<uint32_t>(a, i)));
+	}
+	return ret;
+}
+
+// f32x4.convert_i32x4_{s,u}
+template <typename T>
+V128 SimdConvert(V128 a) {
+	V128 ret;
+	for (Index i = 0; i < 4; ++ i) {
+		SimdSetLane<float>(ret, i, float(SimdLane<T>(a, i)));
+	}
+	return ret;
+}
+
+// i8x16.shuffle takes lane indexes from immediate, i8x16.swizzle from operand
+V128 SimdShuffle_generic(V128 a, V128 b, V128 lanes) {
+	uint8_t src[32];
+	memcpy(src, &a, sizeof(V128));
+	memcpy(src + 16, &b, sizeof(V128));
+	V128 ret;
+	for (Index i = 0; i < 16; ++ i) {
+		SimdSetLane<uint8_t>(ret, i, src[SimdLane<uint8_t>(lanes, i) & 31]);
+	}
+	return ret;
+}
+
+V128 SimdSwizzle_generic(V128 a, V128 idx) {
+	V128 ret;
+	for (Index i = 0; i < 16; ++ i) {
+		auto lane = SimdLane<uint8_t>(idx, i);
+		SimdSetLane<uint8_t>(ret, i, lane < 16 ? SimdLane<uint8_t>(a, lane) : 0);
+	}
+	return ret;
+}
+
+#if WASM_SIMD_X86
+__attribute__((target("ssse3")))
+V128 SimdShuffle_ssse3(V128 a, V128 b, V128 lanes) {
+	auto idx = SimdFrom<__m128i>(lanes);
+	// indexes 16-31 select from b, set high bit for them to zero lanes from a
+	auto fromA = _mm_or_si128(idx, _mm_cmpgt_epi8(idx, _mm_set1_epi8(15)));
+	auto fromB = _mm_sub_epi8(idx, _mm_set1_epi8(16));
+	return SimdTo(_mm_or_si128(_mm_shuffle_epi8(SimdFrom<__m128i>(a), fromA), _mm_shuffle_epi8(SimdFrom<__m128i>(b), fromB)));
+}
+
+__attribute__((target("ssse3")))
+V128 SimdSwizzle_ssse3(V128 a, V128 idx) {
+	// indexes >= 16 saturate to values with high bit set, and produce zero
+	auto mask = _mm_adds_epu8(SimdFrom<__m128i>(idx), _mm_set1_epi8(0x70));
+	return SimdTo(_mm_shuffle_epi8(SimdFrom<__m128i>(a), mask));
+}
+
+__attribute__((target("sse4.1")))
+V128 SimdI32X4Mul_sse41(V128 a, V128 b) { return SimdTo(_mm_mullo_epi32(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+
+__attribute__((target("sse4.1")))
+V128 SimdI8X16MinS_sse41(V128 a, V128 b) { return SimdTo(_mm_min_epi8(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+
+__attribute__((target("sse4.1")))
+V128 SimdI8X16MaxS_sse41(V128 a, V128 b) { return SimdTo(_mm_max_epi8(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+
+__attribute__((target("sse4.1")))
+V128 SimdI16X8MinU_sse41(V128 a, V128 b) { return SimdTo(_mm_min_epu16(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+
+__attribute__((target("sse4.1")))
+V128 SimdI16X8MaxU_sse41(V128 a, V128 b) { return SimdTo(_mm_max_epu16(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+
+__attribute__((target("sse4.1")))
+V128 SimdI32X4MinS_sse41(V128 a, V128 b) { return SimdTo(_mm_min_epi32(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+
+__attribute__((target("sse4.1")))
+V128 SimdI32X4MinU_sse41(V128 a, V128 b) { return SimdTo(_mm_min_epu32(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+
+__attribute__((target("sse4.1")))
+V128 SimdI32X4MaxS_sse41(V128 a, V128 b) { return SimdTo(_mm_max_epi32(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+
+__attribute__((target("sse4.1")))
+V128 SimdI32X4MaxU_sse41(V128 a, V128 b) { return SimdTo(_mm_max_epu32(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+
+__attribute__((target("sse4.1")))
+V128 SimdI16X8NarrowU_sse41(V128 a, V128 b) { return SimdTo(_mm_packus_epi32(SimdFrom<__m128i>(a), SimdFrom<__m128i>(b))); }
+#endif
+
+struct SimdDispatch {
+	V128 (*shuffle)(V128, V128, V128) = &SimdShuffle_generic;
+	V128 (*swizzle)(V128, V128) = &SimdSwizzle_generic;
+	V128 (*i32x4Mul)(V128, V128) = &SimdMul<simd_u32x4>;
+	V128 (*i8x16MinS)(V128, V128) = &SimdMin<simd_i8x16>;
+	V128 (*i8x16MaxS)(V128, V128) = &SimdMax<simd_i8x16>;
+	V128 (*i16x8MinU)(V128, V128) = &SimdMin<simd_u16x8>;
+	V128 (*i16x8MaxU)(V128, V128) = &SimdMax<simd_u16x8>;
+	V128 (*i32x4MinS)(V128, V128) = &SimdMin<simd_i32x4>;
+	V128 (*i32x4MinU)(V128, V128) = &SimdMin<simd_u32x4>;
+	V128 (*i32x4MaxS)(V128, V128) = &SimdMax<simd_i32x4>;
+	V128 (*i32x4MaxU)(V128, V128) = &SimdMax<simd_u32x4>;
+	V128 (*i16x8NarrowU)(V128, V128) = &SimdNarrow<uint16_t, int32_t>;
+
+	SimdDispatch() {
+#if WASM_SIMD_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("ssse3")) {
+			shuffle = &SimdShuffle_ssse3;
+			swizzle = &SimdSwizzle_ssse3;
+		}
+		if (__builtin_cpu_supports("sse4.1")) {
+			i32x4Mul = &SimdI32X4Mul_sse41;
+			i8x16MinS = &SimdI8X16MinS_sse41;
+			i8x16MaxS = &SimdI8X16MaxS_sse41;
+			i16x8MinU = &SimdI16X8MinU_sse41;
+			i16x8MaxU = &SimdI16X8MaxU_sse41;
+			i32x4MinS = &SimdI32X4MinS_sse41;
+			i32x4MinU = &SimdI32X4MinU_sse41;
+			i32x4MaxS = &SimdI32X4MaxS_sse41;
+			i32x4MaxU = &SimdI32X4MaxU_sse41;
+			i16x8NarrowU = &SimdI16X8NarrowU_sse41;
+		}
+#endif
+	}
+};
+
+static const SimdDispatch s_simdDispatch;
+
+Thread::Result Thread::SimdLoad(const Func::OpcodeRec * pc) {
+	void* src;
+	CHECK_TRAP(GetAccessAddress<V128>(pc, &src));
+	V128 value;
+	LoadFromMemory<V128>(&value, src);
+	return PushRep<V128>(value);
+}
+
+Thread::Result Thread::SimdStore(const Func::OpcodeRec * pc) {
+	V128 value = PopRep<V128>();
+	void* dst;
+	CHECK_TRAP(GetAccessAddress<V128>(pc, &dst));
+	StoreToMemory<V128>(dst, value);
+	return Result::Ok;
+}
+
+Thread::Result Thread::SimdShift(V128 (*func)(V128, uint32_t)) {
+	auto count = Pop<uint32_t>();
+	auto value = PopRep<V128>();
+	return PushRep<V128>(func(value, count));
+}
+
+Thread::Result Thread::SimdTernop(V128 (*func)(V128, V128, V128)) {
+	auto c = PopRep<V128>();
+	auto b = PopRep<V128>();
+	auto a = PopRep<V128>();
+	return PushRep<V128>(func(a, b, c));
+}
+
+Thread::Result Thread::SimdShuffle(const Func::OpcodeRec * pc) {
+	auto b = PopRep<V128>();
+	auto a = PopRep<V128>();
+	return PushRep<V128>(s_simdDispatch.shuffle(a, b, V128{pc[0].value64, pc[1].value64}));
+}
+
+template <typename T, typename R>
+Thread::Result Thread::SimdExtractLane(const Func::OpcodeRec * pc) {
+	auto value = PopRep<V128>();
+	return Push<R>(R(SimdLane<T>(value, pc->value32.v1)));
+}
+
+template <typename T, typename S>
+Thread::Result Thread::SimdReplaceLane(const Func::OpcodeRec * pc) {
+	auto lane = Pop<S>();
+	auto value = PopRep<V128>();
+	SimdSetLane<T>(value, pc->value32.v1, T(lane));
+	return PushRep<V128>(value);
+}
+
+}
@@ -29,6 +29,7 @@ static void printType(std::ostream &stream, Type t) {
 	case Type::I64: stream << "i64"; break;
 	case Type::F32: stream << "f32"; break;
 	case Type::F64: stream << "f64"; break;
+	case Type::V128: stream << "v128"; break;
 	case Type::Anyfunc: stream << "anyfunc"; break;
 	case Type::Func: stream << "func"; break;
 	case Type::Void: stream << "void"; break;
@@ -61,6 +62,13 @@ Thread::Result Thread::GetAtomicAccessAddress(const Func::OpcodeRec * pc, void**
 	return Result::Ok;
 }
 
+// used only within loops, where range of accessed addresses was checked by InterpLoopGuard
+template<typename MemType>
+void *Thread::GetUncheckedAccessAddress(const Func::OpcodeRec * pc) {
+	auto memory = _currentFrame->module->memory[pc->value32.v2];
+	return memory->data + static_cast<uint64_t>(Pop<uint32_t>()) + pc->value32.v1;
+}
+
 Value& Thread::Top() {
 	return Pick(1);
 }
@@ -127,27 +135,78 @@ Thread::Result Thread::PushCall(const RuntimeModule &module, const Func &func) {
 
 Thread::Result Thread::PushCall(const RuntimeModule &module, Index idx, bool import) {
 	TrySync();
+	TRAP_IF(isInterrupted(), Interrupted);
 	if (!import) {
-		return PushCall(module, *module.func[idx].first);
+		return EnterCall(module, *module.func[idx].first);
 	} else {
 		TRAP_IF(_callStackTop >= _callStack.size(), CallStackExhausted);
 		auto &fn = module.func[idx];
 		if (fn.first) {
 			if (auto rtMod = _runtime->getModule(fn.first->module)) {
-				return PushCall(*rtMod, *module.func[idx].first);
+				return EnterCall(*rtMod, *module.func[idx].first);
 			}
 		} else if (fn.second) {
 			Index newTop = _valueStackTop - fn.second->sig.params.size() + fn.second->sig.results.size();
 			TRAP_IF(newTop >= _valueStack.size(), ValueStackExhausted);
-			if (fn.second->callback(this, fn.second, _valueStack.data() + _valueStackTop - fn.second->sig.params.size()) == wasm::Result::Ok) {
+			switch (fn.second->callback(this, fn.second, _valueStack.data() + _valueStackTop - fn.second->sig.params.size())) {
+			case wasm::Result::Ok:
 				_valueStackTop = newTop;
 				return Result::Returned;
+			case wasm::Result::Suspend:
+				// call position and arguments stay on stacks until Resume
+				TRAP_UNLESS(_canSuspend, HostTrapped);
+				_suspended.host = fn.second;
+				return Result::Suspended;
+			default:
+				break;
 			}
 		}
 	}
 	return Result::TrapHostTrapped;
 }
 
+Thread::Result Thread::EnterCall(const RuntimeModule &module, const Func &func) {
+	TRAP_UNLESS(func.isTranslated() || func.module->translate(func), InvalidFunction);
+
+	// arguments are already on stack, declared locals should be zero-initialized
+	const Index nLocals = func.types.size() - func.sig->params.size();
+	TRAP_IF(_valueStackTop + nLocals > _valueStack.size(), ValueStackExhausted);
+	memset(_valueStack.data() + _valueStackTop, 0, nLocals * sizeof(Value));
+	_valueStackTop += nLocals;
+	return PushCall(module, func);
+}
+
+Thread::Result Thread::ReplaceCall(const RuntimeModule &module, Index idx, bool import) {
+	TrySync();
+	TRAP_IF(isInterrupted(), Interrupted);
+
+	auto &fn = module.func[idx];
+	const RuntimeModule *targetModule = &module;
+	if (import) {
+		if (!fn.first) {
+			// host function can not reuse frame, call it in place, caller should return its results
+			return PushCall(module, idx, import);
+		}
+		targetModule = _runtime->getModule(fn.first->module);
+		TRAP_IF(!targetModule, HostTrapped);
+	}
+
+	// move arguments into current frame's locals window, and replace frame with callee
+	const Func &func = *fn.first;
+	TRAP_UNLESS(func.isTranslated() || func.module->translate(func), InvalidFunction);
+
+	const Index nParams = func.sig->params.size();
+	const Index nLocals = func.types.size();
+	const Index base = _currentFrame->locals - _valueStack.data();
+	TRAP_IF(base + nLocals > _valueStack.size(), ValueStackExhausted);
+
+	memmove(_currentFrame->locals, _valueStack.data() + _valueStackTop - nParams, nParams * sizeof(Value));
+	memset(_currentFrame->locals + nParams, 0, (nLocals - nParams) * sizeof(Value));
+	_valueStackTop = base + nLocals;
+	*_currentFrame = CallStackFrame{targetModule, &func, _currentFrame->locals, func.opcodes.data()};
+	return Result::Ok;
+}
+
 void Thread::PopCall(Index idx) {
 	const Index newTop = _currentFrame->locals - _valueStack.data() + idx;
 	if (idx > 0) {
@@ -180,6 +239,21 @@ Thread::Result Thread::Store(const Func::OpcodeRec * pc) {
 	return Result::Ok;
 }
 
+template <typename MemType, typename ResultType>
+Thread::Result Thread::LoadUnchecked(const Func::OpcodeRec * pc) {
+	typedef typename ExtendMemType<ResultType, MemType>::type ExtendedType;
+	MemType value;
+	LoadFromMemory<MemType>(&value, GetUncheckedAccessAddress<MemType>(pc));
+	return Push<ResultType>(static_cast<ExtendedType>(value));
+}
+
+template <typename MemType, typename ResultType>
+void Thread::StoreUnchecked(const Func::OpcodeRec * pc) {
+	typedef typename WrapMemType<ResultType, MemType>::type WrappedType;
+	WrappedType value = PopRep<ResultType>();
+	StoreToMemory<WrappedType>(GetUncheckedAccessAddress<MemType>(pc), value);
+}
+
 template <typename MemType, typename ResultType>
 Thread::Result Thread::AtomicLoad(const Func::OpcodeRec * pc) {
 	typedef typename ExtendMemType<ResultType, MemType>::type ExtendedType;
@@ -187,8 +261,7 @@ Thread::Result Thread::AtomicLoad(const Func::OpcodeRec * pc) {
 			"AtomicLoad type can't be float");
 	void* src;
 	CHECK_TRAP(GetAtomicAccessAddress<MemType>(pc, &src));
-	MemType value;
-	LoadFromMemory<MemType>(&value, src);
+	MemType value = __atomic_load_n(reinterpret_cast<MemType *>(src), __ATOMIC_SEQ_CST);
 	return Push<ResultType>(static_cast<ExtendedType>(value));
 }
 
@@ -198,19 +271,18 @@ Thread::Result Thread::AtomicStore(const Func::OpcodeRec * pc) {
 	WrappedType value = PopRep<ResultType>();
 	void* dst;
 	CHECK_TRAP(GetAtomicAccessAddress<MemType>(pc, &dst));
-	StoreToMemory<WrappedType>(dst, value);
+	__atomic_store_n(reinterpret_cast<WrappedType *>(dst), value, __ATOMIC_SEQ_CST);
 	return Result::Ok;
 }
 
+// linear memory is little-endian, as well as supported hosts, so atomics operate on memory directly
 template<typename MemType, typename ResultType>
-Thread::Result Thread::AtomicRmw(BinopFunc<ResultType, ResultType> func, const Func::OpcodeRec * pc) {
+Thread::Result Thread::AtomicRmw(AtomicRmwFunc<MemType> func, const Func::OpcodeRec * pc) {
 	typedef typename ExtendMemType<ResultType, MemType>::type ExtendedType;
 	MemType rhs = PopRep<ResultType>();
 	void* addr;
 	CHECK_TRAP(GetAtomicAccessAddress<MemType>(pc, &addr));
-	MemType read;
-	LoadFromMemory<MemType>(&read, addr);
-	StoreToMemory<MemType>(addr, func(read, rhs));
+	MemType read = func(reinterpret_cast<MemType *>(addr), rhs);
 	return Push<ResultType>(static_cast<ExtendedType>(read));
 }
 
@@ -221,12 +293,141 @@ Thread::Result Thread::AtomicRmwCmpxchg(const Func::OpcodeRec * pc) {
 	MemType expect = PopRep<ResultType>();
 	void* addr;
 	CHECK_TRAP(GetAtomicAccessAddress<MemType>(pc, &addr));
-	MemType read;
-	LoadFromMemory<MemType>(&read, addr);
-	if (read == expect) {
-		StoreToMemory<MemType>(addr, replace);
+	// on failure, expect is updated with value, that was read
+	__atomic_compare_exchange_n(reinterpret_cast<MemType *>(addr), &expect, replace, false,
+			__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return Push<ResultType>(static_cast<ExtendedType>(expect));
+}
+
+template<typename MemType>
+Thread::Result Thread::AtomicWait(const Func::OpcodeRec * pc) {
+	using Clock = std::chrono::steady_clock;
+
+	auto timeout = Pop<int64_t>(); // nanoseconds, negative for no timeout
+	MemType expected = Pop<MemType>();
+	void* ptr;
+	CHECK_TRAP(GetAtomicAccessAddress<MemType>(pc, &ptr));
+	auto memory = _currentFrame->module->memory[pc->value32.v2];
+	TRAP_UNLESS(memory->limits.is_shared, ExpectedSharedMemory);
+
+	auto table = AtomicWaitTable::getInstance();
+	const uint32_t address = static_cast<uint8_t *>(ptr) - memory->data;
+	auto &bucket = table->getBucket(memory, address);
+
+	std::unique_lock<std::mutex> lock(bucket.mutex);
+	// notifier takes bucket lock after store, so value can not be changed unnoticed between check and park
+	if (__atomic_load_n(reinterpret_cast<MemType *>(ptr), __ATOMIC_SEQ_CST) != expected) {
+		return Push<uint32_t>(1); // not-equal
 	}
-	return Push<ResultType>(static_cast<ExtendedType>(read));
+
+	AtomicWaitTable::Waiter waiter{memory, address, false, nullptr};
+	table->park(bucket, waiter);
+
+	// parked thread should not block stop-the-world sync (see GrowMemory)
+	const bool contextLocked = _contextLock.owns_lock();
+	if (contextLocked) {
+		_contextLock.unlock();
+	}
+
+	const auto now = Clock::now();
+	const auto deadline = (timeout < 0 || std::chrono::nanoseconds(timeout) > Clock::time_point::max() - now)
+			? Clock::time_point::max() : now + std::chrono::nanoseconds(timeout);
+
+	// interrupt() notifies bucket; deadline of thread is checked, when watchdog epoch should reach it,
+	// so untimed wait without deadline is woken only by notify or interrupt
+	const auto tick = Watchdog::getInstance()->getTick();
+	_waitBucket.store(&bucket);
+	bool interrupted = false;
+	while (!waiter.notified) {
+		const auto threadDeadline = _deadline.load();
+		const auto epoch = Watchdog::getEpoch();
+		if (epoch >= threadDeadline) {
+			interrupted = true;
+			break;
+		}
+		auto current = Clock::now();
+		if (current >= deadline) {
+			break;
+		}
+		auto wake = deadline;
+		if (threadDeadline != kNoDeadline && threadDeadline - epoch < uint64_t((deadline - current) / tick)) {
+			wake = current + tick * (threadDeadline - epoch);
+		}
+		if (wake == Clock::time_point::max()) {
+			bucket.cond.wait(lock);
+		} else {
+			bucket.cond.wait_until(lock, wake);
+		}
+	}
+	_waitBucket.store(nullptr);
+
+	if (!waiter.notified) {
+		table->unpark(bucket, waiter);
+	}
+	lock.unlock();
+
+	if (contextLocked) {
+		_contextLock.lock();
+	}
+
+	TRAP_IF(interrupted, Interrupted);
+	return Push<uint32_t>(waiter.notified ? 0 : 2); // ok or timed-out
+}
+
+Thread::Result Thread::AtomicNotify(const Func::OpcodeRec * pc) {
+	auto count = Pop<uint32_t>();
+	void* ptr;
+	CHECK_TRAP(GetAtomicAccessAddress<uint32_t>(pc, &ptr));
+	auto memory = _currentFrame->module->memory[pc->value32.v2];
+	if (!memory->limits.is_shared) {
+		return Push<uint32_t>(0); // unshared memory can not have waiters
+	}
+
+	const uint32_t address = static_cast<uint8_t *>(ptr) - memory->data;
+	return Push<uint32_t>(AtomicWaitTable::getInstance()->notify(memory, address, count));
+}
+
+Thread::Result Thread::MemoryInit(const Func::OpcodeRec * pc) {
+	auto module = _currentFrame->module;
+	auto memory = module->memory[pc->value32.v2];
+	auto &data = module->module->getMemoryData()[pc->value32.v1];
+	uint64_t size = Pop<uint32_t>();
+	uint64_t src = Pop<uint32_t>();
+	uint64_t dst = Pop<uint32_t>();
+	uint64_t segmentSize = __atomic_load_n(&module->droppedData[pc->value32.v1], __ATOMIC_RELAXED) ? 0 : data.size();
+	TRAP_IF(src + size > segmentSize || dst + size > memory->size, MemoryAccessOutOfBounds);
+	if (size) {
+		memcpy(memory->data + dst, data.data() + src, size);
+	}
+	return Result::Ok;
+}
+
+void Thread::DataDrop(const Func::OpcodeRec * pc) {
+	__atomic_store_n(&_currentFrame->module->droppedData[pc->value32.v1], uint8_t(1), __ATOMIC_RELAXED);
+}
+
+Thread::Result Thread::MemoryCopy(const Func::OpcodeRec * pc) {
+	auto memory = _currentFrame->module->memory[pc->value32.v2];
+	uint64_t size = Pop<uint32_t>();
+	uint64_t src = Pop<uint32_t>();
+	uint64_t dst = Pop<uint32_t>();
+	TRAP_IF(src + size > memory->size || dst + size > memory->size, MemoryAccessOutOfBounds);
+	if (size) {
+		memmove(memory->data + dst, memory->data + src, size);
+	}
+	return Result::Ok;
+}
+
+Thread::Result Thread::MemoryFill(const Func::OpcodeRec * pc) {
+	auto memory = _currentFrame->module->memory[pc->value32.v2];
+	uint64_t size = Pop<uint32_t>();
+	uint8_t value = uint8_t(Pop<uint32_t>());
+	uint64_t dst = Pop<uint32_t>();
+	TRAP_IF(dst + size > memory->size, MemoryAccessOutOfBounds);
+	if (size) {
+		memset(memory->data + dst, value, size);
+	}
+	return Result::Ok;
 }
 
 template<typename R, typename T>
@@ -271,6 +472,10 @@ bool Thread::init(uint32_t valueStackSize, uint32_t callStackSize) {
 	return true;
 }
 
+const Runtime *Thread::getRuntime() const {
+	return _runtime;
+}
+
 void Thread::setSyncContext(ThreadContext *ctx) {
 	_context = ctx;
 	if (_context) {
@@ -309,6 +514,70 @@ uint32_t Thread::getUserStackGuard() const {
 	return _userStackGuard;
 }
 
+void Thread::setFuel(uint64_t fuel) {
+	if (_fuelSlice && fuel > _fuelSlice) {
+		_fuel = _fuelSlice;
+		_fuelReserve = (fuel == kUnlimitedFuel) ? kUnlimitedFuel : fuel - _fuelSlice;
+	} else {
+		_fuel = fuel;
+		_fuelReserve = 0;
+	}
+}
+uint64_t Thread::getFuel() const {
+	return (_fuelReserve == kUnlimitedFuel) ? kUnlimitedFuel : _fuel + _fuelReserve;
+}
+
+void Thread::setFuelSlice(uint64_t slice) {
+	auto fuel = getFuel();
+	_fuelSlice = slice;
+	setFuel(fuel);
+}
+uint64_t Thread::getFuelSlice() const {
+	return _fuelSlice;
+}
+
+void Thread::setDeadline(uint64_t epoch) {
+	_deadline.store(epoch, std::memory_order_relaxed);
+	_checkEpoch.store(_preempt.load() ? 0 : epoch);
+}
+uint64_t Thread::getDeadline() const {
+	return _deadline.load(std::memory_order_relaxed);
+}
+
+void Thread::setSuspendable(bool value) {
+	_suspendable = value;
+}
+bool Thread::isSuspendable() const {
+	return _suspendable;
+}
+
+bool Thread::isSuspended() const {
+	return _suspended.func != nullptr;
+}
+const HostFunc *Thread::getSuspendedFunc() const {
+	return _suspended.host;
+}
+
+void Thread::interrupt() {
+	// deadline is stored before bucket is read, and waiter stores bucket before it reads deadline,
+	// so either waiter sees interruption, or it is parked, when bucket lock is taken
+	_deadline.store(0);
+	_checkEpoch.store(0, std::memory_order_relaxed);
+	if (auto bucket = _waitBucket.load()) {
+		std::unique_lock<std::mutex> lock(bucket->mutex);
+		lock.unlock();
+		bucket->cond.notify_all();
+	}
+}
+
+void Thread::preempt() {
+	_preempt.store(true);
+	_checkEpoch.store(0);
+}
+bool Thread::isInterrupted() const {
+	return Watchdog::getEpoch() >= _deadline.load(std::memory_order_relaxed);
+}
+
 Thread::Result Thread::allocStack(uint32_t size, uint32_t &result) {
 	if (_userStackGuard + size > _userStackPointer) {
 		return Result::TrapUserStackExhausted;
@@ -328,6 +597,12 @@ const uint8_t* GetIstream() {
 }
 
 Thread::Result Thread::Run(const RuntimeModule &module, const Func &func, Value *buffer, bool silent) {
+	PinCode();
+	if (!func.isTranslated() && !func.module->translate(func)) {
+		UnpinCode();
+		return Result::TrapInvalidFunction;
+	}
+
 	bool locked = false;
 	if (_contextLock.mutex() && !_contextLock.owns_lock()) {
 		_contextLock.lock();
@@ -336,13 +611,84 @@ Thread::Result Thread::Run(const RuntimeModule &module, const Func &func, Value
 
 	auto origStack = _callStackTop;
 	auto origValue = _valueStackTop;
-	CHECK_TRAP(PushLocals(func, buffer));
-	CHECK_TRAP(PushCall(module, func));
-	auto res = Run(origStack);
+	auto res = PushLocals(func, buffer);
+	if (res == Result::Ok) {
+		res = PushCall(module, func);
+	}
+
+	if (res == Result::Ok) {
+		// only outermost call can be suspended, nested calls from host functions hold host's C stack
+		const bool canSuspend = _canSuspend;
+		_canSuspend = _suspendable && origStack == 0 && !_suspended.func;
+		if (_canSuspend) {
+			// preemption, requested after previous call returned, does not stop new call
+			_preempt.store(false);
+			_checkEpoch.store(_deadline.load());
+			if (_preempt.load()) {
+				_checkEpoch.store(0);
+			}
+		}
+
+		res = FinishRun(Run(origStack), func, buffer, origStack, origValue, silent);
+
+		_canSuspend = canSuspend;
+	}
+
+	if (locked) {
+		_contextLock.unlock();
+	}
+	UnpinCode();
+	return res;
+}
+
+// slow path of InterpChargeFuel, when current slice has not enough fuel
+Thread::Result Thread::ChargeFuel(uint32_t amount) {
+	while (_fuel < amount) {
+		if (_fuelReserve == 0) {
+			_fuel = 0;
+			TRAP(FuelExhausted);
+		}
+
+		const uint64_t next = std::min(_fuelSlice, _fuelReserve);
+		if (_fuelReserve != kUnlimitedFuel) {
+			_fuelReserve -= next;
+		}
+		_fuel += next;
+
+		if (_canSuspend) {
+			// charge is repeated on resume
+			return Result::Preempted;
+		}
+	}
+	_fuel -= amount;
+	return Result::Ok;
+}
+
+// slow path of epoch check, when deadline is reached or preemption is requested
+Thread::Result Thread::CheckEpoch() {
+	TRAP_IF(isInterrupted(), Interrupted);
+
+	const bool preempted = _preempt.exchange(false);
+	_checkEpoch.store(_deadline.load());
+	if (_preempt.load()) {
+		// concurrent request could be overwritten by store above
+		_checkEpoch.store(0);
+	}
+
+	return (preempted && _canSuspend) ? Result::Preempted : Result::Ok;
+}
+
+Thread::Result Thread::FinishRun(Result res, const Func &func, Value *buffer, Index origStack, Index origValue, bool silent) {
 	if (res == Result::Ok || res == Result::Returned) {
 		Index nresults = func.sig->results.size();
 		memcpy(buffer, &_valueStack[_valueStackTop - nresults], nresults * sizeof(Value));
 		_valueStackTop -= nresults;
+	} else if (res == Result::Suspended || res == Result::Preempted) {
+		_suspended.func = &func;
+		_suspended.buffer = buffer;
+		_suspended.origStack = origStack;
+		_suspended.origValue = origValue;
+		_suspended.silent = silent;
 	} else {
 		if (!silent) {
 			_runtime->onThreadError(*this);
@@ -350,13 +696,91 @@ Thread::Result Thread::Run(const RuntimeModule &module, const Func &func, Value
 		_callStackTop = origStack;
 		_valueStackTop = origValue;
 	}
+	return res;
+}
+
+Thread::Result Thread::Resume(const Value *results) {
+	if (!_suspended.func) {
+		return Result::TrapHostTrapped;
+	}
+
+	bool locked = false;
+	if (_contextLock.mutex() && !_contextLock.owns_lock()) {
+		_contextLock.lock();
+		locked = true;
+	}
+
+	const SuspendedCall call(_suspended);
+	_suspended = SuspendedCall();
+
+	if (call.host) {
+		// replace host function arguments with its results
+		const Index nResults = call.host->sig.results.size();
+		const Index args = _valueStackTop - call.host->sig.params.size();
+		if (nResults > 0) {
+			memcpy(&_valueStack[args], results, nResults * sizeof(Value));
+		}
+		_valueStackTop = args + nResults;
+
+		// continue after call instruction, tail call from host function returns from caller's frame
+		auto &frame = _callStack[_callStackTop - 1];
+		switch (frame.position->opcode) {
+		case Opcode::ReturnCall:
+		case Opcode::ReturnCallIndirect:
+			frame.position = frame.func->opcodes.data() + frame.func->opcodes.size();
+			break;
+		default:
+			++ frame.position;
+			break;
+		}
+	}
+	// preempted call continues from instruction, that was not executed
 
+	const bool canSuspend = _canSuspend;
+	_canSuspend = _suspendable;
+
+	auto res = FinishRun(Run(call.origStack), *call.func, call.buffer, call.origStack, call.origValue, call.silent);
+
+	_canSuspend = canSuspend;
 	if (locked) {
 		_contextLock.unlock();
 	}
+	UnpinCode();
 	return res;
 }
 
+Thread::Result Thread::Cancel() {
+	if (!_suspended.func) {
+		return Result::TrapHostTrapped;
+	}
+
+	if (!_suspended.silent) {
+		_runtime->onThreadError(*this);
+	}
+
+	_callStackTop = _suspended.origStack;
+	_valueStackTop = _suspended.origValue;
+	_suspended = SuspendedCall();
+	UnpinCode();
+	return Result::TrapHostTrapped;
+}
+
+void Thread::PinCode() {
+	if (!_codeReader.isPinned() && _runtime && _runtime->getEnvironment()) {
+		auto cache = _runtime->getEnvironment()->getCodeCache();
+		if (cache->isEnabled()) {
+			_codeReader.pin(cache);
+		}
+	}
+}
+
+void Thread::UnpinCode() {
+	// suspended thread holds frames of its call stack
+	if (_callStackTop == 0 && !_suspended.func && _codeReader.isPinned()) {
+		_codeReader.unpin();
+	}
+}
+
 RuntimeMemory *Thread::GetMemoryPtr(Index memIndex) const {
 	if (_currentFrame && memIndex < _currentFrame->module->memory.size()) {
 		return _currentFrame->module->memory[memIndex];
@@ -476,6 +900,10 @@ void Thread::PrintStackFrame(std::ostream &stream, const CallStackFrame &frame,
 			printMemoryBlock(stream, (const uint8_t *)&frame.locals[i].f64_bits, 8);
 			stream << " ( " << std::dec << std::setw(1) << reinterpret_cast<double &>(frame.locals[i].f64_bits) << " ):";
 			break;
+		case Type::V128:
+			stream << "memory:";
+			printMemoryBlock(stream, (const uint8_t *)&frame.locals[i].v128_bits, 16);
+			break;
 		default:
 			break;
 		}
@@ -526,4 +954,120 @@ void Thread::onThreadError() const {
 	_runtime->onThreadError(*this);
 }
 
+
+AtomicWaitTable *AtomicWaitTable::getInstance() {
+	static AtomicWaitTable s_instance;
+	return &s_instance;
+}
+
+AtomicWaitTable::Bucket &AtomicWaitTable::getBucket(const RuntimeMemory *memory, uint32_t address) {
+	auto hash = (reinterpret_cast<uintptr_t>(memory) >> 4) ^ (address >> 2) * 0x9E3779B1U;
+	return _buckets[(hash ^ (hash >> 16)) % kBucketsCount];
+}
+
+void AtomicWaitTable::park(Bucket &bucket, Waiter &waiter) {
+	auto tail = &bucket.waiters;
+	while (*tail) {
+		tail = &(*tail)->next;
+	}
+	*tail = &waiter;
+}
+
+void AtomicWaitTable::unpark(Bucket &bucket, Waiter &waiter) {
+	for (auto it = &bucket.waiters; *it; it = &(*it)->next) {
+		if (*it == &waiter) {
+			*it = waiter.next;
+			break;
+		}
+	}
+}
+
+uint32_t AtomicWaitTable::notify(const RuntimeMemory *memory, uint32_t address, uint32_t count) {
+	auto &bucket = getBucket(memory, address);
+	uint32_t woken = 0;
+
+	std::unique_lock<std::mutex> lock(bucket.mutex);
+	auto it = &bucket.waiters;
+	while (*it && woken < count) {
+		auto waiter = *it;
+		if (waiter->memory == memory && waiter->address == address) {
+			*it = waiter->next;
+			waiter->notified = true;
+			++ woken;
+		} else {
+			it = &waiter->next;
+		}
+	}
+	lock.unlock();
+
+	if (woken > 0) {
+		bucket.cond.notify_all();
+	}
+	return woken;
+}
+
+std::atomic<uint64_t> Watchdog::s_epoch = ATOMIC_VAR_INIT(1);
+constexpr Watchdog::Clock::duration Watchdog::kDefaultTick;
+
+Watchdog *Watchdog::getInstance() {
+	static Watchdog s_instance;
+	return &s_instance;
+}
+
+Watchdog::~Watchdog() {
+	if (_thread.joinable()) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_exit = true;
+		lock.unlock();
+		_cond.notify_all();
+		_thread.join();
+	}
+}
+
+uint64_t Watchdog::acquire(Clock::duration timeout) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (!_thread.joinable()) {
+		_thread = std::thread([this] { run(); });
+	}
+	if (_active ++ == 0) {
+		_cond.notify_all();
+	}
+
+	const uint64_t ticks = (std::max(timeout, Clock::duration::zero()) + _tick - Clock::duration(1)) / _tick;
+	// current tick is partially passed, so deadline can be reached up to one tick later
+	return getEpoch() + ticks + 1;
+}
+
+void Watchdog::release() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_active > 0) {
+		-- _active;
+	}
+}
+
+void Watchdog::setTick(Clock::duration tick) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_tick = std::max(tick, Clock::duration(1));
+}
+
+Watchdog::Clock::duration Watchdog::getTick() const {
+	std::unique_lock<std::mutex> lock(_mutex);
+	return _tick;
+}
+
+void Watchdog::run() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto next = Clock::now() + _tick;
+	while (!_exit) {
+		if (_active == 0) {
+			// no deadlines to track, sleep until next acquire
+			_cond.wait(lock);
+			next = Clock::now() + _tick;
+		} else if (_cond.wait_until(lock, next) == std::cv_status::timeout) {
+			s_epoch.fetch_add(1, std::memory_order_relaxed);
+			next += _tick;
+		}
+	}
+}
+
 }
@@ -28,65 +28,17 @@ bool ThreadedRuntime::init(const Environment *env, const LinkingThreadOptions &o
 	return _mainThread.init(opts.valueStackSize, opts.callStackSize);
 }
 
-const Func *ThreadedRuntime::getExportFunc(const StringView &module, const StringView &name) const {
-	if (auto mod = getModule(module)) {
-		return getExportFunc(*mod, name);
-	}
-	return nullptr;
-}
-const Func *ThreadedRuntime::getExportFunc(const RuntimeModule &module, const StringView &name) const {
-	auto it = module.exports.find(name);
-	if (it != module.exports.end() && it->second.second == ExternalKind::Func) {
-		if (module.func[it->second.first].first) {
-			return module.func[it->second.first].first;
-		}
-	}
-	return nullptr;
-}
-
-const RuntimeGlobal *ThreadedRuntime::getGlobal(const StringView &module, const StringView &name) const {
-	if (auto mod = getModule(module)) {
-		return getGlobal(*mod, name);
-	}
-	return nullptr;
-}
-const RuntimeGlobal *ThreadedRuntime::getGlobal(const RuntimeModule &module, const StringView &name) const {
-	auto it = module.exports.find(name);
-	if (it != module.exports.end() && it->second.second == ExternalKind::Global) {
-		return module.globals[it->second.first];
-	}
-	return nullptr;
-}
-
-bool ThreadedRuntime::setGlobal(const StringView &module, const StringView &name, const Value &value) {
-	if (auto mod = getModule(module)) {
-		return setGlobal(*mod, name, value);
-	}
-	return false;
-}
-
-bool ThreadedRuntime::setGlobal(const RuntimeModule &module, const StringView &name, const Value &value) {
-	auto it = module.exports.find(name);
-	if (it != module.exports.end() && it->second.second == ExternalKind::Global) {
-		if (module.globals[it->second.first]->mut) {
-			module.globals[it->second.first]->value.value = value;
-			return true;
-		}
-	}
-	return false;
-}
-
-bool ThreadedRuntime::call(const RuntimeModule &module, const Func &func, Vector<Value> &paramsInOut) {
+bool ThreadedRuntime::call(const RuntimeModule &module, const Func &func, Vector<Value> &paramsInOut, const CallLimits &limits) {
 	paramsInOut.resize(std::max(func.sig->params.size(), func.sig->results.size()));
-	if (call(module, func, paramsInOut.data())) {
+	if (call(module, func, paramsInOut.data(), limits)) {
 		paramsInOut.resize(func.sig->results.size());
 		return true;
 	}
 	return false;
 }
 
-bool ThreadedRuntime::call(const RuntimeModule &module, const Func &func, Value *paramsInOut) {
-	auto result = _mainThread.Run(module, func, paramsInOut);
+bool ThreadedRuntime::call(const RuntimeModule &module, const Func &func, Value *paramsInOut, const CallLimits &limits) {
+	auto result = run(module, func, paramsInOut, limits);
 	if (result == Thread::Result::Returned || result == Thread::Result::Ok) {
 		return true;
 	}
@@ -95,6 +47,12 @@ bool ThreadedRuntime::call(const RuntimeModule &module, const Func &func, Value
 		case Thread::Result::Returned:
 		case Thread::Result::Ok:
 			break;
+		case Thread::Result::Suspended:
+			stream << "Execution suspended: host function suspended the thread";
+			break;
+		case Thread::Result::Preempted:
+			stream << "Execution suspended: time slice is over";
+			break;
 		case Thread::Result::TrapMemoryAccessOutOfBounds:
 			stream << "Execution failed: out of bounds memory access";
 			break;
@@ -131,6 +89,18 @@ bool ThreadedRuntime::call(const RuntimeModule &module, const Func &func, Value
 		case Thread::Result::TrapUserStackExhausted:
 			stream << "Execution failed: user stack exhausted";
 			break;
+		case Thread::Result::TrapFuelExhausted:
+			stream << "Execution failed: fuel exhausted, instruction limit for the call was reached";
+			break;
+		case Thread::Result::TrapInterrupted:
+			stream << "Execution failed: interrupted, deadline for the call was reached";
+			break;
+		case Thread::Result::TrapExpectedSharedMemory:
+			stream << "Execution failed: atomic wait on unshared memory";
+			break;
+		case Thread::Result::TrapInvalidFunction:
+			stream << "Execution failed: body of lazily translated function is invalid";
+			break;
 		case Thread::Result::TrapHostResultTypeMismatch:
 			stream << "Execution failed: host result type mismatch";
 			break;
@@ -153,48 +123,103 @@ bool ThreadedRuntime::call(const RuntimeModule &module, const Func &func, Value
 	return false;
 }
 
-bool ThreadedRuntime::call(const Func &func, Vector<Value> &paramsInOut) {
+bool ThreadedRuntime::call(const Func &func, Vector<Value> &paramsInOut, const CallLimits &limits) {
 	if (auto mod = getModule(func.module)) {
-		return call(*mod, func, paramsInOut);
+		return call(*mod, func, paramsInOut, limits);
 	}
 	return false;
 }
-bool ThreadedRuntime::call(const Func &func, Value *paramsInOut) {
+bool ThreadedRuntime::call(const Func &func, Value *paramsInOut, const CallLimits &limits) {
 	if (auto mod = getModule(func.module)) {
-		return call(*mod, func, paramsInOut);
+		return call(*mod, func, paramsInOut, limits);
 	}
 	return false;
 }
 
-Thread::Result ThreadedRuntime::callSafe(const RuntimeModule &module, const Func &func, Vector<Value> &paramsInOut) {
+Thread::Result ThreadedRuntime::callSafe(const RuntimeModule &module, const Func &func, Vector<Value> &paramsInOut, const CallLimits &limits) {
 	paramsInOut.resize(std::max(func.sig->params.size(), func.sig->results.size()));
-	auto res = callSafe(module, func, paramsInOut.data());
+	auto res = callSafe(module, func, paramsInOut.data(), limits);
 	if (res == Thread::Result::Ok || res == Thread::Result::Returned) {
 		paramsInOut.resize(func.sig->results.size());
 		return res;
 	}
 	return res;
 }
-Thread::Result ThreadedRuntime::callSafe(const RuntimeModule &module, const Func &func, Value *paramsInOut) {
+Thread::Result ThreadedRuntime::callSafe(const RuntimeModule &module, const Func &func, Value *paramsInOut, const CallLimits &limits) {
 	_silent = true;
-	auto res = _mainThread.Run(module, func, paramsInOut);
+	auto res = run(module, func, paramsInOut, limits);
 	_silent = false;
 	return res;
 }
 
-Thread::Result ThreadedRuntime::callSafe(const Func &func, Vector<Value> &paramsInOut) {
+Thread::Result ThreadedRuntime::callSafe(const Func &func, Vector<Value> &paramsInOut, const CallLimits &limits) {
 	if (auto mod = getModule(func.module)) {
-		return callSafe(*mod, func, paramsInOut);
+		return callSafe(*mod, func, paramsInOut, limits);
 	}
 	return Thread::Result::TrapHostTrapped;
 }
-Thread::Result ThreadedRuntime::callSafe(const Func &func, Value *paramsInOut) {
+Thread::Result ThreadedRuntime::callSafe(const Func &func, Value *paramsInOut, const CallLimits &limits) {
 	if (auto mod = getModule(func.module)) {
-		return callSafe(*mod, func, paramsInOut);
+		return callSafe(*mod, func, paramsInOut, limits);
 	}
 	return Thread::Result::TrapHostTrapped;
 }
 
+uint64_t ThreadedRuntime::getRemainingFuel() const {
+	return _remainingFuel;
+}
+
+void ThreadedRuntime::interrupt() {
+	_mainThread.interrupt();
+}
+
+Thread &ThreadedRuntime::getMainThread() {
+	return _mainThread;
+}
+
+const Thread &ThreadedRuntime::getMainThread() const {
+	return _mainThread;
+}
+
+Thread::Result ThreadedRuntime::run(const RuntimeModule &module, const Func &func, Value *paramsInOut, const CallLimits &limits) {
+	// nested call (from host function) can not use more, then outer call has left
+	const auto outer = _mainThread.getFuel();
+	const auto limit = std::min(limits.fuel, outer);
+	_mainThread.setFuel(limit);
+
+	if (_depth == 0) {
+		// interrupt, requested while runtime was idle or after previous call was stopped, is cleared
+		_mainThread.setDeadline(Thread::kNoDeadline);
+	}
+
+	const auto outerDeadline = _mainThread.getDeadline();
+	const bool hasTimeout = limits.timeout != CallLimits::Duration::zero();
+	if (hasTimeout) {
+		_mainThread.setDeadline(std::min(outerDeadline, Watchdog::getInstance()->acquire(limits.timeout)));
+	}
+
+	++ _depth;
+	auto res = _mainThread.Run(module, func, paramsInOut);
+	-- _depth;
+
+	if (hasTimeout) {
+		Watchdog::getInstance()->release();
+	}
+
+	if (outerDeadline == Thread::kNoDeadline || _mainThread.getDeadline() != 0) {
+		// explicit interrupt should also stop outer calls, it is cleared with next top-level call
+		_mainThread.setDeadline(outerDeadline);
+	}
+
+	_remainingFuel = _mainThread.getFuel();
+	if (outer != Thread::kUnlimitedFuel) {
+		_mainThread.setFuel(outer - (limit - _remainingFuel));
+	} else {
+		_mainThread.setFuel(outer);
+	}
+	return res;
+}
+
 void ThreadedRuntime::onError(StringStream &stream) const {
 	if (!_silent) {
 		Runtime::onError(stream);
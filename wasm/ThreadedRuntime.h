@@ -27,6 +27,21 @@ struct LinkingThreadOptions : LinkingPolicy {
 	uint32_t callStackSize = Thread::kDefaultCallStackSize;
 };
 
+struct CallLimits {
+	using Duration = Watchdog::Clock::duration;
+
+	CallLimits() { }
+	CallLimits(uint64_t fuel) : fuel(fuel) { }
+	CallLimits(Duration timeout) : timeout(timeout) { }
+	CallLimits(uint64_t fuel, Duration timeout) : fuel(fuel), timeout(timeout) { }
+
+	// number of instructions, executed by call (see Features::setFuelMetering)
+	uint64_t fuel = Thread::kUnlimitedFuel;
+
+	// wall-clock time for the call, zero for no limit (see Features::setEpochInterruption)
+	Duration timeout = Duration::zero();
+};
+
 class ThreadedRuntime : public Runtime {
 public:
 	virtual ~ThreadedRuntime() { }
@@ -34,32 +49,37 @@ public:
 
 	bool init(const Environment *, const LinkingThreadOptions & = LinkingThreadOptions());
 
-	const Func *getExportFunc(const StringView &module, const StringView &name) const;
-	const Func *getExportFunc(const RuntimeModule &module, const StringView &name) const;
+	// results are stored from the beginning of paramsInOut, raw buffer should fit max(params, results) values
+	bool call(const RuntimeModule &module, const Func &, Vector<Value> &paramsInOut, const CallLimits & = CallLimits());
+	bool call(const RuntimeModule &module, const Func &, Value *paramsInOut, const CallLimits & = CallLimits());
 
-	const RuntimeGlobal *getGlobal(const StringView &module, const StringView &name) const;
-	const RuntimeGlobal *getGlobal(const RuntimeModule &module, const StringView &name) const;
+	bool call(const Func &, Vector<Value> &paramsInOut, const CallLimits & = CallLimits());
+	bool call(const Func &, Value *paramsInOut, const CallLimits & = CallLimits());
 
-	bool setGlobal(const StringView &module, const StringView &name, const Value &);
-	bool setGlobal(const RuntimeModule &module, const StringView &name, const Value &);
+	Thread::Result callSafe(const RuntimeModule &module, const Func &, Vector<Value> &paramsInOut, const CallLimits & = CallLimits());
+	Thread::Result callSafe(const RuntimeModule &module, const Func &, Value *paramsInOut, const CallLimits & = CallLimits());
 
-	bool call(const RuntimeModule &module, const Func &, Vector<Value> &paramsInOut);
-	bool call(const RuntimeModule &module, const Func &, Value *paramsInOut);
+	Thread::Result callSafe(const Func &, Vector<Value> &paramsInOut, const CallLimits & = CallLimits());
+	Thread::Result callSafe(const Func &, Value *paramsInOut, const CallLimits & = CallLimits());
 
-	bool call(const Func &, Vector<Value> &paramsInOut);
-	bool call(const Func &, Value *paramsInOut);
+	// fuel, left after last call
+	uint64_t getRemainingFuel() const;
 
-	Thread::Result callSafe(const RuntimeModule &module, const Func &, Vector<Value> &paramsInOut);
-	Thread::Result callSafe(const RuntimeModule &module, const Func &, Value *paramsInOut);
+	// can be called from any thread to stop current call with TrapInterrupted
+	void interrupt();
 
-	Thread::Result callSafe(const Func &, Vector<Value> &paramsInOut);
-	Thread::Result callSafe(const Func &, Value *paramsInOut);
+	Thread &getMainThread();
+	const Thread &getMainThread() const;
 
 	virtual void onError(StringStream &) const;
 	virtual void onThreadError(const Thread &) const;
 
 protected:
+	Thread::Result run(const RuntimeModule &module, const Func &, Value *paramsInOut, const CallLimits &);
+
 	bool _silent = false;
+	uint32_t _depth = 0; // nested calls from host functions
+	uint64_t _remainingFuel = Thread::kUnlimitedFuel;
 	Thread _mainThread;
 };
 
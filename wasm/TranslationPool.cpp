@@ -0,0 +1,137 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TranslationPool.h"
+#include "Binary.h"
+
+namespace wasm {
+
+TranslationPool::~TranslationPool() {
+	stop();
+}
+
+size_t TranslationPool::getThreads() const {
+	std::unique_lock<std::mutex> lock(_mutex);
+	return _threads.size();
+}
+
+void TranslationPool::stop() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_stopped = true;
+	auto threads = std::move(_threads);
+	lock.unlock();
+
+	_cond.notify_all();
+	for (auto &it : threads) {
+		it.join();
+	}
+}
+
+void TranslationPool::add(ModuleLazyCode *code, uint32_t threads) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_stopped) {
+		return;
+	}
+
+	_sources.emplace_back(Source{code, 0, false});
+
+	const uint32_t max = std::max(std::thread::hardware_concurrency(), 1U);
+	while (_threads.size() < std::min(threads, max)) {
+		_threads.emplace_back([this] { run(); });
+	}
+	lock.unlock();
+	_cond.notify_all();
+}
+
+void TranslationPool::remove(ModuleLazyCode *code) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (auto source = find(code)) {
+		source->removed = true;
+		while (true) {
+			source = find(code);
+			if (!source || source->active == 0) {
+				break;
+			}
+			_idle.wait(lock);
+		}
+		erase(code);
+	}
+}
+
+void TranslationPool::run() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_stopped) {
+		auto source = next();
+		if (!source) {
+			_cond.wait(lock);
+			continue;
+		}
+
+		auto code = source->code;
+		++ source->active;
+		lock.unlock();
+
+		Index idx;
+		const bool pending = code->nextPending(idx);
+		if (pending) {
+			code->translate(idx, true);
+		}
+
+		// source is not erased, while it is active
+		lock.lock();
+		source = find(code);
+		-- source->active;
+		if (!pending) {
+			source->removed = true;
+		}
+		if (source->removed && source->active == 0) {
+			erase(code);
+			_idle.notify_all();
+		}
+	}
+}
+
+// modules in turn, so every module gets threads of pool
+TranslationPool::Source *TranslationPool::next() {
+	for (size_t i = 0; i < _sources.size(); ++ i) {
+		auto &it = _sources[(_next + i) % _sources.size()];
+		if (!it.removed) {
+			_next = (_next + i + 1) % _sources.size();
+			return &it;
+		}
+	}
+	return nullptr;
+}
+
+TranslationPool::Source *TranslationPool::find(ModuleLazyCode *code) {
+	for (auto &it : _sources) {
+		if (it.code == code) {
+			return &it;
+		}
+	}
+	return nullptr;
+}
+
+void TranslationPool::erase(ModuleLazyCode *code) {
+	for (auto it = _sources.begin(); it != _sources.end(); ++ it) {
+		if (it->code == code) {
+			_sources.erase(it);
+			return;
+		}
+	}
+}
+
+}
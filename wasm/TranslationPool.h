@@ -0,0 +1,71 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRANSLATIONPOOL_H_
+#define SRC_TRANSLATIONPOOL_H_
+
+#include "Module.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace wasm {
+
+// Threads of environment for speculative translation of modules, read with ReadOptions::lazy and
+// ReadOptions::backgroundThreads. Pool is started with first such module and grows to the largest
+// backgroundThreads of modules, limited with std::thread::hardware_concurrency; threads take functions
+// of modules in turn, one function at a time.
+class TranslationPool {
+public:
+	~TranslationPool();
+
+	size_t getThreads() const;
+
+	// cancels translation (after current functions) and joins threads, modules are not translated in background after it
+	void stop();
+
+protected:
+	friend class ModuleLazyCode;
+
+	struct Source {
+		ModuleLazyCode *code;
+		uint32_t active; // threads, that translate function of module
+		bool removed; // module has no pending functions or is destroyed
+	};
+
+	void add(ModuleLazyCode *, uint32_t threads);
+
+	// waits for threads, that translate functions of module
+	void remove(ModuleLazyCode *);
+
+	void run();
+
+	Source *next();
+	Source *find(ModuleLazyCode *);
+	void erase(ModuleLazyCode *);
+
+	mutable std::mutex _mutex;
+	std::condition_variable _cond; // new sources or stop
+	std::condition_variable _idle; // source is not used by threads
+	Vector<Source> _sources;
+	size_t _next = 0;
+	bool _stopped = false;
+	Vector<std::thread> _threads;
+};
+
+}
+
+#endif /* SRC_TRANSLATIONPOOL_H_ */
@@ -57,6 +57,8 @@ static const char* GetTypeName(Type type) {
 		return "f32";
 	case Type::F64:
 		return "f64";
+	case Type::V128:
+		return "v128";
 	case Type::Anyfunc:
 		return "anyfunc";
 	case Type::Func:
@@ -69,8 +71,8 @@ static const char* GetTypeName(Type type) {
 	return "";
 }
 
-TypeChecker::Label::Label(LabelType label_type, const TypeVector& sig, size_t limit)
-: label_type(label_type), sig(sig), type_stack_limit(limit), unreachable(false) { }
+TypeChecker::Label::Label(LabelType label_type, const TypeVector& sig, size_t limit, const TypeVector& params)
+: label_type(label_type), sig(sig), params(params), type_stack_limit(limit), unreachable(false) { }
 
 TypeChecker::TypeChecker(const ErrorCallback& error_callback)
 : error_callback_(error_callback) {
@@ -118,6 +120,14 @@ void TypeChecker::PushLabel(LabelType label_type, const TypeVector& sig) {
 	label_stack_.emplace_back(label_type, sig, type_stack_.size());
 }
 
+Result TypeChecker::PushBlockLabel(LabelType label_type, const TypeVector& params, const TypeVector& sig, const char* desc) {
+	// block params are taken from enclosing stack, and become first values of block's own stack
+	Result result = PopAndCheckSignature(params, desc);
+	label_stack_.emplace_back(label_type, sig, type_stack_.size(), params);
+	PushTypes(params);
+	return result;
+}
+
 Result TypeChecker::PopLabel() {
 	label_stack_.pop_back();
 	return Result::Ok;
@@ -351,19 +361,16 @@ Result TypeChecker::OnBinary(Opcode opcode) {
 	return CheckOpcode2(opcode);
 }
 
-Result TypeChecker::OnBlock(const TypeVector* sig) {
-	PushLabel(LabelType::Block, *sig);
-	return Result::Ok;
+Result TypeChecker::OnBlock(const TypeVector* params, const TypeVector* sig) {
+	return PushBlockLabel(LabelType::Block, *params, *sig, "block");
 }
 
 Result TypeChecker::OnBr(Index depth) {
 	Result result = Result::Ok;
 	Label* label;
 	CHECK_RESULT(GetLabel(depth, &label));
-	if (label->label_type != LabelType::Loop) {
-		result = result | CheckSignature(label->sig);
-	}
-	PrintStackIfFailed(result, "br", label->sig);
+	result = result | CheckSignature(label->branch_sig());
+	PrintStackIfFailed(result, "br", label->branch_sig());
 	CHECK_RESULT(SetUnreachable());
 	return result;
 }
@@ -372,15 +379,13 @@ Result TypeChecker::OnBrIf(Index depth) {
 	Result result = PopAndCheck1Type(Type::I32, "br_if");
 	Label* label;
 	CHECK_RESULT(GetLabel(depth, &label));
-	if (label->label_type != LabelType::Loop) {
-		result = result | PopAndCheckSignature(label->sig, "br_if");
-		PushTypes(label->sig);
-	}
+	result = result | PopAndCheckSignature(label->branch_sig(), "br_if");
+	PushTypes(label->branch_sig());
 	return result;
 }
 
 Result TypeChecker::BeginBrTable() {
-	br_table_sig_ = Type::Any;
+	br_table_sig_ = nullptr;
 	return PopAndCheck1Type(Type::I32, "br_table");
 }
 
@@ -388,27 +393,29 @@ Result TypeChecker::OnBrTableTarget(Index depth) {
 	Result result = Result::Ok;
 	Label* label;
 	CHECK_RESULT(GetLabel(depth, &label));
-	Type label_sig;
-	if (label->label_type == LabelType::Loop) {
-		label_sig = Type::Void;
-	} else {
-		assert(label->sig.size() <= 1);
-		label_sig = label->sig.size() == 0 ? Type::Void : label->sig[0];
-
-		result = result | CheckSignature(label->sig);
-		PrintStackIfFailed(result, "br_table", label_sig);
-	}
+	const TypeVector& label_sig = label->branch_sig();
+	result = result | CheckSignature(label_sig);
+	PrintStackIfFailed(result, "br_table", label_sig);
 
 	// Make sure this label's signature is consistent with the previous labels'
 	// signatures.
-	if (Failed(CheckType(br_table_sig_, label_sig))) {
+	if (br_table_sig_ && *br_table_sig_ != label_sig) {
 		result = result | Result::Error;
 		PushErrorStream([&] (StringStream &stream) {
-			stream << "br_table labels have inconsistent types: expected " << GetTypeName(br_table_sig_)
-				<< ", got " << GetTypeName(label_sig);
+			auto printSig = [&] (const TypeVector &sig) {
+				stream << "[";
+				for (size_t i = 0; i < sig.size(); ++ i) {
+					stream << (i == 0 ? "" : ", ") << GetTypeName(sig[i]);
+				}
+				stream << "]";
+			};
+			stream << "br_table labels have inconsistent types: expected ";
+			printSig(*br_table_sig_);
+			stream << ", got ";
+			printSig(label_sig);
 		});
 	}
-	br_table_sig_ = label_sig;
+	br_table_sig_ = &label_sig;
 
 	return result;
 }
@@ -480,6 +487,7 @@ Result TypeChecker::OnElse() {
 	result = result | PopAndCheckSignature(label->sig, "if true branch");
 	result = result | CheckTypeStackEnd("if true branch");
 	ResetTypeStackToLabel(label);
+	PushTypes(label->params);
 	label->label_type = LabelType::Else;
 	label->unreachable = false;
 	return result;
@@ -505,7 +513,7 @@ Result TypeChecker::OnEnd() {
 	CHECK_RESULT(TopLabel(&label));
 	assert(static_cast<int>(label->label_type) < kLabelTypeCount);
 	if (label->label_type == LabelType::If) {
-		if (label->sig.size() != 0) {
+		if (label->sig != label->params) {
 			PushErrorStream([&] (StringStream &stream) {
 				stream << "if without else cannot have type signature.";
 			});
@@ -521,9 +529,9 @@ Result TypeChecker::OnGrowMemory() {
 	return CheckOpcode1(Opcode::GrowMemory);
 }
 
-Result TypeChecker::OnIf(const TypeVector* sig) {
+Result TypeChecker::OnIf(const TypeVector* params, const TypeVector* sig) {
 	Result result = PopAndCheck1Type(Type::I32, "if");
-	PushLabel(LabelType::If, *sig);
+	result = result | PushBlockLabel(LabelType::If, *params, *sig, "if");
 	return result;
 }
 
@@ -541,9 +549,20 @@ Result TypeChecker::OnLoad(Opcode opcode) {
 	return CheckOpcode1(opcode);
 }
 
-Result TypeChecker::OnLoop(const TypeVector* sig) {
-	PushLabel(LabelType::Loop, *sig);
-	return Result::Ok;
+Result TypeChecker::OnLoop(const TypeVector* params, const TypeVector* sig) {
+	return PushBlockLabel(LabelType::Loop, *params, *sig, "loop");
+}
+
+Result TypeChecker::OnMemoryCopy() {
+	return CheckOpcode3(Opcode::MemoryCopy);
+}
+
+Result TypeChecker::OnMemoryFill() {
+	return CheckOpcode3(Opcode::MemoryFill);
+}
+
+Result TypeChecker::OnMemoryInit() {
+	return CheckOpcode3(Opcode::MemoryInit);
 }
 
 Result TypeChecker::OnRethrow(Index depth) {
@@ -577,6 +596,10 @@ Result TypeChecker::OnRethrow(Index depth) {
 	return result;
 }
 
+Result TypeChecker::OnTernary(Opcode opcode) {
+	return CheckOpcode3(opcode);
+}
+
 Result TypeChecker::OnThrow(const TypeVector* sig) {
 	Result result = Result::Ok;
 	result = result | PopAndCheckSignature(*sig, "throw");
@@ -593,6 +616,27 @@ Result TypeChecker::OnReturn() {
 	return result;
 }
 
+Result TypeChecker::OnReturnCall(const TypeVector* param_types,
+		const TypeVector* result_types) {
+	Label* func_label;
+	CHECK_RESULT(GetLabel(label_stack_.size() - 1, &func_label));
+	Result result = PopAndCheckCall(*param_types, *result_types, "return_call");
+	if (*result_types != func_label->sig) {
+		result = result | Result::Error;
+		PushErrorStream([&] (StringStream &stream) {
+			stream << "return_call: callee results should match results of caller";
+		});
+	}
+	CHECK_RESULT(SetUnreachable());
+	return result;
+}
+
+Result TypeChecker::OnReturnCallIndirect(const TypeVector* param_types,
+		const TypeVector* result_types) {
+	Result result = PopAndCheck1Type(Type::I32, "return_call_indirect");
+	return result | OnReturnCall(param_types, result_types);
+}
+
 Result TypeChecker::OnSelect() {
 	Result result = Result::Ok;
 	Type type = Type::Any;
@@ -613,6 +657,13 @@ Result TypeChecker::OnSetLocal(Type type) {
 	return PopAndCheck1Type(type, "set_local");
 }
 
+Result TypeChecker::OnSimdLaneOp(Opcode opcode) {
+	if (opcode.GetParamType2() == Type::Void) {
+		return CheckOpcode1(opcode);
+	}
+	return CheckOpcode2(opcode);
+}
+
 Result TypeChecker::OnStore(Opcode opcode) {
 	return CheckOpcode2(opcode);
 }
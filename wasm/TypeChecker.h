@@ -27,10 +27,16 @@ public:
 	using ErrorCallback = Function<void (StringStream &msg)>;
 
 	struct Label {
-		Label(LabelType, const TypeVector& sig, size_t limit);
+		Label(LabelType, const TypeVector& sig, size_t limit, const TypeVector& params = TypeVector());
+
+		// types, passed by branch to this label: params for loop, results for others
+		const TypeVector& branch_sig() const {
+			return label_type == LabelType::Loop ? params : sig;
+		}
 
 		LabelType label_type;
 		TypeVector sig;
+		TypeVector params;
 		size_t type_stack_limit;
 		bool unreachable;
 	};
@@ -57,7 +63,7 @@ public:
 	Result OnAtomicWait(Opcode);
 	Result OnAtomicWake(Opcode);
 	Result OnBinary(Opcode);
-	Result OnBlock(const TypeVector* sig);
+	Result OnBlock(const TypeVector* params, const TypeVector* sig);
 	Result OnBr(Index depth);
 	Result OnBrIf(Index depth);
 	Result BeginBrTable();
@@ -77,16 +83,23 @@ public:
 	Result OnGetGlobal(Type);
 	Result OnGetLocal(Type);
 	Result OnGrowMemory();
-	Result OnIf(const TypeVector* sig);
+	Result OnIf(const TypeVector* params, const TypeVector* sig);
 	Result OnLoad(Opcode);
-	Result OnLoop(const TypeVector* sig);
+	Result OnLoop(const TypeVector* params, const TypeVector* sig);
+	Result OnMemoryCopy();
+	Result OnMemoryFill();
+	Result OnMemoryInit();
 	Result OnRethrow(Index depth);
 	Result OnReturn();
+	Result OnReturnCall(const TypeVector* param_types, const TypeVector* result_types);
+	Result OnReturnCallIndirect(const TypeVector* param_types, const TypeVector* result_types);
 	Result OnSelect();
 	Result OnSetGlobal(Type);
 	Result OnSetLocal(Type);
+	Result OnSimdLaneOp(Opcode);
 	Result OnStore(Opcode);
 	Result OnTeeLocal(Type);
+	Result OnTernary(Opcode);
 	Result OnThrow(const TypeVector* sig);
 	Result OnTryBlock(const TypeVector* sig);
 	Result OnUnary(Opcode);
@@ -101,6 +114,7 @@ private:
 	void ResetTypeStackToLabel(Label* label);
 	Result SetUnreachable();
 	void PushLabel(LabelType label_type, const TypeVector& sig);
+	Result PushBlockLabel(LabelType label_type, const TypeVector& params, const TypeVector& sig, const char* desc);
 	Result PopLabel();
 	Result CheckLabelType(Label* label, LabelType label_type);
 	Result PeekType(Index depth, Type* out_type);
@@ -135,7 +149,7 @@ private:
 	ErrorCallback error_callback_;
 	TypeVector type_stack_;
 	Vector<Label> label_stack_;
-	Type br_table_sig_ = Type::Void;
+	const TypeVector* br_table_sig_ = nullptr;
 };
 
 }
@@ -33,6 +33,7 @@ namespace wasm {
 enum class Result {
 	Ok,
 	Error,
+	Suspend, // host function only: suspend calling thread until Thread::Resume
 };
 
 inline Result operator|(Result lhs, Result rhs) {
@@ -78,9 +79,10 @@ enum class BinarySection {
 	Elem = 9,
 	Code = 10,
 	Data = 11,
+	DataCount = 12,
 	Invalid,
 	First = Custom,
-	Last = Data,
+	Last = DataCount,
 };
 
 /* matches binary format, do not change */
@@ -89,6 +91,7 @@ enum class Type {
 	I64 = -0x02,
 	F32 = -0x03,
 	F64 = -0x04,
+	V128 = -0x05,
 	Anyfunc = -0x10,
 	Func = -0x20,
 	Void = -0x40,
@@ -143,25 +146,59 @@ public:
 		_exceptionsEnabled = true;
 		_satFloatToIntEnabled = true;
 		_threadsEnabled = true;
+		_tailCallEnabled = true;
+		_multiValueEnabled = true;
+		_bulkMemoryEnabled = true;
+		_simdEnabled = true;
 		_script_stackPointerEnabled = true;
+		_script_boundsCheckHoistingEnabled = true;
+		_script_fuelMeteringEnabled = true;
+		_script_epochInterruptionEnabled = true;
 	}
 
 	bool isExceptionsEnabled() const { return _exceptionsEnabled; }
 	bool isSatFloatToIntEnabled() const { return _satFloatToIntEnabled; }
 	bool isThreadsEnabled() const { return _threadsEnabled; }
+	bool isTailCallEnabled() const { return _tailCallEnabled; }
+	bool isMultiValueEnabled() const { return _multiValueEnabled; }
+	bool isBulkMemoryEnabled() const { return _bulkMemoryEnabled; }
+	bool isSimdEnabled() const { return _simdEnabled; }
 	bool isStackPointerEnabled() const { return _script_stackPointerEnabled; }
+	bool isBoundsCheckHoistingEnabled() const { return _script_boundsCheckHoistingEnabled; }
+	bool isFuelMeteringEnabled() const { return _script_fuelMeteringEnabled; }
+	bool isEpochInterruptionEnabled() const { return _script_epochInterruptionEnabled; }
 
 	void setExceptionsEnabled(bool value) { _exceptionsEnabled = value; }
 	void setSatFloatToIntEnabled(bool value) { _satFloatToIntEnabled = value; }
 	void setThreadsEnabled(bool value) { _threadsEnabled = value; }
+	void setTailCallEnabled(bool value) { _tailCallEnabled = value; }
+	void setMultiValueEnabled(bool value) { _multiValueEnabled = value; }
+	void setBulkMemoryEnabled(bool value) { _bulkMemoryEnabled = value; }
+	void setSimdEnabled(bool value) { _simdEnabled = value; }
 	void setStackPointer(bool value) { _script_stackPointerEnabled = value; }
+	void setBoundsCheckHoisting(bool value) { _script_boundsCheckHoistingEnabled = value; }
+	void setFuelMetering(bool value) { _script_fuelMeteringEnabled = value; }
+	void setEpochInterruption(bool value) { _script_epochInterruptionEnabled = value; }
 
 private:
 	bool _exceptionsEnabled = false;
 	bool _satFloatToIntEnabled = false;
 	bool _threadsEnabled = false;
+	bool _tailCallEnabled = false;
+	bool _multiValueEnabled = false;
+	bool _bulkMemoryEnabled = false;
+	bool _simdEnabled = false;
 
 	bool _script_stackPointerEnabled = false;
+
+	// replace per-access bounds checks in simple counted loops with one range check before the loop
+	bool _script_boundsCheckHoistingEnabled = false;
+
+	// charge instruction count of every basic block against Thread's fuel
+	bool _script_fuelMeteringEnabled = false;
+
+	// check Thread's deadline against Watchdog epoch on every loop iteration
+	bool _script_epochInterruptionEnabled = false;
 };
 
 struct ReadOptions {
@@ -172,6 +209,24 @@ struct ReadOptions {
 	Features features;
 	bool read_debug_names = false;
 	bool stop_on_first_error = true;
+
+	// threads for validation and translation of function bodies, 0 for std::thread::hardware_concurrency;
+	// small code sections are always read on calling thread
+	uint32_t threads = 0;
+
+	// function bodies are validated and translated on first call instead of load, module data is not copied
+	// and should outlive module; invalid body traps with TrapInvalidFunction
+	bool lazy = false;
+
+	// with lazy: threads of TranslationPool of environment, that translate functions speculatively after load
+	// (start and exported functions first, then their callees by call distance, then others); pool is shared
+	// by modules and limited with hardware concurrency; 0 - only on first call
+	uint32_t backgroundThreads = 0;
+};
+
+struct V128 {
+	uint64_t lo;
+	uint64_t hi;
 };
 
 template <typename T>
@@ -183,6 +238,7 @@ template <> struct ValueTypeRepT<int64_t> { typedef uint64_t type; };
 template <> struct ValueTypeRepT<uint64_t> { typedef uint64_t type; };
 template <> struct ValueTypeRepT<float> { typedef uint32_t type; };
 template <> struct ValueTypeRepT<double> { typedef uint64_t type; };
+template <> struct ValueTypeRepT<V128> { typedef V128 type; };
 
 template <typename T>
 using ValueTypeRep = typename ValueTypeRepT<T>::type;
@@ -192,6 +248,7 @@ union Value {
 	uint64_t i64;
 	ValueTypeRep<float> f32_bits;
 	ValueTypeRep<double> f64_bits;
+	ValueTypeRep<V128> v128_bits;
 
 	Value() = default;
 	Value(const Value &) = default;
@@ -203,6 +260,7 @@ union Value {
 	Value(int64_t value) { memcpy(&i64, &value, sizeof(int64_t)); }
 	Value(float value) { memcpy(&f32_bits, &value, sizeof(float)); }
 	Value(double value) { memcpy(&f64_bits, &value, sizeof(double)); }
+	Value(const V128 &value) : v128_bits(value) { }
 
 	float asFloat() { float ret; memcpy(&ret, &f32_bits, sizeof(float)); return ret; }
 	double asDouble() { double ret; memcpy(&ret, &f64_bits, sizeof(double)); return ret; }
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2017 Roman Katuntsev <sbkarr@stappler.org>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_WORKSTEALINGDEQUE_H_
+#define SRC_WORKSTEALINGDEQUE_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace wasm {
+
+// Chase-Lev work-stealing deque (Le, Pop, Cohen, Nardelli, "Correct and Efficient Work-Stealing
+// for Weak Memory Models", 2013). Owner thread pushes and pops at bottom, any other thread
+// can steal from top. T should be trivially copyable (pointer); nullptr-like T() means empty.
+template <typename T>
+class WorkStealingDeque {
+public:
+	explicit WorkStealingDeque(size_t capacity = 256) {
+		size_t size = 1;
+		while (size < capacity) {
+			size <<= 1;
+		}
+		_arrays.emplace_back(new Array(size));
+		_array.store(_arrays.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkStealingDeque(const WorkStealingDeque &) = delete;
+	WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+	// owner only
+	void push(T value) {
+		int64_t b = _bottom.load(std::memory_order_relaxed);
+		int64_t t = _top.load(std::memory_order_acquire);
+		Array *a = _array.load(std::memory_order_relaxed);
+		if (b - t > int64_t(a->mask)) {
+			a = grow(a, t, b);
+		}
+		a->put(b, value);
+		std::atomic_thread_fence(std::memory_order_release);
+		_bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	// owner only
+	T pop() {
+		int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+		Array *a = _array.load(std::memory_order_relaxed);
+		_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = _top.load(std::memory_order_relaxed);
+
+		T ret = T();
+		if (t <= b) {
+			ret = a->get(b);
+			if (t == b) {
+				// last element, race with thieves
+				if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					ret = T();
+				}
+				_bottom.store(b + 1, std::memory_order_relaxed);
+			}
+		} else {
+			_bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return ret;
+	}
+
+	// any thread; returns T() when deque is empty or when lost race with other thief or owner
+	T steal() {
+		int64_t t = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = _bottom.load(std::memory_order_acquire);
+
+		if (t < b) {
+			Array *a = _array.load(std::memory_order_acquire);
+			T ret = a->get(t);
+			if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				return T();
+			}
+			return ret;
+		}
+		return T();
+	}
+
+	bool empty() const {
+		return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct Array {
+		explicit Array(size_t size) : mask(size - 1), data(new std::atomic<T>[size]) { }
+
+		T get(int64_t i) const { return data[i & mask].load(std::memory_order_relaxed); }
+		void put(int64_t i, T value) { data[i & mask].store(value, std::memory_order_relaxed); }
+
+		size_t mask;
+		std::unique_ptr<std::atomic<T>[]> data;
+	};
+
+	Array *grow(Array *a, int64_t t, int64_t b) {
+		// old arrays are kept alive, until deque is destroyed, because thieves can still read them
+		auto next = new Array((a->mask + 1) * 2);
+		for (int64_t i = t; i < b; ++ i) {
+			next->put(i, a->get(i));
+		}
+		_arrays.emplace_back(next);
+		_array.store(next, std::memory_order_release);
+		return next;
+	}
+
+	alignas(64) std::atomic<int64_t> _top = ATOMIC_VAR_INIT(0);
+	alignas(64) std::atomic<int64_t> _bottom = ATOMIC_VAR_INIT(0);
+	std::atomic<Array *> _array;
+	std::vector<std::unique_ptr<Array>> _arrays; // owner only
+};
+
+}
+
+#endif /* SRC_WORKSTEALINGDEQUE_H_ */